@@ -5,10 +5,12 @@ set PATH=C:\msys64\ucrt64\bin;C:\msys64\usr\bin;%PATH%
 
 setlocal enabledelayedexpansion
 set PACKAGE=0
+set TEST=0
 
-REM Parse parameters for -upakuj flag
+REM Parse parameters for -upakuj and -testiraj flags
 for %%A in (%*) do (
     if "%%A"=="-upakuj" set PACKAGE=1
+    if "%%A"=="-testiraj" set TEST=1
 )
 
 :start_build
@@ -24,10 +26,11 @@ echo.
 echo Compiling CSV++ (64-bit)...
 echo.
 
-REM Compile using MSYS2 environment with direct include/library paths
+REM Compile using MSYS2 environment with direct include/library paths.
+REM -O2 lets the compiler vectorise the plain loops of the expression kernels.
 echo Attempting build with wxWidgets...
 
-C:\msys64\ucrt64\bin\g++.exe -o CSVPlusPlus.exe src/main.cpp src/MainFrame.cpp src/CSVParser.cpp src/CSVOptionsDialog.cpp src/Translations.cpp app.res ^
+C:\msys64\ucrt64\bin\g++.exe -o CSVPlusPlus.exe src/main.cpp src/MainFrame.cpp src/CSVParser.cpp src/CSVOptionsDialog.cpp src/Translations.cpp src/EditJournal.cpp src/WorkerPool.cpp src/MappedFile.cpp src/CSVTable.cpp src/MemoryBudget.cpp src/CSVDocument.cpp src/CSVDiff.cpp src/DiffFrame.cpp src/CompareDialog.cpp src/CommandLine.cpp src/Snapshot.cpp src/GridClipboard.cpp src/Profiler.cpp src/PerformanceFrame.cpp src/StringDictionary.cpp src/Compression.cpp src/ColumnExpression.cpp src/ComputedColumnDialog.cpp src/TableQuery.cpp src/PivotTable.cpp src/PivotFrame.cpp src/CSVJoin.cpp src/MergeDialog.cpp src/Deduplicator.cpp src/DuplicatesDialog.cpp src/CSVSplitter.cpp src/SplitDialog.cpp src/ConcatDialog.cpp src/CSVValidator.cpp src/ValidateDialog.cpp src/ShardSource.cpp src/OpenFolderDialog.cpp src/ColumnTransform.cpp src/ColumnTransformDialog.cpp src/LargeCellRenderer.cpp src/CellViewerDialog.cpp app.res ^
     -Iinclude ^
     -IC:/msys64/ucrt64/include/wx-3.2 ^
     -IC:/msys64/ucrt64/lib/wx/include/msw-unicode-3.2 ^
@@ -38,6 +41,7 @@ C:\msys64\ucrt64\bin\g++.exe -o CSVPlusPlus.exe src/main.cpp src/MainFrame.cpp s
     -fexec-charset=UTF-8 ^
     -finput-charset=UTF-8 ^
     -std=c++17 ^
+    -O2 ^
     -mwindows ^
     -static-libgcc ^
     -static-libstdc++ ^
@@ -68,7 +72,10 @@ C:\msys64\ucrt64\bin\g++.exe -o CSVPlusPlus.exe src/main.cpp src/MainFrame.cpp s
     -ladvapi32 ^
     -lversion ^
     -luxtheme ^
-    -loleacc
+    -loleacc ^
+    -lzstd ^
+    -lz ^
+    -llzma
 
 if %errorlevel% == 0 (
     echo Dynamic build successful!
@@ -79,6 +86,53 @@ if %errorlevel% == 0 (
     exit /b 1
 )
 
+:test_check
+if !TEST! equ 1 (
+    for %%T in (RecordSplitTest FieldBufferTest LoadSaveBenchmark AllocationBenchmark) do (
+        echo.
+        echo Compiling %%T...
+        C:\msys64\ucrt64\bin\g++.exe -o %%T.exe tests/%%T.cpp src/CSVParser.cpp src/MappedFile.cpp src/Compression.cpp src/WorkerPool.cpp src/Profiler.cpp ^
+            -Iinclude ^
+            -IC:/msys64/ucrt64/include/wx-3.2 ^
+            -IC:/msys64/ucrt64/lib/wx/include/msw-unicode-3.2 ^
+            -D__WXMSW__ ^
+            -DUNICODE ^
+            -D_UNICODE ^
+            -fexec-charset=UTF-8 ^
+            -finput-charset=UTF-8 ^
+            -std=c++17 ^
+            -O2 ^
+            -static-libgcc ^
+            -static-libstdc++ ^
+            -LC:/msys64/ucrt64/lib ^
+            -lwx_mswu_core-3.2 ^
+            -lwx_baseu-3.2 ^
+            -lkernel32 ^
+            -luser32 ^
+            -lgdi32 ^
+            -lshell32 ^
+            -lole32 ^
+            -luuid ^
+            -ladvapi32 ^
+            -lzstd ^
+            -lz ^
+            -llzma
+        if not !errorlevel! == 0 (
+            echo Test build failed!
+            pause
+            exit /b 1
+        )
+        
+        echo Running %%T...
+        %%T.exe
+        if not !errorlevel! == 0 (
+            echo Tests failed!
+            pause
+            exit /b 1
+        )
+    )
+)
+
 :package_check
 if !PACKAGE! equ 1 (
     echo.
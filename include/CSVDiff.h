@@ -0,0 +1,97 @@
+#ifndef CSVDIFF_H
+#define CSVDIFF_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include "CSVParser.h"
+#include "MappedFile.h"
+
+// Compares two CSV files row by row. Both files are streamed through the
+// parser and reduced to per-row hashes and byte offsets, so memory grows
+// with the row count rather than the data size. Rows are matched by the
+// chosen key columns, or by their whole content when no key is given.
+class CSVDiff {
+public:
+    enum Side {
+        LEFT = 0,
+        RIGHT = 1
+    };
+    
+    enum class Change {
+        Added,
+        Removed,
+        Modified
+    };
+    
+    struct Input {
+        wxString filename;
+        Encoding encoding;
+        wxChar separator;
+        bool hasHeader;
+    };
+    
+    // One differing row, the missing side is -1
+    struct Entry {
+        Change change;
+        long long leftRow;
+        long long rightRow;
+    };
+    
+    CSVDiff();
+    
+    // Fill an input with the encoding and separator detected from the file
+    static bool DetectInput(const wxString& filename, bool hasHeader, Input& input);
+    
+    // Key columns are header names or 1-based column numbers, comma separated.
+    // Progress is reported in percent.
+    bool Compare(const Input& left, const Input& right, const wxString& keyColumns,
+                 wxString& error, const std::function<void(int)>& progress = nullptr);
+    
+    const std::vector<Entry>& GetEntries() const { return entries; }
+    const Input& GetInput(Side side) const { return files[side].input; }
+    size_t GetCount(Change change) const;
+    size_t GetRowCount(Side side) const { return files[side].rows.size(); }
+    size_t GetColumnCount(Side side) const { return files[side].columns; }
+    const std::vector<wxString>& GetHeader(Side side) const { return files[side].header; }
+    bool IsKeyed() const { return !files[LEFT].keyColumns.empty(); }
+    
+    // Re-parse one row of either file from its offset
+    bool GetRow(Side side, long long row, std::vector<wxString>& fields) const;
+    
+    // Key columns given as header names or 1-based column numbers, comma
+    // separated, to column indices
+    static bool ResolveKeyColumns(const wxString& spec, const std::vector<wxString>& header,
+                                  std::vector<int>& columns, wxString& error);
+    
+    // Columns whose values differ between two rows
+    static std::vector<int> GetChangedCells(const std::vector<wxString>& left,
+                                            const std::vector<wxString>& right);
+
+private:
+    struct RowRecord {
+        uint64_t key;
+        uint64_t hash;
+        long long offset;
+    };
+    
+    struct File {
+        Input input;
+        std::unique_ptr<MappedFile> mapping;
+        std::vector<RowRecord> rows;
+        std::vector<wxString> header;
+        std::vector<int> keyColumns;
+        size_t columns;
+    };
+    
+    File files[2];
+    std::vector<Entry> entries;
+    
+    bool ScanFile(File& file, const wxString& keyColumns, wxString& error,
+                  const std::function<void(int)>& progress, int progressBase);
+    static std::vector<uint32_t> SortByKey(const std::vector<RowRecord>& rows);
+};
+
+#endif // CSVDIFF_H
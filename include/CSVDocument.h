@@ -0,0 +1,205 @@
+#ifndef CSVDOCUMENT_H
+#define CSVDOCUMENT_H
+
+#include <wx/wx.h>
+#include <wx/grid.h>
+#include <deque>
+#include <memory>
+#include <functional>
+#include "CSVParser.h"
+#include "CSVTable.h"
+#include "EditJournal.h"
+#include "Deduplicator.h"
+#include "ColumnTransform.h"
+#include "GridClipboard.h"
+#include "Translations.h"
+
+// One entry of the undo history. Pastes keep only the rectangle they
+// overwrote, so undoing a paste costs memory proportional to the pasted
+// cells. A computed column keeps only its expression and is recomputed when
+// redone. Deleting rows or columns keeps only what was deleted, inserting
+// them only where, and a column transform only the cells it changed.
+struct UndoStep {
+    enum Kind {
+        CELLS,
+        COLUMNS,
+        ROWS,
+        TRANSFORM,
+        INSERT_ROWS,
+        INSERT_COLUMNS,
+        DELETE_COLUMNS,
+        HEADER
+    };
+    
+    Kind kind;
+    int top;                        // CELLS: rectangle, values row by row, INSERT_ROWS: position
+    int left;                       // COLUMNS: position of the computed column, TRANSFORM and HEADER:
+                                    // the column, INSERT_COLUMNS: position
+    int rows;                       // INSERT_ROWS: count, DELETE_COLUMNS: rows of each deleted column
+    int cols;                       // ROWS: columns of each deleted row, TRANSFORM: split parts,
+                                    // INSERT_COLUMNS: count
+    CSVTable::RangeList ranges;     // ROWS: deleted rows, TRANSFORM: changed rows, values row by row,
+                                    // DELETE_COLUMNS: deleted columns, values column by column
+    int addedRows;                  // rows and columns appended to fit the cells
+    int addedCols;
+    std::vector<wxString> values;
+    wxString label;                 // COLUMNS: name, empty for the default label, HEADER: label to set
+    wxString expression;            // COLUMNS: formula, TRANSFORM: the encoded ColumnTransform
+    bool headerRow;                 // HEADER: whether the table has a header row after the step
+    std::vector<wxString> labels;   // DELETE_COLUMNS: labels and widths of the deleted columns
+    std::vector<int> widths;
+};
+
+// One open file: its grid, data store, file settings, undo history and
+// edit journal. Documents live as pages of the main window's notebook.
+class CSVDocument : public wxPanel {
+public:
+    CSVDocument(wxWindow* parent, int fontSize, Language language);
+    virtual ~CSVDocument();
+    
+    wxGrid* GetGrid() const { return grid; }
+    CSVTable* GetTable() const { return table; }
+    
+    // File state
+    const wxString& GetFile() const { return currentFile; }
+    Encoding GetEncoding() const { return currentEncoding; }
+    wxChar GetSeparator() const { return currentSeparator; }
+    bool IsDirty() const { return isDirty; }
+    bool HasHeaderRow() const { return hasHeaderRow; }
+    const std::vector<int>& GetLoadedColumns() const { return loadedColumns; }
+    bool IsRestoringState() const { return isRestoringState; }
+    void SetDirty(bool dirty) { isDirty = dirty; }
+    wxString GetDisplayName() const;
+    
+    // An untitled document nobody has touched can be replaced by an opened file
+    bool IsUntouched() const;
+    
+    // File operations
+    // columns selects source columns to load (ascending), empty loads all
+    bool LoadFile(const wxString& filename, Encoding encoding, wxChar separator, bool hasHeader,
+                  const std::vector<int>& columns = std::vector<int>());
+    // Several files of the same layout as one untitled table, a first column
+    // naming each row's file. Name is shown on the tab, e.g. the pattern the
+    // files were found by. Save As writes the combined rows.
+    bool LoadShards(const wxArrayString& files, const wxString& name, Encoding encoding, wxChar separator,
+                    bool hasHeader, const std::vector<int>& columns, wxString& error,
+                    const std::function<void(int)>& progress = nullptr);
+    bool SaveFile(const wxString& filename);
+    void NewFile(int rows, int cols);
+    void CloseFile();
+    // Show a query result as an untitled, unsaved table that exports in the
+    // given dialect with its labels as the header row. Takes ownership.
+    void ShowQueryResult(CSVTable* result, Encoding encoding, wxChar separator);
+    
+    // Edit operations, all recorded in the undo history and the journal
+    void AddRowBelow();
+    void AddRowAbove();
+    void AddColumnLeft();
+    void AddColumnRight();
+    void DeleteSelectedRows();
+    void DeleteSelectedColumns();
+    void RenameColumn(int col, const wxString& label);
+    // New column right of the cursor holding an expression's value per row,
+    // false with a message when the expression does not compile
+    bool InsertComputedColumn(const wxString& name, const wxString& expression, wxString& error);
+    // Rows repeating another row on the columns (all when empty), keeping
+    // the first or last copy. Select marks them, Remove deletes them as one
+    // undo step. Both return how many rows there were.
+    size_t SelectDuplicates(const std::vector<int>& columns, Deduplicator::Keep keep);
+    size_t RemoveDuplicates(const std::vector<int>& columns, Deduplicator::Keep keep);
+    // Clean up a column as one undo step that keeps only the cells it
+    // changed. A split fills new columns right of it instead. False when
+    // nothing changes.
+    bool TransformColumn(int col, const ColumnTransform& transform);
+    std::vector<wxString> GetColumnNames() const;
+    void SetFormat(Encoding encoding, wxChar separator);
+    // The in-place editor opens on a cell, before its value changes
+    void PrepareCellEdit();
+    // The in-place editor changed a cell, an undo step keeps only its previous value
+    void CellChanged(int row, int col, const wxString& previous);
+    // Set one cell as an undo step keeping only its previous value, for
+    // edits made outside the grid's in-place editor
+    void SetCell(int row, int col, const wxString& value);
+    bool IsLargeCell(int row, int col) const;
+    
+    // Clipboard. Copy covers the bounding box of the selection (or the
+    // cursor cell), Paste writes parsed text at the top left of it.
+    std::shared_ptr<ClipboardCopy> Copy();
+    bool Paste(const wxString& text);
+    
+    // Undo/redo
+    bool CanUndo() const { return !undoStack.empty(); }
+    bool CanRedo() const { return !redoStack.empty(); }
+    void Undo();
+    void Redo();
+    
+    // Display settings shared by all documents
+    void SetFontSize(int fontSize);
+    void SetLanguage(Language language) { currentLanguage = language; }
+    
+    // Crash recovery
+    void StopJournal(bool discard) { journal.Stop(discard); }
+    const wxString& GetJournalPath() const { return journal.GetPath(); }
+    // True once after the journal could not be written
+    bool TakeJournalFailure() { return journal.TakeFailure(); }
+    bool Recover(const wxString& path, const JournalHeader& header, const std::vector<JournalEntry>& entries,
+                 wxFileOffset validLength);
+
+private:
+    wxGrid* grid;
+    CSVTable* table;
+    int currentFontSize;
+    Language currentLanguage;
+    
+    // File state
+    wxString currentFile;
+    Encoding currentEncoding;
+    wxChar currentSeparator;
+    bool isDirty;
+    bool hasHeaderRow;
+    bool isRestoringState;
+    std::vector<int> loadedColumns;   // source columns when only some were loaded
+    
+    // Undo/redo
+    std::deque<UndoStep> undoStack;
+    std::deque<UndoStep> redoStack;
+    const size_t MAX_UNDO_LEVELS = 50;
+    
+    // Last copy, rendered before its cells change
+    std::shared_ptr<ClipboardCopy> pendingCopy;
+    
+    // Crash recovery
+    EditJournal journal;
+    
+    void AttachTable(CSVTable* newTable);
+    void InsertColumns(int pos, int count);
+    static CSVTable::RangeList ToRanges(const wxArrayInt& indices);
+    static CSVTable::RangeList ToRanges(const std::vector<size_t>& sorted);
+    bool LoadSnapshot(const wxString& filename);
+    void ApplyStep(UndoStep& step, bool undo);
+    void ApplyColumnStep(UndoStep& step, bool undo);
+    void ApplyRowStep(UndoStep& step, bool undo);
+    void ApplyTransformStep(UndoStep& step, bool undo);
+    void ApplyInsertStep(UndoStep& step, bool undo);
+    void ApplyDeleteColumnStep(UndoStep& step, bool undo);
+    void ApplyHeaderStep(UndoStep& step);
+    // Apply a new edit's step and make it the one to undo
+    void ApplyNewStep(UndoStep& step);
+    bool FillComputedColumn(int col, const wxString& expression, wxString& error);
+    void PushStep(std::deque<UndoStep>& stack, UndoStep& step);
+    void DropRedo();
+    void ClearHistory();
+    void PasteCells(int top, int left, std::vector<std::vector<wxString>>& rows);
+    void ReleaseCopy();
+    void ApplyGridDimensions();
+    void AutoSizeColumns();
+    int GetDefaultColumnWidth() const;
+    void CreateEmptyGrid(int rows, int cols);
+    wxString GetDefaultColumnLabel(int col) const;
+    
+    // Edit journal helpers
+    void StartJournal(int initialRows = 0, int initialCols = 0);
+    void ApplyJournalEntry(const JournalEntry& entry);
+};
+
+#endif // CSVDOCUMENT_H
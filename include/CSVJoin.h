@@ -0,0 +1,66 @@
+#ifndef CSVJOIN_H
+#define CSVJOIN_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "CSVDiff.h"
+
+// Joins two CSV files on key columns into a third. The smaller file of an
+// inner join, or the right file of a left or anti join, is streamed once
+// into a hash index holding each row's key and its output fields as
+// formatted text. The other file is then streamed through the parser and
+// each batch is probed against the index in parallel, its output lines
+// going straight to the writer, so neither file is held as parsed rows.
+class CSVJoin {
+public:
+    enum class Type {
+        INNER,   // left rows with a match, once per matching right row
+        LEFT,    // every left row, right columns empty when nothing matches
+        ANTI     // left rows without a match, left columns only
+    };
+    
+    CSVJoin();
+    
+    // Output is the left columns followed by the right columns other than
+    // the keys, in the left file's encoding and separator, with a header row
+    // when the left file has one. Key columns are header names or 1-based
+    // column numbers, comma separated; the right keys default to the left
+    // ones. Progress is reported in percent.
+    bool Run(const CSVDiff::Input& left, const CSVDiff::Input& right,
+             const wxString& leftKeys, const wxString& rightKeys, Type type,
+             const wxString& output, wxString& error,
+             const std::function<void(int)>& progress = nullptr);
+    
+    // Rows written, not counting the header
+    size_t GetRowCount() const { return rowCount; }
+
+private:
+    // One file reduced to what the output needs: per row the hash and text
+    // of its key and its output fields formatted in the output separator.
+    // The rows of each hash bucket are listed together, in file order.
+    struct Index {
+        std::vector<uint64_t> keys;
+        std::vector<size_t> starts;          // per row, into text; one extra at the end
+        std::vector<uint32_t> keyLengths;    // per row, the key text comes first
+        std::vector<uint32_t> fieldCounts;   // per row
+        std::vector<wxChar> text;
+        std::vector<uint32_t> bucketStarts;
+        std::vector<uint32_t> bucketRows;
+        uint64_t mask;
+        std::vector<wxString> header;        // names of the output fields
+        size_t width;                        // most output fields of any row
+    };
+    
+    size_t rowCount;
+    
+    static bool BuildIndex(const CSVDiff::Input& input, const wxString& keySpec, bool skipKeys,
+                           wxChar separator, Index& index, std::vector<int>& keyColumns,
+                           wxString& error, const std::function<void(int)>& progress);
+    static bool KeyEquals(const Index& index, uint32_t row, const wxString& key);
+    
+    static const size_t BLOCK_ROWS = 1024;
+};
+
+#endif // CSVJOIN_H
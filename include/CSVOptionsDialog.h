@@ -3,29 +3,68 @@
 
 #include <wx/wx.h>
 #include <wx/choice.h>
+#include <wx/checklst.h>
+#include <wx/grid.h>
+#include <vector>
 #include "CSVParser.h"
+#include "MappedFile.h"
 
 class CSVOptionsDialog : public wxDialog {
 public:
+    // With a filename the dialog also lists the file's columns so only some
+    // of them can be loaded, and previews a few rows with the chosen options
     CSVOptionsDialog(wxWindow* parent, Encoding detectedEncoding, 
-                     wxChar detectedSeparator, bool hasHeader = false);
+                     wxChar detectedSeparator, bool hasHeader = false,
+                     const wxString& filename = wxEmptyString);
     
     Encoding GetSelectedEncoding() const;
     wxChar GetSelectedSeparator() const;
     bool GetHasHeader() const;
     
+    // Source columns to load in file order, empty when all are selected
+    std::vector<int> GetSelectedColumns() const;
+
 private:
     wxChoice* encodingChoice;
     wxChoice* separatorChoice;
     wxCheckBox* headerCheckBox;
+    wxCheckListBox* columnList;
+    wxChoice* columnSetChoice;
+    wxChoice* previewChoice;
+    wxGrid* previewGrid;
     
     Encoding detectedEnc;
     wxChar detectedSep;
     wxChar customSeparator;
     
+    // Sniffed first row, used for the column list
+    MappedFile file;
+    std::vector<wxString> columnNames;
+    
+    void LoadColumns();
+    void CheckAllColumns(bool check);
+    void LoadColumnSets();
+    void ApplyColumnSet();
+    void LoadPreview();
+    
     void OnSeparatorChoice(wxCommandEvent& event);
+    void OnSelectAll(wxCommandEvent& event);
+    void OnSelectNone(wxCommandEvent& event);
+    void OnSaveColumnSet(wxCommandEvent& event);
+    void OnHeaderCheck(wxCommandEvent& event);
+    void OnResample(wxCommandEvent& event);
     void OnOK(wxCommandEvent& event);
     
+    enum {
+        ID_SELECT_ALL = wxID_HIGHEST + 1,
+        ID_SELECT_NONE,
+        ID_SAVE_COLUMN_SET,
+        ID_RESAMPLE
+    };
+    
+    // Rows shown in the preview, kept small so it appears instantly
+    static const size_t PREVIEW_ROWS = 100;
+    
     wxDECLARE_EVENT_TABLE();
 };
 
@@ -3,6 +3,9 @@
 
 #include <wx/wx.h>
 #include <vector>
+#include <functional>
+#include <string>
+#include <memory>
 
 enum class Encoding {
     UTF8,
@@ -12,6 +15,16 @@ enum class Encoding {
     UTF16_BE
 };
 
+class MappedFile;
+class CompressedWriter;
+
+// Receives each batch of parsed rows together with the byte offset of every row
+typedef std::function<void(std::vector<std::vector<wxString>>& rows,
+                           const std::vector<long long>& offsets)> RowBatchHandler;
+
+// Supplies the fields of one row to a writer
+typedef std::function<void(size_t row, std::vector<wxString>& fields)> RowSource;
+
 class CSVParser {
 public:
     CSVParser();
@@ -21,31 +34,182 @@ public:
     bool ReadFile(const wxString& filename, std::vector<std::vector<wxString>>& data, 
                   wxChar& separator, Encoding& encoding, bool& hasHeader);
     
+    // Stream a mapped file through the parser with a known encoding and separator.
+    // Lines are decoded and parsed in parallel, batches arrive in file order.
+    // With a column selection (source indices, ascending) rows hold only those
+    // fields; the others are skipped without being decoded or copied.
+    bool ReadFile(const MappedFile& file, Encoding& encoding, wxChar separator,
+                  const RowBatchHandler& handler,
+                  const std::vector<int>& columns = std::vector<int>());
+    
+    // Parse up to maxRows rows starting at a byte offset of a mapped file
+    static size_t ParseRows(const MappedFile& file, size_t offset, Encoding encoding,
+                            wxChar separator, size_t maxRows, bool keepFirstEmpty,
+                            std::vector<std::vector<wxString>>& rows,
+                            const std::vector<int>& columns = std::vector<int>());
+    
+    // Parse up to count records starting at uniformly random byte offsets past
+    // offset. Each offset is moved forward to the next line start that checks
+    // out as a record start: quotes close within a bounded window and most of
+    // the following records have as many fields as the first one. Offsets
+    // that find none within a bounded scan are skipped, those past the last
+    // record start wrap around to the first record. Rows are returned in file
+    // order, so fewer than count may come back.
+    static size_t SampleRows(const MappedFile& file, size_t offset, Encoding encoding,
+                             wxChar separator, size_t count,
+                             std::vector<std::vector<wxString>>& rows);
+    
+    // Advance pos past up to maxRecords whole records, stopping at the last
+    // record boundary at or before limit but always passing at least one
+    // record. Only quotes and line breaks are looked at, fields are not
+    // decoded. Returns the number of records passed.
+    static size_t SkipRecords(const MappedFile& file, size_t& pos, Encoding encoding,
+                              size_t maxRecords, size_t limit = (size_t)-1);
+    
+    // The byte ranges of up to maxRecords records from pos, each without its
+    // line break, advancing pos past them. Returns the number found.
+    static size_t FindRecords(const MappedFile& file, size_t& pos, Encoding encoding, size_t maxRecords,
+                              std::vector<std::pair<size_t, size_t>>& records);
+    
+    // Decode and split the record in a byte range of a mapped file, false
+    // when its bytes are invalid in the encoding. Columns select source
+    // fields as in ReadFile.
+    static bool ParseRecordAt(const MappedFile& file, size_t begin, size_t end, Encoding encoding,
+                              wxChar separator, std::vector<wxString>& fields,
+                              const std::vector<int>& columns = std::vector<int>());
+    
+    // Detect encoding and separator from the start of a mapped file
+    static void DetectFormat(const MappedFile& file, Encoding& encoding, wxChar& separator);
+    
+    // Adjust the selected encoding to the BOM actually present in the file
+    static Encoding ResolveEncoding(const MappedFile& file, Encoding selected);
+    
+    // Byte offset of the first row, past any BOM
+    static size_t GetDataOffset(const MappedFile& file, Encoding encoding);
+    
     // Write CSV file from 2D vector
     bool WriteFile(const wxString& filename, const std::vector<std::vector<wxString>>& data,
                    wxChar separator, Encoding encoding);
     
+    // Stream rowCount rows to a file, rows(i, fields) fills the fields of row i.
+    // Names ending in .gz, .zst or .xz are written compressed.
+    static bool WriteFile(const wxString& filename, size_t rowCount, const RowSource& rows,
+                          wxChar separator, Encoding encoding);
+    
     // Auto-detect separator from content
     static wxChar DetectSeparator(const wxString& content);
     
     // Auto-detect encoding from file
     static Encoding DetectEncoding(const wxString& filename);
+    static Encoding DetectEncoding(const MappedFile& file);
     
     // Parse a single CSV line respecting quotes
     static std::vector<wxString> ParseLine(const wxString& line, wxChar separator);
     
+    // Parse only the selected columns (ascending) of a line, missing ones are empty
+    static std::vector<wxString> ParseLine(const wxString& line, wxChar separator,
+                                           const std::vector<int>& columns);
+    
+    // The same into a caller's buffer. Its strings are overwritten in place,
+    // so parsing many lines into one buffer allocates only while it grows.
+    static void ParseLine(const wxString& line, wxChar separator, std::vector<wxString>& fields,
+                          const std::vector<int>& columns = std::vector<int>());
+    
     // Format a line with proper quoting
     static wxString FormatLine(const std::vector<wxString>& fields, wxChar separator);
     
+    // Append a formatted line to out, without a line break
+    static void AppendLine(wxString& out, const std::vector<wxString>& fields, wxChar separator);
+    
+    // Append one field to out, quoted when needed
+    static void AppendField(wxString& out, const wxString& field, wxChar separator);
+    
+    // Parse text held in memory (e.g. the clipboard) into rows. Line breaks
+    // inside quoted fields stay in their record, a trailing line break does
+    // not add an empty row.
+    static void ParseText(const wxString& text, wxChar separator,
+                          std::vector<std::vector<wxString>>& rows);
+
 private:
+    // Byte range of one record, several physical lines when a quoted
+    // field contains line breaks
+    struct LineSpan {
+        size_t begin;
+        size_t end;
+    };
+    
+    // Buffers a parser reuses from record to record, so decoding and
+    // splitting a record allocates nothing once they have grown
+    struct ParseScratch {
+        std::vector<wchar_t> text;
+        std::string raw;
+    };
+    
+    struct ParseBatch;
+    struct LoadPipeline;
+    
+    // Find the next record starting at pos, advancing pos past its terminator
+    static bool NextRecord(const char* data, size_t size, size_t& pos, Encoding encoding, LineSpan& line);
+    // The same over a mapped file whose content may still be arriving
+    static bool NextRecord(const MappedFile& file, size_t& pos, Encoding encoding, LineSpan& line);
+    
+    // Offset just past the next line break at or after pos, size if there is none
+    static size_t NextLineStart(const char* data, size_t size, size_t pos, Encoding encoding);
+    
+    // Whether a record starting at pos looks like a real one, judged from the
+    // few records that follow it
+    static bool IsRecordStart(const char* data, size_t size, size_t pos, Encoding encoding,
+                              wxChar separator, size_t expectedFields, ParseScratch& scratch);
+    
+    // Decode raw line bytes to a string
+    static wxString DecodeLine(const char* text, size_t length, Encoding encoding);
+    
+    // Decode raw bytes into the scratch text, false when they are invalid
+    static bool DecodeText(const char* text, size_t length, Encoding encoding,
+                           std::vector<wchar_t>& out, size_t& decodedLength);
+    
+    // Split decoded characters into the fields buffer, all columns or only the selected ones
+    static void ParseChars(const wxChar* chars, size_t length, wxChar separator,
+                           const std::vector<int>& columns, std::vector<wxString>& fields);
+    
+    // Decode and parse one record, all columns or only the selected ones.
+    // Returns false when the bytes are invalid in the encoding.
+    static bool ParseRecord(const char* text, size_t length, Encoding encoding, wxChar separator,
+                            const std::vector<int>& columns, std::vector<wxString>& fields,
+                            ParseScratch& scratch);
+    
     // Check if field needs quoting
     static bool NeedsQuoting(const wxString& field, wxChar separator);
     
-    // Escape quotes in field
-    static wxString EscapeField(const wxString& field);
-    
     // Unescape quotes in field
     static wxString UnescapeField(const wxString& field);
 };
 
+// Streams text to a file as it is produced, for output whose row count is
+// not known up front. Lines are formatted with CSVParser::AppendLine.
+class CSVWriter {
+public:
+    CSVWriter();
+    ~CSVWriter();
+    
+    // Starts the file with the encoding's BOM. Names ending in .gz, .zst or
+    // .xz are written compressed.
+    bool Open(const wxString& filename, Encoding encoding);
+    
+    // False when the text cannot be represented in the encoding or the
+    // write failed, the file is then left unchanged by Close
+    bool Write(const wxString& text);
+    
+    // Replace the target, false if any write failed
+    bool Close();
+
+private:
+    std::unique_ptr<CompressedWriter> writer;
+    std::unique_ptr<wxMBConv> conv;
+    bool ok;
+    
+    CSVWriter(const CSVWriter&) = delete;
+    CSVWriter& operator=(const CSVWriter&) = delete;
+};
+
 #endif // CSVPARSER_H
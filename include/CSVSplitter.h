@@ -0,0 +1,57 @@
+#ifndef CSVSPLITTER_H
+#define CSVSPLITTER_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <functional>
+#include "CSVDiff.h"
+
+// Splits a CSV file into parts and concatenates parts back into one file.
+// Records are found with the parser's quote-aware boundary scan, so a line
+// break inside a quoted field never splits a record, and their bytes are
+// copied as they are, without decoding or parsing the fields. Parts are
+// written in parallel, one file per task.
+class CSVSplitter {
+public:
+    enum class Mode {
+        ROWS,    // at most size rows per part
+        BYTES    // at most size bytes per part, unless one record is larger
+    };
+    
+    CSVSplitter();
+    
+    // Write the rows of input to parts named after output with a number
+    // before the first dot, e.g. data.csv gives data_001.csv, data_002.csv.
+    // Each part repeats the input's BOM and header row. Names ending in .gz,
+    // .zst or .xz are written compressed. Progress is reported in percent.
+    bool Split(const CSVDiff::Input& input, Mode mode, size_t size, const wxString& output,
+               wxString& error, const std::function<void(int)>& progress = nullptr);
+    
+    // Append the inputs to output in order. The output starts with the first
+    // file's BOM and header; the headers of the others must match it and are
+    // left out. The files must share an encoding and a separator.
+    bool Concat(const std::vector<CSVDiff::Input>& inputs, const wxString& output,
+                wxString& error, const std::function<void(int)>& progress = nullptr);
+    
+    // Files written by the last Split, or the output of the last Concat
+    const std::vector<wxString>& GetOutputFiles() const { return outputFiles; }
+    // Rows written by the last Split, not counting headers
+    size_t GetRowCount() const { return rowCount; }
+    
+    // Name of part index (0-based) of count parts
+    static wxString PartName(const wxString& output, size_t index, size_t count);
+
+private:
+    // Byte range of the records of one part
+    struct Part {
+        size_t begin;
+        size_t end;
+    };
+    
+    std::vector<wxString> outputFiles;
+    size_t rowCount;
+    
+    static const size_t COPY_BYTES = 4 * 1024 * 1024;
+};
+
+#endif // CSVSPLITTER_H
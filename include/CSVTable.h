@@ -0,0 +1,216 @@
+#ifndef CSVTABLE_H
+#define CSVTABLE_H
+
+#include <wx/wx.h>
+#include <wx/grid.h>
+#include <vector>
+#include <memory>
+#include "CSVParser.h"
+#include "MappedFile.h"
+#include "StringDictionary.h"
+
+// Somewhere evicted pages can be reloaded from
+class PageSource {
+public:
+    virtual ~PageSource() {}
+    
+    // Parse rowCount rows starting at a source specific position
+    virtual bool LoadRows(long long position, size_t rowCount,
+                          std::vector<std::vector<wxString>>& rows) = 0;
+    
+    // The same rows as column arrays, columns[col][row]. Sources that store
+    // columns override this to skip transposing rows.
+    virtual bool LoadColumns(long long position, size_t rowCount,
+                             std::vector<std::vector<wxString>>& columns);
+    
+    // Only some source columns, columns[i] holding selected[i]. Called from
+    // several threads at once, sources parsing text override it to decode
+    // just the selected fields.
+    virtual bool LoadSelectedColumns(long long position, size_t rowCount, const std::vector<int>& selected,
+                                     std::vector<std::vector<wxString>>& columns);
+    
+    // File the pages are read from, it must not be overwritten while attached
+    virtual wxString GetFilename() const = 0;
+    // Whether pages are read from this file, sources of several files override it
+    virtual bool ReadsFrom(const wxString& filename) const;
+};
+
+// Pages backed by the memory mapped CSV file they were parsed from
+class CSVFileSource : public PageSource {
+public:
+    CSVFileSource();
+    
+    bool Open(const wxString& filename);
+    void SetFormat(Encoding encoding, wxChar separator);
+    // Pages hold only these source columns, empty for all of them
+    void SetColumns(const std::vector<int>& selected) { columns = selected; }
+    
+    MappedFile& GetFile() { return file; }
+    wxString GetFilename() const override { return file.GetFilename(); }
+    
+    bool LoadRows(long long position, size_t rowCount,
+                  std::vector<std::vector<wxString>>& rows) override;
+    bool LoadSelectedColumns(long long position, size_t rowCount, const std::vector<int>& selected,
+                             std::vector<std::vector<wxString>>& loaded) override;
+
+private:
+    MappedFile file;
+    Encoding encoding;
+    wxChar separator;
+    std::vector<int> columns;
+};
+
+// Data store behind a document's grid. Rows are held in pages of column
+// arrays. Pages that still match their source can be evicted to free memory
+// and are transparently re-parsed when the grid touches them again.
+// Columns with few distinct values in the first page are stored as 16-bit
+// codes into a per-column dictionary instead of one string per cell.
+class CSVTable : public wxGridTableBase {
+public:
+    static const size_t PAGE_ROWS = 4096;
+    
+    CSVTable();
+    virtual ~CSVTable();
+    
+    // wxGridTableBase
+    int GetNumberRows() override;
+    int GetNumberCols() override;
+    wxString GetValue(int row, int col) override;
+    void SetValue(int row, int col, const wxString& value) override;
+    bool IsEmptyCell(int row, int col) override;
+    void Clear() override;
+    bool InsertRows(size_t pos = 0, size_t numRows = 1) override;
+    bool AppendRows(size_t numRows = 1) override;
+    bool DeleteRows(size_t pos = 0, size_t numRows = 1) override;
+    bool InsertCols(size_t pos = 0, size_t numCols = 1) override;
+    bool AppendCols(size_t numCols = 1) override;
+    bool DeleteCols(size_t pos = 0, size_t numCols = 1) override;
+    wxString GetColLabelValue(int col) override;
+    void SetColLabelValue(int col, const wxString& label) override;
+    
+    // Copy a cell into value, reusing its buffer instead of returning a new string
+    void CopyValue(int row, int col, wxString& value);
+    
+    // Cells longer than this are drawn and measured from a prefix and edited
+    // in the cell viewer instead of the grid's in-place editor
+    static const size_t LARGE_CELL_CHARS = 4096;
+    
+    // Length of a cell, and at most maxChars of its text, without copying
+    // the rest. CopyPrefix is true when the cell was cut short.
+    size_t GetValueLength(int row, int col);
+    bool CopyPrefix(int row, int col, size_t maxChars, wxString& value);
+    
+    // Whole column access for computed columns. PrepareRows loads the pages
+    // covering the rows, after which ReadColumn may be called from several
+    // threads at once as long as nothing modifies the table.
+    void PrepareRows(size_t first, size_t count);
+    void ReadColumn(int col, size_t first, size_t count, std::vector<wxString>& values) const;
+    // Move values into rows [first, first + values.size()) of a column
+    void WriteColumn(int col, size_t first, std::vector<wxString>& values);
+    
+    // Page by page access for queries, safe from several threads while the
+    // table is not modified. Loaded pages are read in place; evicted pages
+    // are parsed for just the requested columns and stay evicted, so a query
+    // does not pull a large file into memory.
+    size_t GetPageRows(size_t page) const { return pages[page].rowCount; }
+    bool IsPageResident(size_t page) const { return pages[page].resident; }
+    void ReadPageColumn(size_t page, int col, size_t first, size_t count, wxString* values) const;
+    void LoadPageColumns(size_t page, const std::vector<int>& cols,
+                         std::vector<std::vector<wxString>>& values) const;
+    
+    // Sorted, non-overlapping (first, count) ranges inside the table
+    typedef std::vector<std::pair<size_t, size_t>> RangeList;
+    
+    // Delete many rows or columns at once. Each page is compacted in a single
+    // pass, pages without deleted rows are not loaded or modified.
+    void DeleteRowRanges(const RangeList& ranges);
+    void DeleteColRanges(const RangeList& ranges);
+    
+    // Bulk loading, used before the table is attached to a grid
+    void AppendLoadedRow(std::vector<wxString>& row, long long sourcePosition);
+    // The next loaded row starts a page, so no page spans two source files
+    void EndLoadedPage() { pageBreak = true; }
+    // A page left in the source, loaded when the grid first touches it
+    void AppendSourcePage(size_t rows, long long sourcePosition);
+    void FinishLoad(const std::vector<wxString>& labels, size_t cols,
+                    std::shared_ptr<PageSource> source);
+    
+    // Load every evicted page and drop the source (e.g. before overwriting it)
+    void DetachSource();
+    PageSource* GetSource() const { return source.get(); }
+    
+    // Memory accounting for the budget manager
+    size_t GetMemoryUsage() const { return memoryUsage; }
+    size_t GetPageCount() const { return pages.size(); }
+    bool CanEvictPage(size_t page) const;
+    unsigned long long GetPageLastAccess(size_t page) const { return pages[page].lastAccess; }
+    size_t EvictPage(size_t page);
+
+private:
+    // One column of a page, plain strings or codes into the column's dictionary
+    struct PageColumn {
+        std::vector<wxString> values;
+        std::vector<StringDictionary::Code> codes;
+        StringDictionary* dictionary;   // null when plain
+        
+        PageColumn() : dictionary(nullptr) {}
+        
+        size_t Size() const { return dictionary ? codes.size() : values.size(); }
+        const wxString& Get(size_t row) const;
+        void Set(size_t row, const wxString& value);
+        void Take(size_t row, wxString& value);
+        void Append(wxString& value);
+        void Insert(size_t pos, size_t count);
+        void Erase(size_t pos, size_t count);
+        void Compact(const std::vector<bool>& keep);
+        void Resize(size_t count);
+        void Assign(std::vector<wxString>& source);
+        PageColumn Slice(size_t start, size_t count);
+        bool Encode(StringDictionary* target);
+        void Decode();
+        size_t GetCellMemory(size_t row) const;
+        size_t GetMemoryUsage() const;
+    };
+    
+    struct Page {
+        size_t rowCount;
+        std::vector<PageColumn> columns;
+        long long sourcePosition;   // -1 once the page no longer matches the source
+        bool resident;
+        unsigned long long lastAccess;
+        size_t memoryUsage;
+    };
+    
+    std::vector<Page> pages;
+    std::vector<size_t> pageStarts;   // first row of each page
+    bool pageStartsValid;
+    bool pageBreak;
+    size_t rowCount;
+    
+    std::vector<wxString> labels;
+    std::vector<int> sourceColumns;   // source column of each column, -1 if added later
+    std::vector<std::shared_ptr<StringDictionary>> dictionaries;   // per column, null when plain
+    std::shared_ptr<PageSource> source;
+    size_t memoryUsage;
+    
+    Page& LocateRow(size_t row, size_t& pageIndex, size_t& localRow);
+    void EnsureResident(Page& page);
+    void Touch(Page& page);
+    void MarkModified(Page& page);
+    void UpdatePageMemory(Page& page);
+    Page NewPage(size_t rows) const;
+    PageColumn NewColumn(size_t col, size_t rows) const;
+    void ChooseDictionaries(Page& page);
+    void ChooseDictionary(Page& page, size_t col);
+    void SplitPage(size_t pageIndex);
+    void Notify(int message, int first, int second = -1);
+    
+    static size_t CellMemory(const wxString& value);
+    
+    // A column gets a dictionary when the first page has at most one
+    // distinct value per DICTIONARY_RATIO rows
+    static const size_t DICTIONARY_MIN_ROWS = 64;
+    static const size_t DICTIONARY_RATIO = 16;
+};
+
+#endif // CSVTABLE_H
@@ -0,0 +1,125 @@
+#ifndef CSVVALIDATOR_H
+#define CSVVALIDATOR_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <functional>
+#include "CSVDiff.h"
+
+class MappedFile;
+class wxRegEx;
+
+// Checks a CSV file for structural problems and, given a schema, for the
+// values of its columns, without loading it. Record boundaries are found by
+// the parser's quote-aware scan while blocks of records are decoded, split
+// and checked on the pool a round at a time, so memory is bounded by the
+// round whatever the file size. Issues are handed over in file order.
+class CSVValidator {
+public:
+    enum class Problem {
+        RAGGED_ROW,           // more or fewer fields than the header
+        UNTERMINATED_QUOTE,   // a quoted field runs to the end of the file
+        INVALID_TEXT,         // bytes invalid in the file's encoding
+        MISSING_COLUMN,       // a schema column the header does not have
+        REQUIRED,             // a required field is empty
+        TYPE,                 // a value not of the column's type
+        RANGE,                // a value outside the column's minimum and maximum
+        PATTERN,              // a value not matching the column's pattern
+        COUNT
+    };
+    
+    enum class Type {
+        TEXT,
+        INTEGER,
+        NUMBER,
+        DATE,
+        BOOLEAN
+    };
+    
+    // Rules for one column. Minimum and maximum bound numbers and dates by
+    // value and text by length, empty means unbounded. The pattern is a
+    // regular expression the whole value must match.
+    struct ColumnRule {
+        wxString name;
+        Type type;
+        bool required;
+        wxString minimum;
+        wxString maximum;
+        wxString pattern;
+    };
+    
+    struct Issue {
+        Problem problem;
+        size_t line;          // 1-based line the record starts on
+        long long offset;     // byte offset of the record
+        long long row;        // 0-based data row, -1 for the header
+        int column;           // -1 for the whole record
+        wxString message;
+        wxString value;
+    };
+    
+    typedef std::function<void(const Issue& issue)> IssueHandler;
+    
+    CSVValidator();
+    
+    // Rules from a CSV schema with a header row naming its columns: name,
+    // type (text, integer, number, date or boolean), required (yes or no),
+    // min, max and pattern. Only name is needed. Each row describes the data
+    // column of that name, or of that position when the data has no header.
+    bool LoadSchema(const wxString& filename, wxString& error);
+    void SetRules(const std::vector<ColumnRule>& columnRules) { rules = columnRules; }
+    const std::vector<ColumnRule>& GetRules() const { return rules; }
+    
+    // Report every issue of the file to handler, on the calling thread.
+    // False only when the file cannot be read or a rule is invalid; the
+    // issues found are not errors. Progress is reported in percent.
+    bool Validate(const CSVDiff::Input& input, const IssueHandler& handler, wxString& error,
+                  const std::function<void(int)>& progress = nullptr);
+    
+    size_t GetRowCount() const { return rowCount; }
+    size_t GetIssueCount() const;
+    size_t GetProblemCount(Problem problem) const { return problemCounts[(int)problem]; }
+    // Name of a column of the last file, from its header or the schema
+    wxString GetColumnName(int column) const;
+    
+    // Short English name of a problem, as written to reports
+    static wxString GetProblemName(Problem problem);
+    // Column names of a report, and the fields of one issue in a report
+    static std::vector<wxString> GetReportHeader();
+    void FormatIssue(const Issue& issue, std::vector<wxString>& fields) const;
+
+private:
+    // A rule bound to a column of the file, its bounds parsed once
+    struct BoundRule {
+        const ColumnRule* rule;
+        int column;
+        double minimum;
+        double maximum;
+    };
+    
+    // Records of one block and what checking them found
+    struct Block {
+        std::vector<std::pair<size_t, size_t>> records;
+        size_t end;                        // where the next block starts
+        bool keepFirstEmpty;               // an empty first record is a row
+        size_t rowCount;
+        size_t lineBreaks;
+        std::vector<Issue> issues;         // line and row relative to the block
+    };
+    
+    std::vector<ColumnRule> rules;
+    std::vector<wxString> columnNames;
+    size_t rowCount;
+    size_t problemCounts[(int)Problem::COUNT];
+    
+    bool BindRules(const std::vector<wxString>& header, bool hasHeader, std::vector<BoundRule>& bound,
+                   std::vector<Issue>& issues, wxString& error) const;
+    void CheckBlock(const MappedFile& file, Encoding encoding, wxChar separator, size_t width,
+                    const std::vector<BoundRule>& bound, Block& block) const;
+    void CheckValue(const BoundRule& bound, const wxString& value, Issue& issue,
+                    std::vector<Issue>& issues, wxRegEx* pattern) const;
+    
+    static const size_t BLOCK_RECORDS = 4096;
+};
+
+#endif // CSVVALIDATOR_H
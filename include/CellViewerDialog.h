@@ -0,0 +1,45 @@
+#ifndef CELLVIEWERDIALOG_H
+#define CELLVIEWERDIALOG_H
+
+#include <wx/wx.h>
+#include "Translations.h"
+
+// Viewer and editor for one cell, used for cells too long for the grid's
+// in-place editor. The text is handed to the control in slices while the
+// dialog is idle, so even a cell of megabytes opens at once; it becomes
+// editable when all of it is there. JSON can be pretty-printed on demand.
+class CellViewerDialog : public wxDialog {
+public:
+    CellViewerDialog(wxWindow* parent, Language language, const wxString& columnName, int row,
+                     const wxString& value);
+    
+    // The text as edited, the cell's own while it is still loading
+    wxString GetValue() const;
+    
+    // Indent JSON by two spaces per level, false when the text is not an
+    // object or array with brackets balanced outside its strings
+    static bool FormatJson(const wxString& text, wxString& formatted);
+
+private:
+    enum {
+        ID_FORMAT_JSON = wxID_HIGHEST + 1
+    };
+    
+    wxTextCtrl* textCtrl;
+    wxButton* formatButton;
+    wxString value;
+    size_t loaded;
+    Language language;
+    
+    bool IsLoaded() const { return loaded >= value.length(); }
+    void StartLoading();
+    void OnIdle(wxIdleEvent& event);
+    void OnFormatJson(wxCommandEvent& event);
+    
+    // Characters handed to the control per idle event
+    static const size_t LOAD_CHARS = 64 * 1024;
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // CELLVIEWERDIALOG_H
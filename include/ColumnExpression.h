@@ -0,0 +1,130 @@
+#ifndef COLUMNEXPRESSION_H
+#define COLUMNEXPRESSION_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <functional>
+
+class CSVTable;
+
+// Formula of a computed column, e.g. [price] * [qty] or
+// LEFT(name, 3) & "-" & YEAR(date). The text is compiled once into bytecode
+// whose registers hold a whole batch of rows, so every instruction is one
+// tight typed loop per batch instead of a walk over the formula per cell.
+// Batches are evaluated in parallel on the worker pool.
+class ColumnExpression {
+public:
+    static const size_t BATCH_ROWS = 4096;
+    
+    enum class Type {
+        NUMBER,
+        TEXT,
+        BOOL
+    };
+    
+    // Values of one register for a batch of rows, only the vector of its type is used
+    struct Register {
+        std::vector<double> numbers;
+        std::vector<wxString> texts;
+        std::vector<unsigned char> flags;
+    };
+    
+    // Registers of one evaluating thread, reused from batch to batch
+    typedef std::vector<Register> Workspace;
+    
+    // Fills values[0, count) with one column's cells for rows [first, first + count).
+    // Called from several threads at once.
+    typedef std::function<void(int column, size_t first, size_t count,
+                               std::vector<wxString>& values)> ColumnReader;
+    
+    ColumnExpression();
+    
+    // Columns are referenced by name, written as [name] when it is not a
+    // plain word, or by 1-based number as [3].
+    bool Compile(const wxString& text, const std::vector<wxString>& columnNames, wxString& error);
+    // The same with the result converted to a type, e.g. BOOL for a filter
+    bool Compile(const wxString& text, const std::vector<wxString>& columnNames, Type resultType,
+                 wxString& error);
+    // An expression that is one column's text, by 0-based index, so a
+    // column named like a number or like another column is never mistaken
+    void CompileColumn(int column);
+    
+    Type GetResultType() const { return registerTypes[result]; }
+    // Columns the expression reads, ascending
+    std::vector<int> GetColumns() const;
+    
+    // Compute rows [first, first + count) into results[0, count)
+    void Evaluate(size_t first, size_t count, const ColumnReader& reader,
+                  std::vector<wxString>& results) const;
+    
+    // Replace the values of a table column a window of pages at a time. The
+    // expression was compiled against the other columns, as they were before
+    // the target was inserted, so [3] means the same column before and after.
+    void Fill(CSVTable& table, int target) const;
+    
+    // Batch by batch evaluation for callers that drive the threads themselves.
+    // RunBatch computes at most BATCH_ROWS rows into the workspace.
+    void InitWorkspace(Workspace& workspace) const;
+    void RunBatch(Workspace& workspace, size_t first, size_t count, const ColumnReader& reader) const;
+    const Register& GetResult(const Workspace& workspace) const { return workspace[result]; }
+    void FormatResult(const Workspace& workspace, size_t row, wxString& out) const;
+    
+    // Numbers as the expressions read and write them. Text that is not a
+    // number is NaN, NaN is written as an empty cell.
+    static double ParseNumber(const wxString& text);
+    static void FormatNumber(double value, wxString& out);
+    
+    // Year, month and day of 2024-03-15, 15.03.2024 or 03/15/2024, anything
+    // after the date (a time) is ignored
+    static bool ParseDate(const wxString& text, int& year, int& month, int& day);
+
+private:
+    enum class Op {
+        LOAD,                       // a = column
+        TEXT_TO_NUMBER, BOOL_TO_NUMBER, NUMBER_TO_TEXT, BOOL_TO_TEXT, NUMBER_TO_BOOL, TEXT_TO_BOOL,
+        ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULO, NEGATE,
+        CONCAT,
+        COMPARE_NUMBER,             // c = comparison
+        COMPARE_TEXT,               // numbers when both cells are numeric, otherwise text
+        AND, OR, NOT,
+        SELECT,                     // a = condition, b and c = values of the target's type
+        LEN, LEFT, RIGHT, MID, UPPER, LOWER, TRIM, CONTAINS, IS_EMPTY,
+        YEAR, MONTH, DAY, ROUND, ABS
+    };
+    
+    enum Comparison {
+        EQUAL,
+        NOT_EQUAL,
+        LESS,
+        LESS_EQUAL,
+        GREATER,
+        GREATER_EQUAL
+    };
+    
+    struct Instruction {
+        Op op;
+        int target;
+        int a;
+        int b;
+        int c;
+    };
+    
+    // Registers filled once per evaluation thread and never written again
+    struct Constant {
+        int target;
+        double number;
+        wxString text;
+    };
+    
+    class Compiler;
+    
+    std::vector<Type> registerTypes;
+    std::vector<Instruction> program;
+    std::vector<Constant> constants;
+    int result;
+    
+    bool CompileProgram(const wxString& text, const std::vector<wxString>& columnNames,
+                        const Type* resultType, wxString& error);
+};
+
+#endif // COLUMNEXPRESSION_H
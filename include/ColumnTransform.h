@@ -0,0 +1,70 @@
+#ifndef COLUMNTRANSFORM_H
+#define COLUMNTRANSFORM_H
+
+#include <wx/wx.h>
+#include <vector>
+#include "CSVTable.h"
+
+// A cleanup applied to every cell of one column: trimming, changing case,
+// find and replace, splitting on a delimiter or converting the decimal mark.
+// The column is read a window of pages at a time and its cells transformed
+// in parallel on the worker pool. Only the rows that change are written
+// back, so pages where nothing changes stay clean and can still be evicted.
+class ColumnTransform {
+public:
+    enum class Operation {
+        TRIM,            // leading and trailing white space
+        UPPER,
+        LOWER,
+        REPLACE,         // every occurrence of find by replacement
+        SPLIT,           // parts between delimiters (find) into new columns
+        DECIMAL_POINT,   // 1.234.567,89 to 1234567.89
+        DECIMAL_COMMA    // 1,234,567.89 to 1234567,89
+    };
+    
+    ColumnTransform();
+    ColumnTransform(Operation operation, const wxString& find = wxEmptyString,
+                    const wxString& replacement = wxEmptyString, bool matchCase = true);
+    
+    Operation GetOperation() const { return operation; }
+    
+    // Text form kept by the undo history and the edit journal
+    wxString Encode() const;
+    bool Decode(const wxString& text);
+    
+    // Transformed cell into out, false when the cell stays as it is and out
+    // is left untouched. Called from several threads at once.
+    bool Apply(const wxString& value, wxString& out) const;
+    
+    // Transform a column in place. The rows that changed are returned as
+    // ranges, ascending, with their previous values row by row.
+    void Run(CSVTable& table, int col, CSVTable::RangeList& changed,
+             std::vector<wxString>& previous) const;
+    
+    // Most parts any cell of a column splits into, at most MAX_PARTS
+    size_t CountParts(CSVTable& table, int col) const;
+    // Fill columns [col + 1, col + parts] with the parts of each cell. The
+    // rest of a cell with more parts stays together in the last column.
+    void Split(CSVTable& table, int col, size_t parts) const;
+    
+    static const size_t MAX_PARTS = 64;
+
+private:
+    Operation operation;
+    wxString find;
+    wxString replacement;
+    wxString lowerFind;      // find folded for matching without case
+    bool matchCase;
+    
+    bool ChangeCase(const wxString& value, bool upper, wxString& out) const;
+    bool ReplaceAll(const wxString& value, wxString& out) const;
+    // Number written with group and decimal marks into plain digits and
+    // newDecimal, false when the value is not such a number
+    static bool NormalizeNumber(const wxString& value, wxChar group, wxChar decimal,
+                                wxChar newDecimal, wxString& out);
+    
+    static const size_t WINDOW_ROWS = 64 * CSVTable::PAGE_ROWS;
+    static const size_t CHUNK_ROWS = 4096;
+};
+
+#endif // COLUMNTRANSFORM_H
@@ -0,0 +1,37 @@
+#ifndef COLUMNTRANSFORMDIALOG_H
+#define COLUMNTRANSFORMDIALOG_H
+
+#include <wx/wx.h>
+#include <vector>
+#include "ColumnTransform.h"
+#include "Translations.h"
+
+class ColumnTransformDialog : public wxDialog {
+public:
+    ColumnTransformDialog(wxWindow* parent, Language language, const std::vector<wxString>& columnNames,
+                          int column);
+    
+    int GetColumn() const;
+    ColumnTransform GetTransform() const;
+
+private:
+    enum {
+        ID_OPERATION = wxID_HIGHEST + 1
+    };
+    
+    wxChoice* columnChoice;
+    wxChoice* operationChoice;
+    wxTextCtrl* findText;
+    wxTextCtrl* replaceText;
+    wxCheckBox* matchCaseCheckBox;
+    Language language;
+    
+    ColumnTransform::Operation GetOperation() const;
+    void UpdateControls();
+    void OnOperationChanged(wxCommandEvent& event);
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // COLUMNTRANSFORMDIALOG_H
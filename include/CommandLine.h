@@ -0,0 +1,42 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <wx/wx.h>
+#include <vector>
+
+// Subcommands run from the command line without opening the main window,
+// e.g. "CSVPlusPlus diff old.csv new.csv". Returns the process exit code.
+class CommandLine {
+public:
+    // True when the arguments start with a known subcommand
+    static bool IsCommand(const wxArrayString& args);
+    
+    static int Run(const wxArrayString& args);
+
+private:
+    // Options given as --name=value or --flag, everything else is positional
+    struct Options {
+        std::vector<std::pair<wxString, wxString>> named;
+        wxArrayString positional;
+        
+        bool Has(const wxString& name) const;
+        wxString Get(const wxString& name, const wxString& defaultValue = wxEmptyString) const;
+    };
+    
+    static Options ParseOptions(const wxArrayString& args);
+    static void SetUpConsole();
+    static void Print(const wxString& text);
+    static void PrintError(const wxString& text);
+    static void PrintUsage();
+    
+    static int RunDiff(const Options& options);
+    static int RunCompute(const Options& options);
+    static int RunQuery(const Options& options);
+    static int RunMerge(const Options& options);
+    static int RunDedup(const Options& options);
+    static int RunSplit(const Options& options);
+    static int RunConcat(const Options& options);
+    static int RunValidate(const Options& options);
+};
+
+#endif // COMMANDLINE_H
@@ -0,0 +1,29 @@
+#ifndef COMPAREDIALOG_H
+#define COMPAREDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/filepicker.h>
+#include "Translations.h"
+
+class CompareDialog : public wxDialog {
+public:
+    CompareDialog(wxWindow* parent, Language language, const wxString& leftFile);
+    
+    wxString GetLeftFile() const;
+    wxString GetRightFile() const;
+    bool GetHasHeader() const;
+    wxString GetKeyColumns() const;
+
+private:
+    wxFilePickerCtrl* leftPicker;
+    wxFilePickerCtrl* rightPicker;
+    wxCheckBox* headerCheckBox;
+    wxTextCtrl* keyText;
+    Language language;
+    
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // COMPAREDIALOG_H
@@ -0,0 +1,126 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Containers CSV files can be read from and saved to
+enum class Compression {
+    NONE,
+    GZIP,
+    ZSTD,
+    XZ
+};
+
+// Format of data from its magic bytes
+Compression DetectCompression(const char* data, size_t size);
+
+// Format implied by a file name's extension (.gz, .zst, .xz)
+Compression CompressionFromFilename(const wxString& filename);
+
+// Decompresses a whole compressed file into memory on a background thread.
+// The output goes to address space reserved up front, so it never moves and
+// readers can parse what has been produced while the rest is decompressed.
+// Multi-frame zstd, BGZF (blocked gzip) and multi-block xz input is
+// decompressed in parallel.
+class DecompressedBuffer {
+public:
+    DecompressedBuffer();
+    ~DecompressedBuffer();
+    
+    // The input must stay valid until the buffer is destroyed
+    bool Start(const char* input, size_t inputSize, Compression format);
+    
+    const char* GetData() const { return data; }
+    
+    // Wait until at least bytes are available or decompression has ended,
+    // returns the number of bytes available
+    size_t WaitFor(size_t bytes) const;
+    size_t WaitForEnd() const { return WaitFor((size_t)-1); }
+    
+    // False once the input turned out to be corrupt, truncated or too large
+    bool IsValid() const { return !failed; }
+
+private:
+    // Independently compressed piece of the input with a known output size
+    struct Block {
+        size_t offset;
+        size_t size;
+        size_t output;
+        size_t outputSize;
+    };
+    
+    const char* input;
+    size_t inputSize;
+    Compression format;
+    
+    char* data;
+    size_t reserved;
+    size_t committed;
+    
+    std::atomic<size_t> available;
+    std::atomic<bool> finished;
+    std::atomic<bool> failed;
+    std::atomic<bool> stopping;
+    mutable std::mutex mutex;
+    mutable std::condition_variable progress;
+    std::thread worker;
+    
+    DecompressedBuffer(const DecompressedBuffer&) = delete;
+    DecompressedBuffer& operator=(const DecompressedBuffer&) = delete;
+    
+    bool Reserve();
+    void Release();
+    bool Commit(size_t end);
+    void Publish(size_t end);
+    void Run();
+    
+    bool DecodeBlocks(const std::vector<Block>& blocks);
+    bool InflateGzip();
+    bool DecompressZstd();
+    bool DecompressXz();
+    
+    static bool FindBgzfBlocks(const char* input, size_t inputSize, std::vector<Block>& blocks);
+    static bool FindZstdFrames(const char* input, size_t inputSize, std::vector<Block>& blocks);
+};
+
+// Writes a file, compressing it on the way unless the format is NONE. The
+// target is replaced only when Close succeeds. gzip output is BGZF and zstd
+// output has one frame per few megabytes, both compressed in parallel and
+// readable by the standard tools; xz uses the multi-threaded encoder.
+class CompressedWriter {
+public:
+    CompressedWriter();
+    ~CompressedWriter();
+    
+    bool Open(const wxString& filename, Compression format);
+    bool Write(const char* bytes, size_t length);
+    // Flush the compressor and replace the target, false if any write failed
+    bool Close();
+
+private:
+    struct XzEncoder;
+    
+    wxTempFile file;
+    Compression format;
+    bool ok;
+    std::string pending;   // input not yet compressed
+    size_t batchInput;     // pending input compressed at once
+    std::unique_ptr<XzEncoder> xz;
+    
+    CompressedWriter(const CompressedWriter&) = delete;
+    CompressedWriter& operator=(const CompressedWriter&) = delete;
+    
+    void CompressPending(bool final);
+    void WriteXz(const char* bytes, size_t length, bool final);
+    void WriteOutput(const void* bytes, size_t length);
+};
+
+#endif // COMPRESSION_H
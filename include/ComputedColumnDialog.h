@@ -0,0 +1,32 @@
+#ifndef COMPUTEDCOLUMNDIALOG_H
+#define COMPUTEDCOLUMNDIALOG_H
+
+#include <wx/wx.h>
+#include <vector>
+#include "Translations.h"
+
+class ComputedColumnDialog : public wxDialog {
+public:
+    ComputedColumnDialog(wxWindow* parent, Language language, const std::vector<wxString>& columnNames);
+    
+    wxString GetColumnName() const;
+    wxString GetExpression() const;
+
+private:
+    enum {
+        ID_COLUMN_LIST = wxID_HIGHEST + 1
+    };
+    
+    wxTextCtrl* nameText;
+    wxTextCtrl* expressionText;
+    wxListBox* columnList;
+    std::vector<wxString> columnNames;
+    Language language;
+    
+    void OnColumnChosen(wxCommandEvent& event);
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // COMPUTEDCOLUMNDIALOG_H
@@ -0,0 +1,35 @@
+#ifndef CONCATDIALOG_H
+#define CONCATDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/filepicker.h>
+#include "Translations.h"
+
+class ConcatDialog : public wxDialog {
+public:
+    ConcatDialog(wxWindow* parent, Language language);
+    
+    // Files in the order they are appended
+    wxArrayString GetInputFiles() const;
+    wxString GetOutputFile() const;
+    bool GetHasHeader() const;
+
+private:
+    enum {
+        ID_ADD_FILES = wxID_HIGHEST + 1,
+        ID_REMOVE_FILES
+    };
+    
+    wxListBox* fileList;
+    wxFilePickerCtrl* outputPicker;
+    wxCheckBox* headerCheckBox;
+    Language language;
+    
+    void OnAdd(wxCommandEvent& event);
+    void OnRemove(wxCommandEvent& event);
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // CONCATDIALOG_H
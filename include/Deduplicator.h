@@ -0,0 +1,67 @@
+#ifndef DEDUPLICATOR_H
+#define DEDUPLICATOR_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <cstdint>
+#include "CSVDiff.h"
+
+class CSVTable;
+
+// Finds rows repeating another row on a set of columns. Rows are hashed in
+// parallel to 128 bits, split into partitions by hash and sorted within
+// each partition, one partition per task. Rows whose hashes are equal are
+// then compared by value, so a hash collision never drops a distinct row.
+class Deduplicator {
+public:
+    enum class Keep {
+        FIRST,
+        LAST
+    };
+    
+    explicit Deduplicator(Keep keep);
+    
+    // Duplicate rows of a table on the columns (all columns when empty), in
+    // ascending order, without the one copy of each row that is kept
+    std::vector<size_t> FindDuplicates(CSVTable& table, const std::vector<int>& columns);
+    
+    // Copy a file to output without its duplicate rows, in the same format.
+    // Key columns are header names or 1-based column numbers, comma
+    // separated, empty for whole rows. Row hashes beyond memoryLimit bytes
+    // are spilled to temporary files by partition, so memory stays bounded
+    // for files larger than RAM; the file is then read a second time to
+    // verify candidates and a third time to write the rows that are kept.
+    bool RemoveDuplicates(const CSVDiff::Input& input, const wxString& keyColumns,
+                          const wxString& output, size_t memoryLimit, wxString& error);
+    
+    // Rows removed by the last RemoveDuplicates, and rows read
+    size_t GetDuplicateCount() const { return duplicateCount; }
+    size_t GetRowCount() const { return rowCount; }
+    
+    static const size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+private:
+    struct RowRecord {
+        uint64_t hash1;
+        uint64_t hash2;
+        uint64_t row;
+        long long offset;   // files only, -1 for tables
+    };
+    
+    Keep keep;
+    size_t duplicateCount;
+    size_t rowCount;
+    
+    // Runs of records with the same hash, as rows ascending. groupStarts has
+    // one entry per group and one at the end.
+    static void FindCandidates(std::vector<RowRecord>& records, std::vector<RowRecord>& candidates,
+                               std::vector<size_t>& groupStarts);
+    // Duplicates among one group of candidates given the exact key text of each
+    void ResolveGroup(const RowRecord* rows, const wxString* keys, size_t count,
+                      std::vector<uint64_t>& duplicates) const;
+    
+    static const size_t PARTITIONS = 64;
+    static const size_t BLOCK_ROWS = 1024;
+};
+
+#endif // DEDUPLICATOR_H
@@ -0,0 +1,62 @@
+#ifndef DIFFFRAME_H
+#define DIFFFRAME_H
+
+#include <wx/wx.h>
+#include <wx/grid.h>
+#include <memory>
+#include <unordered_map>
+#include "CSVDiff.h"
+#include "Translations.h"
+
+// Grid table showing one side of a diff, one row per differing row.
+// Rows are re-parsed from the file on demand and cached briefly.
+class DiffTable : public wxGridTableBase {
+public:
+    DiffTable(const CSVDiff& diff, CSVDiff::Side side);
+    virtual ~DiffTable();
+    
+    int GetNumberRows() override;
+    int GetNumberCols() override;
+    wxString GetValue(int row, int col) override;
+    void SetValue(int row, int col, const wxString& value) override;
+    bool IsEmptyCell(int row, int col) override;
+    wxString GetRowLabelValue(int row) override;
+    wxString GetColLabelValue(int col) override;
+    wxGridCellAttr* GetAttr(int row, int col, wxGridCellAttr::wxAttrKind kind) override;
+
+private:
+    const CSVDiff& diff;
+    CSVDiff::Side side;
+    std::unordered_map<long long, std::vector<wxString>> cache[2];
+    
+    wxGridCellAttr* addedAttr;
+    wxGridCellAttr* removedAttr;
+    wxGridCellAttr* changedAttr;
+    wxGridCellAttr* missingAttr;
+    
+    const std::vector<wxString>& FetchRow(CSVDiff::Side fromSide, long long row);
+    long long GetSourceRow(int row, CSVDiff::Side fromSide) const;
+    
+    static const size_t CACHE_ROWS = 4096;
+};
+
+// Side-by-side view of a comparison with synchronized scrolling
+class DiffFrame : public wxFrame {
+public:
+    DiffFrame(wxWindow* parent, std::unique_ptr<CSVDiff> diff, Language language, int fontSize);
+
+private:
+    std::unique_ptr<CSVDiff> diff;
+    wxGrid* leftGrid;
+    wxGrid* rightGrid;
+    bool syncing;
+    
+    wxGrid* CreateSideGrid(wxWindow* parent, CSVDiff::Side side, int fontSize);
+    void OnGridScroll(wxScrollWinEvent& event);
+    void OnSelectCell(wxGridEvent& event);
+    void SyncScroll(wxGrid* source);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // DIFFFRAME_H
@@ -0,0 +1,30 @@
+#ifndef DUPLICATESDIALOG_H
+#define DUPLICATESDIALOG_H
+
+#include <wx/wx.h>
+#include <vector>
+#include "Deduplicator.h"
+#include "Translations.h"
+
+class DuplicatesDialog : public wxDialog {
+public:
+    DuplicatesDialog(wxWindow* parent, Language language, const std::vector<wxString>& columnNames);
+    
+    // Columns rows are compared on, empty when every column is checked
+    std::vector<int> GetColumns() const;
+    Deduplicator::Keep GetKeep() const;
+    // Delete the duplicates instead of selecting them
+    bool GetRemove() const;
+
+private:
+    wxCheckListBox* columnList;
+    wxRadioBox* keepRadio;
+    wxRadioBox* actionRadio;
+    Language language;
+    
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // DUPLICATESDIALOG_H
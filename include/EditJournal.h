@@ -0,0 +1,130 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "CSVParser.h"
+
+// Edit commands recorded in the journal
+enum class JournalOp : unsigned char {
+    SetCell = 1,     // a = row, b = col, value = new cell text
+    InsertRows,      // a = position, b = count
+    DeleteRows,      // a = position, b = count
+    InsertCols,      // a = position, b = count
+    DeleteCols,      // a = position, b = count
+    SetHeader,       // a = col, b = 1 if renamed by the user, value = header text
+    Resize,          // a = rows, b = cols (grid is cleared)
+    SetFormat,       // a = encoding, b = separator
+    ComputeColumn,   // a = col, value = expression its cells are computed from
+    TransformColumn  // a = col, b = split parts or 0, value = encoded ColumnTransform
+};
+
+struct JournalEntry {
+    JournalOp op;
+    int a;
+    int b;
+    wxString value;
+};
+
+// Describes the file a journal has to be replayed over
+struct JournalHeader {
+    wxString sourceFile;     // empty for a new, never saved file
+    wxLongLong_t sourceSize;
+    wxLongLong_t sourceModified;
+    Encoding encoding;
+    wxChar separator;
+    bool hasHeader;
+    int initialRows;         // grid size to start from when there is no source
+    int initialCols;
+    std::vector<int> columns;   // source columns that were loaded, empty for all
+};
+
+// Append-only write-ahead log of grid edits. Records are encoded on the UI
+// thread into a memory buffer and written + fsynced in batches by a
+// background thread, so a crash loses at most one flush interval of edits.
+class EditJournal {
+public:
+    EditJournal();
+    ~EditJournal();
+
+    // Begin journaling edits made over the given file. The journal file
+    // itself is only created once the first edit is recorded.
+    void Start(const JournalHeader& header);
+
+    // Continue appending to an existing journal (after recovery). The file
+    // is cut to validLength first, so a torn tail is not left between the
+    // recovered records and new ones.
+    bool Resume(const wxString& path, const JournalHeader& header, wxFileOffset validLength);
+
+    // Flush pending records and stop; optionally delete the journal file
+    void Stop(bool discard);
+
+    bool IsActive() const { return active; }
+    const wxString& GetPath() const { return path; }
+
+    // True once a write failed. Later records are dropped, replaying them
+    // past the lost ones would rebuild a different grid.
+    bool HasFailed() const { return failed; }
+    // True the first time it is asked after a write failed, to warn once
+    bool TakeFailure();
+
+    void RecordSetCell(int row, int col, const wxString& value);
+    void RecordInsertRows(int pos, int count);
+    void RecordDeleteRows(int pos, int count);
+    void RecordInsertCols(int pos, int count);
+    void RecordDeleteCols(int pos, int count);
+    void RecordSetHeader(int col, const wxString& value, bool markHeaderRow);
+    void RecordResize(int rows, int cols);
+    void RecordSetFormat(Encoding encoding, wxChar separator);
+    void RecordComputeColumn(int col, const wxString& expression);
+    void RecordTransformColumn(int col, int parts, const wxString& transform);
+
+    // Block until everything recorded so far is on disk
+    void Flush();
+
+    // Journal discovery and reading for crash recovery
+    static wxString GetJournalDir();
+    static wxArrayString FindPendingJournals();
+    // validLength is set to the end of the last intact record
+    static bool ReadJournal(const wxString& path, JournalHeader& header,
+                            std::vector<JournalEntry>& entries, wxFileOffset& validLength);
+    static JournalHeader MakeHeader(const wxString& sourceFile, Encoding encoding,
+                                    wxChar separator, bool hasHeader);
+
+private:
+    // Records are flushed when this much data is pending or the interval elapses
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+    static const int FLUSH_INTERVAL_MS = 500;
+
+    JournalHeader header;
+    wxString path;
+    bool active;
+    bool fileCreated;
+
+    wxFile file;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable flushed;
+    std::vector<unsigned char> pending;
+    unsigned long long appendedBytes;
+    unsigned long long writtenBytes;
+    bool flushRequested;
+    bool stopping;
+    std::atomic<bool> failed;
+    bool failureReported;
+
+    void Append(JournalOp op, int a, int b, const wxString& value);
+    bool CreateFile();
+    void WriterLoop();
+    void StopWriter();
+
+    static wxString MakeJournalPath(const wxString& sourceFile);
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,48 @@
+#ifndef GRIDCLIPBOARD_H
+#define GRIDCLIPBOARD_H
+
+#include <wx/wx.h>
+#include <wx/dataobj.h>
+#include <memory>
+#include "CSVTable.h"
+
+// A rectangle of cells put on the clipboard. The text is only built when a
+// program actually pastes it, straight from the table into one buffer.
+// Detach renders it immediately, the owning document calls it before the
+// cells change or the table goes away.
+class ClipboardCopy {
+public:
+    ClipboardCopy(CSVTable* table, int top, int left, int bottom, int right);
+    
+    int GetRowCount() const { return bottom - top + 1; }
+    int GetColumnCount() const { return right - left + 1; }
+    
+    const wxString& GetText();
+    void Detach();
+
+private:
+    CSVTable* table;
+    int top;
+    int left;
+    int bottom;
+    int right;
+    wxString text;
+    bool rendered;
+    
+    void Render();
+};
+
+// Text data object that renders its copy on the first request (delayed
+// rendering through the OLE clipboard)
+class ClipboardTextObject : public wxTextDataObject {
+public:
+    explicit ClipboardTextObject(std::shared_ptr<ClipboardCopy> copy) : copy(copy) {}
+    
+    size_t GetTextLength() const override;
+    wxString GetText() const override;
+
+private:
+    std::shared_ptr<ClipboardCopy> copy;
+};
+
+#endif // GRIDCLIPBOARD_H
@@ -0,0 +1,32 @@
+#ifndef LARGECELLRENDERER_H
+#define LARGECELLRENDERER_H
+
+#include <wx/wx.h>
+#include <wx/grid.h>
+
+class CSVTable;
+
+// Default renderer of a document's grid. Cells up to the table's large
+// cell length draw as usual; longer ones, such as embedded JSON documents,
+// are drawn and measured from a prefix of their text on one line, so
+// painting and autosizing never lay out the whole value.
+class LargeCellRenderer : public wxGridCellStringRenderer {
+public:
+    void Draw(wxGrid& grid, wxGridCellAttr& attr, wxDC& dc, const wxRect& rect,
+              int row, int col, bool isSelected) override;
+    wxSize GetBestSize(wxGrid& grid, wxGridCellAttr& attr, wxDC& dc, int row, int col) override;
+    wxGridCellRenderer* Clone() const override { return new LargeCellRenderer(); }
+
+private:
+    // The table when the cell is a large one, null otherwise
+    static CSVTable* GetLargeCellTable(wxGrid& grid, int row, int col);
+    // At most maxChars of the cell with line breaks and tabs as spaces
+    static wxString GetPreview(CSVTable& table, int row, int col, size_t maxChars);
+    
+    // Characters a column is sized for
+    static const size_t MEASURE_CHARS = 64;
+    // Most characters drawn, however wide the column
+    static const size_t DRAW_CHARS = 1024;
+};
+
+#endif // LARGECELLRENDERER_H
@@ -4,24 +4,20 @@
 #include <wx/wx.h>
 #include <wx/grid.h>
 #include <wx/dnd.h>
-#include <deque>
+#include <wx/snglinst.h>
+#include <wx/notebook.h>
 #include "CSVParser.h"
+#include "CSVDocument.h"
 #include "Translations.h"
 
-// Structure to store grid state for undo/redo
-struct GridState {
-    std::vector<std::vector<wxString>> data;
-    std::vector<wxString> headers;
-    int rows;
-    int cols;
-};
+class PerformanceFrame;
 
 // File drop target class
 class FileDropTarget : public wxFileDropTarget {
 public:
     FileDropTarget(class MainFrame* frame) : mainFrame(frame) {}
     virtual bool OnDropFiles(wxCoord x, wxCoord y, const wxArrayString& filenames) override;
-    
+
 private:
     MainFrame* mainFrame;
 };
@@ -31,28 +27,25 @@ public:
     MainFrame(const wxString& title);
     
     void OpenFileFromDrop(const wxString& filename);
+    // Dropped or picked together: a folder opens its files as one table,
+    // several files open as one table or in tabs of their own
+    void OpenFiles(const wxArrayString& filenames);
     
     wxDECLARE_EVENT_TABLE();
-    
+
 private:
-    wxGrid* grid;
+    wxNotebook* notebook;
     wxStatusBar* statusBar;
     wxToolBar* toolBar;
     wxChoice* fontSizeChoice;
+    wxTextCtrl* queryCtrl;
     int currentFontSize;
     
-    // File state
-    wxString currentFile;
-    Encoding currentEncoding;
-    wxChar currentSeparator;
-    bool isDirty;
-    bool hasHeaderRow;
-    bool isRestoringState;
+    // Diagnostics window, created on first use
+    PerformanceFrame* performanceFrame;
     
-    // Undo/redo
-    std::deque<GridState> undoStack;
-    std::deque<GridState> redoStack;
-    const size_t MAX_UNDO_LEVELS = 50;
+    // Crash recovery
+    wxSingleInstanceChecker instanceChecker;
     
     // Language support
     Language currentLanguage;
@@ -61,6 +54,7 @@ private:
     enum {
         ID_NEW = wxID_HIGHEST + 1,
         ID_OPEN,
+        ID_OPEN_FOLDER,
         ID_SAVE,
         ID_SAVE_AS,
         ID_CLOSE,
@@ -70,8 +64,13 @@ private:
         ID_ADD_ROW_ABOVE,
         ID_ADD_COLUMN_LEFT,
         ID_ADD_COLUMN_RIGHT,
+        ID_ADD_COMPUTED_COLUMN,
+        ID_TRANSFORM_COLUMN,
         ID_DELETE_ROW,
         ID_DELETE_COLUMN,
+        ID_COPY,
+        ID_PASTE,
+        ID_VIEW_CELL,
         ID_ENC_UTF8,
         ID_ENC_ANSI,
         ID_ENC_UTF16,
@@ -82,6 +81,15 @@ private:
         ID_LANG_ENGLISH,
         ID_LANG_SERBIAN,
         ID_FONT_SIZE_CHOICE,
+        ID_QUERY,
+        ID_COMPARE,
+        ID_MERGE,
+        ID_SPLIT,
+        ID_CONCAT,
+        ID_VALIDATE,
+        ID_PIVOT,
+        ID_DUPLICATES,
+        ID_PERFORMANCE,
         ID_HELP_INSTRUCTIONS,
         ID_HELP_ABOUT
     };
@@ -94,6 +102,7 @@ private:
     // File operations
     void OnNew(wxCommandEvent& event);
     void OnOpen(wxCommandEvent& event);
+    void OnOpenFolder(wxCommandEvent& event);
     void OnSave(wxCommandEvent& event);
     void OnSaveAs(wxCommandEvent& event);
     void OnClose(wxCommandEvent& event);
@@ -106,8 +115,13 @@ private:
     void OnAddRowAbove(wxCommandEvent& event);
     void OnAddColumnLeft(wxCommandEvent& event);
     void OnAddColumnRight(wxCommandEvent& event);
+    void OnAddComputedColumn(wxCommandEvent& event);
+    void OnTransformColumn(wxCommandEvent& event);
     void OnDeleteRow(wxCommandEvent& event);
     void OnDeleteColumn(wxCommandEvent& event);
+    void OnCopy(wxCommandEvent& event);
+    void OnPaste(wxCommandEvent& event);
+    void OnViewCell(wxCommandEvent& event);
     
     // Settings
     void OnEncodingChange(wxCommandEvent& event);
@@ -115,6 +129,17 @@ private:
     void OnLanguageChange(wxCommandEvent& event);
     void OnFontSizeChange(wxCommandEvent& event);
     
+    // Tools
+    void OnCompare(wxCommandEvent& event);
+    void OnMerge(wxCommandEvent& event);
+    void OnSplit(wxCommandEvent& event);
+    void OnConcat(wxCommandEvent& event);
+    void OnValidate(wxCommandEvent& event);
+    void OnPivot(wxCommandEvent& event);
+    void OnDuplicates(wxCommandEvent& event);
+    void OnPerformance(wxCommandEvent& event);
+    void OnQuery(wxCommandEvent& event);
+    
     // Help
     void OnInstructions(wxCommandEvent& event);
     void OnAbout(wxCommandEvent& event);
@@ -127,23 +152,37 @@ private:
     void OnGridRightClick(wxGridEvent& event);
     void OnColSize(wxGridSizeEvent& event);
     void OnSelectCell(wxGridEvent& event);
+    void OnGridKeyDown(wxKeyEvent& event);
+    
+    // Tabs
+    void OnPageChanged(wxBookCtrlEvent& event);
+    
+    // Document helpers
+    CSVDocument* GetActiveDocument() const;
+    CSVDocument* GetDocument(size_t index) const;
+    CSVDocument* AddDocument();
+    void CloseDocument(CSVDocument* doc);
+    void UpdateDocumentUI();
     
     // Helper methods
+    void OpenShards(const wxArrayString& files, const wxString& name);
+    void ShowCellViewer(int row, int col);
     void LoadCSVFile(const wxString& filename, Encoding encoding, 
-                     wxChar separator, bool hasHeader);
-    void SaveCSVFile(const wxString& filename);
+                     wxChar separator, bool hasHeader,
+                     const std::vector<int>& columns = std::vector<int>());
+    bool SaveCSVFile(CSVDocument* doc, const wxString& filename);
+    bool SaveDocument(CSVDocument* doc);
     void UpdateStatusBar();
+    void WarnJournalFailure();
     void UpdateMenuChecks();
-    void SaveState();
-    void RestoreState(const GridState& state);
-    GridState GetCurrentState();
-    void ClearGrid();
-    void SetDirty(bool dirty);
-    bool PromptSaveChanges();
+    void UpdateTitle();
+    bool PromptSaveChanges(CSVDocument* doc);
     void UpdateUndoRedoButtons();
     void UpdateUILanguage();
-    void ApplyGridDimensions();
-    int GetDefaultColumnWidth() const;
+    
+    // Crash recovery
+    void RecoverJournals();
+    bool RecoverJournal(const wxString& path);
 };
 
 #endif // MAINFRAME_H
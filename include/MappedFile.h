@@ -0,0 +1,55 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <wx/wx.h>
+#include <memory>
+#include "Compression.h"
+
+// Read-only memory mapping of a whole file. Compressed files (gzip, zstd,
+// xz) are recognised by their magic bytes and decompressed in the background,
+// the accessors then describe the decompressed content.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    
+    bool Open(const wxString& filename);
+    void Close();
+    
+    bool IsOpened() const { return opened; }
+    const char* GetData() const { return decompressed ? decompressed->GetData() : data; }
+    // Waits for decompression to finish
+    size_t GetSize() const { return decompressed ? decompressed->WaitForEnd() : size; }
+    const wxString& GetFilename() const { return filename; }
+    
+    // Wait until at least the first bytes of the content are available, or
+    // all of it when it is shorter, and return how many are. Readers use it
+    // to start on compressed input while the rest is decompressed.
+    size_t WaitForData(size_t bytes) const { return decompressed ? decompressed->WaitFor(bytes) : size; }
+    
+    // False when compressed input turned out to be corrupt or truncated
+    bool IsValid() const { return !decompressed || decompressed->IsValid(); }
+    Compression GetCompression() const { return compression; }
+    
+    // Tell the OS the mapping is about to be read front to back
+    void AdviseSequential();
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef __WXMSW__
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+    const char* data;
+    size_t size;
+    bool opened;
+    wxString filename;
+    Compression compression;
+    std::unique_ptr<DecompressedBuffer> decompressed;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,42 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <vector>
+#include <cstddef>
+
+class CSVTable;
+
+// Tracks the memory held by every open document's table and evicts the
+// least recently used clean pages of inactive documents when over budget.
+// Evicted pages are re-parsed from the document's source file on access.
+class MemoryBudget {
+public:
+    static MemoryBudget& Get();
+    
+    void Register(CSVTable* table);
+    void Unregister(CSVTable* table);
+    
+    // The active document's pages are never evicted
+    void SetActive(CSVTable* table);
+    
+    size_t GetLimit() const { return limit; }
+    void SetLimit(size_t bytes);
+    size_t GetUsage() const;
+    
+    // Evict pages until usage fits the budget, returns the bytes freed
+    size_t Enforce();
+
+private:
+    MemoryBudget();
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+    
+    // Also evict when the system itself is running low on free memory
+    static const size_t LOW_MEMORY_BYTES = 256 * 1024 * 1024;
+    
+    std::vector<CSVTable*> tables;
+    CSVTable* active;
+    size_t limit;
+};
+
+#endif // MEMORYBUDGET_H
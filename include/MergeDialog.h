@@ -0,0 +1,36 @@
+#ifndef MERGEDIALOG_H
+#define MERGEDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/filepicker.h>
+#include "CSVJoin.h"
+#include "Translations.h"
+
+class MergeDialog : public wxDialog {
+public:
+    MergeDialog(wxWindow* parent, Language language, const wxString& leftFile);
+    
+    wxString GetLeftFile() const;
+    wxString GetRightFile() const;
+    wxString GetOutputFile() const;
+    bool GetHasHeader() const;
+    wxString GetLeftKeys() const;
+    wxString GetRightKeys() const;
+    CSVJoin::Type GetType() const;
+
+private:
+    wxFilePickerCtrl* leftPicker;
+    wxFilePickerCtrl* rightPicker;
+    wxFilePickerCtrl* outputPicker;
+    wxCheckBox* headerCheckBox;
+    wxTextCtrl* leftKeyText;
+    wxTextCtrl* rightKeyText;
+    wxChoice* typeChoice;
+    Language language;
+    
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // MERGEDIALOG_H
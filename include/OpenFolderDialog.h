@@ -0,0 +1,25 @@
+#ifndef OPENFOLDERDIALOG_H
+#define OPENFOLDERDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/filepicker.h>
+#include "Translations.h"
+
+class OpenFolderDialog : public wxDialog {
+public:
+    OpenFolderDialog(wxWindow* parent, Language language);
+    
+    // The folder alone, or the folder joined with the file name pattern
+    wxString GetPattern() const;
+
+private:
+    wxDirPickerCtrl* folderPicker;
+    wxTextCtrl* patternText;
+    Language language;
+    
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // OPENFOLDERDIALOG_H
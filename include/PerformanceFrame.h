@@ -0,0 +1,39 @@
+#ifndef PERFORMANCEFRAME_H
+#define PERFORMANCEFRAME_H
+
+#include <wx/wx.h>
+#include <wx/listctrl.h>
+#include <wx/timer.h>
+#include "Translations.h"
+
+// Live table of the profiler's per scope totals, refreshed every second.
+// Closing the window hides it and stops profiling.
+class PerformanceFrame : public wxFrame {
+public:
+    PerformanceFrame(wxWindow* parent, Language language);
+    
+    // Enable profiling and bring the window up
+    void Start();
+
+private:
+    enum {
+        ID_RESET = wxID_HIGHEST + 1,
+        ID_SAVE_TRACE
+    };
+    
+    Language language;
+    wxListCtrl* list;
+    wxTimer timer;
+    
+    void UpdateStats();
+    void OnTimer(wxTimerEvent& event);
+    void OnReset(wxCommandEvent& event);
+    void OnSaveTrace(wxCommandEvent& event);
+    void OnCloseWindow(wxCloseEvent& event);
+    
+    static const int REFRESH_MS = 1000;
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // PERFORMANCEFRAME_H
@@ -0,0 +1,60 @@
+#ifndef PIVOTFRAME_H
+#define PIVOTFRAME_H
+
+#include <wx/wx.h>
+#include <wx/grid.h>
+#include <wx/checklst.h>
+#include <wx/weakref.h>
+#include <memory>
+#include "CSVDocument.h"
+#include "PivotTable.h"
+#include "Translations.h"
+
+// Pivot of one document's table: row and column keys are ticked, aggregates
+// added to a list, and the result is recomputed into the grid on every
+// change. Edits made to the document afterwards show after Refresh.
+class PivotFrame : public wxFrame {
+public:
+    PivotFrame(wxWindow* parent, CSVDocument* document, Language language, int fontSize);
+
+private:
+    enum {
+        ID_ROW_KEYS = wxID_HIGHEST + 1,
+        ID_COLUMN_KEYS,
+        ID_ADD_VALUE,
+        ID_REMOVE_VALUE,
+        ID_REFRESH,
+        ID_EXPORT
+    };
+    
+    wxWeakRef<CSVDocument> document;
+    CSVTable* table;
+    Language language;
+    Encoding encoding;
+    wxChar separator;
+    std::unique_ptr<PivotTable> pivot;
+    std::vector<PivotTable::Value> values;
+    
+    wxCheckListBox* rowKeyList;
+    wxCheckListBox* columnKeyList;
+    wxChoice* valueColumnChoice;
+    wxChoice* functionChoice;
+    wxListBox* valueList;
+    wxGrid* grid;
+    CSVTable* result;   // owned by the grid
+    wxStaticText* status;
+    
+    bool IsSourceOpen() const;
+    void UpdatePivot();
+    void OnKeysChanged(wxCommandEvent& event);
+    void OnAddValue(wxCommandEvent& event);
+    void OnRemoveValue(wxCommandEvent& event);
+    void OnRefresh(wxCommandEvent& event);
+    void OnExport(wxCommandEvent& event);
+    
+    static const int AUTOSIZE_ROWS = 1000;
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // PIVOTFRAME_H
@@ -0,0 +1,94 @@
+#ifndef PIVOTTABLE_H
+#define PIVOTTABLE_H
+
+#include <wx/wx.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+class CSVTable;
+
+// Summary of a table with one row per combination of the row key values
+// and one column per combination of the column key values and aggregate.
+// Columns are read once into dictionary codes and kept, and rows are split
+// into partitions by the hash of their key and grouped in parallel, one
+// partition per task. The partitions are kept too, so changing only the
+// aggregates reads the cached codes instead of the table.
+class PivotTable {
+public:
+    enum class Function {
+        COUNT,
+        SUM,
+        AVG,
+        MIN,
+        MAX,
+        DISTINCT
+    };
+    
+    struct Value {
+        int column;
+        Function function;
+    };
+    
+    struct Layout {
+        std::vector<int> rowKeys;
+        std::vector<int> columnKeys;
+        std::vector<Value> values;
+    };
+    
+    explicit PivotTable(CSVTable& table);
+    ~PivotTable();
+    
+    // Result with the row keys first, rows sorted by key. False with a
+    // message when the keys have too many combinations to show.
+    bool Compute(const Layout& layout, std::unique_ptr<CSVTable>& result, wxString& error);
+    
+    // Forget what was read, after the table changed. Done by Compute
+    // itself when rows or columns were added or deleted since.
+    void Clear();
+    
+    static wxString GetFunctionName(Function function);
+    
+    static const size_t MAX_RESULT_COLUMNS = 2000;
+
+private:
+    // A column with each distinct value stored once
+    struct EncodedColumn {
+        std::vector<uint32_t> codes;      // per row
+        std::vector<wxString> values;     // per code
+        std::vector<uint32_t> ranks;      // per code, its position in sorted order
+        std::vector<double> numbers;      // per code, NaN for text
+        uint32_t emptyCode;               // code of the empty cell, or values.size()
+    };
+    
+    // Rows whose key hashes to one partition, numbered by group
+    struct Partition {
+        std::vector<uint32_t> rows;
+        std::vector<uint32_t> groupOfRow;   // parallel to rows
+        std::vector<uint64_t> groupKeys;    // packed key of each group
+    };
+    
+    // Row keys then column keys packed into one number, radix[i] is the
+    // weight of key i's code
+    struct Grouping {
+        std::vector<int> keys;
+        std::vector<uint64_t> radix;
+        std::vector<uint64_t> sizes;
+        std::vector<Partition> partitions;
+    };
+    
+    CSVTable& table;
+    std::map<int, std::unique_ptr<EncodedColumn>> columns;
+    std::unique_ptr<Grouping> grouping;
+    size_t cachedRows;    // table size the cache was read at
+    size_t cachedCols;
+    
+    void EncodeColumns(const std::vector<int>& cols);
+    bool GroupRows(const std::vector<int>& keys, wxString& error);
+    void Aggregate(const std::vector<Value>& values, std::vector<std::vector<wxString>>& cells);
+    
+    static const size_t PARTITIONS = 64;
+};
+
+#endif // PIVOTTABLE_H
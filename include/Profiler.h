@@ -0,0 +1,161 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <wx/wx.h>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+// Accumulated timings of one named scope
+struct ProfileStat {
+    const char* name;
+    uint64_t calls;
+    double totalMs;
+    double maxMs;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+};
+
+// Scoped timers and allocation counters around the expensive phases of
+// loading, parsing, saving and undo. While disabled a scope costs a single
+// relaxed atomic load; building with CSVPP_NO_PROFILER removes them
+// entirely. While enabled every scope is also kept as a trace event that
+// can be written in the Chrome trace format (chrome://tracing, Perfetto).
+class Profiler {
+public:
+    static Profiler& Get();
+    
+    static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+    void SetEnabled(bool enable);
+    
+    // Microseconds since the profiler was created
+    static int64_t Now();
+    
+    // Allocations made by the calling thread while profiling was enabled
+    static uint64_t GetThreadAllocations();
+    static uint64_t GetThreadAllocatedBytes();
+    static void CountAllocation(size_t bytes);
+    
+    void Record(const char* name, int depth, int64_t start, int64_t duration,
+                uint64_t allocations, uint64_t bytes);
+    
+    // Sample of a gauge such as a queue depth, written as a trace counter
+    void RecordCounter(const char* name, int64_t value);
+    
+    // Per scope totals sorted by total time, and the last outermost scope
+    // that finished on the main thread
+    std::vector<ProfileStat> GetStats() const;
+    bool GetLastOperation(wxString& name, double& ms) const;
+    void Reset();
+    
+    bool WriteTrace(const wxString& filename) const;
+
+private:
+    Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    
+    struct Event {
+        const char* name;
+        uint32_t thread;
+        int64_t start;
+        int64_t duration;
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+    
+    struct CounterSample {
+        const char* name;
+        int64_t time;
+        int64_t value;
+    };
+    
+    // Scope names are literals, but the same text may have several addresses
+    struct NameLess {
+        bool operator()(const char* a, const char* b) const { return strcmp(a, b) < 0; }
+    };
+    
+    static std::atomic<bool> enabled;
+    
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    std::vector<CounterSample> counters;
+    std::map<const char*, ProfileStat, NameLess> stats;
+    const char* lastName;
+    int64_t lastDuration;
+    
+    // Trace events beyond this are only counted in the totals
+    static const size_t MAX_EVENTS = 1000000;
+};
+
+// Times the enclosing scope, use through PROFILE_SCOPE. A deferred scope
+// (PROFILE_DEFERRED) is opened and closed explicitly, e.g. to time a wait
+// once rather than each of its retries, and closes with the enclosing scope
+// if still open.
+class ProfileScope {
+public:
+    ProfileScope() : name(nullptr) {}
+    
+    explicit ProfileScope(const char* scopeName)
+        : name(Profiler::IsEnabled() ? scopeName : nullptr) {
+        if (name) {
+            Begin();
+        }
+    }
+    
+    ~ProfileScope() {
+        if (name) {
+            End();
+        }
+    }
+    
+    // Open the scope unless it is already open
+    void Start(const char* scopeName) {
+        if (!name && Profiler::IsEnabled()) {
+            name = scopeName;
+            Begin();
+        }
+    }
+    
+    void Stop() {
+        if (name) {
+            End();
+            name = nullptr;
+        }
+    }
+
+private:
+    const char* name;
+    int depth;
+    int64_t start;
+    uint64_t allocations;
+    uint64_t bytes;
+    
+    void Begin();
+    void End();
+    
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#ifdef CSVPP_NO_PROFILER
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_DEFERRED(scope)
+#define PROFILE_START(scope, name)
+#define PROFILE_STOP(scope)
+#else
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) \
+    do { if (Profiler::IsEnabled()) Profiler::Get().RecordCounter(name, (int64_t)(value)); } while (0)
+#define PROFILE_DEFERRED(scope) ProfileScope scope
+#define PROFILE_START(scope, name) scope.Start(name)
+#define PROFILE_STOP(scope) scope.Stop()
+#endif
+
+#endif // PROFILER_H
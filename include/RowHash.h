@@ -0,0 +1,61 @@
+#ifndef ROWHASH_H
+#define ROWHASH_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic 64-bit hashing of fields and rows, used to compare
+// rows without keeping copies of them
+
+inline uint64_t HashMix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t HashBytes(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (length * 0x9e3779b97f4a7c15ULL);
+    
+    // Eight bytes at a time, then the tail
+    while (length >= 8) {
+        uint64_t k;
+        memcpy(&k, p, 8);
+        h = (h ^ HashMix(k)) * 0x9e3779b97f4a7c15ULL;
+        p += 8;
+        length -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p, length);
+    h ^= HashMix(tail ^ length);
+    return HashMix(h);
+}
+
+inline uint64_t HashField(const wxString& field, uint64_t seed) {
+    return HashBytes(field.wx_str(), field.length() * sizeof(wxStringCharType), seed);
+}
+
+// Hash of every field in order
+inline uint64_t HashRow(const std::vector<wxString>& fields) {
+    uint64_t h = 0x2545f4914f6cdd1dULL;
+    for (const wxString& field : fields) {
+        h = HashField(field, h);
+    }
+    return h;
+}
+
+// Hash of the selected columns only, missing columns hash as empty
+inline uint64_t HashColumns(const std::vector<wxString>& fields, const std::vector<int>& columns) {
+    uint64_t h = 0x2545f4914f6cdd1dULL;
+    for (int col : columns) {
+        h = HashField(col >= 0 && col < (int)fields.size() ? fields[col] : wxString(), h);
+    }
+    return h;
+}
+
+#endif // ROWHASH_H
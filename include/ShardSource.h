@@ -0,0 +1,54 @@
+#ifndef SHARDSOURCE_H
+#define SHARDSOURCE_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "CSVTable.h"
+
+// Pages backed by several CSV files of the same layout, shown as one table
+// whose first column names the file each row came from. The files stay
+// where they are, nothing is concatenated on disk. A page never spans two
+// files; its position holds the file's index above the byte offset in it.
+class ShardSource : public PageSource {
+public:
+    // Files of a folder (its CSV, text and compressed CSV files) or of a
+    // pattern with wildcards in the file name such as data\2024-*.csv,
+    // sorted by name. False when nothing matches.
+    static bool FindFiles(const wxString& pattern, wxArrayString& files);
+    
+    // Parse every file into table, a round of files at a time with one
+    // task per file. With a header the first row of every file must match
+    // the first file's and is returned in header. Columns select source
+    // columns as in CSVFileSource; cols is the widest row including the
+    // file column. Name is what the table is called, e.g. the pattern.
+    bool Load(const wxArrayString& files, const wxString& name, Encoding encoding, wxChar separator,
+              bool hasHeader, const std::vector<int>& columns, CSVTable& table,
+              std::vector<wxString>& header, size_t& cols, wxString& error,
+              const std::function<void(int)>& progress = nullptr);
+    
+    size_t GetFileCount() const { return shards.size(); }
+    
+    // The folder or pattern the files were found by
+    wxString GetFilename() const override { return name; }
+    bool ReadsFrom(const wxString& filename) const override;
+    
+    bool LoadRows(long long position, size_t rowCount,
+                  std::vector<std::vector<wxString>>& rows) override;
+    bool LoadSelectedColumns(long long position, size_t rowCount, const std::vector<int>& selected,
+                             std::vector<std::vector<wxString>>& loaded) override;
+
+private:
+    std::vector<std::unique_ptr<CSVFileSource>> shards;
+    std::vector<wxString> shardNames;   // shown in the file column
+    wxString name;
+    
+    bool Locate(long long position, size_t& shard, size_t& offset) const;
+    
+    // Offsets up to a terabyte, the file index goes above them
+    static const int OFFSET_BITS = 40;
+    static const size_t BLOCK_RECORDS = 4096;
+};
+
+#endif // SHARDSOURCE_H
@@ -0,0 +1,104 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "CSVParser.h"
+#include "CSVTable.h"
+#include "MappedFile.h"
+
+// Dialect of the CSV file a snapshot was taken from, used again on export
+struct SnapshotInfo {
+    Encoding encoding;
+    wxChar separator;
+    bool hasHeader;
+};
+
+// Native ".csvpp" format. The table is stored as blocks of PAGE_ROWS rows,
+// each holding one array per column (dictionary encoded when the column has
+// few distinct values) and compressed on its own, followed by a block index.
+//
+//   header   magic, version, dialect, row/column/block counts, index offset
+//   columns  label and width of every column
+//   blocks   zstd compressed column arrays
+//   index    offset, sizes and row count of every block
+//
+// Opening a snapshot only reads the header and index. Blocks are
+// decompressed straight into table pages when the grid first needs them.
+class Snapshot {
+public:
+    static const char* const EXTENSION;
+    
+    static bool IsSnapshotFile(const wxString& filename);
+    
+    // Write every row of the table, columnWidths may be empty
+    static bool Write(const wxString& filename, CSVTable& table, const SnapshotInfo& info,
+                      const std::vector<int>& columnWidths);
+
+private:
+    friend class SnapshotSource;
+    
+    enum ColumnKind : uint8_t {
+        PLAIN = 0,
+        DICTIONARY8 = 1,
+        DICTIONARY16 = 2
+    };
+    
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t encoding;
+        uint32_t separator;
+        uint32_t hasHeader;
+        uint64_t rowCount;
+        uint32_t columnCount;
+        uint32_t blockCount;
+        uint64_t indexOffset;
+    };
+    
+    struct BlockEntry {
+        uint64_t offset;
+        uint32_t compressedSize;
+        uint32_t rawSize;
+        uint32_t rowCount;
+        uint32_t reserved;
+    };
+    
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    
+    static std::string EncodeBlock(const std::vector<std::vector<wxString>>& columns, size_t rowCount);
+    static bool DecodeBlock(const char* data, size_t size, size_t rowCount, size_t columnCount,
+                            std::vector<std::vector<wxString>>& columns);
+};
+
+// Pages backed by the blocks of a snapshot file. Block i is page position i.
+class SnapshotSource : public PageSource {
+public:
+    bool Open(const wxString& filename);
+    
+    const SnapshotInfo& GetInfo() const { return info; }
+    const std::vector<wxString>& GetLabels() const { return labels; }
+    const std::vector<int>& GetColumnWidths() const { return columnWidths; }
+    size_t GetColumnCount() const { return labels.size(); }
+    size_t GetBlockCount() const { return blocks.size(); }
+    size_t GetBlockRows(size_t block) const { return blocks[block].rowCount; }
+    
+    wxString GetFilename() const override { return file.GetFilename(); }
+    
+    bool LoadRows(long long position, size_t rowCount,
+                  std::vector<std::vector<wxString>>& rows) override;
+    bool LoadColumns(long long position, size_t rowCount,
+                     std::vector<std::vector<wxString>>& columns) override;
+
+private:
+    MappedFile file;
+    SnapshotInfo info;
+    std::vector<wxString> labels;
+    std::vector<int> columnWidths;
+    std::vector<Snapshot::BlockEntry> blocks;
+};
+
+#endif // SNAPSHOT_H
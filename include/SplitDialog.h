@@ -0,0 +1,33 @@
+#ifndef SPLITDIALOG_H
+#define SPLITDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/filepicker.h>
+#include "CSVSplitter.h"
+#include "Translations.h"
+
+class SplitDialog : public wxDialog {
+public:
+    SplitDialog(wxWindow* parent, Language language, const wxString& inputFile);
+    
+    wxString GetInputFile() const;
+    wxString GetOutputFile() const;
+    bool GetHasHeader() const;
+    CSVSplitter::Mode GetMode() const;
+    // Rows, or bytes from the megabytes entered
+    size_t GetPartSize() const;
+
+private:
+    wxFilePickerCtrl* inputPicker;
+    wxFilePickerCtrl* outputPicker;
+    wxCheckBox* headerCheckBox;
+    wxChoice* modeChoice;
+    wxTextCtrl* sizeText;
+    Language language;
+    
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // SPLITDIALOG_H
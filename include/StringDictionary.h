@@ -0,0 +1,43 @@
+#ifndef STRINGDICTIONARY_H
+#define STRINGDICTIONARY_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <cstdint>
+
+// Distinct values of one column, numbered in order of first appearance.
+// Code 0 is always the empty string. Lookups go through an open addressing
+// table that keeps each entry's hash next to its code, so probing short
+// strings rarely touches the strings themselves.
+class StringDictionary {
+public:
+    typedef uint16_t Code;
+    static const size_t MAX_SIZE = 65536;
+    
+    StringDictionary();
+    
+    // Code of a value, added if new. Fails once the dictionary is full.
+    bool Intern(const wxString& value, Code& code);
+    bool Find(const wxString& value, Code& code) const;
+    
+    const wxString& GetValue(Code code) const { return values[code]; }
+    size_t GetSize() const { return values.size(); }
+    bool IsFull() const { return values.size() >= MAX_SIZE; }
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t entry;   // code + 1, 0 when the slot is free
+    };
+    
+    std::vector<wxString> values;
+    std::vector<Slot> slots;
+    
+    size_t Probe(const wxString& value, uint32_t hash) const;
+    void Grow();
+    
+    static uint32_t Hash(const wxString& value);
+};
+
+#endif // STRINGDICTIONARY_H
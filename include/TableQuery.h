@@ -0,0 +1,86 @@
+#ifndef TABLEQUERY_H
+#define TABLEQUERY_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <memory>
+#include "ColumnExpression.h"
+
+class CSVTable;
+
+// SQL subset run directly over a table:
+//   SELECT items [FROM name] [WHERE condition] [GROUP BY expressions]
+//   [ORDER BY items [ASC|DESC]] [LIMIT n]
+// Items, conditions and groups use the computed column expression syntax.
+// An item is *, an expression or COUNT(*), COUNT, SUM, AVG, MIN or MAX of
+// one, optionally named with AS. Pages are independent morsels spread over
+// the worker pool, each filtered, projected and aggregated a batch at a time.
+class TableQuery {
+public:
+    TableQuery();
+    
+    bool Parse(const wxString& sql, const std::vector<wxString>& columnNames, wxString& error);
+    
+    // Result as a new table with a label per item, owned by the caller
+    std::unique_ptr<CSVTable> Run(CSVTable& table) const;
+    
+    // Order of ORDER BY, MIN and MAX: empty cells, then numbers by value,
+    // then other text. The numbers are the cells' ParseNumber values.
+    static int CompareValues(const wxString& a, double aNumber, const wxString& b, double bNumber);
+
+private:
+    enum class Aggregate {
+        NONE,
+        COUNT_ALL,
+        COUNT,
+        SUM,
+        AVG,
+        MIN,
+        MAX
+    };
+    
+    struct Item {
+        wxString label;
+        wxString text;   // as written, to match ORDER BY terms
+        Aggregate aggregate;
+        ColumnExpression expression;
+    };
+    
+    // Column of the result rows to sort on. Expressions that are not
+    // selected are computed into extra columns after the items, which
+    // only a query that does not group can do.
+    struct SortKey {
+        int column;
+        ColumnExpression expression;
+        bool descending;
+    };
+    
+    struct Accumulator;
+    struct Group;
+    struct Partial;
+    struct Morsel;
+    
+    std::vector<Item> items;
+    bool hasWhere;
+    ColumnExpression where;
+    std::vector<ColumnExpression> groupBy;
+    std::vector<SortKey> orderBy;
+    long long limit;   // -1 without LIMIT
+    bool grouped;
+    
+    // Columns read by the condition, and by everything else but not the condition
+    std::vector<int> whereColumns;
+    std::vector<int> otherColumns;
+    
+    bool ParseItems(const wxString& text, const std::vector<wxString>& columnNames, wxString& error);
+    bool ParseOrderBy(const wxString& text, const std::vector<wxString>& columnNames, wxString& error);
+    void CollectColumns();
+    
+    void RunMorsel(const CSVTable& table, Morsel& morsel, Partial& partial) const;
+    void Project(Morsel& morsel, size_t offset, const std::vector<size_t>& selection, Partial& partial) const;
+    void Accumulate(Morsel& morsel, size_t offset, const std::vector<size_t>& selection, Partial& partial) const;
+    void FinishGroups(std::vector<Partial>& partials, std::vector<std::vector<wxString>>& rows) const;
+    void SortRows(std::vector<std::vector<wxString>>& rows) const;
+};
+
+#endif // TABLEQUERY_H
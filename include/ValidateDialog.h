@@ -0,0 +1,31 @@
+#ifndef VALIDATEDIALOG_H
+#define VALIDATEDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/filepicker.h>
+#include "Translations.h"
+
+class ValidateDialog : public wxDialog {
+public:
+    ValidateDialog(wxWindow* parent, Language language, const wxString& inputFile);
+    
+    wxString GetInputFile() const;
+    bool GetHasHeader() const;
+    // Empty when only the structure is checked
+    wxString GetSchemaFile() const;
+    // Empty when issues are only listed
+    wxString GetReportFile() const;
+
+private:
+    wxFilePickerCtrl* inputPicker;
+    wxFilePickerCtrl* schemaPicker;
+    wxFilePickerCtrl* reportPicker;
+    wxCheckBox* headerCheckBox;
+    Language language;
+    
+    void OnOK(wxCommandEvent& event);
+    
+    wxDECLARE_EVENT_TABLE();
+};
+
+#endif // VALIDATEDIALOG_H
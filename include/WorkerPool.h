@@ -0,0 +1,42 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Process-wide thread pool shared by all documents for parsing and other
+// data-parallel work. Callers of ParallelFor take part in the work, so it
+// is safe to call from inside a pool task.
+class WorkerPool {
+public:
+    static WorkerPool& Get();
+    
+    size_t GetThreadCount() const { return threads.size() + 1; }
+    
+    // Run fn(begin, end) over [0, count) in chunks of at least `grain` items
+    // and block until every chunk has completed
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+    
+    // Queue a task to run on a worker thread
+    void Submit(std::function<void()> task);
+
+private:
+    WorkerPool();
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+    
+    void WorkerLoop();
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,265 @@
+#include "CSVDiff.h"
+#include "RowHash.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/tokenzr.h>
+#include <algorithm>
+#include <numeric>
+
+CSVDiff::CSVDiff() {
+    for (File& file : files) {
+        file.columns = 0;
+    }
+}
+
+bool CSVDiff::DetectInput(const wxString& filename, bool hasHeader, Input& input) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
+    input.filename = filename;
+    input.hasHeader = hasHeader;
+    CSVParser::DetectFormat(file, input.encoding, input.separator);
+    return true;
+}
+
+bool CSVDiff::Compare(const Input& left, const Input& right, const wxString& keyColumns,
+                      wxString& error, const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("diff.compare");
+    entries.clear();
+    files[LEFT].input = left;
+    files[RIGHT].input = right;
+    
+    if (!ScanFile(files[LEFT], keyColumns, error, progress, 0) ||
+        !ScanFile(files[RIGHT], keyColumns, error, progress, 45)) {
+        return false;
+    }
+    
+    // Match rows with equal keys, pairing duplicates in file order
+    const std::vector<RowRecord>& leftRows = files[LEFT].rows;
+    const std::vector<RowRecord>& rightRows = files[RIGHT].rows;
+    std::vector<uint32_t> leftOrder = SortByKey(leftRows);
+    std::vector<uint32_t> rightOrder = SortByKey(rightRows);
+    if (progress) {
+        progress(95);
+    }
+    
+    size_t i = 0, j = 0;
+    while (i < leftOrder.size() || j < rightOrder.size()) {
+        if (j >= rightOrder.size() ||
+            (i < leftOrder.size() && leftRows[leftOrder[i]].key < rightRows[rightOrder[j]].key)) {
+            entries.push_back({Change::Removed, (long long)leftOrder[i], -1});
+            ++i;
+        } else if (i >= leftOrder.size() || rightRows[rightOrder[j]].key < leftRows[leftOrder[i]].key) {
+            entries.push_back({Change::Added, -1, (long long)rightOrder[j]});
+            ++j;
+        } else {
+            if (leftRows[leftOrder[i]].hash != rightRows[rightOrder[j]].hash) {
+                entries.push_back({Change::Modified, (long long)leftOrder[i], (long long)rightOrder[j]});
+            }
+            ++i;
+            ++j;
+        }
+    }
+    
+    // Report in file order, added rows go where they appear in the right file
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        long long positionA = a.leftRow >= 0 ? a.leftRow : a.rightRow;
+        long long positionB = b.leftRow >= 0 ? b.leftRow : b.rightRow;
+        if (positionA != positionB) {
+            return positionA < positionB;
+        }
+        if (a.leftRow != b.leftRow) {
+            return a.leftRow > b.leftRow;
+        }
+        return a.rightRow < b.rightRow;
+    });
+    
+    if (progress) {
+        progress(100);
+    }
+    return true;
+}
+
+size_t CSVDiff::GetCount(Change change) const {
+    return std::count_if(entries.begin(), entries.end(), [change](const Entry& entry) {
+        return entry.change == change;
+    });
+}
+
+bool CSVDiff::GetRow(Side side, long long row, std::vector<wxString>& fields) const {
+    const File& file = files[side];
+    if (row < 0 || row >= (long long)file.rows.size() || !file.mapping) {
+        return false;
+    }
+    
+    size_t offset = (size_t)file.rows[row].offset;
+    bool keepFirstEmpty = offset == CSVParser::GetDataOffset(*file.mapping, file.input.encoding);
+    std::vector<std::vector<wxString>> rows;
+    if (CSVParser::ParseRows(*file.mapping, offset, file.input.encoding, file.input.separator,
+                             1, keepFirstEmpty, rows) != 1) {
+        return false;
+    }
+    fields = std::move(rows[0]);
+    return true;
+}
+
+std::vector<int> CSVDiff::GetChangedCells(const std::vector<wxString>& left,
+                                          const std::vector<wxString>& right) {
+    std::vector<int> changed;
+    size_t count = wxMax(left.size(), right.size());
+    for (size_t col = 0; col < count; ++col) {
+        const wxString& a = col < left.size() ? left[col] : wxEmptyString;
+        const wxString& b = col < right.size() ? right[col] : wxEmptyString;
+        if (a != b) {
+            changed.push_back((int)col);
+        }
+    }
+    return changed;
+}
+
+bool CSVDiff::ScanFile(File& file, const wxString& keyColumns, wxString& error,
+                       const std::function<void(int)>& progress, int progressBase) {
+    file.rows.clear();
+    file.header.clear();
+    file.keyColumns.clear();
+    file.columns = 0;
+    
+    file.mapping.reset(new MappedFile());
+    if (!file.mapping->Open(file.input.filename)) {
+        error = wxString::Format("Cannot open %s", file.input.filename);
+        return false;
+    }
+    file.mapping->AdviseSequential();
+    
+    bool headerPending = file.input.hasHeader;
+    bool keysResolved = false;
+    wxString keyError;
+    double size = (double)wxMax(file.mapping->GetSize(), (size_t)1);
+    
+    // Only hashes and offsets are kept, rows are dropped batch by batch
+    CSVParser parser;
+    bool parsed = parser.ReadFile(*file.mapping, file.input.encoding, file.input.separator,
+                                  [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        size_t first = 0;
+        if (headerPending && !rows.empty()) {
+            file.header = rows[0];
+            file.columns = file.header.size();
+            headerPending = false;
+            first = 1;
+        }
+        if (!keysResolved) {
+            keysResolved = true;
+            if (!keyColumns.IsEmpty()) {
+                ResolveKeyColumns(keyColumns, file.header, file.keyColumns, keyError);
+            }
+        }
+        
+        size_t base = file.rows.size();
+        file.rows.resize(base + rows.size() - first);
+        WorkerPool::Get().ParallelFor(rows.size() - first, 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const std::vector<wxString>& fields = rows[first + i];
+                RowRecord& record = file.rows[base + i];
+                record.hash = HashRow(fields);
+                record.key = file.keyColumns.empty() ? record.hash : HashColumns(fields, file.keyColumns);
+                record.offset = offsets[first + i];
+            }
+        });
+        
+        for (size_t i = first; i < rows.size(); ++i) {
+            file.columns = wxMax(file.columns, rows[i].size());
+        }
+        if (progress && !offsets.empty()) {
+            progress(progressBase + (int)(45.0 * offsets.back() / size));
+        }
+    });
+    
+    if (!parsed) {
+        error = wxString::Format("Failed to read %s", file.input.filename);
+        return false;
+    }
+    if (!keyError.IsEmpty()) {
+        error = keyError;
+        return false;
+    }
+    return true;
+}
+
+bool CSVDiff::ResolveKeyColumns(const wxString& spec, const std::vector<wxString>& header,
+                                std::vector<int>& columns, wxString& error) {
+    columns.clear();
+    wxStringTokenizer tokenizer(spec, ",");
+    while (tokenizer.HasMoreTokens()) {
+        wxString name = tokenizer.GetNextToken().Trim().Trim(false);
+        if (name.IsEmpty()) {
+            continue;
+        }
+        
+        // Header names first, then 1-based column numbers
+        int found = -1;
+        for (size_t col = 0; col < header.size() && found < 0; ++col) {
+            if (header[col] == name) {
+                found = (int)col;
+            }
+        }
+        for (size_t col = 0; col < header.size() && found < 0; ++col) {
+            if (header[col].CmpNoCase(name) == 0) {
+                found = (int)col;
+            }
+        }
+        long number;
+        if (found < 0 && name.ToLong(&number) && number >= 1) {
+            found = (int)number - 1;
+        }
+        
+        if (found < 0) {
+            error = wxString::Format("Unknown key column: %s", name);
+            return false;
+        }
+        columns.push_back(found);
+    }
+    return true;
+}
+
+std::vector<uint32_t> CSVDiff::SortByKey(const std::vector<RowRecord>& rows) {
+    std::vector<uint32_t> order(rows.size());
+    std::iota(order.begin(), order.end(), 0);
+    
+    auto less = [&rows](uint32_t a, uint32_t b) {
+        return rows[a].key != rows[b].key ? rows[a].key < rows[b].key : a < b;
+    };
+    
+    // Sort one run per thread, then merge runs pairwise
+    size_t count = order.size();
+    size_t runs = WorkerPool::Get().GetThreadCount();
+    if (count < 65536 || runs < 2) {
+        std::sort(order.begin(), order.end(), less);
+        return order;
+    }
+    
+    size_t runLength = (count + runs - 1) / runs;
+    WorkerPool::Get().ParallelFor(runs, 1, [&](size_t begin, size_t end) {
+        for (size_t run = begin; run < end; ++run) {
+            size_t first = wxMin(run * runLength, count);
+            size_t last = wxMin(first + runLength, count);
+            std::sort(order.begin() + first, order.begin() + last, less);
+        }
+    });
+    
+    for (size_t width = runLength; width < count; width *= 2) {
+        size_t pairs = (count + 2 * width - 1) / (2 * width);
+        WorkerPool::Get().ParallelFor(pairs, 1, [&](size_t begin, size_t end) {
+            for (size_t pair = begin; pair < end; ++pair) {
+                size_t first = pair * 2 * width;
+                size_t middle = wxMin(first + width, count);
+                size_t last = wxMin(first + 2 * width, count);
+                if (middle < last) {
+                    std::inplace_merge(order.begin() + first, order.begin() + middle,
+                                       order.begin() + last, less);
+                }
+            }
+        });
+    }
+    return order;
+}
@@ -0,0 +1,1286 @@
+#include "CSVDocument.h"
+#include "Snapshot.h"
+#include "ShardSource.h"
+#include "ColumnExpression.h"
+#include "LargeCellRenderer.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/filename.h>
+#include <wx/msgdlg.h>
+#include <algorithm>
+
+CSVDocument::CSVDocument(wxWindow* parent, int fontSize, Language language)
+    : wxPanel(parent, wxID_ANY),
+      table(nullptr),
+      currentFontSize(fontSize),
+      currentLanguage(language),
+      currentEncoding(Encoding::UTF8),
+      currentSeparator(','),
+      isDirty(false),
+      hasHeaderRow(false),
+      isRestoringState(false) {
+    
+    // Create main table grid
+    grid = new wxGrid(this, wxID_ANY);
+    grid->EnableEditing(true);
+    grid->EnableDragGridSize(true);
+    grid->EnableDragColSize(true);
+    grid->EnableDragRowSize(false);
+    grid->SetDefaultCellOverflow(false);
+    grid->SetDefaultRenderer(new LargeCellRenderer());
+    
+    // Apply initial font size to grid based on Font setting
+    wxFont font = grid->GetDefaultCellFont();
+    font.SetPointSize(currentFontSize);
+    grid->SetDefaultCellFont(font);
+    
+    wxFont labelFont = grid->GetLabelFont();
+    labelFont.SetPointSize(currentFontSize);
+    grid->SetLabelFont(labelFont);
+    
+    CreateEmptyGrid(0, 0);
+    
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(grid, 1, wxEXPAND);
+    SetSizer(sizer);
+}
+
+CSVDocument::~CSVDocument() {
+    // Text still on the clipboard must not outlive the table
+    ReleaseCopy();
+}
+
+wxString CSVDocument::GetDisplayName() const {
+    if (currentFile.IsEmpty()) {
+        // Files opened together are named after their folder or pattern
+        PageSource* source = table ? table->GetSource() : nullptr;
+        if (source && !source->GetFilename().IsEmpty()) {
+            return wxFileName(source->GetFilename()).GetFullName();
+        }
+        return Translate("tab_untitled", currentLanguage);
+    }
+    return wxFileName(currentFile).GetFullName();
+}
+
+bool CSVDocument::IsUntouched() const {
+    return currentFile.IsEmpty() && !isDirty && undoStack.empty() && redoStack.empty();
+}
+
+bool CSVDocument::LoadFile(const wxString& filename, Encoding encoding,
+                           wxChar separator, bool hasHeader, const std::vector<int>& columns) {
+    PROFILE_SCOPE("document.load");
+    // Snapshots carry their own dialect
+    if (Snapshot::IsSnapshotFile(filename)) {
+        return LoadSnapshot(filename);
+    }
+    
+    std::shared_ptr<CSVFileSource> source = std::make_shared<CSVFileSource>();
+    if (!source->Open(filename)) {
+        wxMessageBox("Failed to load CSV file!", "Error", wxOK | wxICON_ERROR);
+        return false;
+    }
+    source->GetFile().AdviseSequential();
+    
+    // Rows stream straight into a fresh table, the header row becomes the labels
+    CSVTable* newTable = new CSVTable();
+    std::vector<wxString> headerRow;
+    bool headerPending = hasHeader;
+    size_t cols = 0;
+    
+    CSVParser parser;
+    bool loaded = parser.ReadFile(source->GetFile(), encoding, separator,
+                                  [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            cols = wxMax(cols, rows[i].size());
+            if (headerPending) {
+                headerRow = std::move(rows[i]);
+                headerPending = false;
+                continue;
+            }
+            newTable->AppendLoadedRow(rows[i], offsets[i]);
+        }
+    }, columns);
+    
+    if (!loaded) {
+        delete newTable;
+        wxMessageBox("Failed to load CSV file!", "Error", wxOK | wxICON_ERROR);
+        return false;
+    }
+    
+    if (cols == 0) {
+        delete newTable;
+        wxMessageBox("CSV file is empty!", "Warning", wxOK | wxICON_WARNING);
+        return false;
+    }
+    
+    // Without a header, selected columns keep the letters of their position in the file
+    std::vector<wxString> labels(cols);
+    for (size_t col = 0; col < cols; ++col) {
+        int sourceCol = col < columns.size() ? columns[col] : (int)col;
+        labels[col] = hasHeader ? (col < headerRow.size() ? headerRow[col] : wxString())
+                                : GetDefaultColumnLabel(sourceCol);
+    }
+    
+    // Pages reload from the file in the encoding it was actually read with
+    source->SetFormat(encoding, separator);
+    source->SetColumns(columns);
+    newTable->FinishLoad(labels, cols, source);
+    AttachTable(newTable);
+    
+    ApplyGridDimensions();
+    AutoSizeColumns();
+    
+    currentFile = filename;
+    currentEncoding = encoding;
+    currentSeparator = separator;
+    hasHeaderRow = hasHeader;
+    loadedColumns = columns;
+    isDirty = false;
+    
+    ClearHistory();
+    StartJournal();
+    return true;
+}
+
+bool CSVDocument::LoadShards(const wxArrayString& files, const wxString& name, Encoding encoding, wxChar separator,
+                             bool hasHeader, const std::vector<int>& columns, wxString& error,
+                             const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("document.load_shards");
+    std::shared_ptr<ShardSource> source = std::make_shared<ShardSource>();
+    CSVTable* newTable = new CSVTable();
+    std::vector<wxString> headerRow;
+    size_t cols = 0;
+    if (!source->Load(files, name, encoding, separator, hasHeader, columns, *newTable, headerRow, cols, error,
+                      progress)) {
+        delete newTable;
+        return false;
+    }
+    if (cols <= 1) {
+        delete newTable;
+        error = "The files are empty";
+        return false;
+    }
+    
+    // The file column comes first, the others are labelled as in LoadFile
+    std::vector<wxString> labels(cols);
+    labels[0] = Translate("shards_file_column", currentLanguage);
+    for (size_t col = 1; col < cols; ++col) {
+        size_t fileCol = col - 1;
+        int sourceCol = fileCol < columns.size() ? columns[fileCol] : (int)fileCol;
+        labels[col] = hasHeader ? (fileCol < headerRow.size() ? headerRow[fileCol] : wxString())
+                                : GetDefaultColumnLabel(sourceCol);
+    }
+    newTable->FinishLoad(labels, cols, source);
+    AttachTable(newTable);
+    
+    ApplyGridDimensions();
+    AutoSizeColumns();
+    
+    // Untitled like a query result, the combined rows exist in no one file
+    currentFile.Clear();
+    currentEncoding = encoding;
+    currentSeparator = separator;
+    hasHeaderRow = hasHeader;
+    loadedColumns.clear();
+    isDirty = true;
+    
+    // Journaled once it is saved, like a query result. A reused tab's
+    // journal still describes its blank grid and must not log these rows.
+    StopJournal(true);
+    ClearHistory();
+    return true;
+}
+
+bool CSVDocument::LoadSnapshot(const wxString& filename) {
+    PROFILE_SCOPE("document.load_snapshot");
+    std::shared_ptr<SnapshotSource> source = std::make_shared<SnapshotSource>();
+    if (!source->Open(filename)) {
+        wxMessageBox("Failed to load CSV file!", "Error", wxOK | wxICON_ERROR);
+        return false;
+    }
+    
+    // Every block stays in the file until the grid scrolls to it
+    CSVTable* newTable = new CSVTable();
+    for (size_t block = 0; block < source->GetBlockCount(); ++block) {
+        newTable->AppendSourcePage(source->GetBlockRows(block), (long long)block);
+    }
+    newTable->FinishLoad(source->GetLabels(), source->GetColumnCount(), source);
+    AttachTable(newTable);
+    
+    // Stored widths instead of measuring every row
+    ApplyGridDimensions();
+    const std::vector<int>& widths = source->GetColumnWidths();
+    for (size_t col = 0; col < widths.size(); ++col) {
+        if (widths[col] > 0) {
+            grid->SetColSize((int)col, widths[col]);
+        }
+    }
+    
+    const SnapshotInfo& info = source->GetInfo();
+    currentFile = filename;
+    currentEncoding = info.encoding;
+    currentSeparator = info.separator;
+    hasHeaderRow = info.hasHeader;
+    loadedColumns.clear();
+    isDirty = false;
+    
+    ClearHistory();
+    StartJournal();
+    return true;
+}
+
+bool CSVDocument::SaveFile(const wxString& filename) {
+    PROFILE_SCOPE("document.save");
+    // The mapped source cannot be overwritten while pages are read from it
+    PageSource* source = table->GetSource();
+    if (source && source->ReadsFrom(filename)) {
+        table->DetachSource();
+    }
+    
+    if (Snapshot::IsSnapshotFile(filename)) {
+        // The dialect is kept so the snapshot exports back to the same CSV
+        SnapshotInfo info = { currentEncoding, currentSeparator, hasHeaderRow };
+        std::vector<int> widths;
+        for (int col = 0; col < grid->GetNumberCols(); ++col) {
+            widths.push_back(grid->GetColSize(col));
+        }
+        if (!Snapshot::Write(filename, *table, info, widths)) {
+            return false;
+        }
+    } else {
+        // Rows stream from the table to the file, the header first if present
+        size_t headerRows = hasHeaderRow ? 1 : 0;
+        int cols = grid->GetNumberCols();
+        RowSource rows = [&](size_t row, std::vector<wxString>& fields) {
+            fields.resize(cols);
+            for (int col = 0; col < cols; ++col) {
+                if (row < headerRows) {
+                    fields[col] = grid->GetColLabelValue(col);
+                } else {
+                    // Copied into the writer's buffer, no string per cell
+                    table->CopyValue((int)(row - headerRows), col, fields[col]);
+                }
+            }
+        };
+        if (!CSVParser::WriteFile(filename, headerRows + grid->GetNumberRows(), rows,
+                                  currentSeparator, currentEncoding)) {
+            return false;
+        }
+    }
+    
+    isDirty = false;
+    currentFile = filename;
+    // The saved file holds exactly the loaded columns
+    loadedColumns.clear();
+    // The saved file now contains every journaled edit
+    StartJournal();
+    return true;
+}
+
+void CSVDocument::NewFile(int rows, int cols) {
+    currentFile.Clear();
+    hasHeaderRow = false;
+    loadedColumns.clear();
+    
+    // Create empty grid
+    CreateEmptyGrid(rows, cols);
+    
+    isDirty = false;
+    ClearHistory();
+    StartJournal(rows, cols);
+}
+
+void CSVDocument::CloseFile() {
+    NewFile(0, 0);
+}
+
+void CSVDocument::ShowQueryResult(CSVTable* result, Encoding encoding, wxChar separator) {
+    AttachTable(result);
+    ApplyGridDimensions();
+    AutoSizeColumns();
+    
+    currentFile.Clear();
+    currentEncoding = encoding;
+    currentSeparator = separator;
+    hasHeaderRow = true;
+    loadedColumns.clear();
+    isDirty = true;
+    
+    // Journaled once it is saved, the query can always be run again
+    ClearHistory();
+}
+
+void CSVDocument::AddRowBelow() {
+    int currentRow = grid->GetGridCursorRow();
+    if (currentRow < 0) {
+        currentRow = grid->GetNumberRows() - 1;
+    }
+    
+    // As many rows as are selected, below the last of them
+    int count = 1;
+    wxArrayInt selectedRows = grid->GetSelectedRows();
+    if (!selectedRows.IsEmpty()) {
+        count = selectedRows.GetCount();
+        currentRow = *std::max_element(selectedRows.begin(), selectedRows.end());
+    }
+    
+    UndoStep step;
+    step.kind = UndoStep::INSERT_ROWS;
+    step.top = currentRow + 1;
+    step.rows = count;
+    ApplyNewStep(step);
+}
+
+void CSVDocument::AddRowAbove() {
+    int currentRow = grid->GetGridCursorRow();
+    if (currentRow < 0) {
+        currentRow = 0;
+    }
+    
+    int count = 1;
+    wxArrayInt selectedRows = grid->GetSelectedRows();
+    if (!selectedRows.IsEmpty()) {
+        count = selectedRows.GetCount();
+        currentRow = *std::min_element(selectedRows.begin(), selectedRows.end());
+    }
+    
+    UndoStep step;
+    step.kind = UndoStep::INSERT_ROWS;
+    step.top = currentRow;
+    step.rows = count;
+    ApplyNewStep(step);
+}
+
+void CSVDocument::AddColumnRight() {
+    int currentCol = grid->GetGridCursorCol();
+    if (currentCol < 0) {
+        currentCol = grid->GetNumberCols() - 1;
+    }
+    
+    // As many columns as are selected, right of the last of them
+    int count = 1;
+    wxArrayInt selectedCols = grid->GetSelectedCols();
+    if (!selectedCols.IsEmpty()) {
+        count = selectedCols.GetCount();
+        currentCol = *std::max_element(selectedCols.begin(), selectedCols.end());
+    }
+    
+    InsertColumns(currentCol + 1, count);
+}
+
+void CSVDocument::AddColumnLeft() {
+    int currentCol = grid->GetGridCursorCol();
+    if (currentCol < 0) {
+        currentCol = 0;
+    }
+    
+    int count = 1;
+    wxArrayInt selectedCols = grid->GetSelectedCols();
+    if (!selectedCols.IsEmpty()) {
+        count = selectedCols.GetCount();
+        currentCol = *std::min_element(selectedCols.begin(), selectedCols.end());
+    }
+    
+    InsertColumns(currentCol, count);
+}
+
+void CSVDocument::InsertColumns(int pos, int count) {
+    PROFILE_SCOPE("edit.insert_columns");
+    UndoStep step;
+    step.kind = UndoStep::INSERT_COLUMNS;
+    step.left = pos;
+    step.cols = count;
+    ApplyNewStep(step);
+}
+
+void CSVDocument::DeleteSelectedRows() {
+    PROFILE_SCOPE("edit.delete_rows");
+    wxArrayInt selectedRows = grid->GetSelectedRows();
+    if (selectedRows.IsEmpty() && grid->GetGridCursorRow() >= 0) {
+        selectedRows.Add(grid->GetGridCursorRow());
+    }
+    if (selectedRows.IsEmpty()) {
+        return;
+    }
+    
+    // Only the deleted rows are kept for undo
+    UndoStep step;
+    step.kind = UndoStep::ROWS;
+    step.ranges = ToRanges(selectedRows);
+    ApplyNewStep(step);
+}
+
+void CSVDocument::DeleteSelectedColumns() {
+    PROFILE_SCOPE("edit.delete_columns");
+    wxArrayInt selectedCols = grid->GetSelectedCols();
+    if (selectedCols.IsEmpty() && grid->GetGridCursorCol() >= 0) {
+        selectedCols.Add(grid->GetGridCursorCol());
+    }
+    if (selectedCols.IsEmpty()) {
+        return;
+    }
+    
+    // Only the deleted columns are kept for undo
+    UndoStep step;
+    step.kind = UndoStep::DELETE_COLUMNS;
+    step.ranges = ToRanges(selectedCols);
+    ApplyNewStep(step);
+}
+
+CSVTable::RangeList CSVDocument::ToRanges(const wxArrayInt& indices) {
+    std::vector<size_t> sorted(indices.begin(), indices.end());
+    std::sort(sorted.begin(), sorted.end());
+    return ToRanges(sorted);
+}
+
+CSVTable::RangeList CSVDocument::ToRanges(const std::vector<size_t>& sorted) {
+    // Runs of consecutive indices become one range
+    CSVTable::RangeList ranges;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (!ranges.empty() && ranges.back().first + ranges.back().second == sorted[i]) {
+            ranges.back().second++;
+        } else if (ranges.empty() || ranges.back().first + ranges.back().second < sorted[i]) {
+            ranges.push_back(std::make_pair(sorted[i], (size_t)1));
+        }
+    }
+    return ranges;
+}
+
+void CSVDocument::RenameColumn(int col, const wxString& label) {
+    UndoStep step;
+    step.kind = UndoStep::HEADER;
+    step.left = col;
+    step.label = label;
+    step.headerRow = true;
+    ApplyNewStep(step);
+}
+
+bool CSVDocument::InsertComputedColumn(const wxString& name, const wxString& expression, wxString& error) {
+    PROFILE_SCOPE("edit.computed_column");
+    // Reject a bad expression before anything changes
+    ColumnExpression formula;
+    if (!formula.Compile(expression, GetColumnNames(), error)) {
+        return false;
+    }
+    
+    int currentCol = grid->GetGridCursorCol();
+    
+    UndoStep step;
+    step.kind = UndoStep::COLUMNS;
+    step.left = currentCol < 0 ? grid->GetNumberCols() : currentCol + 1;
+    step.label = name;
+    step.expression = expression;
+    
+    ReleaseCopy();
+    ApplyStep(step, false);
+    PushStep(undoStack, step);
+    DropRedo();
+    
+    isDirty = true;
+    return true;
+}
+
+size_t CSVDocument::SelectDuplicates(const std::vector<int>& columns, Deduplicator::Keep keep) {
+    PROFILE_SCOPE("edit.select_duplicates");
+    Deduplicator deduplicator(keep);
+    std::vector<size_t> rows = deduplicator.FindDuplicates(*table, columns);
+    grid->ClearSelection();
+    if (rows.empty()) {
+        return 0;
+    }
+    
+    // Cursor on the first duplicate, then whole rows selected range by range
+    int col = wxMax(grid->GetGridCursorCol(), 0);
+    grid->SetGridCursor((int)rows[0], col);
+    grid->MakeCellVisible((int)rows[0], col);
+    int lastCol = grid->GetNumberCols() - 1;
+    grid->BeginBatch();
+    for (const auto& range : ToRanges(rows)) {
+        grid->SelectBlock((int)range.first, 0, (int)(range.first + range.second - 1), lastCol, true);
+    }
+    grid->EndBatch();
+    return rows.size();
+}
+
+size_t CSVDocument::RemoveDuplicates(const std::vector<int>& columns, Deduplicator::Keep keep) {
+    PROFILE_SCOPE("edit.remove_duplicates");
+    Deduplicator deduplicator(keep);
+    std::vector<size_t> rows = deduplicator.FindDuplicates(*table, columns);
+    if (rows.empty()) {
+        return 0;
+    }
+    
+    UndoStep step;
+    step.kind = UndoStep::ROWS;
+    step.ranges = ToRanges(rows);
+    
+    ReleaseCopy();
+    ApplyStep(step, false);
+    PushStep(undoStack, step);
+    DropRedo();
+    
+    isDirty = true;
+    return rows.size();
+}
+
+bool CSVDocument::TransformColumn(int col, const ColumnTransform& transform) {
+    PROFILE_SCOPE("edit.transform_column");
+    if (col < 0 || col >= grid->GetNumberCols()) {
+        return false;
+    }
+    
+    UndoStep step;
+    step.kind = UndoStep::TRANSFORM;
+    step.left = col;
+    step.cols = 0;
+    step.expression = transform.Encode();
+    if (transform.GetOperation() == ColumnTransform::Operation::SPLIT) {
+        // The parts are counted once, redo inserts as many columns again
+        size_t parts = transform.CountParts(*table, col);
+        if (parts < 2) {
+            return false;
+        }
+        step.cols = (int)parts;
+    }
+    
+    ReleaseCopy();
+    ApplyStep(step, false);
+    if (step.cols == 0 && step.ranges.empty()) {
+        return false;
+    }
+    PushStep(undoStack, step);
+    DropRedo();
+    
+    isDirty = true;
+    return true;
+}
+
+std::vector<wxString> CSVDocument::GetColumnNames() const {
+    std::vector<wxString> names(grid->GetNumberCols());
+    for (size_t col = 0; col < names.size(); ++col) {
+        names[col] = grid->GetColLabelValue((int)col);
+    }
+    return names;
+}
+
+void CSVDocument::SetFormat(Encoding encoding, wxChar separator) {
+    currentEncoding = encoding;
+    currentSeparator = separator;
+    journal.RecordSetFormat(currentEncoding, currentSeparator);
+    isDirty = true;
+}
+
+void CSVDocument::PrepareCellEdit() {
+    // A pending copy still reads the cell as it is now
+    ReleaseCopy();
+}
+
+void CSVDocument::CellChanged(int row, int col, const wxString& previous) {
+    // The grid already holds the new value, so the step is as a paste
+    // leaves it once applied
+    UndoStep step;
+    step.kind = UndoStep::CELLS;
+    step.top = row;
+    step.left = col;
+    step.rows = 1;
+    step.cols = 1;
+    step.addedRows = 0;
+    step.addedCols = 0;
+    step.values.assign(1, previous);
+    PushStep(undoStack, step);
+    DropRedo();
+    
+    journal.RecordSetCell(row, col, grid->GetCellValue(row, col));
+    isDirty = true;
+}
+
+void CSVDocument::SetCell(int row, int col, const wxString& value) {
+    std::vector<std::vector<wxString>> rows(1, std::vector<wxString>(1, value));
+    PasteCells(row, col, rows);
+}
+
+bool CSVDocument::IsLargeCell(int row, int col) const {
+    return table->GetValueLength(row, col) > CSVTable::LARGE_CELL_CHARS;
+}
+
+std::shared_ptr<ClipboardCopy> CSVDocument::Copy() {
+    int rows = grid->GetNumberRows();
+    int cols = grid->GetNumberCols();
+    if (rows == 0 || cols == 0) {
+        return nullptr;
+    }
+    
+    // Bounding box of all selected blocks, the cursor cell without a selection
+    int top = rows, left = cols, bottom = -1, right = -1;
+    for (const wxGridBlockCoords& block : grid->GetSelectedBlocks()) {
+        top = wxMin(top, block.GetTopRow());
+        left = wxMin(left, block.GetLeftCol());
+        bottom = wxMax(bottom, block.GetBottomRow());
+        right = wxMax(right, block.GetRightCol());
+    }
+    if (bottom < 0 || right < 0) {
+        top = bottom = wxMax(grid->GetGridCursorRow(), 0);
+        left = right = wxMax(grid->GetGridCursorCol(), 0);
+    }
+    
+    // Nothing is read until the clipboard asks for the text
+    ReleaseCopy();
+    pendingCopy = std::make_shared<ClipboardCopy>(table, top, left, bottom, right);
+    return pendingCopy;
+}
+
+bool CSVDocument::Paste(const wxString& text) {
+    PROFILE_SCOPE("clipboard.paste");
+    if (text.IsEmpty()) {
+        return false;
+    }
+    
+    // Text copied from spreadsheets is tab separated, anything else is
+    // taken to use the document's separator
+    size_t firstBreak = text.find_first_of("\r\n");
+    wxChar separator = text.find('\t') < firstBreak ? wxChar('\t') : currentSeparator;
+    
+    std::vector<std::vector<wxString>> rows;
+    CSVParser::ParseText(text, separator, rows);
+    if (rows.empty()) {
+        return false;
+    }
+    
+    // Paste at the top left of the selection, or at the cursor
+    int top = wxMax(grid->GetGridCursorRow(), 0);
+    int left = wxMax(grid->GetGridCursorCol(), 0);
+    bool selected = false;
+    for (const wxGridBlockCoords& block : grid->GetSelectedBlocks()) {
+        top = selected ? wxMin(top, block.GetTopRow()) : block.GetTopRow();
+        left = selected ? wxMin(left, block.GetLeftCol()) : block.GetLeftCol();
+        selected = true;
+    }
+    
+    PasteCells(top, left, rows);
+    return true;
+}
+
+void CSVDocument::PasteCells(int top, int left, std::vector<std::vector<wxString>>& rows) {
+    UndoStep step;
+    step.kind = UndoStep::CELLS;
+    step.top = top;
+    step.left = left;
+    step.rows = (int)rows.size();
+    step.cols = 0;
+    for (const auto& row : rows) {
+        step.cols = wxMax(step.cols, (int)row.size());
+    }
+    step.addedRows = wxMax(0, top + step.rows - grid->GetNumberRows());
+    step.addedCols = wxMax(0, left + step.cols - grid->GetNumberCols());
+    
+    // The pasted values become the step, short rows clear the rest of their width
+    step.values.resize((size_t)step.rows * step.cols);
+    for (int row = 0; row < step.rows; ++row) {
+        for (size_t col = 0; col < rows[row].size(); ++col) {
+            step.values[(size_t)row * step.cols + col] = std::move(rows[row][col]);
+        }
+    }
+    rows.clear();
+    
+    // Applying it leaves the overwritten values behind, which is the undo step
+    ReleaseCopy();
+    ApplyStep(step, false);
+    PushStep(undoStack, step);
+    DropRedo();
+    
+    isDirty = true;
+}
+
+void CSVDocument::ReleaseCopy() {
+    if (pendingCopy) {
+        pendingCopy->Detach();
+        pendingCopy.reset();
+    }
+}
+
+void CSVDocument::ApplyNewStep(UndoStep& step) {
+    ReleaseCopy();
+    ApplyStep(step, false);
+    PushStep(undoStack, step);
+    DropRedo();
+    
+    isDirty = true;
+}
+
+void CSVDocument::Undo() {
+    if (undoStack.empty()) {
+        return;
+    }
+    
+    // Applying a step turns it into its inverse, which goes to the redo stack
+    UndoStep step = std::move(undoStack.back());
+    undoStack.pop_back();
+    ReleaseCopy();
+    ApplyStep(step, true);
+    PushStep(redoStack, step);
+    
+    isDirty = true;
+}
+
+void CSVDocument::Redo() {
+    if (redoStack.empty()) {
+        return;
+    }
+    
+    UndoStep step = std::move(redoStack.back());
+    redoStack.pop_back();
+    ReleaseCopy();
+    ApplyStep(step, false);
+    PushStep(undoStack, step);
+    
+    isDirty = true;
+}
+
+void CSVDocument::PushStep(std::deque<UndoStep>& stack, UndoStep& step) {
+    stack.push_back(std::move(step));
+    if (stack.size() > MAX_UNDO_LEVELS) {
+        stack.pop_front();
+    }
+}
+
+void CSVDocument::DropRedo() {
+    redoStack.clear();
+}
+
+void CSVDocument::ClearHistory() {
+    undoStack.clear();
+    redoStack.clear();
+}
+
+void CSVDocument::ApplyStep(UndoStep& step, bool undo) {
+    PROFILE_SCOPE("undo.apply");
+    if (step.kind == UndoStep::COLUMNS) {
+        ApplyColumnStep(step, undo);
+        return;
+    }
+    if (step.kind == UndoStep::ROWS) {
+        ApplyRowStep(step, undo);
+        return;
+    }
+    if (step.kind == UndoStep::TRANSFORM) {
+        ApplyTransformStep(step, undo);
+        return;
+    }
+    if (step.kind == UndoStep::INSERT_ROWS || step.kind == UndoStep::INSERT_COLUMNS) {
+        ApplyInsertStep(step, undo);
+        return;
+    }
+    if (step.kind == UndoStep::DELETE_COLUMNS) {
+        ApplyDeleteColumnStep(step, undo);
+        return;
+    }
+    if (step.kind == UndoStep::HEADER) {
+        ApplyHeaderStep(step);
+        return;
+    }
+    
+    isRestoringState = true;
+    grid->BeginBatch();
+    
+    // Redoing a paste first grows the grid to fit it
+    if (!undo && step.addedRows > 0) {
+        int pos = grid->GetNumberRows();
+        grid->AppendRows(step.addedRows);
+        journal.RecordInsertRows(pos, step.addedRows);
+    }
+    if (!undo && step.addedCols > 0) {
+        int pos = grid->GetNumberCols();
+        grid->AppendCols(step.addedCols);
+        journal.RecordInsertCols(pos, step.addedCols);
+        for (int col = pos; col < pos + step.addedCols; ++col) {
+            grid->SetColLabelValue(col, GetDefaultColumnLabel(col));
+            journal.RecordSetHeader(col, grid->GetColLabelValue(col), false);
+            grid->SetColSize(col, GetDefaultColumnWidth());
+        }
+    }
+    
+    // Swap the stored values with the grid's, straight through the table
+    size_t index = 0;
+    for (int row = step.top; row < step.top + step.rows; ++row) {
+        for (int col = step.left; col < step.left + step.cols; ++col, ++index) {
+            wxString previous = table->GetValue(row, col);
+            table->SetValue(row, col, step.values[index]);
+            journal.RecordSetCell(row, col, step.values[index]);
+            step.values[index] = std::move(previous);
+        }
+    }
+    
+    // Undoing it removes what the paste appended
+    if (undo && step.addedCols > 0) {
+        int pos = grid->GetNumberCols() - step.addedCols;
+        grid->DeleteCols(pos, step.addedCols);
+        journal.RecordDeleteCols(pos, step.addedCols);
+    }
+    if (undo && step.addedRows > 0) {
+        int pos = grid->GetNumberRows() - step.addedRows;
+        grid->DeleteRows(pos, step.addedRows);
+        journal.RecordDeleteRows(pos, step.addedRows);
+    }
+    
+    grid->EndBatch();
+    grid->ForceRefresh();
+    isRestoringState = false;
+}
+
+void CSVDocument::ApplyColumnStep(UndoStep& step, bool undo) {
+    isRestoringState = true;
+    grid->BeginBatch();
+    
+    // Undo drops the column, redo computes it again from the same cells
+    int col = step.left;
+    if (undo) {
+        grid->DeleteCols(col, 1);
+        journal.RecordDeleteCols(col, 1);
+    } else {
+        grid->InsertCols(col, 1);
+        journal.RecordInsertCols(col, 1);
+        grid->SetColLabelValue(col, step.label.IsEmpty() ? GetDefaultColumnLabel(col) : step.label);
+        journal.RecordSetHeader(col, grid->GetColLabelValue(col), !step.label.IsEmpty());
+        if (!step.label.IsEmpty()) {
+            hasHeaderRow = true;
+        }
+        grid->SetColSize(col, GetDefaultColumnWidth());
+        
+        wxString error;
+        FillComputedColumn(col, step.expression, error);
+        journal.RecordComputeColumn(col, step.expression);
+    }
+    
+    grid->EndBatch();
+    grid->ForceRefresh();
+    isRestoringState = false;
+}
+
+void CSVDocument::ApplyRowStep(UndoStep& step, bool undo) {
+    isRestoringState = true;
+    grid->BeginBatch();
+    
+    if (undo) {
+        // Ranges ascending, so each goes back at its original position
+        size_t index = 0;
+        for (const auto& range : step.ranges) {
+            grid->InsertRows((int)range.first, (int)range.second);
+            journal.RecordInsertRows((int)range.first, (int)range.second);
+            for (size_t row = range.first; row < range.first + range.second; ++row) {
+                for (int col = 0; col < step.cols; ++col, ++index) {
+                    if (!step.values[index].IsEmpty()) {
+                        table->SetValue((int)row, col, step.values[index]);
+                        journal.RecordSetCell((int)row, col, step.values[index]);
+                    }
+                }
+            }
+        }
+        // Redo reads the rows again
+        std::vector<wxString>().swap(step.values);
+    } else {
+        // Keep the rows before they go, one compaction pass deletes them all
+        step.cols = grid->GetNumberCols();
+        size_t count = 0;
+        for (const auto& range : step.ranges) {
+            count += range.second;
+        }
+        step.values.resize(count * step.cols);
+        size_t index = 0;
+        for (const auto& range : step.ranges) {
+            for (size_t row = range.first; row < range.first + range.second; ++row) {
+                for (int col = 0; col < step.cols; ++col, ++index) {
+                    table->CopyValue((int)row, col, step.values[index]);
+                }
+            }
+        }
+        
+        grid->ClearSelection();
+        table->DeleteRowRanges(step.ranges);
+        // Journaled last range first so replayed indices stay valid
+        for (size_t i = step.ranges.size(); i-- > 0;) {
+            journal.RecordDeleteRows((int)step.ranges[i].first, (int)step.ranges[i].second);
+        }
+    }
+    
+    grid->EndBatch();
+    grid->ForceRefresh();
+    isRestoringState = false;
+}
+
+void CSVDocument::ApplyTransformStep(UndoStep& step, bool undo) {
+    isRestoringState = true;
+    grid->BeginBatch();
+    
+    ColumnTransform transform;
+    transform.Decode(step.expression);
+    int col = step.left;
+    if (transform.GetOperation() == ColumnTransform::Operation::SPLIT) {
+        // Parts go to columns of their own, undo drops them and redo splits again
+        if (undo) {
+            grid->DeleteCols(col + 1, step.cols);
+            journal.RecordDeleteCols(col + 1, step.cols);
+        } else {
+            grid->InsertCols(col + 1, step.cols);
+            journal.RecordInsertCols(col + 1, step.cols);
+            wxString name = grid->GetColLabelValue(col);
+            for (int part = 1; part <= step.cols; ++part) {
+                int partCol = col + part;
+                grid->SetColLabelValue(partCol, hasHeaderRow ? wxString::Format("%s %d", name, part)
+                                                             : GetDefaultColumnLabel(partCol));
+                journal.RecordSetHeader(partCol, grid->GetColLabelValue(partCol), hasHeaderRow);
+                grid->SetColSize(partCol, GetDefaultColumnWidth());
+            }
+            transform.Split(*table, col, step.cols);
+            journal.RecordTransformColumn(col, step.cols, step.expression);
+        }
+    } else if (undo) {
+        // The changed cells get their previous values back, redo runs the transform again
+        std::vector<wxString> values;
+        size_t index = 0;
+        for (const auto& range : step.ranges) {
+            values.resize(range.second);
+            for (size_t i = 0; i < range.second; ++i, ++index) {
+                journal.RecordSetCell((int)(range.first + i), col, step.values[index]);
+                values[i].swap(step.values[index]);
+            }
+            table->WriteColumn(col, range.first, values);
+        }
+        std::vector<wxString>().swap(step.values);
+        CSVTable::RangeList().swap(step.ranges);
+    } else {
+        transform.Run(*table, col, step.ranges, step.values);
+        if (!step.ranges.empty()) {
+            journal.RecordTransformColumn(col, 0, step.expression);
+        }
+    }
+    
+    grid->EndBatch();
+    grid->ForceRefresh();
+    isRestoringState = false;
+}
+
+void CSVDocument::ApplyInsertStep(UndoStep& step, bool undo) {
+    isRestoringState = true;
+    grid->BeginBatch();
+    
+    // Inserted rows and columns are empty again by the time they are undone,
+    // so only their position is kept
+    if (step.kind == UndoStep::INSERT_ROWS) {
+        if (undo) {
+            grid->DeleteRows(step.top, step.rows);
+            journal.RecordDeleteRows(step.top, step.rows);
+        } else {
+            // New rows pick up the default row height
+            grid->InsertRows(step.top, step.rows);
+            journal.RecordInsertRows(step.top, step.rows);
+        }
+    } else if (undo) {
+        grid->DeleteCols(step.left, step.cols);
+        journal.RecordDeleteCols(step.left, step.cols);
+    } else {
+        grid->InsertCols(step.left, step.cols);
+        journal.RecordInsertCols(step.left, step.cols);
+        // Default labels and widths for the new columns only
+        for (int col = step.left; col < step.left + step.cols; ++col) {
+            grid->SetColLabelValue(col, GetDefaultColumnLabel(col));
+            journal.RecordSetHeader(col, grid->GetColLabelValue(col), false);
+            grid->SetColSize(col, GetDefaultColumnWidth());
+        }
+    }
+    
+    grid->EndBatch();
+    grid->ForceRefresh();
+    isRestoringState = false;
+}
+
+void CSVDocument::ApplyDeleteColumnStep(UndoStep& step, bool undo) {
+    isRestoringState = true;
+    grid->BeginBatch();
+    
+    if (undo) {
+        // Ranges ascending, so each goes back at its original position
+        size_t index = 0;
+        size_t values = 0;
+        std::vector<wxString> column;
+        for (const auto& range : step.ranges) {
+            grid->InsertCols((int)range.first, (int)range.second);
+            journal.RecordInsertCols((int)range.first, (int)range.second);
+            for (int col = (int)range.first; col < (int)(range.first + range.second); ++col, ++index) {
+                grid->SetColLabelValue(col, step.labels[index]);
+                journal.RecordSetHeader(col, step.labels[index], false);
+                grid->SetColSize(col, step.widths[index]);
+                
+                column.resize(step.rows);
+                for (int row = 0; row < step.rows; ++row, ++values) {
+                    if (!step.values[values].IsEmpty()) {
+                        journal.RecordSetCell(row, col, step.values[values]);
+                    }
+                    column[row].swap(step.values[values]);
+                }
+                table->WriteColumn(col, 0, column);
+            }
+        }
+        // Redo reads the columns again
+        std::vector<wxString>().swap(step.values);
+        std::vector<wxString>().swap(step.labels);
+        std::vector<int>().swap(step.widths);
+    } else {
+        // Keep the columns before they go. Evicted pages are parsed for just
+        // these columns and stay evicted.
+        std::vector<int> cols;
+        for (const auto& range : step.ranges) {
+            for (size_t col = range.first; col < range.first + range.second; ++col) {
+                cols.push_back((int)col);
+                step.labels.push_back(grid->GetColLabelValue((int)col));
+                step.widths.push_back(grid->GetColSize((int)col));
+            }
+        }
+        step.rows = grid->GetNumberRows();
+        step.values.resize(cols.size() * step.rows);
+        
+        size_t pageCount = table->GetPageCount();
+        std::vector<size_t> pageStarts(pageCount + 1, 0);
+        for (size_t page = 0; page < pageCount; ++page) {
+            pageStarts[page + 1] = pageStarts[page] + table->GetPageRows(page);
+        }
+        WorkerPool::Get().ParallelFor(pageCount, 1, [&](size_t begin, size_t end) {
+            std::vector<std::vector<wxString>> loaded;
+            for (size_t page = begin; page < end; ++page) {
+                table->LoadPageColumns(page, cols, loaded);
+                for (size_t i = 0; i < cols.size(); ++i) {
+                    for (size_t row = 0; row < loaded[i].size(); ++row) {
+                        step.values[i * step.rows + pageStarts[page] + row].swap(loaded[i][row]);
+                    }
+                }
+            }
+        });
+        
+        grid->ClearSelection();
+        table->DeleteColRanges(step.ranges);
+        // Journaled last range first so replayed indices stay valid
+        for (size_t i = step.ranges.size(); i-- > 0;) {
+            journal.RecordDeleteCols((int)step.ranges[i].first, (int)step.ranges[i].second);
+        }
+    }
+    
+    grid->EndBatch();
+    grid->ForceRefresh();
+    isRestoringState = false;
+}
+
+void CSVDocument::ApplyHeaderStep(UndoStep& step) {
+    // Swap the label and header row state with the table's
+    wxString label = grid->GetColLabelValue(step.left);
+    grid->SetColLabelValue(step.left, step.label);
+    journal.RecordSetHeader(step.left, step.label, step.headerRow);
+    step.label = label;
+    std::swap(step.headerRow, hasHeaderRow);
+}
+
+bool CSVDocument::FillComputedColumn(int col, const wxString& expression, wxString& error) {
+    // Columns are resolved as they were before this one was inserted
+    std::vector<wxString> names = GetColumnNames();
+    names.erase(names.begin() + col);
+    
+    ColumnExpression formula;
+    if (!formula.Compile(expression, names, error)) {
+        return false;
+    }
+    formula.Fill(*table, col);
+    return true;
+}
+
+void CSVDocument::AttachTable(CSVTable* newTable) {
+    ReleaseCopy();
+    
+    // The grid owns the table and deletes the previous one
+    grid->SetTable(newTable, true);
+    table = newTable;
+}
+
+void CSVDocument::SetFontSize(int fontSize) {
+    currentFontSize = fontSize;
+    
+    // Apply font size to all cells
+    wxFont font = grid->GetDefaultCellFont();
+    font.SetPointSize(currentFontSize);
+    grid->SetDefaultCellFont(font);
+    
+    // Apply to label cells as well
+    wxFont labelFont = grid->GetLabelFont();
+    labelFont.SetPointSize(currentFontSize);
+    grid->SetLabelFont(labelFont);
+    
+    // Apply row heights and column label height
+    int rowHeight = currentFontSize * 2 + 8;
+    grid->SetDefaultRowSize(rowHeight, true);
+    grid->SetColLabelSize(rowHeight);
+    
+    AutoSizeColumns();
+    
+    // Refresh grid
+    grid->ForceRefresh();
+}
+
+int CSVDocument::GetDefaultColumnWidth() const {
+    // Base width for font size 8 is 60 pixels
+    return (currentFontSize * 60) / 8;
+}
+
+wxString CSVDocument::GetDefaultColumnLabel(int col) const {
+    if (col < 26) {
+        return wxString((wxChar)('A' + col));
+    }
+    return wxString::Format("Col%d", col + 1);
+}
+
+void CSVDocument::ApplyGridDimensions() {
+    // Calculate row height based on font size
+    // Formula: fontSize * 2 + 8 pixels
+    int rowHeight = currentFontSize * 2 + 8;
+    
+    // Set row heights for all rows at once
+    grid->SetDefaultRowSize(rowHeight, true);
+    
+    // Set column label height
+    grid->SetColLabelSize(rowHeight);
+    
+    // Set column widths for all columns
+    grid->SetDefaultColSize(GetDefaultColumnWidth(), true);
+}
+
+void CSVDocument::AutoSizeColumns() {
+    PROFILE_SCOPE("document.autosize");
+    // Auto-size columns to fit content with 20% extra space
+    grid->AutoSizeColumns(false);
+    for (int col = 0; col < grid->GetNumberCols(); ++col) {
+        int width = grid->GetColSize(col);
+        grid->SetColSize(col, width + width / 5);
+    }
+}
+
+void CSVDocument::CreateEmptyGrid(int rows, int cols) {
+    // A fresh table also drops any mapping of a previously loaded file
+    CSVTable* newTable = new CSVTable();
+    std::vector<wxString> labels;
+    for (int i = 0; i < cols; ++i) {
+        labels.push_back(GetDefaultColumnLabel(i));
+    }
+    newTable->FinishLoad(labels, cols, nullptr);
+    if (rows > 0) {
+        newTable->AppendRows(rows);
+    }
+    AttachTable(newTable);
+    
+    // Apply grid dimensions based on current font size
+    ApplyGridDimensions();
+}
+
+void CSVDocument::StartJournal(int initialRows, int initialCols) {
+    JournalHeader header = EditJournal::MakeHeader(currentFile, currentEncoding, currentSeparator, hasHeaderRow);
+    header.initialRows = initialRows;
+    header.initialCols = initialCols;
+    header.columns = loadedColumns;
+    journal.Start(header);
+}
+
+bool CSVDocument::Recover(const wxString& path, const JournalHeader& header,
+                          const std::vector<JournalEntry>& entries, wxFileOffset validLength) {
+    PROFILE_SCOPE("journal.recover");
+    // Rebuild the state the journal was recorded over
+    if (header.sourceFile.IsEmpty()) {
+        currentFile.Clear();
+        currentEncoding = header.encoding;
+        currentSeparator = header.separator;
+        hasHeaderRow = false;
+        CreateEmptyGrid(header.initialRows, header.initialCols);
+    } else if (!LoadFile(header.sourceFile, header.encoding, header.separator, header.hasHeader, header.columns)) {
+        return false;
+    }
+    
+    // Replay cost is proportional to the number of journaled edits
+    grid->BeginBatch();
+    for (const auto& entry : entries) {
+        ApplyJournalEntry(entry);
+    }
+    grid->EndBatch();
+    
+    // Keep appending to the same journal so a second crash loses nothing
+    ClearHistory();
+    journal.Resume(path, header, validLength);
+    
+    isDirty = true;
+    return true;
+}
+
+void CSVDocument::ApplyJournalEntry(const JournalEntry& entry) {
+    int rows = grid->GetNumberRows();
+    int cols = grid->GetNumberCols();
+    
+    switch (entry.op) {
+        case JournalOp::SetCell:
+            if (entry.a >= 0 && entry.a < rows && entry.b >= 0 && entry.b < cols) {
+                grid->SetCellValue(entry.a, entry.b, entry.value);
+            }
+            break;
+        case JournalOp::InsertRows:
+            if (entry.a >= 0 && entry.a <= rows && entry.b > 0) {
+                grid->InsertRows(entry.a, entry.b);
+            }
+            break;
+        case JournalOp::DeleteRows:
+            if (entry.a >= 0 && entry.b > 0 && entry.a + entry.b <= rows) {
+                grid->DeleteRows(entry.a, entry.b);
+            }
+            break;
+        case JournalOp::InsertCols:
+            if (entry.a >= 0 && entry.a <= cols && entry.b > 0) {
+                grid->InsertCols(entry.a, entry.b);
+                for (int i = 0; i < entry.b; ++i) {
+                    grid->SetColSize(entry.a + i, GetDefaultColumnWidth());
+                }
+            }
+            break;
+        case JournalOp::DeleteCols:
+            if (entry.a >= 0 && entry.b > 0 && entry.a + entry.b <= cols) {
+                grid->DeleteCols(entry.a, entry.b);
+            }
+            break;
+        case JournalOp::SetHeader:
+            if (entry.a >= 0 && entry.a < cols) {
+                grid->SetColLabelValue(entry.a, entry.value);
+                if (entry.b) {
+                    hasHeaderRow = true;
+                }
+            }
+            break;
+        case JournalOp::Resize:
+            CreateEmptyGrid(entry.a, entry.b);
+            break;
+        case JournalOp::SetFormat:
+            currentEncoding = (Encoding)entry.a;
+            currentSeparator = (wxChar)entry.b;
+            break;
+        case JournalOp::ComputeColumn:
+            if (entry.a >= 0 && entry.a < cols) {
+                wxString error;
+                FillComputedColumn(entry.a, entry.value, error);
+            }
+            break;
+        case JournalOp::TransformColumn:
+            if (entry.a >= 0 && entry.a + entry.b < cols) {
+                ColumnTransform transform;
+                if (!transform.Decode(entry.value)) {
+                    break;
+                }
+                if (transform.GetOperation() == ColumnTransform::Operation::SPLIT) {
+                    transform.Split(*table, entry.a, entry.b);
+                } else {
+                    CSVTable::RangeList changed;
+                    std::vector<wxString> previous;
+                    transform.Run(*table, entry.a, changed, previous);
+                }
+            }
+            break;
+    }
+}
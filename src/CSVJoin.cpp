@@ -0,0 +1,429 @@
+#include "CSVJoin.h"
+#include "RowHash.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/filename.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Append the fields whose columns are not in skip (sorted), separated, and
+// return how many were appended
+size_t AppendFields(wxString& out, const std::vector<wxString>& fields,
+                    const std::vector<int>& skip, wxChar separator) {
+    size_t count = 0;
+    size_t next = 0;
+    for (size_t col = 0; col < fields.size(); ++col) {
+        if (next < skip.size() && skip[next] == (int)col) {
+            ++next;
+            continue;
+        }
+        if (count > 0) {
+            out += separator;
+        }
+        CSVParser::AppendField(out, fields[col], separator);
+        ++count;
+    }
+    return count;
+}
+
+// Empty fields up to width, an empty part already reads as one field
+void AppendPadding(wxString& out, size_t count, size_t width, wxChar separator) {
+    for (size_t i = wxMax(count, (size_t)1); i < width; ++i) {
+        out += separator;
+    }
+}
+
+// Key values quoted as in a CSV line, so different keys never give the same
+// text. Missing columns are empty, as in HashColumns.
+void AppendKey(wxString& out, const std::vector<wxString>& fields, const std::vector<int>& columns) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        int col = columns[i];
+        CSVParser::AppendField(out, col < (int)fields.size() ? fields[col] : wxString(), ',');
+    }
+}
+
+// A key with an empty value matches nothing, like NULL in SQL
+bool HasEmptyKey(const std::vector<wxString>& fields, const std::vector<int>& columns) {
+    for (int col : columns) {
+        if (col >= (int)fields.size() || fields[col].IsEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<int> SortedColumns(std::vector<int> columns) {
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+    return columns;
+}
+
+// Fields of a row of count columns left after skipping the sorted columns
+size_t CountFields(size_t count, const std::vector<int>& skip) {
+    size_t skipped = std::count_if(skip.begin(), skip.end(), [count](int col) {
+        return col < (int)count;
+    });
+    return count - skipped;
+}
+
+}
+
+CSVJoin::CSVJoin() : rowCount(0) {
+}
+
+bool CSVJoin::Run(const CSVDiff::Input& left, const CSVDiff::Input& right,
+                  const wxString& leftKeys, const wxString& rightKeys, Type type,
+                  const wxString& output, wxString& error,
+                  const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("join.run");
+    rowCount = 0;
+    
+    if (leftKeys.Strip(wxString::both).IsEmpty()) {
+        error = "No key columns given";
+        return false;
+    }
+    if (wxFileName(output).SameAs(wxFileName(left.filename)) ||
+        wxFileName(output).SameAs(wxFileName(right.filename))) {
+        error = "The output must be a different file than the inputs";
+        return false;
+    }
+    wxString rightSpec = rightKeys.Strip(wxString::both).IsEmpty() ? leftKeys : rightKeys;
+    
+    // Left and anti joins keep the left file's order and unmatched rows, so
+    // only an inner join is free to index whichever file is smaller
+    bool indexLeft = type == Type::INNER &&
+                     wxFileName::GetSize(left.filename) < wxFileName::GetSize(right.filename);
+    const CSVDiff::Input& streamed = indexLeft ? right : left;
+    wxChar separator = left.separator;
+    
+    Index index;
+    std::vector<int> indexKeys;
+    if (!BuildIndex(indexLeft ? left : right, indexLeft ? leftKeys : rightSpec, !indexLeft,
+                    separator, index, indexKeys, error, progress)) {
+        return false;
+    }
+    
+    MappedFile file;
+    if (!file.Open(streamed.filename)) {
+        error = wxString::Format("Cannot open %s", streamed.filename);
+        return false;
+    }
+    file.AdviseSequential();
+    CSVWriter writer;
+    if (!writer.Open(output, left.encoding)) {
+        error = wxString::Format("Cannot write %s", output);
+        return false;
+    }
+    
+    // The streamed file's width is taken from its first line, rows of a
+    // ragged left file that are wider push the right columns along
+    size_t leftWidth = indexLeft ? index.width : 0;
+    size_t rightWidth = type == Type::ANTI ? 0 : indexLeft ? 0 : index.width;
+    std::vector<int> streamKeys;
+    std::vector<int> streamSkip;
+    const std::vector<int> none;
+    
+    auto appendIndexed = [&](wxString& line, uint32_t row, size_t width) {
+        size_t start = index.starts[row] + index.keyLengths[row];
+        line.append(index.text.data() + start, index.starts[row + 1] - start);
+        AppendPadding(line, index.fieldCounts[row], width, separator);
+    };
+    
+    // A row of the streamed file joined with an indexed row, or with nothing
+    auto appendRow = [&](wxString& line, const std::vector<wxString>& fields, long long row) {
+        if (indexLeft) {
+            appendIndexed(line, (uint32_t)row, leftWidth);
+            if (rightWidth > 0) {
+                line += separator;
+                AppendPadding(line, AppendFields(line, fields, streamSkip, separator), rightWidth, separator);
+            }
+        } else {
+            AppendPadding(line, AppendFields(line, fields, none, separator), leftWidth, separator);
+            if (rightWidth > 0) {
+                line += separator;
+                if (row >= 0) {
+                    appendIndexed(line, (uint32_t)row, rightWidth);
+                } else {
+                    AppendPadding(line, 0, rightWidth, separator);
+                }
+            }
+        }
+        line += wxT("\r\n");
+    };
+    
+    auto appendHeader = [&](wxString& line, const std::vector<wxString>& streamedHeader) {
+        const std::vector<wxString>& leftNames = indexLeft ? index.header : streamedHeader;
+        AppendPadding(line, AppendFields(line, leftNames, none, separator), leftWidth, separator);
+        if (rightWidth > 0) {
+            line += separator;
+            size_t count = indexLeft ? AppendFields(line, streamedHeader, streamSkip, separator)
+                                     : AppendFields(line, index.header, none, separator);
+            AppendPadding(line, count, rightWidth, separator);
+        }
+        line += wxT("\r\n");
+    };
+    
+    bool headerPending = streamed.hasHeader;
+    bool headerWritten = !left.hasHeader;
+    bool keysResolved = false;
+    bool writeFailed = false;
+    wxString keyError;
+    double size = (double)wxMax(file.GetSize(), (size_t)1);
+    
+    CSVParser parser;
+    Encoding encoding = streamed.encoding;
+    bool parsed = parser.ReadFile(file, encoding, streamed.separator,
+                                  [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        if (rows.empty() || !keyError.IsEmpty() || writeFailed) {
+            return;
+        }
+        size_t first = 0;
+        std::vector<wxString> header;
+        if (headerPending) {
+            header = rows[0];
+            headerPending = false;
+            first = 1;
+        }
+        if (!keysResolved) {
+            keysResolved = true;
+            if (CSVDiff::ResolveKeyColumns(indexLeft ? rightSpec : leftKeys, header, streamKeys, keyError) &&
+                streamKeys.size() != indexKeys.size()) {
+                keyError = wxString::Format("The files have %d and %d key columns",
+                                            (int)(indexLeft ? indexKeys.size() : streamKeys.size()),
+                                            (int)(indexLeft ? streamKeys.size() : indexKeys.size()));
+            }
+            if (!keyError.IsEmpty()) {
+                return;
+            }
+            if (indexLeft) {
+                streamSkip = SortedColumns(streamKeys);
+                rightWidth = CountFields(rows[0].size(), streamSkip);
+            } else {
+                leftWidth = rows[0].size();
+            }
+            if (!headerWritten) {
+                wxString line;
+                appendHeader(line, header);
+                writeFailed = !writer.Write(line);
+                headerWritten = true;
+            }
+        }
+        
+        // Blocks of rows are probed in parallel, each into its own text,
+        // and written in order
+        size_t count = rows.size() - first;
+        size_t blocks = (count + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        std::vector<wxString> lines(blocks);
+        std::vector<size_t> written(blocks, 0);
+        WorkerPool::Get().ParallelFor(blocks, 1, [&](size_t begin, size_t end) {
+            wxString key;
+            for (size_t block = begin; block < end; ++block) {
+                size_t last = wxMin((block + 1) * BLOCK_ROWS, count);
+                for (size_t i = block * BLOCK_ROWS; i < last; ++i) {
+                    const std::vector<wxString>& fields = rows[first + i];
+                    bool found = false;
+                    uint64_t hash = 0;
+                    uint64_t bucket = 0;
+                    uint32_t candidates = 0;
+                    if (!HasEmptyKey(fields, streamKeys)) {
+                        key.clear();
+                        AppendKey(key, fields, streamKeys);
+                        hash = HashColumns(fields, streamKeys);
+                        bucket = hash & index.mask;
+                        candidates = index.bucketStarts[bucket + 1];
+                    }
+                    for (uint32_t j = index.bucketStarts[bucket]; j < candidates; ++j) {
+                        uint32_t row = index.bucketRows[j];
+                        if (index.keys[row] != hash || !KeyEquals(index, row, key)) {
+                            continue;
+                        }
+                        found = true;
+                        if (type == Type::ANTI) {
+                            break;
+                        }
+                        appendRow(lines[block], fields, row);
+                        ++written[block];
+                    }
+                    if (!found && type != Type::INNER) {
+                        appendRow(lines[block], fields, -1);
+                        ++written[block];
+                    }
+                }
+            }
+        });
+        
+        for (size_t block = 0; block < blocks && !writeFailed; ++block) {
+            writeFailed = !writer.Write(lines[block]);
+            rowCount += written[block];
+        }
+        if (progress && !offsets.empty()) {
+            progress(40 + (int)(60.0 * offsets.back() / size));
+        }
+    });
+    
+    if (!parsed) {
+        error = wxString::Format("Failed to read %s", streamed.filename);
+        return false;
+    }
+    if (!keyError.IsEmpty()) {
+        error = keyError;
+        return false;
+    }
+    // An empty right file still gets the indexed left file's header
+    if (!headerWritten && indexLeft) {
+        wxString line;
+        appendHeader(line, std::vector<wxString>());
+        writeFailed = !writer.Write(line);
+    }
+    if (writeFailed || !writer.Close()) {
+        error = wxString::Format("Cannot write %s", output);
+        return false;
+    }
+    if (progress) {
+        progress(100);
+    }
+    return true;
+}
+
+bool CSVJoin::BuildIndex(const CSVDiff::Input& input, const wxString& keySpec, bool skipKeys,
+                         wxChar separator, Index& index, std::vector<int>& keyColumns,
+                         wxString& error, const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("join.index");
+    MappedFile file;
+    if (!file.Open(input.filename)) {
+        error = wxString::Format("Cannot open %s", input.filename);
+        return false;
+    }
+    file.AdviseSequential();
+    
+    index.starts.assign(1, 0);
+    index.width = 0;
+    bool headerPending = input.hasHeader;
+    bool keysResolved = false;
+    bool tooLarge = false;
+    std::vector<int> skip;
+    std::vector<char> emptyKeys;
+    wxString keyError;
+    double size = (double)wxMax(file.GetSize(), (size_t)1);
+    
+    CSVParser parser;
+    Encoding encoding = input.encoding;
+    bool parsed = parser.ReadFile(file, encoding, input.separator,
+                                  [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        if (rows.empty() || !keyError.IsEmpty() || tooLarge) {
+            return;
+        }
+        size_t first = 0;
+        std::vector<wxString> header;
+        if (headerPending) {
+            header = rows[0];
+            headerPending = false;
+            first = 1;
+        }
+        if (!keysResolved) {
+            keysResolved = true;
+            if (!CSVDiff::ResolveKeyColumns(keySpec, header, keyColumns, keyError)) {
+                return;
+            }
+            if (skipKeys) {
+                skip = SortedColumns(keyColumns);
+            }
+            for (size_t col = 0; col < header.size(); ++col) {
+                if (!std::binary_search(skip.begin(), skip.end(), (int)col)) {
+                    index.header.push_back(header[col]);
+                }
+            }
+            index.width = index.header.size();
+        }
+        
+        size_t count = rows.size() - first;
+        size_t base = index.keys.size();
+        if (base + count >= UINT32_MAX) {
+            tooLarge = true;
+            return;
+        }
+        
+        // Format in parallel, then copy each row's text to its place
+        std::vector<wxString> lines(count);
+        index.keys.resize(base + count);
+        index.keyLengths.resize(base + count);
+        index.fieldCounts.resize(base + count);
+        emptyKeys.resize(base + count);
+        WorkerPool::Get().ParallelFor(count, 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const std::vector<wxString>& fields = rows[first + i];
+                AppendKey(lines[i], fields, keyColumns);
+                index.keyLengths[base + i] = (uint32_t)lines[i].length();
+                index.fieldCounts[base + i] = (uint32_t)AppendFields(lines[i], fields, skip, separator);
+                index.keys[base + i] = HashColumns(fields, keyColumns);
+                emptyKeys[base + i] = HasEmptyKey(fields, keyColumns);
+            }
+        });
+        
+        index.starts.resize(base + count + 1);
+        for (size_t i = 0; i < count; ++i) {
+            index.starts[base + i + 1] = index.starts[base + i] + lines[i].length();
+            index.width = wxMax(index.width, (size_t)index.fieldCounts[base + i]);
+        }
+        index.text.resize(index.starts.back());
+        WorkerPool::Get().ParallelFor(count, 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                memcpy(index.text.data() + index.starts[base + i], lines[i].wx_str(),
+                       lines[i].length() * sizeof(wxChar));
+            }
+        });
+        
+        if (progress && !offsets.empty()) {
+            progress((int)(40.0 * offsets.back() / size));
+        }
+    });
+    
+    if (!parsed) {
+        error = wxString::Format("Failed to read %s", input.filename);
+        return false;
+    }
+    if (!keyError.IsEmpty()) {
+        error = keyError;
+        return false;
+    }
+    if (tooLarge) {
+        error = wxString::Format("%s has too many rows to index", input.filename);
+        return false;
+    }
+    
+    // Bucket the rows by hash, counting first, then placing them in order.
+    // Rows with an empty key are left out, nothing can match them.
+    size_t rows = index.keys.size();
+    size_t buckets = 1;
+    while (buckets < rows) {
+        buckets <<= 1;
+    }
+    index.mask = buckets - 1;
+    index.bucketStarts.assign(buckets + 1, 0);
+    for (size_t row = 0; row < rows; ++row) {
+        if (!emptyKeys[row]) {
+            ++index.bucketStarts[(index.keys[row] & index.mask) + 1];
+        }
+    }
+    for (size_t bucket = 0; bucket < buckets; ++bucket) {
+        index.bucketStarts[bucket + 1] += index.bucketStarts[bucket];
+    }
+    std::vector<uint32_t> next(index.bucketStarts.begin(), index.bucketStarts.end() - 1);
+    index.bucketRows.resize(index.bucketStarts.back());
+    for (size_t row = 0; row < rows; ++row) {
+        if (!emptyKeys[row]) {
+            index.bucketRows[next[index.keys[row] & index.mask]++] = (uint32_t)row;
+        }
+    }
+    return true;
+}
+
+bool CSVJoin::KeyEquals(const Index& index, uint32_t row, const wxString& key) {
+    return index.keyLengths[row] == key.length() &&
+           memcmp(index.text.data() + index.starts[row], key.wx_str(), key.length() * sizeof(wxChar)) == 0;
+}
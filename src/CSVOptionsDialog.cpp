@@ -1,13 +1,24 @@
 #include "CSVOptionsDialog.h"
+#include <wx/config.h>
+#include <wx/textdlg.h>
+#include <wx/tokenzr.h>
+#include <algorithm>
 
 wxBEGIN_EVENT_TABLE(CSVOptionsDialog, wxDialog)
     EVT_CHOICE(wxID_ANY, CSVOptionsDialog::OnSeparatorChoice)
+    EVT_BUTTON(ID_SELECT_ALL, CSVOptionsDialog::OnSelectAll)
+    EVT_BUTTON(ID_SELECT_NONE, CSVOptionsDialog::OnSelectNone)
+    EVT_BUTTON(ID_SAVE_COLUMN_SET, CSVOptionsDialog::OnSaveColumnSet)
+    EVT_BUTTON(ID_RESAMPLE, CSVOptionsDialog::OnResample)
+    EVT_CHECKBOX(wxID_ANY, CSVOptionsDialog::OnHeaderCheck)
     EVT_BUTTON(wxID_OK, CSVOptionsDialog::OnOK)
 wxEND_EVENT_TABLE()
 
 CSVOptionsDialog::CSVOptionsDialog(wxWindow* parent, Encoding detectedEncoding,
-                                   wxChar detectedSeparator, bool hasHeader)
+                                   wxChar detectedSeparator, bool hasHeader,
+                                   const wxString& filename)
     : wxDialog(parent, wxID_ANY, "CSV Import Options", wxDefaultPosition, wxSize(400, 250)),
+      columnList(nullptr), columnSetChoice(nullptr), previewChoice(nullptr), previewGrid(nullptr),
       detectedEnc(detectedEncoding), detectedSep(detectedSeparator), customSeparator(',') {
     
     wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
@@ -70,6 +81,57 @@ CSVOptionsDialog::CSVOptionsDialog(wxWindow* parent, Encoding detectedEncoding,
     headerCheckBox->SetValue(hasHeader);
     mainSizer->Add(headerCheckBox, 0, wxALL, 5);
     
+    // Columns to load and a preview, both from the start of the file
+    if (!filename.IsEmpty() && file.Open(filename)) {
+        wxBoxSizer* fileSizer = new wxBoxSizer(wxHORIZONTAL);
+        wxBoxSizer* columnSizer = new wxBoxSizer(wxVERTICAL);
+        
+        columnSizer->Add(new wxStaticText(this, wxID_ANY, "Columns to load:"), 0, wxALL, 5);
+        columnList = new wxCheckListBox(this, wxID_ANY, wxDefaultPosition, wxSize(260, -1));
+        columnSizer->Add(columnList, 1, wxLEFT | wxRIGHT | wxEXPAND, 5);
+        
+        wxBoxSizer* selectSizer = new wxBoxSizer(wxHORIZONTAL);
+        selectSizer->Add(new wxButton(this, ID_SELECT_ALL, "All"), 0, wxRIGHT, 5);
+        selectSizer->Add(new wxButton(this, ID_SELECT_NONE, "None"), 0);
+        columnSizer->Add(selectSizer, 0, wxALL, 5);
+        
+        // Named column sets are kept across sessions
+        wxBoxSizer* setSizer = new wxBoxSizer(wxHORIZONTAL);
+        setSizer->Add(new wxStaticText(this, wxID_ANY, "Column set:"), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 5);
+        columnSetChoice = new wxChoice(this, wxID_ANY);
+        setSizer->Add(columnSetChoice, 1, wxRIGHT, 5);
+        setSizer->Add(new wxButton(this, ID_SAVE_COLUMN_SET, "Save Set..."), 0);
+        columnSizer->Add(setSizer, 0, wxALL | wxEXPAND, 5);
+        fileSizer->Add(columnSizer, 0, wxEXPAND);
+        
+        // Preview of the first rows or of rows sampled across the whole file
+        wxBoxSizer* previewSizer = new wxBoxSizer(wxVERTICAL);
+        wxBoxSizer* modeSizer = new wxBoxSizer(wxHORIZONTAL);
+        modeSizer->Add(new wxStaticText(this, wxID_ANY, "Preview:"), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 5);
+        wxArrayString modes;
+        modes.Add(wxString::Format("First %d rows", (int)PREVIEW_ROWS));
+        modes.Add(wxString::Format("%d random rows", (int)PREVIEW_ROWS));
+        previewChoice = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, modes);
+        previewChoice->SetSelection(0);
+        modeSizer->Add(previewChoice, 0, wxRIGHT, 5);
+        modeSizer->Add(new wxButton(this, ID_RESAMPLE, "New Sample"), 0);
+        previewSizer->Add(modeSizer, 0, wxALL, 5);
+        
+        previewGrid = new wxGrid(this, wxID_ANY);
+        previewGrid->CreateGrid(0, 0);
+        previewGrid->EnableEditing(false);
+        previewGrid->SetRowLabelSize(50);
+        previewSizer->Add(previewGrid, 1, wxLEFT | wxRIGHT | wxEXPAND, 5);
+        fileSizer->Add(previewSizer, 1, wxEXPAND);
+        
+        mainSizer->Add(fileSizer, 1, wxEXPAND);
+        
+        LoadColumns();
+        LoadColumnSets();
+        LoadPreview();
+        SetSize(wxSize(900, 620));
+    }
+    
     // Buttons
     wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
     mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
@@ -79,7 +141,16 @@ CSVOptionsDialog::CSVOptionsDialog(wxWindow* parent, Encoding detectedEncoding,
 }
 
 void CSVOptionsDialog::OnSeparatorChoice(wxCommandEvent& event) {
-    if (separatorChoice->GetSelection() == 3) { // Custom
+    if (columnSetChoice && event.GetEventObject() == columnSetChoice) {
+        ApplyColumnSet();
+        return;
+    }
+    if (previewChoice && event.GetEventObject() == previewChoice) {
+        LoadPreview();
+        return;
+    }
+    
+    if (event.GetEventObject() == separatorChoice && separatorChoice->GetSelection() == 3) { // Custom
         wxTextEntryDialog dialog(this, "Enter custom separator character:",
                                 "Custom Separator", ",");
         if (dialog.ShowModal() == wxID_OK) {
@@ -96,6 +167,170 @@ void CSVOptionsDialog::OnSeparatorChoice(wxCommandEvent& event) {
             separatorChoice->SetSelection(0);
         }
     }
+    
+    // The first row depends on both the encoding and the separator
+    LoadColumns();
+    LoadPreview();
+}
+
+void CSVOptionsDialog::LoadColumns() {
+    if (!columnList) {
+        return;
+    }
+    
+    // Only the first record is parsed, however large the file is
+    Encoding encoding = CSVParser::ResolveEncoding(file, GetSelectedEncoding());
+    std::vector<std::vector<wxString>> rows;
+    CSVParser::ParseRows(file, CSVParser::GetDataOffset(file, encoding), encoding,
+                         GetSelectedSeparator(), 1, true, rows);
+    columnNames = rows.empty() ? std::vector<wxString>() : rows[0];
+    
+    columnList->Clear();
+    for (size_t col = 0; col < columnNames.size(); ++col) {
+        columnList->Append(wxString::Format("%d. %s", (int)col + 1, columnNames[col]));
+    }
+    CheckAllColumns(true);
+}
+
+void CSVOptionsDialog::LoadPreview() {
+    if (!previewGrid) {
+        return;
+    }
+    
+    // At most PREVIEW_ROWS records are parsed, the cost does not depend on file size
+    Encoding encoding = CSVParser::ResolveEncoding(file, GetSelectedEncoding());
+    size_t offset = CSVParser::GetDataOffset(file, encoding);
+    wxChar separator = GetSelectedSeparator();
+    bool hasHeader = headerCheckBox->GetValue();
+    bool sample = previewChoice->GetSelection() == 1;
+    
+    std::vector<std::vector<wxString>> rows;
+    std::vector<wxString> labels;
+    if (sample) {
+        // The header row is left out of the sample, any other record can be picked
+        if (hasHeader) {
+            CSVParser::SkipRecords(file, offset, encoding, 1);
+            labels = columnNames;
+        }
+        CSVParser::SampleRows(file, offset, encoding, separator, PREVIEW_ROWS, rows);
+    } else {
+        CSVParser::ParseRows(file, offset, encoding, separator, PREVIEW_ROWS + (hasHeader ? 1 : 0), true, rows);
+        if (hasHeader && !rows.empty()) {
+            labels = rows[0];
+            rows.erase(rows.begin());
+        }
+    }
+    
+    size_t cols = labels.size();
+    for (const std::vector<wxString>& row : rows) {
+        cols = std::max(cols, row.size());
+    }
+    
+    previewGrid->BeginBatch();
+    if (previewGrid->GetNumberRows() > 0) {
+        previewGrid->DeleteRows(0, previewGrid->GetNumberRows());
+    }
+    if (previewGrid->GetNumberCols() > 0) {
+        previewGrid->DeleteCols(0, previewGrid->GetNumberCols());
+    }
+    previewGrid->AppendCols((int)cols);
+    previewGrid->AppendRows((int)rows.size());
+    
+    for (size_t col = 0; col < cols; ++col) {
+        if (hasHeader && col < labels.size()) {
+            previewGrid->SetColLabelValue((int)col, labels[col]);
+        }
+    }
+    for (size_t row = 0; row < rows.size(); ++row) {
+        // Sampled rows have no known row number
+        if (sample) {
+            previewGrid->SetRowLabelValue((int)row, "~");
+        }
+        for (size_t col = 0; col < rows[row].size(); ++col) {
+            previewGrid->SetCellValue((int)row, (int)col, rows[row][col]);
+        }
+    }
+    previewGrid->EndBatch();
+}
+
+void CSVOptionsDialog::CheckAllColumns(bool check) {
+    for (unsigned int i = 0; i < columnList->GetCount(); ++i) {
+        columnList->Check(i, check);
+    }
+}
+
+void CSVOptionsDialog::LoadColumnSets() {
+    columnSetChoice->Clear();
+    columnSetChoice->Append("");
+    
+    wxConfig config("CSV++");
+    config.SetPath("/ColumnSets");
+    wxString name;
+    long index;
+    for (bool more = config.GetFirstEntry(name, index); more; more = config.GetNextEntry(name, index)) {
+        columnSetChoice->Append(name);
+    }
+}
+
+void CSVOptionsDialog::ApplyColumnSet() {
+    wxString name = columnSetChoice->GetStringSelection();
+    if (name.IsEmpty()) {
+        return;
+    }
+    
+    // Sets are stored as tab separated column names
+    wxConfig config("CSV++");
+    config.SetPath("/ColumnSets");
+    wxArrayString names = wxStringTokenize(config.Read(name, wxString()), "\t", wxTOKEN_RET_EMPTY);
+    for (size_t col = 0; col < columnNames.size(); ++col) {
+        columnList->Check((unsigned int)col, names.Index(columnNames[col]) != wxNOT_FOUND);
+    }
+}
+
+void CSVOptionsDialog::OnSelectAll(wxCommandEvent& event) {
+    CheckAllColumns(true);
+}
+
+void CSVOptionsDialog::OnSelectNone(wxCommandEvent& event) {
+    CheckAllColumns(false);
+}
+
+void CSVOptionsDialog::OnSaveColumnSet(wxCommandEvent& event) {
+    wxTextEntryDialog dialog(this, "Name of the column set:", "Save Column Set",
+                             columnSetChoice->GetStringSelection());
+    if (dialog.ShowModal() != wxID_OK || dialog.GetValue().IsEmpty()) {
+        return;
+    }
+    
+    wxString names;
+    for (size_t col = 0; col < columnNames.size(); ++col) {
+        if (columnList->IsChecked((unsigned int)col)) {
+            if (!names.IsEmpty()) {
+                names += '\t';
+            }
+            names += columnNames[col];
+        }
+    }
+    
+    // Entry names cannot contain the path separator
+    wxString name = dialog.GetValue();
+    name.Replace("/", "-");
+    wxConfig config("CSV++");
+    config.SetPath("/ColumnSets");
+    config.Write(name, names);
+    config.Flush();
+    
+    LoadColumnSets();
+    columnSetChoice->SetStringSelection(name);
+}
+
+void CSVOptionsDialog::OnHeaderCheck(wxCommandEvent& event) {
+    LoadPreview();
+}
+
+void CSVOptionsDialog::OnResample(wxCommandEvent& event) {
+    previewChoice->SetSelection(1);
+    LoadPreview();
 }
 
 void CSVOptionsDialog::OnOK(wxCommandEvent& event) {
@@ -103,6 +338,12 @@ void CSVOptionsDialog::OnOK(wxCommandEvent& event) {
     if (separatorChoice->GetSelection() == 3 && customSeparator == '\0') {
         customSeparator = ',';
     }
+    
+    wxArrayInt checked;
+    if (columnList && columnList->GetCount() > 0 && columnList->GetCheckedItems(checked) == 0) {
+        wxMessageBox("Select at least one column to load.", "CSV Import Options", wxOK | wxICON_WARNING);
+        return;
+    }
     event.Skip();
 }
 
@@ -137,3 +378,21 @@ wxChar CSVOptionsDialog::GetSelectedSeparator() const {
 bool CSVOptionsDialog::GetHasHeader() const {
     return headerCheckBox->GetValue();
 }
+
+std::vector<int> CSVOptionsDialog::GetSelectedColumns() const {
+    std::vector<int> columns;
+    if (!columnList) {
+        return columns;
+    }
+    
+    for (unsigned int i = 0; i < columnList->GetCount(); ++i) {
+        if (columnList->IsChecked(i)) {
+            columns.push_back((int)i);
+        }
+    }
+    // Everything selected means no projection
+    if (columns.size() == columnList->GetCount()) {
+        columns.clear();
+    }
+    return columns;
+}
@@ -1,8 +1,75 @@
 #include "CSVParser.h"
+#include "MappedFile.h"
+#include "Compression.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include "BoundedQueue.h"
 #include <wx/textfile.h>
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
 #include <wx/tokenzr.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__SSE2__)
+// wxChar is 16 bits on Windows and 32 bits elsewhere
+inline __m128i Splat(wxChar c) {
+    return sizeof(wxChar) == 2 ? _mm_set1_epi16((short)c) : _mm_set1_epi32((int)c);
+}
+
+inline __m128i Equal(__m128i x, __m128i y) {
+    return sizeof(wxChar) == 2 ? _mm_cmpeq_epi16(x, y) : _mm_cmpeq_epi32(x, y);
+}
+#endif
+
+// First position at or after begin holding any of the four characters,
+// length if there is none. With SSE2 a register of characters is compared
+// against all four at once.
+size_t FindAny(const wxChar* chars, size_t begin, size_t length,
+               wxChar a, wxChar b, wxChar c, wxChar d) {
+    size_t i = begin;
+#if defined(__SSE2__)
+    const size_t LANES = 16 / sizeof(wxChar);
+    __m128i va = Splat(a);
+    __m128i vb = Splat(b);
+    __m128i vc = Splat(c);
+    __m128i vd = Splat(d);
+    for (; i + LANES <= length; i += LANES) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(chars + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(Equal(block, va), Equal(block, vb)),
+                                    _mm_or_si128(Equal(block, vc), Equal(block, vd)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask) / sizeof(wxChar);
+        }
+    }
+#endif
+    for (; i < length; ++i) {
+        wxChar ch = chars[i];
+        if (ch == a || ch == b || ch == c || ch == d) {
+            return i;
+        }
+    }
+    return length;
+}
+
+// First character that forces a field to be quoted, length if none does
+inline size_t FindSpecial(const wxChar* chars, size_t length, wxChar separator) {
+    return FindAny(chars, 0, length, separator, '"', '\n', '\r');
+}
+
+}
+
 
 CSVParser::CSVParser() {
 }
@@ -11,14 +78,21 @@ CSVParser::~CSVParser() {
 }
 
 Encoding CSVParser::DetectEncoding(const wxString& filename) {
-    wxFileInputStream file(filename);
-    if (!file.IsOk()) {
+    MappedFile file;
+    if (!file.Open(filename)) {
         return Encoding::UTF8;
     }
-    
-    // Read first few bytes to check for BOM
+    return DetectEncoding(file);
+}
+
+Encoding CSVParser::DetectEncoding(const MappedFile& file) {
+    PROFILE_SCOPE("parser.detect_encoding");
+    // Check the first few bytes for a BOM
     unsigned char bom[4] = {0};
-    file.Read(bom, 4);
+    size_t available = wxMin(file.WaitForData(4), (size_t)4);
+    if (available > 0) {
+        memcpy(bom, file.GetData(), available);
+    }
     
     // Check for UTF-8 BOM (EF BB BF)
     if (bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF) {
@@ -40,6 +114,7 @@ Encoding CSVParser::DetectEncoding(const wxString& filename) {
 }
 
 wxChar CSVParser::DetectSeparator(const wxString& content) {
+    PROFILE_SCOPE("parser.detect_separator");
     // Count occurrences of common separators in first 10 lines
     int commaCount = 0;
     int semicolonCount = 0;
@@ -68,77 +143,169 @@ wxChar CSVParser::DetectSeparator(const wxString& content) {
 
 std::vector<wxString> CSVParser::ParseLine(const wxString& line, wxChar separator) {
     std::vector<wxString> fields;
-    wxString field;
-    bool inQuotes = false;
+    ParseLine(line, separator, fields);
+    return fields;
+}
+
+std::vector<wxString> CSVParser::ParseLine(const wxString& line, wxChar separator,
+                                           const std::vector<int>& columns) {
+    std::vector<wxString> fields;
+    ParseLine(line, separator, fields, columns);
+    return fields;
+}
+
+void CSVParser::ParseLine(const wxString& line, wxChar separator, std::vector<wxString>& fields,
+                          const std::vector<int>& columns) {
+    ParseChars(line.wx_str(), line.length(), separator, columns, fields);
+}
+
+void CSVParser::ParseChars(const wxChar* chars, size_t length, wxChar separator,
+                           const std::vector<int>& columns, std::vector<wxString>& fields) {
+    bool all = columns.empty();
+    size_t count = 0;
+    int column = 0;
+    size_t i = 0;
     
-    for (size_t i = 0; i < line.length(); ++i) {
-        wxChar c = line[i];
+    for (;;) {
+        if (!all && count >= columns.size()) {
+            break;
+        }
         
-        if (c == '"') {
-            // Check for escaped quote (double quote)
-            if (inQuotes && i + 1 < line.length() && line[i + 1] == '"') {
-                field += '"';
-                ++i; // Skip next quote
-            } else {
-                // Toggle quote state
-                inQuotes = !inQuotes;
+        // Unselected fields are only scanned
+        wxString* field = nullptr;
+        if (all || columns[count] == column) {
+            if (count == fields.size()) {
+                fields.emplace_back();
             }
-        } else if (c == separator && !inQuotes) {
-            // End of field
-            fields.push_back(field);
-            field.clear();
-        } else {
-            field += c;
+            field = &fields[count++];
+            field->clear();
+        }
+        
+        // Runs between quotes are copied whole, a doubled quote inside
+        // quotes is an escaped quote
+        bool inQuotes = false;
+        size_t start = i;
+        for (; i < length; ++i) {
+            wxChar c = chars[i];
+            if (c == '"') {
+                if (field && i > start) {
+                    field->append(chars + start, i - start);
+                }
+                if (inQuotes && i + 1 < length && chars[i + 1] == '"') {
+                    if (field) {
+                        *field += '"';
+                    }
+                    ++i;
+                } else {
+                    inQuotes = !inQuotes;
+                }
+                start = i + 1;
+            } else if (c == separator && !inQuotes) {
+                break;
+            }
+        }
+        if (field && i > start) {
+            field->append(chars + start, i - start);
+        }
+        
+        if (i >= length) {
+            break;
         }
+        ++i;   // past the separator
+        ++column;
     }
     
-    // Add last field
-    fields.push_back(field);
-    
-    return fields;
+    // Selected columns missing from the line are empty
+    for (; !all && count < columns.size(); ++count) {
+        if (count == fields.size()) {
+            fields.emplace_back();
+        }
+        fields[count].clear();
+    }
+    fields.resize(count);
 }
 
 wxString CSVParser::FormatLine(const std::vector<wxString>& fields, wxChar separator) {
     wxString line;
-    
+    AppendLine(line, fields, separator);
+    return line;
+}
+
+void CSVParser::AppendLine(wxString& out, const std::vector<wxString>& fields, wxChar separator) {
     for (size_t i = 0; i < fields.size(); ++i) {
         if (i > 0) {
-            line += separator;
-        }
-        
-        wxString field = fields[i];
-        
-        if (NeedsQuoting(field, separator)) {
-            line += '"';
-            line += EscapeField(field);
-            line += '"';
-        } else {
-            line += field;
+            out += separator;
         }
+        AppendField(out, fields[i], separator);
     }
-    
-    return line;
 }
 
-bool CSVParser::NeedsQuoting(const wxString& field, wxChar separator) {
-    // Field needs quoting if it contains separator, quotes, or newlines
-    return field.Find(separator) != wxNOT_FOUND ||
-           field.Find('"') != wxNOT_FOUND ||
-           field.Find('\n') != wxNOT_FOUND ||
-           field.Find('\r') != wxNOT_FOUND;
+void CSVParser::AppendField(wxString& out, const wxString& field, wxChar separator) {
+    // One scan decides whether the field needs quotes and finds where
+    // escaping starts, plain fields are copied whole
+    const wxChar* chars = field.wx_str();
+    size_t length = field.length();
+    size_t special = FindSpecial(chars, length, separator);
+    if (special == length) {
+        out.append(chars, length);
+        return;
+    }
+    
+    // Nothing before the first special character is a quote. From there
+    // the spans between quotes are copied and each quote is doubled.
+    out += '"';
+    size_t start = 0;
+    size_t quote = FindAny(chars, special, length, '"', '"', '"', '"');
+    while (quote < length) {
+        out.append(chars + start, quote + 1 - start);
+        out += '"';
+        start = quote + 1;
+        quote = FindAny(chars, start, length, '"', '"', '"', '"');
+    }
+    out.append(chars + start, length - start);
+    out += '"';
 }
 
-wxString CSVParser::EscapeField(const wxString& field) {
-    wxString escaped;
-    for (size_t i = 0; i < field.length(); ++i) {
-        wxChar c = field[i];
+void CSVParser::ParseText(const wxString& text, wxChar separator,
+                          std::vector<std::vector<wxString>>& rows) {
+    PROFILE_SCOPE("parser.parse_text");
+    // Find record boundaries first, quote parity decides which breaks count
+    std::vector<std::pair<size_t, size_t>> records;
+    const wxStringCharType* chars = text.wx_str();
+    size_t length = text.length();
+    size_t begin = 0;
+    bool inQuotes = false;
+    
+    for (size_t i = 0; i < length; ++i) {
+        wxChar c = chars[i];
         if (c == '"') {
-            escaped += "\"\""; // Double the quote
-        } else {
-            escaped += c;
+            inQuotes = !inQuotes;
+        } else if ((c == '\n' || c == '\r') && !inQuotes) {
+            records.push_back(std::make_pair(begin, i));
+            if (c == '\r' && i + 1 < length && chars[i + 1] == '\n') {
+                ++i;
+            }
+            begin = i + 1;
         }
     }
-    return escaped;
+    if (begin < length) {
+        records.push_back(std::make_pair(begin, length));
+    }
+    
+    // Records are independent, parse them in parallel
+    rows.clear();
+    rows.resize(records.size());
+    WorkerPool::Get().ParallelFor(records.size(), 1024, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            ParseChars(chars + records[i].first, records[i].second - records[i].first,
+                       separator, std::vector<int>(), rows[i]);
+        }
+    });
+}
+
+bool CSVParser::NeedsQuoting(const wxString& field, wxChar separator) {
+    // Field needs quoting if it contains separator, quotes, or newlines
+    return FindSpecial(field.wx_str(), field.length(), separator) < field.length();
 }
 
 wxString CSVParser::UnescapeField(const wxString& field) {
@@ -149,115 +316,826 @@ bool CSVParser::ReadFile(const wxString& filename, std::vector<std::vector<wxStr
                         wxChar& separator, Encoding& encoding, bool& hasHeader) {
     data.clear();
     
-    // Detect encoding
-    encoding = DetectEncoding(filename);
+    MappedFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
     
-    wxTextFile file;
-    bool opened = false;
+    // Detect encoding and separator
+    DetectFormat(file, encoding, separator);
     
-    // Try to open with detected encoding
-    if (encoding == Encoding::UTF8 || encoding == Encoding::UTF8_BOM) {
-        opened = file.Open(filename, wxConvUTF8);
-    } else if (encoding == Encoding::UTF16_LE) {
-        opened = file.Open(filename, wxMBConvUTF16LE());
-    } else if (encoding == Encoding::UTF16_BE) {
-        opened = file.Open(filename, wxMBConvUTF16BE());
-    } else {
-        // ANSI - use local encoding
-        opened = file.Open(filename);
+    // Parse each line
+    return ReadFile(file, encoding, separator,
+                    [&data](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        for (auto& row : rows) {
+            data.push_back(std::move(row));
+        }
+    });
+}
+
+// A run of records travelling through the load pipeline. Batches are
+// allocated once per load and recycled with their row and field buffers,
+// so once they have grown no stage allocates per batch or per row.
+struct CSVParser::ParseBatch {
+    size_t sequence;
+    std::vector<LineSpan> lines;
+    std::vector<std::vector<wxString>> rows;
+    std::vector<long long> offsets;
+    ParseScratch scratch;
+    bool decodeError;
+};
+
+// Stages of one ReadFile, connected by lock-free queues of batch pointers:
+//
+//   splitter thread   finds record boundaries, waiting for decompressed input
+//   parser tasks      decode and parse batches on the worker pool, any order
+//   caller            hands batches to the row handler in file order
+//
+// Free batches flow back from the caller to the splitter, which bounds the
+// memory in flight. Each split batch queues one short pool task rather than
+// parking workers in a loop, so the pool stays free for parallel
+// decompression. Tasks may only start after the load has ended, so the
+// state is reference counted.
+struct CSVParser::LoadPipeline {
+    static const size_t BATCH_LINES = 4096;
+    
+    const MappedFile* file;
+    Encoding encoding;
+    wxChar separator;
+    std::vector<int> columns;
+    
+    std::vector<ParseBatch> batches;
+    BoundedQueue<ParseBatch*> freeQueue;
+    BoundedQueue<ParseBatch*> splitQueue;
+    BoundedQueue<ParseBatch*> parsedQueue;
+    
+    std::atomic<bool> splitDone;
+    std::atomic<size_t> batchCount;   // valid once splitDone is set
+    std::atomic<bool> stopped;        // the caller has finished or given up
+    std::atomic<size_t> parsing;      // batches held by parser workers
+    
+    LoadPipeline(size_t poolSize)
+        : file(nullptr), encoding(Encoding::UTF8), separator(','),
+          batches(poolSize), freeQueue(poolSize), splitQueue(poolSize), parsedQueue(poolSize),
+          splitDone(false), batchCount(0), stopped(false), parsing(0) {
+        for (ParseBatch& batch : batches) {
+            freeQueue.TryPush(&batch);
+        }
+    }
+    
+    static void Split(std::shared_ptr<LoadPipeline> pipeline, size_t pos) {
+        pipeline->SplitRecords(pipeline, pos);
+    }
+    
+    void SplitRecords(const std::shared_ptr<LoadPipeline>& self, size_t pos) {
+        PROFILE_SCOPE("parser.split_records");
+        size_t sequence = 0;
+        bool firstLine = true;
+        bool more = true;
+        unsigned int attempt = 0;
+        LineSpan line;
+        // One wait is timed once, however many retries it takes
+        PROFILE_DEFERRED(wait);
+        while (more && !stopped) {
+            ParseBatch* batch;
+            if (!freeQueue.TryPop(batch)) {
+                // Every batch is ahead of the parsers or the handler
+                PROFILE_START(wait, "pipeline.split_wait");
+                Backoff(attempt);
+                continue;
+            }
+            PROFILE_STOP(wait);
+            attempt = 0;
+            
+            batch->lines.clear();
+            while (batch->lines.size() < BATCH_LINES && (more = NextRecord(*file, pos, encoding, line))) {
+                // Keep empty lines except skip them after the first line
+                if (line.end > line.begin || firstLine) {
+                    batch->lines.push_back(line);
+                }
+                firstLine = false;
+            }
+            if (batch->lines.empty()) {
+                freeQueue.TryPush(batch);
+                break;
+            }
+            batch->sequence = sequence++;
+            // Never full, it can hold every batch
+            splitQueue.TryPush(batch);
+            WorkerPool::Get().Submit([self]() {
+                self->ParseNext();
+            });
+        }
+        PROFILE_STOP(wait);
+        batchCount = sequence;
+        splitDone = true;
+    }
+    
+    // Parse one waiting batch, false if none was queued
+    bool ParseNext() {
+        ParseBatch* batch;
+        if (!TakeBatch(batch)) {
+            return false;
+        }
+        Parse(batch);
+        return true;
+    }
+    
+    // A split batch to parse, counted in parsing until Parse is done with it
+    bool TakeBatch(ParseBatch*& batch) {
+        // Counted before the pop so the caller never misses a batch in hand
+        parsing++;
+        if (stopped || !splitQueue.TryPop(batch)) {
+            parsing--;
+            return false;
+        }
+        return true;
+    }
+    
+    void Parse(ParseBatch* batch) {
+        PROFILE_SCOPE("parser.parse_batch");
+        const char* data = file->GetData();
+        size_t count = batch->lines.size();
+        batch->rows.resize(count);
+        batch->offsets.resize(count);
+        batch->decodeError = false;
+        for (size_t i = 0; i < count; ++i) {
+            const LineSpan& record = batch->lines[i];
+            if (!ParseRecord(data + record.begin, record.end - record.begin,
+                             encoding, separator, columns, batch->rows[i], batch->scratch)) {
+                batch->decodeError = true;
+            }
+            batch->offsets[i] = (long long)record.begin;
+        }
+        parsedQueue.TryPush(batch);
+        parsing--;
     }
     
-    if (!opened) {
+    // Spin briefly, then yield, then sleep while a queue is empty or full
+    static void Backoff(unsigned int& attempt) {
+        if (attempt < 64) {
+            // Busy wait
+        } else if (attempt < 256) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        ++attempt;
+    }
+};
+
+bool CSVParser::ReadFile(const MappedFile& file, Encoding& encoding, wxChar separator,
+                        const RowBatchHandler& handler, const std::vector<int>& columns) {
+    PROFILE_SCOPE("parser.read");
+    if (!file.IsOpened()) {
         return false;
     }
     
-    // Read all content to detect separator
-    wxString content;
-    for (size_t i = 0; i < file.GetLineCount(); ++i) {
-        content += file.GetLine(i) + wxT("\n");
+    encoding = ResolveEncoding(file, encoding);
+    
+    // Enough batches to keep every worker busy while the handler catches up
+    size_t poolSize = 2 * WorkerPool::Get().GetThreadCount() + 2;
+    std::shared_ptr<LoadPipeline> pipeline = std::make_shared<LoadPipeline>(poolSize);
+    pipeline->file = &file;
+    pipeline->encoding = encoding;
+    pipeline->separator = separator;
+    pipeline->columns = columns;
+    
+    std::thread splitter(&LoadPipeline::Split, pipeline, GetDataOffset(file, encoding));
+    
+    // Batches finish out of order and wait in their slot until it is their turn.
+    // At most poolSize batches exist, so slots never collide.
+    std::vector<ParseBatch*> pending(poolSize, nullptr);
+    size_t next = 0;
+    bool decodeError = false;
+    unsigned int attempt = 0;
+    PROFILE_DEFERRED(wait);
+    while (!decodeError && !(pipeline->splitDone && next == pipeline->batchCount)) {
+        ParseBatch* batch;
+        while (pipeline->parsedQueue.TryPop(batch)) {
+            pending[batch->sequence % poolSize] = batch;
+        }
+        
+        ParseBatch*& ready = pending[next % poolSize];
+        if (!ready) {
+            // Parse a batch here rather than wait for the pool
+            ParseBatch* own;
+            if (pipeline->TakeBatch(own)) {
+                PROFILE_STOP(wait);
+                pipeline->Parse(own);
+            } else {
+                PROFILE_START(wait, "pipeline.build_wait");
+                LoadPipeline::Backoff(attempt);
+            }
+            continue;
+        }
+        PROFILE_STOP(wait);
+        attempt = 0;
+        
+        // Queue depths show which stage holds the pipeline back
+        PROFILE_COUNTER("pipeline.split_queue", pipeline->splitQueue.Size());
+        PROFILE_COUNTER("pipeline.parsed_queue", pipeline->parsedQueue.Size());
+        PROFILE_COUNTER("pipeline.free_queue", pipeline->freeQueue.Size());
+        
+        // Invalid data for the selected encoding
+        if (ready->decodeError) {
+            decodeError = true;
+            break;
+        }
+        
+        // Handing rows to the caller is where the table gets filled
+        {
+            PROFILE_SCOPE("parser.deliver_rows");
+            handler(ready->rows, ready->offsets);
+        }
+        pipeline->freeQueue.TryPush(ready);
+        ready = nullptr;
+        ++next;
     }
+    PROFILE_STOP(wait);
     
-    // Detect separator
+    // Workers still holding a batch finish it before the file may go away
+    pipeline->stopped = true;
+    splitter.join();
+    while (pipeline->parsing > 0) {
+        std::this_thread::yield();
+    }
+    
+    // Compressed input that ended early or failed its checksum
+    return !decodeError && file.IsValid();
+}
+
+void CSVParser::DetectFormat(const MappedFile& file, Encoding& encoding, wxChar& separator) {
+    PROFILE_SCOPE("parser.detect_format");
+    encoding = ResolveEncoding(file, DetectEncoding(file));
+    
+    // Detect separator from the first lines
+    const char* bytes = file.GetData();
+    size_t pos = GetDataOffset(file, encoding);
+    wxString content;
+    LineSpan line;
+    for (int i = 0; i < 10 && NextRecord(file, pos, encoding, line); ++i) {
+        content += DecodeLine(bytes + line.begin, line.end - line.begin, encoding) + wxT("\n");
+    }
     separator = DetectSeparator(content);
+}
+
+size_t CSVParser::ParseRows(const MappedFile& file, size_t offset, Encoding encoding,
+                            wxChar separator, size_t maxRows, bool keepFirstEmpty,
+                            std::vector<std::vector<wxString>>& rows,
+                            const std::vector<int>& columns) {
+    PROFILE_SCOPE("parser.parse_rows");
+    // Rows already in the buffer are parsed over rather than reallocated
+    const char* data = file.GetData();
+    size_t pos = offset;
+    size_t count = 0;
+    bool firstLine = true;
+    ParseScratch scratch;
+    LineSpan line;
+    while (count < maxRows && NextRecord(file, pos, encoding, line)) {
+        if (line.end > line.begin || (firstLine && keepFirstEmpty)) {
+            if (count == rows.size()) {
+                rows.emplace_back();
+            }
+            ParseRecord(data + line.begin, line.end - line.begin, encoding, separator, columns,
+                        rows[count++], scratch);
+        }
+        firstLine = false;
+    }
+    rows.resize(count);
+    return count;
+}
+
+size_t CSVParser::SampleRows(const MappedFile& file, size_t offset, Encoding encoding,
+                             wxChar separator, size_t count,
+                             std::vector<std::vector<wxString>>& rows) {
+    PROFILE_SCOPE("parser.sample_rows");
+    // Bytes and line starts looked at for one sample before it is given up
+    const size_t SCAN_LIMIT = 1024 * 1024;
+    const int MAX_CANDIDATES = 32;
+    rows.clear();
     
-    // Parse each line
-    for (size_t i = 0; i < file.GetLineCount(); ++i) {
-        wxString line = file.GetLine(i);
-        if (!line.IsEmpty() || i == 0) { // Keep empty lines except skip trailing
-            std::vector<wxString> fields = ParseLine(line, separator);
-            data.push_back(fields);
+    const char* data = file.GetData();
+    size_t size = file.GetSize();
+    if (count == 0 || offset >= size) {
+        return 0;
+    }
+    
+    // The first record sets the field count the others are checked against
+    ParseScratch scratch;
+    std::vector<wxString> fields;
+    LineSpan line;
+    size_t pos = offset;
+    if (!NextRecord(data, size, pos, encoding, line)) {
+        return 0;
+    }
+    ParseRecord(data + line.begin, line.end - line.begin, encoding, separator,
+                std::vector<int>(), fields, scratch);
+    size_t expectedFields = fields.size();
+    
+    std::mt19937_64 random(std::random_device{}());
+    std::uniform_int_distribution<size_t> distribution(offset, size - 1);
+    std::vector<size_t> positions(count);
+    for (size_t& position : positions) {
+        position = distribution(random);
+    }
+    std::sort(positions.begin(), positions.end());
+    
+    // UTF-16 offsets must stay on code unit boundaries
+    bool utf16 = encoding == Encoding::UTF16_LE || encoding == Encoding::UTF16_BE;
+    size_t unit = utf16 ? 2 : 1;
+    
+    // Each offset takes the first verified record start at or after it.
+    // Offsets landing in the last record wrap around to the first, so every
+    // record can be picked. Offsets landing in an already sampled record
+    // take the following one.
+    size_t next = offset;
+    bool firstTaken = false;
+    for (size_t position : positions) {
+        if (utf16) {
+            position -= (position - offset) % 2;
+        }
+        size_t limit = std::min(size, position + SCAN_LIMIT);
+        size_t start = position == offset ? offset : NextLineStart(data, limit, position - unit, encoding);
+        bool found = false;
+        for (int candidate = 0; candidate < MAX_CANDIDATES && start < limit; ++candidate) {
+            start = std::max(start, next);
+            if (start >= size || IsRecordStart(data, size, start, encoding, separator, expectedFields, scratch)) {
+                found = start < size;
+                break;
+            }
+            start = NextLineStart(data, limit, start, encoding);
+        }
+        
+        bool wrapped = false;
+        if (!found && start >= size && !firstTaken) {
+            // Past the last record start, wrap around to the first record
+            start = offset;
+            wrapped = true;
+        } else if (!found) {
+            // A long quoted field or an irregular region, skip this sample
+            continue;
+        }
+        
+        pos = start;
+        if (!NextRecord(data, size, pos, encoding, line)) {
+            continue;
+        }
+        if (start == offset) {
+            firstTaken = true;
+        }
+        next = std::max(next, pos);
+        if (line.end > line.begin) {
+            // The wrapped first record goes before the others, in file order
+            auto row = rows.emplace(wrapped ? rows.begin() : rows.end());
+            ParseRecord(data + line.begin, line.end - line.begin, encoding, separator,
+                        std::vector<int>(), *row, scratch);
         }
     }
+    return rows.size();
+}
+
+bool CSVParser::IsRecordStart(const char* data, size_t size, size_t pos, Encoding encoding,
+                              wxChar separator, size_t expectedFields, ParseScratch& scratch) {
+    // A start inside a quoted field usually leaves a quote open until the
+    // window ends, or splits the following records into the wrong fields
+    const size_t WINDOW = 64 * 1024;
+    const int RECORDS = 3;
+    size_t window = std::min(size, pos + WINDOW);
+    std::vector<wxString> fields;
+    LineSpan line;
+    int checked = 0;
+    int matching = 0;
+    while (checked < RECORDS && NextRecord(data, window, pos, encoding, line)) {
+        if (pos >= window && window < size) {
+            // Still inside quotes, or a record longer than the window. Only
+            // the first one has to fit.
+            if (checked == 0) {
+                return false;
+            }
+            break;
+        }
+        ParseRecord(data + line.begin, line.end - line.begin, encoding, separator,
+                    std::vector<int>(), fields, scratch);
+        ++checked;
+        if (fields.size() == expectedFields) {
+            ++matching;
+        }
+    }
+    // Most of them, so rows of an irregular file can still be sampled
+    return checked > 0 && matching * 2 > checked;
+}
+
+Encoding CSVParser::ResolveEncoding(const MappedFile& file, Encoding selected) {
+    const unsigned char* bom = (const unsigned char*)file.GetData();
+    size_t size = file.WaitForData(3);
     
-    file.Close();
-    return true;
+    bool utf8Family = selected == Encoding::UTF8 || selected == Encoding::UTF8_BOM;
+    bool utf16Family = selected == Encoding::UTF16_LE || selected == Encoding::UTF16_BE;
+    
+    if (size >= 3 && bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF) {
+        return utf8Family ? Encoding::UTF8_BOM : selected;
+    }
+    if (size >= 2 && bom[0] == 0xFF && bom[1] == 0xFE) {
+        return utf16Family ? Encoding::UTF16_LE : selected;
+    }
+    if (size >= 2 && bom[0] == 0xFE && bom[1] == 0xFF) {
+        return utf16Family ? Encoding::UTF16_BE : selected;
+    }
+    
+    // No BOM present
+    return selected == Encoding::UTF8_BOM ? Encoding::UTF8 : selected;
 }
 
-bool CSVParser::WriteFile(const wxString& filename, const std::vector<std::vector<wxString>>& data,
-                         wxChar separator, Encoding encoding) {
-    // For ANSI encoding, use wxFile directly instead of wxTextFile
-    if (encoding == Encoding::ANSI) {
-        wxFile file(filename, wxFile::write);
-        if (!file.IsOpened()) {
+size_t CSVParser::GetDataOffset(const MappedFile& file, Encoding encoding) {
+    const unsigned char* bom = (const unsigned char*)file.GetData();
+    size_t size = file.WaitForData(3);
+    
+    if (encoding == Encoding::UTF8_BOM && size >= 3 &&
+        bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF) {
+        return 3;
+    }
+    if (encoding == Encoding::UTF16_LE && size >= 2 && bom[0] == 0xFF && bom[1] == 0xFE) {
+        return 2;
+    }
+    if (encoding == Encoding::UTF16_BE && size >= 2 && bom[0] == 0xFE && bom[1] == 0xFF) {
+        return 2;
+    }
+    return 0;
+}
+
+size_t CSVParser::SkipRecords(const MappedFile& file, size_t& pos, Encoding encoding,
+                              size_t maxRecords, size_t limit) {
+    size_t count = 0;
+    size_t next = pos;
+    LineSpan line;
+    while (count < maxRecords && NextRecord(file, next, encoding, line)) {
+        // A record ending past the limit is left for the next call
+        if (next > limit && count > 0) {
+            break;
+        }
+        pos = next;
+        ++count;
+    }
+    return count;
+}
+
+size_t CSVParser::FindRecords(const MappedFile& file, size_t& pos, Encoding encoding, size_t maxRecords,
+                              std::vector<std::pair<size_t, size_t>>& records) {
+    records.clear();
+    LineSpan line;
+    while (records.size() < maxRecords && NextRecord(file, pos, encoding, line)) {
+        records.push_back(std::make_pair(line.begin, line.end));
+    }
+    return records.size();
+}
+
+bool CSVParser::ParseRecordAt(const MappedFile& file, size_t begin, size_t end, Encoding encoding,
+                              wxChar separator, std::vector<wxString>& fields, const std::vector<int>& columns) {
+    // One scratch per thread, records are parsed from many at once
+    thread_local ParseScratch scratch;
+    return ParseRecord(file.GetData() + begin, end - begin, encoding, separator, columns, fields, scratch);
+}
+
+size_t CSVParser::NextLineStart(const char* data, size_t size, size_t pos, Encoding encoding) {
+    if (encoding == Encoding::UTF16_LE || encoding == Encoding::UTF16_BE) {
+        size_t lo = encoding == Encoding::UTF16_LE ? 0 : 1;
+        size_t hi = 1 - lo;
+        for (; pos + 1 < size; pos += 2) {
+            if (data[pos + hi] == 0 && (data[pos + lo] == '\n' || data[pos + lo] == '\r')) {
+                bool carriageReturn = data[pos + lo] == '\r';
+                pos += 2;
+                if (carriageReturn && pos + 1 < size && data[pos + hi] == 0 && data[pos + lo] == '\n') {
+                    pos += 2;
+                }
+                return pos;
+            }
+        }
+        return size;
+    }
+    
+    for (; pos < size; ++pos) {
+        if (data[pos] == '\n' || data[pos] == '\r') {
+            // \r\n counts as one line break
+            if (data[pos] == '\r' && pos + 1 < size && data[pos + 1] == '\n') {
+                ++pos;
+            }
+            return pos + 1;
+        }
+    }
+    return size;
+}
+
+bool CSVParser::NextRecord(const MappedFile& file, size_t& pos, Encoding encoding, LineSpan& line) {
+    // Content still being decompressed is waited for a step ahead
+    const size_t STEP = 1024 * 1024;
+    size_t wanted = pos + STEP;
+    for (;;) {
+        size_t available = file.WaitForData(wanted);
+        size_t next = pos;
+        if (!NextRecord(file.GetData(), available, next, encoding, line)) {
             return false;
         }
+        // A record reaching the end of what has arrived may continue, unless
+        // that is the end of the content
+        if (next < available || available < wanted) {
+            pos = next;
+            return true;
+        }
+        wanted = available + wxMax(STEP, available - pos);
+    }
+}
+
+bool CSVParser::NextRecord(const char* data, size_t size, size_t& pos, Encoding encoding, LineSpan& line) {
+    if (pos >= size) {
+        return false;
+    }
+    line.begin = pos;
+    
+    // Quotes toggle the quoted state the same way ParseLine does, so a line
+    // break only ends the record when an even number of quotes precede it
+    bool inQuotes = false;
+    
+    if (encoding == Encoding::UTF16_LE || encoding == Encoding::UTF16_BE) {
+        // Offsets of the low and high byte within each code unit
+        size_t lo = encoding == Encoding::UTF16_LE ? 0 : 1;
+        size_t hi = 1 - lo;
+        size_t i = pos;
+        while (i + 1 < size) {
+            if (data[i + hi] == 0) {
+                char c = data[i + lo];
+                if (c == '"') {
+                    inQuotes = !inQuotes;
+                } else if ((c == '\n' || c == '\r') && !inQuotes) {
+                    break;
+                }
+            }
+            i += 2;
+        }
+        if (i + 1 >= size) {
+            // Last record without terminator (ignore a dangling odd byte). An
+            // unterminated quote runs to the end of the file without the line
+            // break ending it, as for 8-bit encodings.
+            line.end = i;
+            if (inQuotes && i >= pos + 2 && data[i - 2 + hi] == 0 &&
+                (data[i - 2 + lo] == '\n' || data[i - 2 + lo] == '\r')) {
+                bool lineFeed = data[i - 2 + lo] == '\n';
+                line.end -= 2;
+                if (lineFeed && line.end >= pos + 2 && data[line.end - 2 + hi] == 0 &&
+                    data[line.end - 2 + lo] == '\r') {
+                    line.end -= 2;
+                }
+            }
+            pos = size;
+            return true;
+        }
+        line.end = i;
+        bool carriageReturn = data[i + lo] == '\r';
+        i += 2;
+        // \r\n counts as one terminator
+        if (carriageReturn && i + 1 < size && data[i + hi] == 0 && data[i + lo] == '\n') {
+            i += 2;
+        }
+        pos = i;
+        return true;
+    }
+    
+    const char* p = data + pos;
+    const char* end = data + size;
+    for (;;) {
+        const char* lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r') {
+            ++lineEnd;
+        }
         
-        wxCSConv conv(wxFONTENCODING_SYSTEM);
+        // Only the parity of the quotes on a physical line matters, and lines
+        // without any quote skip the counting entirely
+        const char* quote = (const char*)memchr(p, '"', lineEnd - p);
+        while (quote) {
+            inQuotes = !inQuotes;
+            quote = (const char*)memchr(quote + 1, '"', lineEnd - quote - 1);
+        }
         
-        for (const auto& row : data) {
-            wxString line = FormatLine(row, separator) + "\r\n";
-            // Convert to ANSI using system's default code page
-            const wxCharBuffer buffer = line.mb_str(conv);
-            if (buffer.length() > 0) {
-                file.Write(buffer.data(), buffer.length());
-            }
+        // \r\n counts as one terminator
+        const char* next = lineEnd;
+        if (next < end) {
+            next += (*next == '\r' && next + 1 < end && next[1] == '\n') ? 2 : 1;
+        }
+        
+        if (!inQuotes || next >= end) {
+            // An unterminated quote runs to the end of the file
+            line.end = lineEnd - data;
+            pos = next - data;
+            return true;
         }
         
-        file.Close();
+        // The line break belongs to a quoted field
+        p = next;
+    }
+}
+
+wxString CSVParser::DecodeLine(const char* text, size_t length, Encoding encoding) {
+    switch (encoding) {
+        case Encoding::UTF8:
+        case Encoding::UTF8_BOM:
+            return wxString::FromUTF8(text, length);
+        case Encoding::UTF16_LE: {
+            static wxMBConvUTF16LE utf16le;
+            return wxString(text, utf16le, length);
+        }
+        case Encoding::UTF16_BE: {
+            static wxMBConvUTF16BE utf16be;
+            return wxString(text, utf16be, length);
+        }
+        case Encoding::ANSI:
+        default: {
+            // ANSI - use system's default code page, same as WriteFile
+            static wxCSConv ansi(wxFONTENCODING_SYSTEM);
+            return wxString(text, ansi, length);
+        }
+    }
+}
+
+bool CSVParser::DecodeText(const char* text, size_t length, Encoding encoding,
+                           std::vector<wchar_t>& out, size_t& decodedLength) {
+    decodedLength = 0;
+    if (length == 0) {
         return true;
     }
     
-    // For other encodings, use wxTextFile
-    wxTextFile file;
+    // No encoding yields more characters than it has bytes
+    if (out.size() < length + 1) {
+        out.resize(length + 1);
+    }
     
-    // Create or open file
-    if (wxFileExists(filename)) {
-        if (!file.Open(filename)) {
-            return false;
+    static wxMBConvUTF16LE utf16le;
+    static wxMBConvUTF16BE utf16be;
+    // ANSI - use system's default code page, same as WriteFile
+    static wxCSConv ansi(wxFONTENCODING_SYSTEM);
+    const wxMBConv& conv = encoding == Encoding::ANSI ? (const wxMBConv&)ansi :
+                           encoding == Encoding::UTF16_LE ? (const wxMBConv&)utf16le :
+                           encoding == Encoding::UTF16_BE ? (const wxMBConv&)utf16be :
+                           (const wxMBConv&)wxConvUTF8;
+    decodedLength = conv.ToWChar(out.data(), out.size(), text, length);
+    if (decodedLength == wxCONV_FAILED) {
+        decodedLength = 0;
+        return false;
+    }
+    return true;
+}
+
+bool CSVParser::ParseRecord(const char* text, size_t length, Encoding encoding, wxChar separator,
+                            const std::vector<int>& columns, std::vector<wxString>& fields,
+                            ParseScratch& scratch) {
+    bool byteEncoding = encoding == Encoding::UTF8 || encoding == Encoding::UTF8_BOM ||
+                        encoding == Encoding::ANSI;
+    size_t decoded;
+    if (columns.empty() || !byteEncoding || (unsigned)separator >= 0x80) {
+        bool valid = DecodeText(text, length, encoding, scratch.text, decoded);
+        ParseChars(scratch.text.data(), decoded, separator, columns, fields);
+        return valid;
+    }
+    
+    // Quotes and ASCII separators never occur inside multi-byte characters,
+    // so field boundaries are found on the raw bytes and only the selected
+    // fields are unescaped and decoded
+    fields.resize(columns.size());
+    const char sep = (char)separator;
+    std::string& raw = scratch.raw;
+    size_t next = 0;
+    int column = 0;
+    size_t i = 0;
+    
+    while (next < columns.size()) {
+        bool keep = columns[next] == column;
+        bool inQuotes = false;
+        raw.clear();
+        for (; i < length; ++i) {
+            char c = text[i];
+            if (c == '"') {
+                if (inQuotes && i + 1 < length && text[i + 1] == '"') {
+                    if (keep) {
+                        raw += '"';
+                    }
+                    ++i;
+                } else {
+                    inQuotes = !inQuotes;
+                }
+            } else if (c == sep && !inQuotes) {
+                break;
+            } else if (keep) {
+                raw += c;
+            }
         }
-        file.Clear();
-    } else {
-        if (!file.Create(filename)) {
-            return false;
+        
+        if (keep) {
+            if (!DecodeText(raw.data(), raw.size(), encoding, scratch.text, decoded)) {
+                return false;
+            }
+            fields[next].assign(scratch.text.data(), decoded);
+            ++next;
+        }
+        if (i >= length) {
+            break;
         }
+        ++i;   // past the separator
+        ++column;
     }
     
-    // Write BOM if needed
-    if (encoding == Encoding::UTF8_BOM) {
-        wxFile bomFile(filename, wxFile::write);
-        if (bomFile.IsOpened()) {
-            unsigned char bom[3] = {0xEF, 0xBB, 0xBF};
-            bomFile.Write(bom, 3);
-            bomFile.Close();
+    // Selected columns missing from the record are empty
+    for (; next < columns.size(); ++next) {
+        fields[next].clear();
+    }
+    return true;
+}
+
+bool CSVParser::WriteFile(const wxString& filename, const std::vector<std::vector<wxString>>& data,
+                         wxChar separator, Encoding encoding) {
+    return WriteFile(filename, data.size(), [&data](size_t row, std::vector<wxString>& fields) {
+        fields = data[row];
+    }, separator, encoding);
+}
+
+bool CSVParser::WriteFile(const wxString& filename, size_t rowCount, const RowSource& rows,
+                         wxChar separator, Encoding encoding) {
+    PROFILE_SCOPE("parser.write");
+    CSVWriter writer;
+    if (!writer.Open(filename, encoding)) {
+        return false;
+    }
+    
+    // Lines are converted and handed to the writer a chunk at a time
+    const size_t CHUNK_CHARS = 1024 * 1024;
+    wxString chunk;
+    std::vector<wxString> fields;
+    for (size_t row = 0; row < rowCount; ++row) {
+        rows(row, fields);
+        AppendLine(chunk, fields, separator);
+        chunk += wxT("\r\n");
+        
+        if (chunk.length() >= CHUNK_CHARS || row + 1 == rowCount) {
+            if (!writer.Write(chunk)) {
+                return false;
+            }
+            chunk.clear();
         }
     }
     
-    // Format and write each line
-    for (const auto& row : data) {
-        wxString line = FormatLine(row, separator);
-        file.AddLine(line);
+    return writer.Close();
+}
+
+CSVWriter::CSVWriter() : ok(false) {
+}
+
+CSVWriter::~CSVWriter() {
+}
+
+bool CSVWriter::Open(const wxString& filename, Encoding encoding) {
+    writer.reset(new CompressedWriter());
+    ok = writer->Open(filename, CompressionFromFilename(filename));
+    if (!ok) {
+        return false;
     }
     
-    // Write file with appropriate encoding
-    bool success = false;
-    if (encoding == Encoding::UTF8 || encoding == Encoding::UTF8_BOM) {
-        success = file.Write(wxTextFileType_Dos, wxConvUTF8);
+    // A BOM goes inside the compressed data, like the rest of the text
+    static const char UTF8_BOM_BYTES[] = {'\xEF', '\xBB', '\xBF'};
+    static const char UTF16_LE_BOM[] = {'\xFF', '\xFE'};
+    static const char UTF16_BE_BOM[] = {'\xFE', '\xFF'};
+    if (encoding == Encoding::UTF8_BOM) {
+        ok = writer->Write(UTF8_BOM_BYTES, sizeof(UTF8_BOM_BYTES));
     } else if (encoding == Encoding::UTF16_LE) {
-        success = file.Write(wxTextFileType_Dos, wxMBConvUTF16LE());
+        ok = writer->Write(UTF16_LE_BOM, sizeof(UTF16_LE_BOM));
     } else if (encoding == Encoding::UTF16_BE) {
-        success = file.Write(wxTextFileType_Dos, wxMBConvUTF16BE());
+        ok = writer->Write(UTF16_BE_BOM, sizeof(UTF16_BE_BOM));
     }
     
-    file.Close();
-    return success;
+    // ANSI uses the system's default code page
+    if (encoding == Encoding::ANSI) {
+        conv.reset(new wxCSConv(wxFONTENCODING_SYSTEM));
+    } else if (encoding == Encoding::UTF16_LE) {
+        conv.reset(new wxMBConvUTF16LE());
+    } else if (encoding == Encoding::UTF16_BE) {
+        conv.reset(new wxMBConvUTF16BE());
+    } else {
+        conv.reset(new wxMBConvUTF8());
+    }
+    return ok;
+}
+
+bool CSVWriter::Write(const wxString& text) {
+    if (!ok || text.empty()) {
+        return ok;
+    }
+    size_t length = 0;
+    wxCharBuffer bytes = conv->cWC2MB(text.wc_str(), text.length(), &length);
+    // Text the encoding cannot represent fails the save rather than being dropped
+    ok = length != wxCONV_FAILED && writer->Write(bytes.data(), length);
+    return ok;
+}
+
+bool CSVWriter::Close() {
+    // After a failed write the temporary file is dropped with the writer
+    bool closed = writer && ok && writer->Close();
+    writer.reset();
+    return closed;
 }
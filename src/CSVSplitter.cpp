@@ -0,0 +1,264 @@
+#include "CSVSplitter.h"
+#include "MappedFile.h"
+#include "Compression.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/filename.h>
+#include <string>
+
+namespace {
+
+// Encodings whose bytes can follow each other in one file
+int EncodingFamily(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::UTF8:
+        case Encoding::UTF8_BOM:
+            return 0;
+        case Encoding::ANSI:
+            return 1;
+        case Encoding::UTF16_LE:
+            return 2;
+        case Encoding::UTF16_BE:
+            return 3;
+    }
+    return 0;
+}
+
+std::string LineBreak(Encoding encoding) {
+    if (encoding == Encoding::UTF16_LE) {
+        return std::string("\r\0\n\0", 4);
+    }
+    if (encoding == Encoding::UTF16_BE) {
+        return std::string("\0\r\0\n", 4);
+    }
+    return "\r\n";
+}
+
+bool EndsWithLineBreak(const char* data, size_t size, Encoding encoding) {
+    if (encoding == Encoding::UTF16_LE || encoding == Encoding::UTF16_BE) {
+        if (size < 2) {
+            return false;
+        }
+        char lo = encoding == Encoding::UTF16_LE ? data[size - 2] : data[size - 1];
+        char hi = encoding == Encoding::UTF16_LE ? data[size - 1] : data[size - 2];
+        return hi == 0 && (lo == '\n' || lo == '\r');
+    }
+    return size > 0 && (data[size - 1] == '\n' || data[size - 1] == '\r');
+}
+
+// Bytes in pieces, so compressed output never buffers a whole range
+bool WriteRange(CompressedWriter& writer, const char* data, size_t begin, size_t end, size_t piece) {
+    for (size_t pos = begin; pos < end; pos += piece) {
+        if (!writer.Write(data + pos, wxMin(piece, end - pos))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+CSVSplitter::CSVSplitter() : rowCount(0) {
+}
+
+wxString CSVSplitter::PartName(const wxString& output, size_t index, size_t count) {
+    wxFileName name(output);
+    wxString fullName = name.GetFullName();
+    int dot = fullName.Find('.');
+    wxString stem = dot == wxNOT_FOUND ? fullName : fullName.Left(dot);
+    wxString extension = dot == wxNOT_FOUND ? wxString() : fullName.Mid(dot);
+    
+    // At least three digits, more when there are more parts
+    size_t digits = wxMax((size_t)3, wxString::Format("%llu", (unsigned long long)count).length());
+    wxString number = wxString::Format("%llu", (unsigned long long)(index + 1));
+    while (number.length() < digits) {
+        number = "0" + number;
+    }
+    name.SetFullName(stem + "_" + number + extension);
+    return name.GetFullPath();
+}
+
+bool CSVSplitter::Split(const CSVDiff::Input& input, Mode mode, size_t size, const wxString& output,
+                        wxString& error, const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("split.file");
+    outputFiles.clear();
+    rowCount = 0;
+    
+    if (size == 0) {
+        error = "The part size must be at least 1";
+        return false;
+    }
+    MappedFile file;
+    if (!file.Open(input.filename)) {
+        error = wxString::Format("Cannot open %s", input.filename);
+        return false;
+    }
+    file.AdviseSequential();
+    
+    // The BOM and header row start every part
+    Encoding encoding = CSVParser::ResolveEncoding(file, input.encoding);
+    size_t prefix = CSVParser::GetDataOffset(file, encoding);
+    if (input.hasHeader) {
+        CSVParser::SkipRecords(file, prefix, encoding, 1);
+    }
+    
+    // One sequential scan finds the boundaries of every part
+    std::vector<Part> parts;
+    size_t total = file.GetCompression() == Compression::NONE ? file.GetSize() : 0;
+    int reported = -1;
+    size_t pos = prefix;
+    for (;;) {
+        size_t begin = pos;
+        size_t count;
+        if (mode == Mode::ROWS) {
+            count = CSVParser::SkipRecords(file, pos, encoding, size);
+        } else {
+            size_t limit = begin + (size > prefix ? size - prefix : 0);
+            count = CSVParser::SkipRecords(file, pos, encoding, (size_t)-1, limit);
+        }
+        if (count == 0) {
+            break;
+        }
+        parts.push_back(Part{begin, pos});
+        rowCount += count;
+        
+        int percent = total > 0 ? (int)((double)pos / total * 50) : 0;
+        if (progress && percent != reported) {
+            reported = percent;
+            progress(percent);
+        }
+    }
+    if (!file.IsValid()) {
+        error = wxString::Format("Failed to read %s", input.filename);
+        return false;
+    }
+    
+    for (size_t i = 0; i < parts.size(); ++i) {
+        outputFiles.push_back(PartName(output, i, parts.size()));
+        if (wxFileName(outputFiles.back()).SameAs(wxFileName(input.filename))) {
+            error = "The output must be a different file than the input";
+            return false;
+        }
+    }
+    
+    // Parts are written in rounds of one per thread, progress is reported
+    // between rounds on the calling thread
+    const char* data = file.GetData();
+    size_t round = WorkerPool::Get().GetThreadCount();
+    std::vector<char> failed(parts.size(), 0);
+    for (size_t first = 0; first < parts.size(); first += round) {
+        size_t last = wxMin(first + round, parts.size());
+        WorkerPool::Get().ParallelFor(last - first, 1, [&](size_t begin, size_t end) {
+            for (size_t i = first + begin; i < first + end; ++i) {
+                CompressedWriter writer;
+                failed[i] = !writer.Open(outputFiles[i], CompressionFromFilename(outputFiles[i])) ||
+                            !WriteRange(writer, data, 0, prefix, COPY_BYTES) ||
+                            !WriteRange(writer, data, parts[i].begin, parts[i].end, COPY_BYTES) ||
+                            !writer.Close();
+            }
+        });
+        for (size_t i = first; i < last; ++i) {
+            if (failed[i]) {
+                error = wxString::Format("Cannot write %s", outputFiles[i]);
+                return false;
+            }
+        }
+        if (progress) {
+            progress(50 + (int)(last * 50 / parts.size()));
+        }
+    }
+    return true;
+}
+
+bool CSVSplitter::Concat(const std::vector<CSVDiff::Input>& inputs, const wxString& output,
+                         wxString& error, const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("concat.files");
+    outputFiles.clear();
+    rowCount = 0;
+    
+    if (inputs.empty()) {
+        error = "No files to concatenate";
+        return false;
+    }
+    for (const CSVDiff::Input& input : inputs) {
+        if (wxFileName(output).SameAs(wxFileName(input.filename))) {
+            error = "The output must be a different file than the inputs";
+            return false;
+        }
+    }
+    
+    // The target is replaced only when every file has been copied
+    CompressedWriter writer;
+    if (!writer.Open(output, CompressionFromFilename(output))) {
+        error = wxString::Format("Cannot write %s", output);
+        return false;
+    }
+    
+    Encoding firstEncoding = inputs[0].encoding;
+    std::vector<wxString> header;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const CSVDiff::Input& input = inputs[i];
+        MappedFile file;
+        if (!file.Open(input.filename)) {
+            error = wxString::Format("Cannot open %s", input.filename);
+            return false;
+        }
+        file.AdviseSequential();
+        
+        Encoding encoding = CSVParser::ResolveEncoding(file, input.encoding);
+        if (i == 0) {
+            firstEncoding = encoding;
+        } else if (EncodingFamily(encoding) != EncodingFamily(firstEncoding) ||
+                   input.separator != inputs[0].separator) {
+            error = wxString::Format("%s does not have the encoding and separator of %s",
+                                     input.filename, inputs[0].filename);
+            return false;
+        }
+        
+        size_t begin = CSVParser::GetDataOffset(file, encoding);
+        if (input.hasHeader) {
+            std::vector<std::vector<wxString>> rows;
+            CSVParser::ParseRows(file, begin, encoding, input.separator, 1, true, rows);
+            std::vector<wxString> fields = rows.empty() ? std::vector<wxString>() : rows[0];
+            if (i == 0) {
+                header = fields;
+            } else if (fields != header) {
+                error = wxString::Format("The header of %s differs from the header of %s",
+                                         input.filename, inputs[0].filename);
+                return false;
+            }
+            CSVParser::SkipRecords(file, begin, encoding, 1);
+        }
+        
+        // The first file's BOM and header start the output
+        size_t from = i == 0 ? 0 : begin;
+        size_t size = file.GetSize();
+        const char* data = file.GetData();
+        for (size_t pos = from; pos < size; pos += COPY_BYTES) {
+            if (!writer.Write(data + pos, wxMin(COPY_BYTES, size - pos))) {
+                error = wxString::Format("Cannot write %s", output);
+                return false;
+            }
+            if (progress) {
+                progress((int)((i * 100 + (double)(pos - from) / (size - from) * 100) / inputs.size()));
+            }
+        }
+        if (!file.IsValid()) {
+            error = wxString::Format("Failed to read %s", input.filename);
+            return false;
+        }
+        
+        // The next file starts on a line of its own
+        if (i + 1 < inputs.size() && size > from && !EndsWithLineBreak(data, size, encoding)) {
+            std::string lineBreak = LineBreak(encoding);
+            writer.Write(lineBreak.data(), lineBreak.size());
+        }
+    }
+    
+    if (!writer.Close()) {
+        error = wxString::Format("Cannot write %s", output);
+        return false;
+    }
+    outputFiles.push_back(output);
+    return true;
+}
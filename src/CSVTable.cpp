@@ -0,0 +1,1006 @@
+#include "CSVTable.h"
+#include "MemoryBudget.h"
+#include "Profiler.h"
+#include <wx/filename.h>
+#include <algorithm>
+#include <iterator>
+
+// Shared clock so page ages compare across documents
+static unsigned long long accessClock = 0;
+
+// Move the kept items to the front, in order, and drop the rest
+template <typename T>
+static void CompactItems(std::vector<T>& items, const std::vector<bool>& keep) {
+    size_t out = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (keep[i]) {
+            if (out != i) {
+                items[out] = std::move(items[i]);
+            }
+            ++out;
+        }
+    }
+    items.erase(items.begin() + out, items.end());
+}
+
+bool PageSource::LoadColumns(long long position, size_t rowCount,
+                             std::vector<std::vector<wxString>>& columns) {
+    std::vector<std::vector<wxString>> rows;
+    if (!LoadRows(position, rowCount, rows)) {
+        return false;
+    }
+    
+    size_t cols = 0;
+    for (const auto& row : rows) {
+        cols = wxMax(cols, row.size());
+    }
+    columns.assign(cols, std::vector<wxString>(rows.size()));
+    for (size_t row = 0; row < rows.size(); ++row) {
+        for (size_t col = 0; col < rows[row].size(); ++col) {
+            columns[col][row] = std::move(rows[row][col]);
+        }
+    }
+    return true;
+}
+
+bool PageSource::LoadSelectedColumns(long long position, size_t rowCount, const std::vector<int>& selected,
+                                     std::vector<std::vector<wxString>>& columns) {
+    std::vector<std::vector<wxString>> all;
+    if (!LoadColumns(position, rowCount, all)) {
+        return false;
+    }
+    
+    columns.assign(selected.size(), std::vector<wxString>());
+    for (size_t i = 0; i < selected.size(); ++i) {
+        if (selected[i] >= 0 && (size_t)selected[i] < all.size()) {
+            columns[i] = all[selected[i]];
+        }
+        columns[i].resize(rowCount);
+    }
+    return true;
+}
+
+bool PageSource::ReadsFrom(const wxString& filename) const {
+    return wxFileName(GetFilename()).SameAs(wxFileName(filename));
+}
+
+CSVFileSource::CSVFileSource()
+    : encoding(Encoding::UTF8),
+      separator(',') {
+}
+
+bool CSVFileSource::Open(const wxString& filename) {
+    return file.Open(filename);
+}
+
+void CSVFileSource::SetFormat(Encoding enc, wxChar sep) {
+    encoding = enc;
+    separator = sep;
+}
+
+bool CSVFileSource::LoadRows(long long position, size_t rowCount,
+                             std::vector<std::vector<wxString>>& rows) {
+    if (!file.IsOpened() || position < 0) {
+        return false;
+    }
+    
+    // The first line is kept even when empty, same as when the file was loaded
+    bool keepFirstEmpty = (size_t)position == CSVParser::GetDataOffset(file, encoding);
+    return CSVParser::ParseRows(file, (size_t)position, encoding, separator,
+                                rowCount, keepFirstEmpty, rows, columns) == rowCount;
+}
+
+bool CSVFileSource::LoadSelectedColumns(long long position, size_t rowCount, const std::vector<int>& selected,
+                                        std::vector<std::vector<wxString>>& loaded) {
+    if (!file.IsOpened() || position < 0) {
+        return false;
+    }
+    
+    // The parser takes file columns in ascending order, each once
+    std::vector<int> fileColumns;
+    for (int col : selected) {
+        fileColumns.push_back(columns.empty() ? col : columns[col]);
+    }
+    std::vector<int> parsed = fileColumns;
+    std::sort(parsed.begin(), parsed.end());
+    parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    
+    std::vector<std::vector<wxString>> rows;
+    bool keepFirstEmpty = (size_t)position == CSVParser::GetDataOffset(file, encoding);
+    if (CSVParser::ParseRows(file, (size_t)position, encoding, separator, rowCount,
+                             keepFirstEmpty, rows, parsed) != rowCount) {
+        return false;
+    }
+    
+    loaded.assign(selected.size(), std::vector<wxString>(rowCount));
+    for (size_t i = 0; i < selected.size(); ++i) {
+        size_t field = std::lower_bound(parsed.begin(), parsed.end(), fileColumns[i]) - parsed.begin();
+        for (size_t row = 0; row < rowCount; ++row) {
+            if (field < rows[row].size()) {
+                loaded[i][row] = rows[row][field];
+            }
+        }
+    }
+    return true;
+}
+
+const wxString& CSVTable::PageColumn::Get(size_t row) const {
+    return dictionary ? dictionary->GetValue(codes[row]) : values[row];
+}
+
+void CSVTable::PageColumn::Set(size_t row, const wxString& value) {
+    if (dictionary) {
+        StringDictionary::Code code;
+        if (dictionary->Intern(value, code)) {
+            codes[row] = code;
+            return;
+        }
+        // The dictionary is full, this page keeps plain strings from now on
+        Decode();
+    }
+    values[row] = value;
+}
+
+void CSVTable::PageColumn::Take(size_t row, wxString& value) {
+    if (dictionary) {
+        StringDictionary::Code code;
+        if (dictionary->Intern(value, code)) {
+            codes[row] = code;
+            return;
+        }
+        Decode();
+    }
+    values[row] = std::move(value);
+}
+
+void CSVTable::PageColumn::Append(wxString& value) {
+    if (dictionary) {
+        StringDictionary::Code code;
+        if (dictionary->Intern(value, code)) {
+            codes.push_back(code);
+            return;
+        }
+        Decode();
+    }
+    values.push_back(std::move(value));
+}
+
+void CSVTable::PageColumn::Insert(size_t pos, size_t count) {
+    if (dictionary) {
+        codes.insert(codes.begin() + pos, count, 0);
+    } else {
+        values.insert(values.begin() + pos, count, wxString());
+    }
+}
+
+void CSVTable::PageColumn::Erase(size_t pos, size_t count) {
+    if (dictionary) {
+        codes.erase(codes.begin() + pos, codes.begin() + pos + count);
+    } else {
+        values.erase(values.begin() + pos, values.begin() + pos + count);
+    }
+}
+
+void CSVTable::PageColumn::Compact(const std::vector<bool>& keep) {
+    if (dictionary) {
+        CompactItems(codes, keep);
+    } else {
+        CompactItems(values, keep);
+    }
+}
+
+void CSVTable::PageColumn::Resize(size_t count) {
+    if (dictionary) {
+        codes.resize(count, 0);
+    } else {
+        values.resize(count);
+    }
+}
+
+void CSVTable::PageColumn::Assign(std::vector<wxString>& source) {
+    StringDictionary* target = dictionary;
+    dictionary = nullptr;
+    codes.clear();
+    values = std::move(source);
+    if (target) {
+        Encode(target);
+    }
+}
+
+CSVTable::PageColumn CSVTable::PageColumn::Slice(size_t start, size_t count) {
+    PageColumn part;
+    part.dictionary = dictionary;
+    if (dictionary) {
+        part.codes.assign(codes.begin() + start, codes.begin() + start + count);
+    } else {
+        auto first = values.begin() + start;
+        part.values.assign(std::make_move_iterator(first), std::make_move_iterator(first + count));
+    }
+    return part;
+}
+
+bool CSVTable::PageColumn::Encode(StringDictionary* target) {
+    if (dictionary || !target) {
+        return dictionary == target;
+    }
+    std::vector<StringDictionary::Code> encoded(values.size());
+    for (size_t row = 0; row < values.size(); ++row) {
+        if (!target->Intern(values[row], encoded[row])) {
+            return false;
+        }
+    }
+    codes.swap(encoded);
+    std::vector<wxString>().swap(values);
+    dictionary = target;
+    return true;
+}
+
+void CSVTable::PageColumn::Decode() {
+    if (!dictionary) {
+        return;
+    }
+    values.resize(codes.size());
+    for (size_t row = 0; row < codes.size(); ++row) {
+        values[row] = dictionary->GetValue(codes[row]);
+    }
+    std::vector<StringDictionary::Code>().swap(codes);
+    dictionary = nullptr;
+}
+
+size_t CSVTable::PageColumn::GetCellMemory(size_t row) const {
+    return dictionary ? sizeof(StringDictionary::Code) : CellMemory(values[row]);
+}
+
+size_t CSVTable::PageColumn::GetMemoryUsage() const {
+    if (dictionary) {
+        return codes.size() * sizeof(StringDictionary::Code);
+    }
+    size_t usage = 0;
+    for (const wxString& value : values) {
+        usage += CellMemory(value);
+    }
+    return usage;
+}
+
+CSVTable::CSVTable()
+    : pageStartsValid(true),
+      pageBreak(false),
+      rowCount(0),
+      memoryUsage(0) {
+    MemoryBudget::Get().Register(this);
+}
+
+CSVTable::~CSVTable() {
+    MemoryBudget::Get().Unregister(this);
+}
+
+int CSVTable::GetNumberRows() {
+    return (int)rowCount;
+}
+
+int CSVTable::GetNumberCols() {
+    return (int)labels.size();
+}
+
+wxString CSVTable::GetValue(int row, int col) {
+    if (row < 0 || col < 0 || (size_t)row >= rowCount || (size_t)col >= labels.size()) {
+        return wxEmptyString;
+    }
+    
+    size_t pageIndex, localRow;
+    Page& page = LocateRow(row, pageIndex, localRow);
+    EnsureResident(page);
+    Touch(page);
+    return page.columns[col].Get(localRow);
+}
+
+void CSVTable::CopyValue(int row, int col, wxString& value) {
+    if (row < 0 || col < 0 || (size_t)row >= rowCount || (size_t)col >= labels.size()) {
+        value.clear();
+        return;
+    }
+    
+    size_t pageIndex, localRow;
+    Page& page = LocateRow(row, pageIndex, localRow);
+    EnsureResident(page);
+    Touch(page);
+    value = page.columns[col].Get(localRow);
+}
+
+size_t CSVTable::GetValueLength(int row, int col) {
+    if (row < 0 || col < 0 || (size_t)row >= rowCount || (size_t)col >= labels.size()) {
+        return 0;
+    }
+    
+    size_t pageIndex, localRow;
+    Page& page = LocateRow(row, pageIndex, localRow);
+    EnsureResident(page);
+    Touch(page);
+    return page.columns[col].Get(localRow).length();
+}
+
+bool CSVTable::CopyPrefix(int row, int col, size_t maxChars, wxString& value) {
+    if (row < 0 || col < 0 || (size_t)row >= rowCount || (size_t)col >= labels.size()) {
+        value.clear();
+        return false;
+    }
+    
+    size_t pageIndex, localRow;
+    Page& page = LocateRow(row, pageIndex, localRow);
+    EnsureResident(page);
+    Touch(page);
+    const wxString& cell = page.columns[col].Get(localRow);
+    if (cell.length() <= maxChars) {
+        value = cell;
+        return false;
+    }
+    value.assign(cell, 0, maxChars);
+    return true;
+}
+
+void CSVTable::PrepareRows(size_t first, size_t count) {
+    if (count == 0 || first >= rowCount) {
+        return;
+    }
+    
+    size_t pageIndex, localRow;
+    LocateRow(first, pageIndex, localRow);
+    size_t end = wxMin(first + count, rowCount);
+    for (size_t row = first - localRow; row < end; row += pages[pageIndex++].rowCount) {
+        EnsureResident(pages[pageIndex]);
+        Touch(pages[pageIndex]);
+    }
+}
+
+void CSVTable::ReadColumn(int col, size_t first, size_t count, std::vector<wxString>& values) const {
+    // Only reads, the page index was brought up to date by PrepareRows
+    auto it = std::upper_bound(pageStarts.begin(), pageStarts.end(), first);
+    size_t pageIndex = (it - pageStarts.begin()) - 1;
+    size_t done = 0;
+    for (; done < count && pageIndex < pages.size(); ++pageIndex) {
+        size_t localRow = first + done - pageStarts[pageIndex];
+        size_t rows = wxMin(count - done, pages[pageIndex].rowCount - localRow);
+        ReadPageColumn(pageIndex, col, localRow, rows, &values[done]);
+        done += rows;
+    }
+}
+
+void CSVTable::ReadPageColumn(size_t page, int col, size_t first, size_t count, wxString* values) const {
+    const PageColumn& column = pages[page].columns[col];
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = column.Get(first + i);
+    }
+}
+
+void CSVTable::LoadPageColumns(size_t pageIndex, const std::vector<int>& cols,
+                               std::vector<std::vector<wxString>>& values) const {
+    const Page& page = pages[pageIndex];
+    values.assign(cols.size(), std::vector<wxString>());
+    if (page.resident) {
+        for (size_t i = 0; i < cols.size(); ++i) {
+            values[i].resize(page.rowCount);
+            ReadPageColumn(pageIndex, cols[i], 0, page.rowCount, values[i].data());
+        }
+        return;
+    }
+    
+    // Columns added after loading are not in the source and stay empty
+    std::vector<int> selected;
+    std::vector<size_t> targets;
+    for (size_t i = 0; i < cols.size(); ++i) {
+        if (sourceColumns[cols[i]] >= 0) {
+            selected.push_back(sourceColumns[cols[i]]);
+            targets.push_back(i);
+        }
+    }
+    std::vector<std::vector<wxString>> loaded;
+    if (!selected.empty() && source &&
+        source->LoadSelectedColumns(page.sourcePosition, page.rowCount, selected, loaded)) {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            values[targets[i]] = std::move(loaded[i]);
+        }
+    }
+    for (auto& column : values) {
+        column.resize(page.rowCount);
+    }
+}
+
+void CSVTable::WriteColumn(int col, size_t first, std::vector<wxString>& values) {
+    if (col < 0 || (size_t)col >= labels.size()) {
+        return;
+    }
+    
+    size_t count = first < rowCount ? wxMin(values.size(), rowCount - first) : 0;
+    size_t done = 0;
+    while (done < count) {
+        size_t pageIndex, localRow;
+        Page& page = LocateRow(first + done, pageIndex, localRow);
+        EnsureResident(page);
+        Touch(page);
+        
+        PageColumn& column = page.columns[col];
+        size_t rows = wxMin(count - done, page.rowCount - localRow);
+        size_t before = column.GetMemoryUsage();
+        for (size_t i = 0; i < rows; ++i) {
+            column.Take(localRow + i, values[done + i]);
+        }
+        
+        // A column filled from scratch gets a dictionary like a loaded one,
+        // decided on its first page and applied to the pages after it
+        if (pageIndex == 0 && rows == page.rowCount) {
+            ChooseDictionary(page, col);
+        } else if (dictionaries[col] && !dictionaries[col]->IsFull()) {
+            column.Encode(dictionaries[col].get());
+        }
+        size_t after = column.GetMemoryUsage();
+        page.memoryUsage += after - before;
+        memoryUsage += after - before;
+        MarkModified(page);
+        done += rows;
+    }
+}
+
+void CSVTable::SetValue(int row, int col, const wxString& value) {
+    if (row < 0 || col < 0 || (size_t)row >= rowCount || (size_t)col >= labels.size()) {
+        return;
+    }
+    
+    size_t pageIndex, localRow;
+    Page& page = LocateRow(row, pageIndex, localRow);
+    EnsureResident(page);
+    Touch(page);
+    
+    PageColumn& column = page.columns[col];
+    bool encoded = column.dictionary != nullptr;
+    size_t before = column.GetCellMemory(localRow);
+    column.Set(localRow, value);
+    if (encoded && !column.dictionary) {
+        // Decoded to plain strings, the whole page changed size
+        UpdatePageMemory(page);
+    } else {
+        size_t after = column.GetCellMemory(localRow);
+        page.memoryUsage += after - before;
+        memoryUsage += after - before;
+    }
+    MarkModified(page);
+}
+
+bool CSVTable::IsEmptyCell(int row, int col) {
+    return GetValue(row, col).IsEmpty();
+}
+
+void CSVTable::Clear() {
+    for (Page& page : pages) {
+        page.columns.clear();
+        for (size_t col = 0; col < labels.size(); ++col) {
+            page.columns.push_back(NewColumn(col, page.rowCount));
+        }
+        page.resident = true;
+        MarkModified(page);
+        UpdatePageMemory(page);
+    }
+}
+
+bool CSVTable::InsertRows(size_t pos, size_t numRows) {
+    if (pos >= rowCount) {
+        return AppendRows(numRows);
+    }
+    if (numRows == 0) {
+        return true;
+    }
+    
+    size_t pageIndex, localRow;
+    Page& page = LocateRow(pos, pageIndex, localRow);
+    EnsureResident(page);
+    Touch(page);
+    for (auto& column : page.columns) {
+        column.Insert(localRow, numRows);
+    }
+    page.rowCount += numRows;
+    rowCount += numRows;
+    pageStartsValid = false;
+    MarkModified(page);
+    UpdatePageMemory(page);
+    
+    // Keep pages small so later edits stay cheap
+    if (page.rowCount > PAGE_ROWS * 2) {
+        SplitPage(pageIndex);
+    }
+    
+    Notify(wxGRIDTABLE_NOTIFY_ROWS_INSERTED, (int)pos, (int)numRows);
+    return true;
+}
+
+bool CSVTable::AppendRows(size_t numRows) {
+    size_t remaining = numRows;
+    
+    // Grow the last page if it is already detached from the source
+    if (!pages.empty()) {
+        Page& last = pages.back();
+        if (last.resident && last.sourcePosition < 0 && last.rowCount < PAGE_ROWS) {
+            size_t count = wxMin(remaining, PAGE_ROWS - last.rowCount);
+            for (auto& column : last.columns) {
+                column.Resize(last.rowCount + count);
+            }
+            last.rowCount += count;
+            remaining -= count;
+            Touch(last);
+            UpdatePageMemory(last);
+        }
+    }
+    
+    while (remaining > 0) {
+        size_t count = wxMin(remaining, PAGE_ROWS);
+        pages.push_back(NewPage(count));
+        UpdatePageMemory(pages.back());
+        remaining -= count;
+    }
+    
+    rowCount += numRows;
+    pageStartsValid = false;
+    Notify(wxGRIDTABLE_NOTIFY_ROWS_APPENDED, (int)numRows);
+    return true;
+}
+
+bool CSVTable::DeleteRows(size_t pos, size_t numRows) {
+    if (pos >= rowCount) {
+        return false;
+    }
+    numRows = wxMin(numRows, rowCount - pos);
+    
+    // Rows after the deleted range shift down, so pos stays the same
+    size_t remaining = numRows;
+    while (remaining > 0) {
+        size_t pageIndex, localRow;
+        Page& page = LocateRow(pos, pageIndex, localRow);
+        size_t count = wxMin(remaining, page.rowCount - localRow);
+        
+        if (count == page.rowCount) {
+            memoryUsage -= page.memoryUsage;
+            pages.erase(pages.begin() + pageIndex);
+        } else {
+            EnsureResident(page);
+            for (auto& column : page.columns) {
+                column.Erase(localRow, count);
+            }
+            page.rowCount -= count;
+            MarkModified(page);
+            UpdatePageMemory(page);
+        }
+        
+        rowCount -= count;
+        remaining -= count;
+        pageStartsValid = false;
+    }
+    
+    Notify(wxGRIDTABLE_NOTIFY_ROWS_DELETED, (int)pos, (int)numRows);
+    return true;
+}
+
+void CSVTable::DeleteRowRanges(const RangeList& ranges) {
+    PROFILE_SCOPE("table.delete_rows");
+    size_t next = 0;
+    size_t pageStart = 0;
+    size_t kept = 0;
+    size_t removedTotal = 0;
+    
+    for (size_t i = 0; i < pages.size(); ++i) {
+        Page& page = pages[i];
+        size_t pageEnd = pageStart + page.rowCount;
+        
+        // Survivors mask of this page, built only when a range reaches it
+        std::vector<bool> keep;
+        size_t removed = 0;
+        while (next < ranges.size() && ranges[next].first < pageEnd) {
+            size_t rangeEnd = ranges[next].first + ranges[next].second;
+            size_t first = wxMax(ranges[next].first, pageStart);
+            size_t last = wxMin(rangeEnd, pageEnd);
+            if (keep.empty()) {
+                keep.assign(page.rowCount, true);
+            }
+            for (size_t row = first; row < last; ++row) {
+                keep[row - pageStart] = false;
+            }
+            removed += last - first;
+            if (rangeEnd > pageEnd) {
+                break;   // continues on the next page
+            }
+            ++next;
+        }
+        pageStart = pageEnd;
+        removedTotal += removed;
+        
+        if (removed == page.rowCount) {
+            memoryUsage -= page.memoryUsage;
+            continue;
+        }
+        if (removed > 0) {
+            EnsureResident(page);
+            for (auto& column : page.columns) {
+                column.Compact(keep);
+            }
+            page.rowCount -= removed;
+            MarkModified(page);
+            UpdatePageMemory(page);
+        }
+        if (kept != i) {
+            pages[kept] = std::move(page);
+        }
+        ++kept;
+    }
+    
+    pages.erase(pages.begin() + kept, pages.end());
+    rowCount -= removedTotal;
+    pageStartsValid = false;
+    
+    // Last range first so each message's indices are still valid for the grid
+    for (size_t i = ranges.size(); i-- > 0;) {
+        Notify(wxGRIDTABLE_NOTIFY_ROWS_DELETED, (int)ranges[i].first, (int)ranges[i].second);
+    }
+}
+
+void CSVTable::DeleteColRanges(const RangeList& ranges) {
+    std::vector<bool> keep(labels.size(), true);
+    for (const auto& range : ranges) {
+        for (size_t col = range.first; col < range.first + range.second && col < keep.size(); ++col) {
+            keep[col] = false;
+        }
+    }
+    
+    CompactItems(labels, keep);
+    CompactItems(sourceColumns, keep);
+    for (Page& page : pages) {
+        if (page.resident) {
+            CompactItems(page.columns, keep);
+            UpdatePageMemory(page);
+        }
+    }
+    // Dictionaries go last, the dropped page columns pointed into them
+    CompactItems(dictionaries, keep);
+    
+    for (size_t i = ranges.size(); i-- > 0;) {
+        Notify(wxGRIDTABLE_NOTIFY_COLS_DELETED, (int)ranges[i].first, (int)ranges[i].second);
+    }
+}
+
+bool CSVTable::InsertCols(size_t pos, size_t numCols) {
+    if (pos >= labels.size()) {
+        return AppendCols(numCols);
+    }
+    
+    labels.insert(labels.begin() + pos, numCols, wxString());
+    sourceColumns.insert(sourceColumns.begin() + pos, numCols, -1);
+    dictionaries.insert(dictionaries.begin() + pos, numCols, nullptr);
+    for (Page& page : pages) {
+        if (page.resident) {
+            PageColumn column;
+            column.Resize(page.rowCount);
+            page.columns.insert(page.columns.begin() + pos, numCols, column);
+            size_t added = numCols * page.rowCount * sizeof(wxString);
+            page.memoryUsage += added;
+            memoryUsage += added;
+        }
+    }
+    
+    Notify(wxGRIDTABLE_NOTIFY_COLS_INSERTED, (int)pos, (int)numCols);
+    return true;
+}
+
+bool CSVTable::AppendCols(size_t numCols) {
+    labels.resize(labels.size() + numCols);
+    sourceColumns.resize(sourceColumns.size() + numCols, -1);
+    dictionaries.resize(labels.size());
+    for (Page& page : pages) {
+        if (page.resident) {
+            PageColumn column;
+            column.Resize(page.rowCount);
+            page.columns.resize(labels.size(), column);
+            size_t added = numCols * page.rowCount * sizeof(wxString);
+            page.memoryUsage += added;
+            memoryUsage += added;
+        }
+    }
+    
+    Notify(wxGRIDTABLE_NOTIFY_COLS_APPENDED, (int)numCols);
+    return true;
+}
+
+bool CSVTable::DeleteCols(size_t pos, size_t numCols) {
+    if (pos >= labels.size()) {
+        return false;
+    }
+    numCols = wxMin(numCols, labels.size() - pos);
+    
+    labels.erase(labels.begin() + pos, labels.begin() + pos + numCols);
+    sourceColumns.erase(sourceColumns.begin() + pos, sourceColumns.begin() + pos + numCols);
+    for (Page& page : pages) {
+        if (page.resident) {
+            size_t removed = 0;
+            for (size_t col = pos; col < pos + numCols; ++col) {
+                removed += page.columns[col].GetMemoryUsage();
+            }
+            page.columns.erase(page.columns.begin() + pos, page.columns.begin() + pos + numCols);
+            page.memoryUsage -= removed;
+            memoryUsage -= removed;
+        }
+    }
+    // Dictionaries go last, the erased page columns pointed into them
+    dictionaries.erase(dictionaries.begin() + pos, dictionaries.begin() + pos + numCols);
+    
+    Notify(wxGRIDTABLE_NOTIFY_COLS_DELETED, (int)pos, (int)numCols);
+    return true;
+}
+
+wxString CSVTable::GetColLabelValue(int col) {
+    if (col >= 0 && (size_t)col < labels.size() && !labels[col].IsEmpty()) {
+        return labels[col];
+    }
+    // Fall back to the spreadsheet style letters
+    return wxGridTableBase::GetColLabelValue(col);
+}
+
+void CSVTable::SetColLabelValue(int col, const wxString& label) {
+    if (col >= 0 && (size_t)col < labels.size()) {
+        labels[col] = label;
+    }
+}
+
+void CSVTable::AppendLoadedRow(std::vector<wxString>& row, long long sourcePosition) {
+    if (pages.empty() || pageBreak || pages.back().rowCount >= PAGE_ROWS) {
+        // The first full page decides which columns get a dictionary
+        pageBreak = false;
+        if (pages.size() == 1) {
+            ChooseDictionaries(pages[0]);
+        }
+        
+        Page page;
+        page.rowCount = 0;
+        page.sourcePosition = sourcePosition;
+        page.resident = true;
+        page.lastAccess = 0;
+        page.memoryUsage = 0;
+        pages.push_back(std::move(page));
+    }
+    
+    // Rows can be ragged, columns are padded as wider rows show up
+    Page& page = pages.back();
+    while (row.size() > page.columns.size()) {
+        page.columns.push_back(NewColumn(page.columns.size(), page.rowCount));
+    }
+    for (size_t col = 0; col < page.columns.size(); ++col) {
+        if (col < row.size()) {
+            page.columns[col].Append(row[col]);
+        } else {
+            wxString empty;
+            page.columns[col].Append(empty);
+        }
+    }
+    page.rowCount++;
+    rowCount++;
+}
+
+void CSVTable::AppendSourcePage(size_t rows, long long sourcePosition) {
+    Page page;
+    page.rowCount = rows;
+    page.sourcePosition = sourcePosition;
+    page.resident = false;
+    page.lastAccess = 0;
+    page.memoryUsage = 0;
+    pages.push_back(std::move(page));
+    rowCount += rows;
+}
+
+void CSVTable::FinishLoad(const std::vector<wxString>& columnLabels, size_t cols,
+                          std::shared_ptr<PageSource> pageSource) {
+    PROFILE_SCOPE("table.finish_load");
+    labels = columnLabels;
+    labels.resize(cols);
+    sourceColumns.resize(cols);
+    for (size_t col = 0; col < cols; ++col) {
+        sourceColumns[col] = (int)col;
+    }
+    
+    // Small files never filled a page, decide on what was loaded
+    if (pages.size() == 1) {
+        ChooseDictionaries(pages[0]);
+    }
+    dictionaries.resize(cols);
+    
+    source = pageSource;
+    for (Page& page : pages) {
+        if (page.resident) {
+            while (page.columns.size() < cols) {
+                page.columns.push_back(NewColumn(page.columns.size(), page.rowCount));
+            }
+        }
+        if (!source) {
+            MarkModified(page);
+        }
+        Touch(page);
+        UpdatePageMemory(page);
+    }
+    pageStartsValid = false;
+}
+
+void CSVTable::DetachSource() {
+    PROFILE_SCOPE("table.detach_source");
+    for (Page& page : pages) {
+        EnsureResident(page);
+        MarkModified(page);
+    }
+    source.reset();
+}
+
+bool CSVTable::CanEvictPage(size_t page) const {
+    return source && pages[page].resident && pages[page].sourcePosition >= 0;
+}
+
+size_t CSVTable::EvictPage(size_t pageIndex) {
+    if (!CanEvictPage(pageIndex)) {
+        return 0;
+    }
+    
+    Page& page = pages[pageIndex];
+    size_t freed = page.memoryUsage;
+    std::vector<PageColumn>().swap(page.columns);
+    page.resident = false;
+    page.memoryUsage = 0;
+    memoryUsage -= freed;
+    return freed;
+}
+
+CSVTable::Page& CSVTable::LocateRow(size_t row, size_t& pageIndex, size_t& localRow) {
+    if (!pageStartsValid) {
+        pageStarts.resize(pages.size());
+        size_t start = 0;
+        for (size_t i = 0; i < pages.size(); ++i) {
+            pageStarts[i] = start;
+            start += pages[i].rowCount;
+        }
+        pageStartsValid = true;
+    }
+    
+    auto it = std::upper_bound(pageStarts.begin(), pageStarts.end(), row);
+    pageIndex = (it - pageStarts.begin()) - 1;
+    localRow = row - pageStarts[pageIndex];
+    return pages[pageIndex];
+}
+
+void CSVTable::EnsureResident(Page& page) {
+    if (page.resident) {
+        return;
+    }
+    PROFILE_SCOPE("table.load_page");
+    
+    std::vector<std::vector<wxString>> sourceColumnData;
+    if (!source || !source->LoadColumns(page.sourcePosition, page.rowCount, sourceColumnData)) {
+        // The source went away underneath us, keep the rows but empty
+        sourceColumnData.clear();
+    }
+    
+    // Whole source columns move into place, columns added later start empty
+    page.columns.clear();
+    for (size_t col = 0; col < labels.size(); ++col) {
+        PageColumn column = NewColumn(col, 0);
+        int sourceCol = sourceColumns[col];
+        if (sourceCol >= 0 && (size_t)sourceCol < sourceColumnData.size()) {
+            column.Assign(sourceColumnData[sourceCol]);
+        }
+        column.Resize(page.rowCount);
+        page.columns.push_back(std::move(column));
+    }
+    page.resident = true;
+    UpdatePageMemory(page);
+}
+
+void CSVTable::Touch(Page& page) {
+    page.lastAccess = ++accessClock;
+}
+
+void CSVTable::MarkModified(Page& page) {
+    page.sourcePosition = -1;
+}
+
+void CSVTable::UpdatePageMemory(Page& page) {
+    size_t usage = 0;
+    for (const auto& column : page.columns) {
+        usage += column.GetMemoryUsage();
+    }
+    memoryUsage += usage - page.memoryUsage;
+    page.memoryUsage = usage;
+}
+
+CSVTable::Page CSVTable::NewPage(size_t rows) const {
+    Page page;
+    page.rowCount = rows;
+    for (size_t col = 0; col < labels.size(); ++col) {
+        page.columns.push_back(NewColumn(col, rows));
+    }
+    page.sourcePosition = -1;
+    page.resident = true;
+    page.lastAccess = ++accessClock;
+    page.memoryUsage = 0;
+    return page;
+}
+
+CSVTable::PageColumn CSVTable::NewColumn(size_t col, size_t rows) const {
+    // Encode new pages of dictionary columns until the dictionary fills up
+    PageColumn column;
+    if (col < dictionaries.size() && dictionaries[col] && !dictionaries[col]->IsFull()) {
+        column.dictionary = dictionaries[col].get();
+    }
+    column.Resize(rows);
+    return column;
+}
+
+void CSVTable::ChooseDictionaries(Page& page) {
+    dictionaries.resize(wxMax(dictionaries.size(), page.columns.size()));
+    if (page.rowCount < DICTIONARY_MIN_ROWS) {
+        return;
+    }
+    
+    for (size_t col = 0; col < page.columns.size(); ++col) {
+        ChooseDictionary(page, col);
+    }
+    UpdatePageMemory(page);
+}
+
+void CSVTable::ChooseDictionary(Page& page, size_t col) {
+    dictionaries.resize(wxMax(dictionaries.size(), page.columns.size()));
+    PageColumn& column = page.columns[col];
+    if (page.rowCount < DICTIONARY_MIN_ROWS || dictionaries[col] || column.dictionary) {
+        return;
+    }
+    
+    // Count distinct values, giving up as soon as there are too many
+    size_t maxDistinct = page.rowCount / DICTIONARY_RATIO;
+    std::shared_ptr<StringDictionary> dictionary = std::make_shared<StringDictionary>();
+    bool lowCardinality = true;
+    StringDictionary::Code code;
+    for (size_t row = 0; row < column.values.size() && lowCardinality; ++row) {
+        lowCardinality = dictionary->Intern(column.values[row], code) &&
+                         dictionary->GetSize() <= maxDistinct;
+    }
+    if (lowCardinality && column.Encode(dictionary.get())) {
+        dictionaries[col] = dictionary;
+    }
+}
+
+void CSVTable::SplitPage(size_t pageIndex) {
+    Page big = std::move(pages[pageIndex]);
+    memoryUsage -= big.memoryUsage;
+    
+    std::vector<Page> parts;
+    for (size_t start = 0; start < big.rowCount; start += PAGE_ROWS) {
+        size_t count = wxMin(PAGE_ROWS, big.rowCount - start);
+        Page part;
+        part.rowCount = count;
+        for (PageColumn& column : big.columns) {
+            part.columns.push_back(column.Slice(start, count));
+        }
+        part.sourcePosition = -1;
+        part.resident = true;
+        part.lastAccess = big.lastAccess;
+        part.memoryUsage = 0;
+        parts.push_back(std::move(part));
+    }
+    
+    pages.erase(pages.begin() + pageIndex);
+    pages.insert(pages.begin() + pageIndex,
+                 std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+    for (size_t i = pageIndex; i < pageIndex + parts.size(); ++i) {
+        UpdatePageMemory(pages[i]);
+    }
+    pageStartsValid = false;
+}
+
+void CSVTable::Notify(int message, int first, int second) {
+    if (GetView()) {
+        wxGridTableMessage msg(this, message, first, second);
+        GetView()->ProcessTableMessage(msg);
+    }
+}
+
+size_t CSVTable::CellMemory(const wxString& value) {
+    return sizeof(wxString) + value.length() * sizeof(wxChar);
+}
@@ -0,0 +1,552 @@
+#include "CSVValidator.h"
+#include "CSVParser.h"
+#include "MappedFile.h"
+#include "ColumnExpression.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/regex.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace {
+
+const double UNBOUNDED = std::numeric_limits<double>::infinity();
+
+// Field of a short row past its last column
+const wxString EMPTY_FIELD;
+
+bool IsUTF16(Encoding encoding) {
+    return encoding == Encoding::UTF16_LE || encoding == Encoding::UTF16_BE;
+}
+
+// \r\n, \n and a lone \r each count as one line break
+size_t CountLineBreaks(const char* data, size_t begin, size_t end, Encoding encoding) {
+    size_t count = 0;
+    if (IsUTF16(encoding)) {
+        size_t lo = encoding == Encoding::UTF16_LE ? 0 : 1;
+        size_t hi = 1 - lo;
+        for (size_t i = begin; i + 1 < end; i += 2) {
+            if (data[i + hi] != 0) {
+                continue;
+            }
+            char c = data[i + lo];
+            if (c == '\n') {
+                ++count;
+            } else if (c == '\r' && !(i + 3 < end && data[i + 2 + hi] == 0 && data[i + 2 + lo] == '\n')) {
+                ++count;
+            }
+        }
+        return count;
+    }
+    
+    const char* stop = data + end;
+    for (const char* p = data + begin; (p = (const char*)memchr(p, '\n', stop - p)) != nullptr; ++p) {
+        ++count;
+    }
+    for (const char* p = data + begin; (p = (const char*)memchr(p, '\r', stop - p)) != nullptr; ++p) {
+        if (p + 1 >= stop || p[1] != '\n') {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// An odd number of quotes leaves a quoted field open. The boundary scan
+// only ends a record inside quotes at the end of the file.
+bool HasOpenQuote(const char* data, size_t begin, size_t end, Encoding encoding) {
+    size_t quotes = 0;
+    if (IsUTF16(encoding)) {
+        size_t lo = encoding == Encoding::UTF16_LE ? 0 : 1;
+        for (size_t i = begin; i + 1 < end; i += 2) {
+            if (data[i + lo] == '"' && data[i + 1 - lo] == 0) {
+                ++quotes;
+            }
+        }
+    } else {
+        const char* stop = data + end;
+        for (const char* p = data + begin; (p = (const char*)memchr(p, '"', stop - p)) != nullptr; ++p) {
+            ++quotes;
+        }
+    }
+    return quotes % 2 == 1;
+}
+
+bool IsInteger(const wxString& text) {
+    if (text.empty()) {
+        return false;
+    }
+    size_t i = text[0] == '-' || text[0] == '+' ? 1 : 0;
+    if (i >= text.length()) {
+        return false;
+    }
+    for (; i < text.length(); ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsBoolean(const wxString& text) {
+    static const char* const NAMES[] = {"true", "false", "yes", "no", "y", "n", "1", "0"};
+    for (const char* name : NAMES) {
+        if (text.IsSameAs(name, false)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The value ranges are checked on: numbers and dates by value, text by
+// length. False when the text is not of the type.
+bool ValueOf(CSVValidator::Type type, const wxString& text, double& value) {
+    switch (type) {
+        case CSVValidator::Type::TEXT:
+            value = (double)text.length();
+            return true;
+        case CSVValidator::Type::INTEGER: {
+            wxString trimmed = text.Strip(wxString::both);
+            if (!IsInteger(trimmed)) {
+                return false;
+            }
+            value = ColumnExpression::ParseNumber(trimmed);
+            return true;
+        }
+        case CSVValidator::Type::NUMBER:
+            value = ColumnExpression::ParseNumber(text);
+            return !std::isnan(value);
+        case CSVValidator::Type::DATE: {
+            int year, month, day;
+            if (!ColumnExpression::ParseDate(text, year, month, day)) {
+                return false;
+            }
+            value = year * 10000.0 + month * 100.0 + day;
+            return true;
+        }
+        case CSVValidator::Type::BOOLEAN:
+            value = 0;
+            return IsBoolean(text.Strip(wxString::both));
+    }
+    return false;
+}
+
+// A bound of a rule, in the units ValueOf compares
+bool ParseBound(CSVValidator::Type type, const wxString& text, double unbounded, double& bound) {
+    if (text.IsEmpty() || type == CSVValidator::Type::BOOLEAN) {
+        bound = unbounded;
+        return true;
+    }
+    if (type == CSVValidator::Type::TEXT) {
+        bound = ColumnExpression::ParseNumber(text);
+        return !std::isnan(bound);
+    }
+    return ValueOf(type, text, bound);
+}
+
+bool ParseType(const wxString& text, CSVValidator::Type& type) {
+    wxString name = text.Strip(wxString::both).Lower();
+    if (name.IsEmpty() || name == "text" || name == "string") {
+        type = CSVValidator::Type::TEXT;
+    } else if (name == "integer" || name == "int") {
+        type = CSVValidator::Type::INTEGER;
+    } else if (name == "number" || name == "decimal" || name == "float") {
+        type = CSVValidator::Type::NUMBER;
+    } else if (name == "date") {
+        type = CSVValidator::Type::DATE;
+    } else if (name == "boolean" || name == "bool") {
+        type = CSVValidator::Type::BOOLEAN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+wxString TypeDescription(CSVValidator::Type type) {
+    switch (type) {
+        case CSVValidator::Type::INTEGER:
+            return "an integer";
+        case CSVValidator::Type::NUMBER:
+            return "a number";
+        case CSVValidator::Type::DATE:
+            return "a date";
+        case CSVValidator::Type::BOOLEAN:
+            return "a boolean";
+        default:
+            return "text";
+    }
+}
+
+// Anchored, so the whole value has to match
+wxString AnchoredPattern(const wxString& pattern) {
+    return "^(" + pattern + ")$";
+}
+
+}
+
+CSVValidator::CSVValidator() : rowCount(0) {
+    std::fill(problemCounts, problemCounts + (int)Problem::COUNT, (size_t)0);
+}
+
+bool CSVValidator::LoadSchema(const wxString& filename, wxString& error) {
+    std::vector<std::vector<wxString>> data;
+    wxChar separator;
+    Encoding encoding;
+    bool hasHeader = true;
+    CSVParser parser;
+    if (!parser.ReadFile(filename, data, separator, encoding, hasHeader) || data.empty()) {
+        error = wxString::Format("Cannot read the schema %s", filename);
+        return false;
+    }
+    
+    // Schema columns by header name, in any order
+    enum { NAME, TYPE, REQUIRED, MINIMUM, MAXIMUM, PATTERN, FIELD_COUNT };
+    static const char* const FIELDS[FIELD_COUNT] = {"name", "type", "required", "min", "max", "pattern"};
+    int positions[FIELD_COUNT];
+    for (int field = 0; field < FIELD_COUNT; ++field) {
+        positions[field] = -1;
+        for (size_t col = 0; col < data[0].size(); ++col) {
+            if (data[0][col].Strip(wxString::both).IsSameAs(FIELDS[field], false)) {
+                positions[field] = (int)col;
+            }
+        }
+    }
+    if (positions[NAME] < 0) {
+        error = "The schema has no name column";
+        return false;
+    }
+    
+    std::vector<ColumnRule> schema;
+    for (size_t row = 1; row < data.size(); ++row) {
+        auto get = [&](int field) {
+            int col = positions[field];
+            return col >= 0 && col < (int)data[row].size() ? data[row][col].Strip(wxString::both) : wxString();
+        };
+        ColumnRule rule;
+        rule.name = get(NAME);
+        if (!ParseType(get(TYPE), rule.type)) {
+            error = wxString::Format("Unknown type %s for column %s", get(TYPE), rule.name);
+            return false;
+        }
+        wxString required = get(REQUIRED).Lower();
+        rule.required = required == "yes" || required == "true" || required == "y" || required == "1" || required == "x";
+        rule.minimum = get(MINIMUM);
+        rule.maximum = get(MAXIMUM);
+        rule.pattern = get(PATTERN);
+        schema.push_back(rule);
+    }
+    rules = schema;
+    return true;
+}
+
+size_t CSVValidator::GetIssueCount() const {
+    size_t count = 0;
+    for (size_t problemCount : problemCounts) {
+        count += problemCount;
+    }
+    return count;
+}
+
+wxString CSVValidator::GetColumnName(int column) const {
+    if (column < 0) {
+        return wxEmptyString;
+    }
+    if (column < (int)columnNames.size() && !columnNames[column].IsEmpty()) {
+        return columnNames[column];
+    }
+    return wxString::Format("%d", column + 1);
+}
+
+wxString CSVValidator::GetProblemName(Problem problem) {
+    switch (problem) {
+        case Problem::RAGGED_ROW:
+            return "ragged_row";
+        case Problem::UNTERMINATED_QUOTE:
+            return "unterminated_quote";
+        case Problem::INVALID_TEXT:
+            return "invalid_text";
+        case Problem::MISSING_COLUMN:
+            return "missing_column";
+        case Problem::REQUIRED:
+            return "required";
+        case Problem::TYPE:
+            return "type";
+        case Problem::RANGE:
+            return "range";
+        case Problem::PATTERN:
+            return "pattern";
+        default:
+            return wxEmptyString;
+    }
+}
+
+std::vector<wxString> CSVValidator::GetReportHeader() {
+    return {"line", "offset", "row", "column", "problem", "message", "value"};
+}
+
+void CSVValidator::FormatIssue(const Issue& issue, std::vector<wxString>& fields) const {
+    fields.resize(7);
+    fields[0] = wxString::Format("%llu", (unsigned long long)issue.line);
+    fields[1] = wxString::Format("%lld", issue.offset);
+    fields[2] = issue.row >= 0 ? wxString::Format("%lld", issue.row + 1) : wxString();
+    fields[3] = GetColumnName(issue.column);
+    fields[4] = GetProblemName(issue.problem);
+    fields[5] = issue.message;
+    fields[6] = issue.value;
+}
+
+bool CSVValidator::Validate(const CSVDiff::Input& input, const IssueHandler& handler, wxString& error,
+                            const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("validate.file");
+    rowCount = 0;
+    std::fill(problemCounts, problemCounts + (int)Problem::COUNT, (size_t)0);
+    columnNames.clear();
+    
+    MappedFile file;
+    if (!file.Open(input.filename)) {
+        error = wxString::Format("Cannot open %s", input.filename);
+        return false;
+    }
+    file.AdviseSequential();
+    
+    auto report = [&](const Issue& issue) {
+        problemCounts[(int)issue.problem]++;
+        handler(issue);
+    };
+    
+    Encoding encoding = CSVParser::ResolveEncoding(file, input.encoding);
+    size_t pos = CSVParser::GetDataOffset(file, encoding);
+    size_t line = 1;
+    
+    // The header names the columns the rules are bound to
+    std::vector<wxString> header;
+    std::vector<std::pair<size_t, size_t>> first;
+    if (input.hasHeader && CSVParser::FindRecords(file, pos, encoding, 1, first) == 1) {
+        Issue issue = {Problem::INVALID_TEXT, 1, (long long)first[0].first, -1, -1, wxString(), wxString()};
+        if (!CSVParser::ParseRecordAt(file, first[0].first, first[0].second, encoding, input.separator, header)) {
+            issue.message = "Text invalid in the file's encoding";
+            report(issue);
+        }
+        if (HasOpenQuote(file.GetData(), first[0].first, first[0].second, encoding)) {
+            issue.problem = Problem::UNTERMINATED_QUOTE;
+            issue.message = "A quoted field runs to the end of the file";
+            report(issue);
+        }
+        line += CountLineBreaks(file.GetData(), first[0].first, pos, encoding);
+    }
+    
+    std::vector<BoundRule> bound;
+    std::vector<Issue> headerIssues;
+    if (!BindRules(header, input.hasHeader, bound, headerIssues, error)) {
+        return false;
+    }
+    for (Issue& issue : headerIssues) {
+        issue.offset = (long long)CSVParser::GetDataOffset(file, encoding);
+        report(issue);
+    }
+    if (input.hasHeader) {
+        columnNames = header;
+    } else {
+        for (const ColumnRule& rule : rules) {
+            columnNames.push_back(rule.name);
+        }
+    }
+    
+    // Rows should be as wide as the header or the schema, or else the first row
+    size_t width = input.hasHeader ? header.size() : rules.size();
+    bool widthKnown = width > 0;
+    
+    size_t total = file.GetCompression() == Compression::NONE ? file.GetSize() : 0;
+    size_t roundBlocks = 2 * WorkerPool::Get().GetThreadCount();
+    std::vector<Block> blocks(roundBlocks);
+    bool firstRecord = true;
+    bool more = true;
+    while (more) {
+        // Boundaries of a round of blocks, found on this thread
+        size_t used = 0;
+        for (; used < roundBlocks; ++used) {
+            Block& block = blocks[used];
+            if (CSVParser::FindRecords(file, pos, encoding, BLOCK_RECORDS, block.records) == 0) {
+                more = false;
+                break;
+            }
+            block.end = pos;
+            block.keepFirstEmpty = firstRecord && !input.hasHeader;
+            firstRecord = false;
+        }
+        if (used == 0) {
+            break;
+        }
+        
+        if (!widthKnown) {
+            for (const auto& record : blocks[0].records) {
+                std::vector<wxString> fields;
+                if (record.second > record.first &&
+                    CSVParser::ParseRecordAt(file, record.first, record.second, encoding, input.separator, fields)) {
+                    width = fields.size();
+                    break;
+                }
+            }
+            widthKnown = true;
+        }
+        
+        WorkerPool::Get().ParallelFor(used, 1, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                CheckBlock(file, encoding, input.separator, width, bound, blocks[b]);
+            }
+        });
+        
+        // Line and row numbers are known once the blocks before are counted
+        for (size_t b = 0; b < used; ++b) {
+            Block& block = blocks[b];
+            for (Issue& issue : block.issues) {
+                issue.line += line;
+                issue.row += (long long)rowCount;
+                report(issue);
+            }
+            line += block.lineBreaks;
+            rowCount += block.rowCount;
+        }
+        
+        if (progress && total > 0) {
+            progress((int)((double)pos / total * 100));
+        }
+    }
+    
+    if (!file.IsValid()) {
+        error = wxString::Format("Failed to read %s", input.filename);
+        return false;
+    }
+    return true;
+}
+
+bool CSVValidator::BindRules(const std::vector<wxString>& header, bool hasHeader, std::vector<BoundRule>& bound,
+                             std::vector<Issue>& issues, wxString& error) const {
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const ColumnRule& rule = rules[i];
+        BoundRule binding = {&rule, (int)i, -UNBOUNDED, UNBOUNDED};
+        
+        if (hasHeader) {
+            auto exact = std::find(header.begin(), header.end(), rule.name);
+            auto loose = std::find_if(header.begin(), header.end(), [&rule](const wxString& name) {
+                return name.Strip(wxString::both).IsSameAs(rule.name, false);
+            });
+            auto found = exact != header.end() ? exact : loose;
+            if (found == header.end()) {
+                Issue issue = {Problem::MISSING_COLUMN, 1, 0, -1, -1,
+                               wxString::Format("The header has no column %s", rule.name), rule.name};
+                issues.push_back(issue);
+                continue;
+            }
+            binding.column = (int)(found - header.begin());
+        }
+        
+        if (!ParseBound(rule.type, rule.minimum, -UNBOUNDED, binding.minimum) ||
+            !ParseBound(rule.type, rule.maximum, UNBOUNDED, binding.maximum)) {
+            error = wxString::Format("Invalid minimum or maximum for column %s", rule.name);
+            return false;
+        }
+        if (!rule.pattern.IsEmpty() && !wxRegEx(AnchoredPattern(rule.pattern), wxRE_EXTENDED | wxRE_NOSUB).IsValid()) {
+            error = wxString::Format("Invalid pattern for column %s", rule.name);
+            return false;
+        }
+        bound.push_back(binding);
+    }
+    return true;
+}
+
+void CSVValidator::CheckBlock(const MappedFile& file, Encoding encoding, wxChar separator, size_t width,
+                              const std::vector<BoundRule>& bound, Block& block) const {
+    block.issues.clear();
+    block.rowCount = 0;
+    
+    // A compiled expression keeps match state, so every block has its own
+    std::vector<std::unique_ptr<wxRegEx>> patterns(bound.size());
+    for (size_t r = 0; r < bound.size(); ++r) {
+        if (!bound[r].rule->pattern.IsEmpty()) {
+            patterns[r].reset(new wxRegEx(AnchoredPattern(bound[r].rule->pattern), wxRE_EXTENDED | wxRE_NOSUB));
+        }
+    }
+    
+    const char* data = file.GetData();
+    std::vector<wxString> fields;
+    size_t lineBreaks = 0;
+    size_t previous = block.records[0].first;
+    for (size_t i = 0; i < block.records.size(); ++i) {
+        const auto& record = block.records[i];
+        lineBreaks += CountLineBreaks(data, previous, record.first, encoding);
+        previous = record.first;
+        // Empty lines are skipped, as when the file is loaded
+        if (record.second == record.first && !(i == 0 && block.keepFirstEmpty)) {
+            continue;
+        }
+        
+        Issue issue = {Problem::INVALID_TEXT, lineBreaks, (long long)record.first, (long long)block.rowCount++, -1,
+                       wxString(), wxString()};
+        if (!CSVParser::ParseRecordAt(file, record.first, record.second, encoding, separator, fields)) {
+            issue.message = "Text invalid in the file's encoding";
+            block.issues.push_back(issue);
+            continue;
+        }
+        // Only the last record of a file can be left inside quotes
+        if (i + 1 == block.records.size() && HasOpenQuote(data, record.first, record.second, encoding)) {
+            issue.problem = Problem::UNTERMINATED_QUOTE;
+            issue.message = "A quoted field runs to the end of the file";
+            block.issues.push_back(issue);
+        }
+        if (width > 0 && fields.size() != width) {
+            issue.problem = Problem::RAGGED_ROW;
+            issue.message = wxString::Format("Expected %d fields, found %d", (int)width, (int)fields.size());
+            block.issues.push_back(issue);
+        }
+        
+        for (size_t r = 0; r < bound.size(); ++r) {
+            int column = bound[r].column;
+            issue.column = column;
+            CheckValue(bound[r], column < (int)fields.size() ? fields[column] : EMPTY_FIELD, issue,
+                       block.issues, patterns[r].get());
+        }
+    }
+    block.lineBreaks = lineBreaks + CountLineBreaks(data, previous, block.end, encoding);
+}
+
+void CSVValidator::CheckValue(const BoundRule& bound, const wxString& value, Issue& issue,
+                              std::vector<Issue>& issues, wxRegEx* pattern) const {
+    const ColumnRule& rule = *bound.rule;
+    if (value.IsEmpty()) {
+        if (rule.required) {
+            issue.problem = Problem::REQUIRED;
+            issue.message = "A required value is empty";
+            issue.value.clear();
+            issues.push_back(issue);
+        }
+        return;
+    }
+    
+    issue.value = value;
+    double number;
+    if (!ValueOf(rule.type, value, number)) {
+        issue.problem = Problem::TYPE;
+        issue.message = "Not " + TypeDescription(rule.type);
+        issues.push_back(issue);
+        return;
+    }
+    if (number < bound.minimum || number > bound.maximum) {
+        issue.problem = Problem::RANGE;
+        bool below = number < bound.minimum;
+        wxString limit = below ? rule.minimum : rule.maximum;
+        if (rule.type == Type::TEXT) {
+            issue.message = wxString::Format(below ? "Shorter than %s characters" : "Longer than %s characters", limit);
+        } else {
+            issue.message = wxString::Format(below ? "Below the minimum %s" : "Above the maximum %s", limit);
+        }
+        issues.push_back(issue);
+    }
+    if (pattern && !pattern->Matches(value)) {
+        issue.problem = Problem::PATTERN;
+        issue.message = wxString::Format("Does not match %s", rule.pattern);
+        issues.push_back(issue);
+    }
+}
@@ -0,0 +1,188 @@
+#include "CellViewerDialog.h"
+#include <vector>
+
+wxBEGIN_EVENT_TABLE(CellViewerDialog, wxDialog)
+    EVT_IDLE(CellViewerDialog::OnIdle)
+    EVT_BUTTON(ID_FORMAT_JSON, CellViewerDialog::OnFormatJson)
+wxEND_EVENT_TABLE()
+
+CellViewerDialog::CellViewerDialog(wxWindow* parent, Language language, const wxString& columnName, int row,
+                                   const wxString& value)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_cell_viewer_title", language), wxDefaultPosition, wxSize(760, 560),
+               wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+      value(value),
+      loaded(0),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    // Which cell this is and how long it is
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, wxString::Format(Translate("cell_viewer_info", language),
+                                                                     columnName, row + 1, (int)value.length())),
+                   0, wxALL, 5);
+    
+    // Rich text controls take text of any length on Windows
+    textCtrl = new wxTextCtrl(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize,
+                              wxTE_MULTILINE | wxTE_RICH2 | wxTE_NOHIDESEL);
+    wxFont font(wxFontInfo(10).Family(wxFONTFAMILY_TELETYPE));
+    textCtrl->SetFont(font);
+    mainSizer->Add(textCtrl, 1, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxBoxSizer* buttonSizer = new wxBoxSizer(wxHORIZONTAL);
+    formatButton = new wxButton(this, ID_FORMAT_JSON, Translate("cell_viewer_format_json", language));
+    buttonSizer->Add(formatButton, 0, wxRIGHT, 5);
+    buttonSizer->AddStretchSpacer();
+    buttonSizer->Add(CreateButtonSizer(wxOK | wxCANCEL), 0);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+    StartLoading();
+}
+
+void CellViewerDialog::StartLoading() {
+    loaded = 0;
+    textCtrl->Clear();
+    textCtrl->SetEditable(false);
+    formatButton->Enable(false);
+}
+
+void CellViewerDialog::OnIdle(wxIdleEvent& event) {
+    event.Skip();
+    if (IsLoaded()) {
+        return;
+    }
+    
+    size_t count = wxMin(LOAD_CHARS, value.length() - loaded);
+    textCtrl->AppendText(value.Mid(loaded, count));
+    loaded += count;
+    if (!IsLoaded()) {
+        event.RequestMore();
+        return;
+    }
+    
+    // All of it is there, editing can start at the top
+    textCtrl->SetEditable(true);
+    textCtrl->SetInsertionPoint(0);
+    textCtrl->ShowPosition(0);
+    formatButton->Enable(true);
+}
+
+void CellViewerDialog::OnFormatJson(wxCommandEvent& event) {
+    wxString formatted;
+    if (!FormatJson(GetValue(), formatted)) {
+        wxMessageBox(Translate("error_cell_viewer_json", language), Translate("msg_error_title", language),
+                     wxOK | wxICON_ERROR);
+        return;
+    }
+    // Loaded again a slice at a time, like the cell itself
+    value = formatted;
+    StartLoading();
+}
+
+wxString CellViewerDialog::GetValue() const {
+    return IsLoaded() ? textCtrl->GetValue() : value;
+}
+
+bool CellViewerDialog::FormatJson(const wxString& text, wxString& formatted) {
+    const wxChar* chars = text.wx_str();
+    size_t length = text.length();
+    wxString out;
+    out.reserve(length + length / 4);
+    std::vector<wxChar> open;
+    
+    auto newLine = [&out, &open]() {
+        out.append(1, '\n');
+        out.append(open.size() * 2, ' ');
+    };
+    auto nextToken = [chars, length](size_t i) {
+        while (i < length && (chars[i] == ' ' || chars[i] == '\t' || chars[i] == '\r' || chars[i] == '\n')) {
+            ++i;
+        }
+        return i;
+    };
+    
+    size_t i = nextToken(0);
+    if (i == length || (chars[i] != '{' && chars[i] != '[')) {
+        return false;
+    }
+    bool inString = false;
+    bool escaped = false;
+    for (; i < length; ++i) {
+        wxChar ch = chars[i];
+        if (inString) {
+            out.append(1, ch);
+            if (escaped) {
+                escaped = false;
+            } else if (ch == '\\') {
+                escaped = true;
+            } else if (ch == '"') {
+                inString = false;
+            }
+            continue;
+        }
+        
+        switch (ch) {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+            case '"':
+                inString = true;
+                out.append(1, ch);
+                break;
+            case '{':
+            case '[': {
+                wxChar close = ch == '{' ? '}' : ']';
+                out.append(1, ch);
+                // Empty objects and arrays stay on one line
+                size_t next = nextToken(i + 1);
+                if (next < length && chars[next] == close) {
+                    out.append(1, close);
+                    i = next;
+                } else {
+                    open.push_back(close);
+                    newLine();
+                }
+                break;
+            }
+            case '}':
+            case ']':
+                if (open.empty() || open.back() != ch) {
+                    return false;
+                }
+                open.pop_back();
+                newLine();
+                out.append(1, ch);
+                break;
+            case ',':
+                if (open.empty()) {
+                    return false;
+                }
+                out.append(1, ch);
+                newLine();
+                break;
+            case ':':
+                out.append(": ");
+                break;
+            default:
+                out.append(1, ch);
+                break;
+        }
+        
+        // Nothing but white space may follow the outermost value
+        if (open.empty() && !inString) {
+            if (nextToken(i + 1) != length) {
+                return false;
+            }
+            break;
+        }
+    }
+    if (inString || !open.empty()) {
+        return false;
+    }
+    formatted.swap(out);
+    return true;
+}
@@ -0,0 +1,1032 @@
+#include "ColumnExpression.h"
+#include "CSVTable.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+namespace {
+
+const double NOT_A_NUMBER = std::numeric_limits<double>::quiet_NaN();
+
+// Powers of ten a double holds exactly
+const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+bool IsDigit(wxChar c) {
+    return c >= '0' && c <= '9';
+}
+
+bool IsSpace(wxChar c) {
+    return c == ' ' || c == '\t';
+}
+
+// Text counts as false when empty, 0 or "false"
+bool TextToBool(const wxString& text) {
+    return !text.IsEmpty() && text != wxT("0") && !text.IsSameAs(wxT("false"), false);
+}
+
+}
+
+// Recursive descent parser emitting instructions as it goes. Each sub
+// expression gets a register of its own; operands are converted to the type
+// an operator needs, so every instruction knows its types when it runs.
+class ColumnExpression::Compiler {
+public:
+    Compiler(ColumnExpression& expression, const wxString& text, const std::vector<wxString>& names)
+        : out(expression), text(text), names(names), pos(0) {
+    }
+    
+    bool Compile(const Type* resultType, wxString& message) {
+        SkipSpaces();
+        if (pos >= text.length()) {
+            message = "The expression is empty";
+            return false;
+        }
+        
+        Operand value = ParseOr();
+        if (resultType) {
+            value = Convert(value, *resultType);
+        }
+        SkipSpaces();
+        if (value.reg >= 0 && pos < text.length()) {
+            Fail(wxString::Format("Unexpected \"%s\"", text.Mid(pos, 10)));
+        }
+        if (!error.IsEmpty()) {
+            message = error;
+            return false;
+        }
+        out.result = value.reg;
+        return true;
+    }
+
+private:
+    struct Operand {
+        int reg;
+        Type type;
+    };
+    
+    struct Function {
+        const char* name;
+        Op op;
+        Type result;
+        int required;
+        int optional;
+        Type arguments[3];
+    };
+    
+    ColumnExpression& out;
+    const wxString& text;
+    const std::vector<wxString>& names;
+    size_t pos;
+    wxString error;
+    std::map<int, int> loaded;   // register of each column read
+    
+    Operand Fail(const wxString& message) {
+        if (error.IsEmpty()) {
+            error = message;
+        }
+        return Operand{-1, Type::TEXT};
+    }
+    
+    bool Failed() const {
+        return !error.IsEmpty();
+    }
+    
+    int NewRegister(Type type) {
+        out.registerTypes.push_back(type);
+        return (int)out.registerTypes.size() - 1;
+    }
+    
+    Operand Emit(Op op, Type type, int a, int b = -1, int c = -1) {
+        int target = NewRegister(type);
+        out.program.push_back(Instruction{op, target, a, b, c});
+        return Operand{target, type};
+    }
+    
+    Operand Constant(Type type, double number, const wxString& value = wxString()) {
+        int target = NewRegister(type);
+        out.constants.push_back(ColumnExpression::Constant{target, number, value});
+        return Operand{target, type};
+    }
+    
+    Operand Convert(Operand value, Type type) {
+        if (value.reg < 0 || value.type == type) {
+            return value;
+        }
+        // The diagonal is never used, equal types return above
+        static const Op conversions[3][3] = {
+            //  to NUMBER            to TEXT              to BOOL
+            {Op::NEGATE,         Op::NUMBER_TO_TEXT, Op::NUMBER_TO_BOOL},   // from NUMBER
+            {Op::TEXT_TO_NUMBER, Op::NEGATE,         Op::TEXT_TO_BOOL},     // from TEXT
+            {Op::BOOL_TO_NUMBER, Op::BOOL_TO_TEXT,   Op::NEGATE}            // from BOOL
+        };
+        return Emit(conversions[(int)value.type][(int)type], type, value.reg);
+    }
+    
+    // Scanning
+    
+    void SkipSpaces() {
+        while (pos < text.length() && (IsSpace(text[pos]) || text[pos] == '\r' || text[pos] == '\n')) {
+            ++pos;
+        }
+    }
+    
+    static bool IsWordChar(wxChar c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) || c == '_' || c > 127;
+    }
+    
+    bool Accept(const char* symbol) {
+        SkipSpaces();
+        wxString wanted(symbol);
+        if (text.compare(pos, wanted.length(), wanted) == 0) {
+            pos += wanted.length();
+            return true;
+        }
+        return false;
+    }
+    
+    bool AcceptKeyword(const char* keyword) {
+        SkipSpaces();
+        wxString wanted(keyword);
+        size_t end = pos + wanted.length();
+        if (end <= text.length() && text.Mid(pos, wanted.length()).IsSameAs(wanted, false) &&
+            (end == text.length() || !IsWordChar(text[end]))) {
+            pos = end;
+            return true;
+        }
+        return false;
+    }
+    
+    // Grammar, loosest binding first
+    
+    Operand ParseOr() {
+        Operand left = ParseAnd();
+        while (!Failed() && AcceptKeyword("OR")) {
+            Operand right = ParseAnd();
+            left = Emit(Op::OR, Type::BOOL, Convert(left, Type::BOOL).reg, Convert(right, Type::BOOL).reg);
+        }
+        return left;
+    }
+    
+    Operand ParseAnd() {
+        Operand left = ParseNot();
+        while (!Failed() && AcceptKeyword("AND")) {
+            Operand right = ParseNot();
+            left = Emit(Op::AND, Type::BOOL, Convert(left, Type::BOOL).reg, Convert(right, Type::BOOL).reg);
+        }
+        return left;
+    }
+    
+    Operand ParseNot() {
+        if (AcceptKeyword("NOT")) {
+            Operand value = ParseNot();
+            return Failed() ? value : Emit(Op::NOT, Type::BOOL, Convert(value, Type::BOOL).reg);
+        }
+        return ParseComparison();
+    }
+    
+    Operand ParseComparison() {
+        Operand left = ParseConcat();
+        if (Failed()) {
+            return left;
+        }
+        
+        static const struct {
+            const char* symbol;
+            Comparison comparison;
+        } symbols[] = {
+            {"<=", LESS_EQUAL}, {">=", GREATER_EQUAL}, {"<>", NOT_EQUAL}, {"!=", NOT_EQUAL},
+            {"==", EQUAL}, {"=", EQUAL}, {"<", LESS}, {">", GREATER}
+        };
+        for (const auto& symbol : symbols) {
+            if (!Accept(symbol.symbol)) {
+                continue;
+            }
+            Operand right = ParseConcat();
+            if (Failed()) {
+                return right;
+            }
+            // Two texts compare per cell, numerically when both are numbers
+            if (left.type == Type::TEXT && right.type == Type::TEXT) {
+                return Emit(Op::COMPARE_TEXT, Type::BOOL, left.reg, right.reg, symbol.comparison);
+            }
+            return Emit(Op::COMPARE_NUMBER, Type::BOOL, Convert(left, Type::NUMBER).reg,
+                        Convert(right, Type::NUMBER).reg, symbol.comparison);
+        }
+        return left;
+    }
+    
+    Operand ParseConcat() {
+        Operand left = ParseSum();
+        while (!Failed() && Accept("&")) {
+            Operand right = ParseSum();
+            left = Emit(Op::CONCAT, Type::TEXT, Convert(left, Type::TEXT).reg, Convert(right, Type::TEXT).reg);
+        }
+        return left;
+    }
+    
+    Operand ParseSum() {
+        Operand left = ParseProduct();
+        while (!Failed()) {
+            Op op;
+            if (Accept("+")) {
+                op = Op::ADD;
+            } else if (Accept("-")) {
+                op = Op::SUBTRACT;
+            } else {
+                break;
+            }
+            Operand right = ParseProduct();
+            left = Emit(op, Type::NUMBER, Convert(left, Type::NUMBER).reg, Convert(right, Type::NUMBER).reg);
+        }
+        return left;
+    }
+    
+    Operand ParseProduct() {
+        Operand left = ParseUnary();
+        while (!Failed()) {
+            Op op;
+            if (Accept("*")) {
+                op = Op::MULTIPLY;
+            } else if (Accept("/")) {
+                op = Op::DIVIDE;
+            } else if (Accept("%")) {
+                op = Op::MODULO;
+            } else {
+                break;
+            }
+            Operand right = ParseUnary();
+            left = Emit(op, Type::NUMBER, Convert(left, Type::NUMBER).reg, Convert(right, Type::NUMBER).reg);
+        }
+        return left;
+    }
+    
+    Operand ParseUnary() {
+        if (Accept("-")) {
+            Operand value = ParseUnary();
+            return Failed() ? value : Emit(Op::NEGATE, Type::NUMBER, Convert(value, Type::NUMBER).reg);
+        }
+        if (Accept("+")) {
+            return Convert(ParseUnary(), Type::NUMBER);
+        }
+        return ParsePrimary();
+    }
+    
+    Operand ParsePrimary() {
+        SkipSpaces();
+        if (pos >= text.length()) {
+            return Fail("Unexpected end of the expression");
+        }
+        
+        wxChar c = text[pos];
+        if (IsDigit(c) || (c == '.' && pos + 1 < text.length() && IsDigit(text[pos + 1]))) {
+            return ParseNumberLiteral();
+        }
+        if (c == '"' || c == '\'') {
+            return ParseTextLiteral(c);
+        }
+        if (c == '(') {
+            ++pos;
+            Operand value = ParseOr();
+            if (!Failed() && !Accept(")")) {
+                return Fail("Missing )");
+            }
+            return value;
+        }
+        if (c == '[') {
+            size_t end = text.find(']', pos);
+            if (end == wxString::npos) {
+                return Fail("Missing ]");
+            }
+            wxString name = text.Mid(pos + 1, end - pos - 1);
+            pos = end + 1;
+            return LoadColumn(name, true);
+        }
+        if (IsWordChar(c)) {
+            size_t start = pos;
+            while (pos < text.length() && IsWordChar(text[pos])) {
+                ++pos;
+            }
+            wxString word = text.Mid(start, pos - start);
+            if (Accept("(")) {
+                return ParseCall(word);
+            }
+            if (word.IsSameAs("TRUE", false) && !FindColumn(word, false)) {
+                return Constant(Type::BOOL, 1);
+            }
+            if (word.IsSameAs("FALSE", false) && !FindColumn(word, false)) {
+                return Constant(Type::BOOL, 0);
+            }
+            return LoadColumn(word, false);
+        }
+        return Fail(wxString::Format("Unexpected \"%c\"", c));
+    }
+    
+    Operand ParseNumberLiteral() {
+        size_t start = pos;
+        while (pos < text.length() && (IsDigit(text[pos]) || text[pos] == '.')) {
+            ++pos;
+        }
+        if (pos < text.length() && (text[pos] == 'e' || text[pos] == 'E')) {
+            size_t exponent = pos + 1;
+            if (exponent < text.length() && (text[exponent] == '-' || text[exponent] == '+')) {
+                ++exponent;
+            }
+            if (exponent < text.length() && IsDigit(text[exponent])) {
+                pos = exponent;
+                while (pos < text.length() && IsDigit(text[pos])) {
+                    ++pos;
+                }
+            }
+        }
+        wxString literal = text.Mid(start, pos - start);
+        double value = ParseNumber(literal);
+        if (std::isnan(value)) {
+            return Fail(wxString::Format("Invalid number %s", literal));
+        }
+        return Constant(Type::NUMBER, value);
+    }
+    
+    // Quotes inside are doubled, as in CSV
+    Operand ParseTextLiteral(wxChar quote) {
+        wxString value;
+        for (++pos; pos < text.length(); ++pos) {
+            if (text[pos] == quote) {
+                if (pos + 1 < text.length() && text[pos + 1] == quote) {
+                    ++pos;
+                } else {
+                    ++pos;
+                    return Constant(Type::TEXT, 0, value);
+                }
+            }
+            value += text[pos];
+        }
+        return Fail("Missing closing quote");
+    }
+    
+    // Exact name, then ignoring case, then a 1-based number in brackets
+    bool FindColumn(const wxString& name, bool allowNumber, int* column = nullptr) const {
+        int found = -1;
+        for (size_t i = 0; i < names.size() && found < 0; ++i) {
+            if (!names[i].IsEmpty() && names[i] == name) {
+                found = (int)i;
+            }
+        }
+        for (size_t i = 0; i < names.size() && found < 0; ++i) {
+            if (!names[i].IsEmpty() && names[i].IsSameAs(name, false)) {
+                found = (int)i;
+            }
+        }
+        long number;
+        if (found < 0 && allowNumber && name.ToLong(&number) && number >= 1 && (size_t)number <= names.size()) {
+            found = (int)number - 1;
+        }
+        if (column) {
+            *column = found;
+        }
+        return found >= 0;
+    }
+    
+    Operand LoadColumn(const wxString& name, bool allowNumber) {
+        int column;
+        if (!FindColumn(name, allowNumber, &column)) {
+            return Fail(wxString::Format("Unknown column %s", name));
+        }
+        // Each column is read once per batch however often it is used
+        auto it = loaded.find(column);
+        if (it != loaded.end()) {
+            return Operand{it->second, Type::TEXT};
+        }
+        Operand value = Emit(Op::LOAD, Type::TEXT, column);
+        loaded[column] = value.reg;
+        return value;
+    }
+    
+    Operand ParseCall(const wxString& name) {
+        std::vector<Operand> arguments;
+        if (!Accept(")")) {
+            do {
+                arguments.push_back(ParseOr());
+                if (Failed()) {
+                    return arguments.back();
+                }
+            } while (Accept(","));
+            if (!Accept(")")) {
+                return Fail(wxString::Format("Missing ) after the arguments of %s", name));
+            }
+        }
+        
+        if (name.IsSameAs("IF", false)) {
+            if (arguments.size() != 3) {
+                return Fail("IF takes 3 arguments");
+            }
+            // Both branches share one type, text when either of them is text
+            Type type = arguments[1].type == arguments[2].type ? arguments[1].type :
+                        (arguments[1].type == Type::TEXT || arguments[2].type == Type::TEXT) ? Type::TEXT :
+                        Type::NUMBER;
+            return Emit(Op::SELECT, type, Convert(arguments[0], Type::BOOL).reg,
+                        Convert(arguments[1], type).reg, Convert(arguments[2], type).reg);
+        }
+        
+        static const Function functions[] = {
+            {"LEN",      Op::LEN,      Type::NUMBER, 1, 0, {Type::TEXT}},
+            {"LEFT",     Op::LEFT,     Type::TEXT,   2, 0, {Type::TEXT, Type::NUMBER}},
+            {"RIGHT",    Op::RIGHT,    Type::TEXT,   2, 0, {Type::TEXT, Type::NUMBER}},
+            {"MID",      Op::MID,      Type::TEXT,   3, 0, {Type::TEXT, Type::NUMBER, Type::NUMBER}},
+            {"UPPER",    Op::UPPER,    Type::TEXT,   1, 0, {Type::TEXT}},
+            {"LOWER",    Op::LOWER,    Type::TEXT,   1, 0, {Type::TEXT}},
+            {"TRIM",     Op::TRIM,     Type::TEXT,   1, 0, {Type::TEXT}},
+            {"CONTAINS", Op::CONTAINS, Type::BOOL,   2, 0, {Type::TEXT, Type::TEXT}},
+            {"ISEMPTY",  Op::IS_EMPTY, Type::BOOL,   1, 0, {Type::TEXT}},
+            {"YEAR",     Op::YEAR,     Type::NUMBER, 1, 0, {Type::TEXT}},
+            {"MONTH",    Op::MONTH,    Type::NUMBER, 1, 0, {Type::TEXT}},
+            {"DAY",      Op::DAY,      Type::NUMBER, 1, 0, {Type::TEXT}},
+            {"ROUND",    Op::ROUND,    Type::NUMBER, 1, 1, {Type::NUMBER, Type::NUMBER}},
+            {"ABS",      Op::ABS,      Type::NUMBER, 1, 0, {Type::NUMBER}}
+        };
+        for (const Function& function : functions) {
+            if (!name.IsSameAs(function.name, false)) {
+                continue;
+            }
+            int count = (int)arguments.size();
+            if (count < function.required || count > function.required + function.optional) {
+                return Fail(wxString::Format("%s takes %d argument%s", function.name,
+                                             function.required, function.required == 1 ? "" : "s"));
+            }
+            // Optional arguments are zero, ROUND(x) rounds to a whole number
+            int registers[3] = {-1, -1, -1};
+            for (int i = 0; i < function.required + function.optional; ++i) {
+                Operand argument = i < count ? arguments[i] : Constant(function.arguments[i], 0);
+                registers[i] = Convert(argument, function.arguments[i]).reg;
+            }
+            return Emit(function.op, function.result, registers[0], registers[1], registers[2]);
+        }
+        return Fail(wxString::Format("Unknown function %s", name));
+    }
+};
+
+ColumnExpression::ColumnExpression()
+    : result(-1) {
+}
+
+bool ColumnExpression::Compile(const wxString& text, const std::vector<wxString>& columnNames, wxString& error) {
+    return CompileProgram(text, columnNames, nullptr, error);
+}
+
+bool ColumnExpression::Compile(const wxString& text, const std::vector<wxString>& columnNames, Type resultType,
+                               wxString& error) {
+    return CompileProgram(text, columnNames, &resultType, error);
+}
+
+bool ColumnExpression::CompileProgram(const wxString& text, const std::vector<wxString>& columnNames,
+                                      const Type* resultType, wxString& error) {
+    registerTypes.clear();
+    program.clear();
+    constants.clear();
+    result = -1;
+    
+    Compiler compiler(*this, text, columnNames);
+    if (!compiler.Compile(resultType, error)) {
+        registerTypes.clear();
+        program.clear();
+        constants.clear();
+        result = -1;
+        return false;
+    }
+    return true;
+}
+
+void ColumnExpression::CompileColumn(int column) {
+    registerTypes.assign(1, Type::TEXT);
+    program.assign(1, Instruction{Op::LOAD, 0, column, -1, -1});
+    constants.clear();
+    result = 0;
+}
+
+std::vector<int> ColumnExpression::GetColumns() const {
+    std::vector<int> columns;
+    for (const Instruction& step : program) {
+        if (step.op == Op::LOAD) {
+            columns.push_back(step.a);
+        }
+    }
+    std::sort(columns.begin(), columns.end());
+    return columns;
+}
+
+// Decimal number with an optional sign, fraction and exponent, spaces
+// around it allowed. Anything else, including an empty cell, is NaN.
+double ColumnExpression::ParseNumber(const wxString& text) {
+    const wxChar* chars = text.wx_str();
+    size_t length = text.length();
+    size_t i = 0;
+    while (i < length && chars[i] == ' ') {
+        ++i;
+    }
+    while (length > i && chars[length - 1] == ' ') {
+        --length;
+    }
+    
+    bool negative = false;
+    if (i < length && (chars[i] == '-' || chars[i] == '+')) {
+        negative = chars[i] == '-';
+        ++i;
+    }
+    
+    // Up to 19 significant digits fit the mantissa, the rest only scale it
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    bool any = false;
+    for (; i < length && IsDigit(chars[i]); ++i) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (chars[i] - '0');
+            digits += mantissa != 0;
+        } else {
+            ++scale;
+        }
+    }
+    if (i < length && chars[i] == '.') {
+        for (++i; i < length && IsDigit(chars[i]); ++i) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (chars[i] - '0');
+                digits += mantissa != 0;
+                --scale;
+            }
+        }
+    }
+    if (!any) {
+        return NOT_A_NUMBER;
+    }
+    
+    if (i < length && (chars[i] == 'e' || chars[i] == 'E')) {
+        ++i;
+        bool negativeExponent = false;
+        if (i < length && (chars[i] == '-' || chars[i] == '+')) {
+            negativeExponent = chars[i] == '-';
+            ++i;
+        }
+        int exponent = 0;
+        bool exponentDigits = false;
+        for (; i < length && IsDigit(chars[i]); ++i) {
+            exponentDigits = true;
+            if (exponent < 10000) {
+                exponent = exponent * 10 + (chars[i] - '0');
+            }
+        }
+        if (!exponentDigits) {
+            return NOT_A_NUMBER;
+        }
+        scale += negativeExponent ? -exponent : exponent;
+    }
+    if (i != length) {
+        return NOT_A_NUMBER;
+    }
+    
+    // Exact when the mantissa and the power of ten are both exact doubles,
+    // which covers nearly every number found in a CSV file
+    if (mantissa < (1ULL << 53) && scale >= -22 && scale <= 22) {
+        double value = scale < 0 ? (double)mantissa / POWERS_OF_TEN[-scale]
+                                 : (double)mantissa * POWERS_OF_TEN[scale];
+        return negative ? -value : value;
+    }
+    double value;
+    return text.Strip(wxString::both).ToCDouble(&value) ? value : NOT_A_NUMBER;
+}
+
+bool ColumnExpression::ParseDate(const wxString& text, int& year, int& month, int& day) {
+    int parts[3] = {0, 0, 0};
+    size_t widths[3] = {0, 0, 0};
+    wxChar separator = 0;
+    size_t i = 0;
+    size_t length = text.length();
+    while (i < length && text[i] == ' ') {
+        ++i;
+    }
+    for (int part = 0; part < 3; ++part) {
+        for (; i < length && IsDigit(text[i]) && widths[part] < 4; ++i, ++widths[part]) {
+            parts[part] = parts[part] * 10 + (text[i] - '0');
+        }
+        if (widths[part] == 0) {
+            return false;
+        }
+        if (part < 2) {
+            if (i >= length || (separator && text[i] != separator) ||
+                (text[i] != '-' && text[i] != '/' && text[i] != '.')) {
+                return false;
+            }
+            separator = text[i++];
+        }
+    }
+    
+    if (widths[0] == 4) {
+        year = parts[0];
+        month = parts[1];
+        day = parts[2];
+    } else if (separator == '/') {
+        month = parts[0];
+        day = parts[1];
+        year = parts[2];
+    } else {
+        day = parts[0];
+        month = parts[1];
+        year = parts[2];
+    }
+    return month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+// Integers are written whole, other numbers with 15 significant digits.
+// NaN, from text that is not a number or a division by zero, is empty.
+void ColumnExpression::FormatNumber(double value, wxString& out) {
+    out.clear();
+    if (std::isnan(value) || std::isinf(value)) {
+        return;
+    }
+    
+    char buffer[32];
+    char* end;
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        end = std::to_chars(buffer, buffer + sizeof(buffer), (long long)value).ptr;
+    } else {
+        end = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 15).ptr;
+    }
+    for (const char* p = buffer; p < end; ++p) {
+        out += (wxChar)*p;
+    }
+}
+
+void ColumnExpression::InitWorkspace(Workspace& registers) const {
+    registers.resize(registerTypes.size());
+    for (size_t i = 0; i < registers.size(); ++i) {
+        switch (registerTypes[i]) {
+            case Type::NUMBER:
+                registers[i].numbers.resize(BATCH_ROWS);
+                break;
+            case Type::TEXT:
+                registers[i].texts.resize(BATCH_ROWS);
+                break;
+            case Type::BOOL:
+                registers[i].flags.resize(BATCH_ROWS);
+                break;
+        }
+    }
+    for (const Constant& constant : constants) {
+        Register& target = registers[constant.target];
+        std::fill(target.numbers.begin(), target.numbers.end(), constant.number);
+        std::fill(target.texts.begin(), target.texts.end(), constant.text);
+        std::fill(target.flags.begin(), target.flags.end(), constant.number != 0 ? 1 : 0);
+    }
+}
+
+void ColumnExpression::RunBatch(Workspace& registers, size_t first, size_t count,
+                                const ColumnReader& reader) const {
+    for (const Instruction& step : program) {
+        Register& target = registers[step.target];
+        if (step.op == Op::LOAD) {
+            reader(step.a, first, count, target.texts);
+            continue;
+        }
+        
+        const Register& a = registers[step.a];
+        const Register& b = registers[step.b >= 0 ? step.b : step.a];
+        const Register& c = registers[step.c >= 0 && step.op != Op::COMPARE_NUMBER &&
+                                      step.op != Op::COMPARE_TEXT ? step.c : step.a];
+        double* numbers = target.numbers.data();
+        unsigned char* flags = target.flags.data();
+        std::vector<wxString>& texts = target.texts;
+        
+        switch (step.op) {
+            case Op::LOAD:
+                break;
+            
+            // Conversions
+            case Op::TEXT_TO_NUMBER:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = ParseNumber(a.texts[i]);
+                }
+                break;
+            case Op::BOOL_TO_NUMBER:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = a.flags[i];
+                }
+                break;
+            case Op::NUMBER_TO_TEXT:
+                for (size_t i = 0; i < count; ++i) {
+                    FormatNumber(a.numbers[i], texts[i]);
+                }
+                break;
+            case Op::BOOL_TO_TEXT:
+                for (size_t i = 0; i < count; ++i) {
+                    texts[i] = a.flags[i] ? wxT("1") : wxT("0");
+                }
+                break;
+            case Op::NUMBER_TO_BOOL:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = a.numbers[i] != 0 && !std::isnan(a.numbers[i]);
+                }
+                break;
+            case Op::TEXT_TO_BOOL:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = TextToBool(a.texts[i]);
+                }
+                break;
+            
+            // Arithmetic, a division by zero is NaN like any other invalid number
+            case Op::ADD:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = a.numbers[i] + b.numbers[i];
+                }
+                break;
+            case Op::SUBTRACT:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = a.numbers[i] - b.numbers[i];
+                }
+                break;
+            case Op::MULTIPLY:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = a.numbers[i] * b.numbers[i];
+                }
+                break;
+            case Op::DIVIDE:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = b.numbers[i] != 0 ? a.numbers[i] / b.numbers[i] : NOT_A_NUMBER;
+                }
+                break;
+            case Op::MODULO:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = b.numbers[i] != 0 ? std::fmod(a.numbers[i], b.numbers[i]) : NOT_A_NUMBER;
+                }
+                break;
+            case Op::NEGATE:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = -a.numbers[i];
+                }
+                break;
+            
+            case Op::CONCAT:
+                for (size_t i = 0; i < count; ++i) {
+                    texts[i] = a.texts[i];
+                    texts[i] += b.texts[i];
+                }
+                break;
+            
+            // Comparisons
+            case Op::COMPARE_NUMBER: {
+                const double* x = a.numbers.data();
+                const double* y = b.numbers.data();
+                switch (step.c) {
+                    case EQUAL:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = x[i] == y[i];
+                        }
+                        break;
+                    case NOT_EQUAL:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = x[i] != y[i];
+                        }
+                        break;
+                    case LESS:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = x[i] < y[i];
+                        }
+                        break;
+                    case LESS_EQUAL:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = x[i] <= y[i];
+                        }
+                        break;
+                    case GREATER:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = x[i] > y[i];
+                        }
+                        break;
+                    case GREATER_EQUAL:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = x[i] >= y[i];
+                        }
+                        break;
+                }
+                break;
+            }
+            case Op::COMPARE_TEXT:
+                for (size_t i = 0; i < count; ++i) {
+                    double x = ParseNumber(a.texts[i]);
+                    double y = ParseNumber(b.texts[i]);
+                    int order;
+                    if (!std::isnan(x) && !std::isnan(y)) {
+                        order = x < y ? -1 : (x > y ? 1 : 0);
+                    } else {
+                        order = a.texts[i].compare(b.texts[i]);
+                    }
+                    switch (step.c) {
+                        case EQUAL:         flags[i] = order == 0; break;
+                        case NOT_EQUAL:     flags[i] = order != 0; break;
+                        case LESS:          flags[i] = order < 0; break;
+                        case LESS_EQUAL:    flags[i] = order <= 0; break;
+                        case GREATER:       flags[i] = order > 0; break;
+                        case GREATER_EQUAL: flags[i] = order >= 0; break;
+                    }
+                }
+                break;
+            
+            // Logic
+            case Op::AND:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = a.flags[i] & b.flags[i];
+                }
+                break;
+            case Op::OR:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = a.flags[i] | b.flags[i];
+                }
+                break;
+            case Op::NOT:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = !a.flags[i];
+                }
+                break;
+            case Op::SELECT:
+                switch (registerTypes[step.target]) {
+                    case Type::NUMBER:
+                        for (size_t i = 0; i < count; ++i) {
+                            numbers[i] = a.flags[i] ? b.numbers[i] : c.numbers[i];
+                        }
+                        break;
+                    case Type::TEXT:
+                        for (size_t i = 0; i < count; ++i) {
+                            texts[i] = a.flags[i] ? b.texts[i] : c.texts[i];
+                        }
+                        break;
+                    case Type::BOOL:
+                        for (size_t i = 0; i < count; ++i) {
+                            flags[i] = a.flags[i] ? b.flags[i] : c.flags[i];
+                        }
+                        break;
+                }
+                break;
+            
+            // Text functions, positions count from 1 and are clamped to the text
+            case Op::LEN:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = (double)a.texts[i].length();
+                }
+                break;
+            case Op::LEFT:
+                for (size_t i = 0; i < count; ++i) {
+                    double n = b.numbers[i] > 0 ? b.numbers[i] : 0;
+                    texts[i].assign(a.texts[i], 0, (size_t)wxMin(n, (double)a.texts[i].length()));
+                }
+                break;
+            case Op::RIGHT:
+                for (size_t i = 0; i < count; ++i) {
+                    size_t length = a.texts[i].length();
+                    size_t n = (size_t)wxMin(b.numbers[i] > 0 ? b.numbers[i] : 0, (double)length);
+                    texts[i].assign(a.texts[i], length - n, n);
+                }
+                break;
+            case Op::MID:
+                for (size_t i = 0; i < count; ++i) {
+                    size_t length = a.texts[i].length();
+                    double start = b.numbers[i] > 1 ? b.numbers[i] - 1 : 0;
+                    double n = c.numbers[i] > 0 ? c.numbers[i] : 0;
+                    if (start >= length) {
+                        texts[i].clear();
+                    } else {
+                        texts[i].assign(a.texts[i], (size_t)start, (size_t)wxMin(n, (double)(length - (size_t)start)));
+                    }
+                }
+                break;
+            case Op::UPPER:
+                for (size_t i = 0; i < count; ++i) {
+                    texts[i] = a.texts[i];
+                    texts[i].MakeUpper();
+                }
+                break;
+            case Op::LOWER:
+                for (size_t i = 0; i < count; ++i) {
+                    texts[i] = a.texts[i];
+                    texts[i].MakeLower();
+                }
+                break;
+            case Op::TRIM:
+                for (size_t i = 0; i < count; ++i) {
+                    const wxString& value = a.texts[i];
+                    size_t begin = 0;
+                    size_t end = value.length();
+                    while (begin < end && IsSpace(value[begin])) {
+                        ++begin;
+                    }
+                    while (end > begin && IsSpace(value[end - 1])) {
+                        --end;
+                    }
+                    texts[i].assign(value, begin, end - begin);
+                }
+                break;
+            case Op::CONTAINS:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = a.texts[i].find(b.texts[i]) != wxString::npos;
+                }
+                break;
+            case Op::IS_EMPTY:
+                for (size_t i = 0; i < count; ++i) {
+                    flags[i] = a.texts[i].IsEmpty();
+                }
+                break;
+            
+            // Dates
+            case Op::YEAR:
+            case Op::MONTH:
+            case Op::DAY:
+                for (size_t i = 0; i < count; ++i) {
+                    int year, month, day;
+                    if (!ParseDate(a.texts[i], year, month, day)) {
+                        numbers[i] = NOT_A_NUMBER;
+                    } else {
+                        numbers[i] = step.op == Op::YEAR ? year : (step.op == Op::MONTH ? month : day);
+                    }
+                }
+                break;
+            
+            // Numbers
+            case Op::ROUND:
+                for (size_t i = 0; i < count; ++i) {
+                    double scale = std::pow(10.0, std::round(b.numbers[i]));
+                    numbers[i] = std::round(a.numbers[i] * scale) / scale;
+                }
+                break;
+            case Op::ABS:
+                for (size_t i = 0; i < count; ++i) {
+                    numbers[i] = std::fabs(a.numbers[i]);
+                }
+                break;
+        }
+    }
+}
+
+void ColumnExpression::FormatResult(const Workspace& workspace, size_t row, wxString& out) const {
+    const Register& value = workspace[result];
+    switch (registerTypes[result]) {
+        case Type::NUMBER:
+            FormatNumber(value.numbers[row], out);
+            break;
+        case Type::TEXT:
+            out = value.texts[row];
+            break;
+        case Type::BOOL:
+            out = value.flags[row] ? wxT("1") : wxT("0");
+            break;
+    }
+}
+
+void ColumnExpression::Evaluate(size_t first, size_t count, const ColumnReader& reader,
+                                std::vector<wxString>& results) const {
+    PROFILE_SCOPE("expression.evaluate");
+    if (result < 0) {
+        return;
+    }
+    
+    size_t batches = (count + BATCH_ROWS - 1) / BATCH_ROWS;
+    WorkerPool::Get().ParallelFor(batches, 1, [&](size_t begin, size_t end) {
+        // Registers are allocated once per chunk and reused by its batches
+        Workspace registers;
+        InitWorkspace(registers);
+        
+        for (size_t batch = begin; batch < end; ++batch) {
+            size_t offset = batch * BATCH_ROWS;
+            size_t rows = wxMin(BATCH_ROWS, count - offset);
+            RunBatch(registers, first + offset, rows, reader);
+            for (size_t i = 0; i < rows; ++i) {
+                FormatResult(registers, i, results[offset + i]);
+            }
+        }
+    });
+}
+
+void ColumnExpression::Fill(CSVTable& table, int target) const {
+    PROFILE_SCOPE("expression.fill");
+    // A window of pages is loaded, evaluated in parallel and moved into the
+    // table before the next one, which bounds the results held at once
+    const size_t WINDOW_ROWS = 64 * CSVTable::PAGE_ROWS;
+    size_t rows = (size_t)table.GetNumberRows();
+    ColumnReader reader = [&table, target](int column, size_t first, size_t count, std::vector<wxString>& values) {
+        table.ReadColumn(column < target ? column : column + 1, first, count, values);
+    };
+    
+    std::vector<wxString> results;
+    for (size_t first = 0; first < rows; first += WINDOW_ROWS) {
+        size_t count = wxMin(WINDOW_ROWS, rows - first);
+        table.PrepareRows(first, count);
+        results.resize(count);
+        Evaluate(first, count, reader, results);
+        table.WriteColumn(target, first, results);
+    }
+}
@@ -0,0 +1,411 @@
+#include "ColumnTransform.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <atomic>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__SSE2__)
+// wxChar is 16 bits on Windows and 32 bits elsewhere
+inline __m128i Splat(wxChar c) {
+    return sizeof(wxChar) == 2 ? _mm_set1_epi16((short)c) : _mm_set1_epi32((int)c);
+}
+
+inline __m128i Greater(__m128i x, __m128i y) {
+    return sizeof(wxChar) == 2 ? _mm_cmpgt_epi16(x, y) : _mm_cmpgt_epi32(x, y);
+}
+
+inline bool IsZero(__m128i x) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+// Copy chars to out with the letters in [first, last] switched to the other
+// case, false when a character is not ASCII and out is then unusable. With
+// SSE2 a register of characters is tested and converted at once, without
+// branches; the case of an ASCII letter is its 0x20 bit.
+bool MapAsciiCase(const wxChar* chars, size_t length, wxChar first, wxChar last,
+                  wxChar* out, bool& changed) {
+    size_t i = 0;
+    wxChar seen = 0;
+    wxChar flipped = 0;
+#if defined(__SSE2__)
+    const size_t LANES = 16 / sizeof(wxChar);
+    __m128i below = Splat(first - 1);
+    __m128i above = Splat(last + 1);
+    __m128i caseBit = Splat(0x20);
+    __m128i seenBlocks = _mm_setzero_si128();
+    __m128i flippedBlocks = _mm_setzero_si128();
+    for (; i + LANES <= length; i += LANES) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(chars + i));
+        seenBlocks = _mm_or_si128(seenBlocks, block);
+        // Signed compares, exact for ASCII; anything else is rejected below
+        __m128i letters = _mm_and_si128(Greater(block, below), Greater(above, block));
+        __m128i flip = _mm_and_si128(letters, caseBit);
+        flippedBlocks = _mm_or_si128(flippedBlocks, flip);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(block, flip));
+    }
+    if (!IsZero(_mm_and_si128(seenBlocks, Splat((wxChar)~0x7F)))) {
+        return false;
+    }
+    if (!IsZero(flippedBlocks)) {
+        flipped = 0x20;
+    }
+#endif
+    for (; i < length; ++i) {
+        wxChar ch = chars[i];
+        wxChar flip = (ch >= first && ch <= last) ? 0x20 : 0;
+        seen |= ch;
+        flipped |= flip;
+        out[i] = ch ^ flip;
+    }
+    changed = flipped != 0;
+    return (seen & ~0x7F) == 0;
+}
+
+inline bool IsSpace(wxChar ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f' || ch == 0xA0;
+}
+
+inline bool IsDigit(wxChar ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+}
+
+
+ColumnTransform::ColumnTransform()
+    : operation(Operation::TRIM), matchCase(true) {
+}
+
+ColumnTransform::ColumnTransform(Operation operation, const wxString& find, const wxString& replacement,
+                                 bool matchCase)
+    : operation(operation), find(find), replacement(replacement), lowerFind(find.Lower()),
+      matchCase(matchCase) {
+}
+
+wxString ColumnTransform::Encode() const {
+    // Operation, case flag and the length of find, then find and replacement
+    return wxString::Format("%d %d %d ", (int)operation, matchCase ? 1 : 0, (int)find.length()) + find + replacement;
+}
+
+bool ColumnTransform::Decode(const wxString& text) {
+    wxString rest = text;
+    long fields[3];
+    for (int i = 0; i < 3; ++i) {
+        wxString tail;
+        wxString field = rest.BeforeFirst(' ', &tail);
+        if (!field.ToLong(&fields[i]) || fields[i] < 0) {
+            return false;
+        }
+        rest.swap(tail);
+    }
+    if (fields[0] > (long)Operation::DECIMAL_COMMA || (size_t)fields[2] > rest.length()) {
+        return false;
+    }
+    *this = ColumnTransform((Operation)fields[0], rest.Left(fields[2]), rest.Mid(fields[2]), fields[1] != 0);
+    return true;
+}
+
+bool ColumnTransform::Apply(const wxString& value, wxString& out) const {
+    switch (operation) {
+        case Operation::TRIM: {
+            const wxChar* chars = value.wx_str();
+            size_t length = value.length();
+            size_t begin = 0;
+            while (begin < length && IsSpace(chars[begin])) {
+                ++begin;
+            }
+            size_t end = length;
+            while (end > begin && IsSpace(chars[end - 1])) {
+                --end;
+            }
+            if (begin == 0 && end == length) {
+                return false;
+            }
+            out.assign(chars + begin, end - begin);
+            return true;
+        }
+        case Operation::UPPER:
+            return ChangeCase(value, true, out);
+        case Operation::LOWER:
+            return ChangeCase(value, false, out);
+        case Operation::REPLACE:
+            return ReplaceAll(value, out);
+        case Operation::SPLIT:
+            // Parts go to other columns, the cell itself stays
+            return false;
+        case Operation::DECIMAL_POINT:
+            return NormalizeNumber(value, '.', ',', '.', out);
+        case Operation::DECIMAL_COMMA:
+            return NormalizeNumber(value, ',', '.', ',', out);
+    }
+    return false;
+}
+
+bool ColumnTransform::ChangeCase(const wxString& value, bool upper, wxString& out) const {
+    size_t length = value.length();
+    if (length == 0) {
+        return false;
+    }
+    
+    // Letters of the other case are the ones to change
+    thread_local std::vector<wxChar> buffer;
+    buffer.resize(length);
+    bool changed = false;
+    if (MapAsciiCase(value.wx_str(), length, upper ? 'a' : 'A', upper ? 'z' : 'Z', buffer.data(), changed)) {
+        if (!changed) {
+            return false;
+        }
+        out.assign(buffer.data(), length);
+        return true;
+    }
+    
+    // Text beyond ASCII takes the full conversion
+    wxString converted = upper ? value.Upper() : value.Lower();
+    if (converted == value) {
+        return false;
+    }
+    out.swap(converted);
+    return true;
+}
+
+bool ColumnTransform::ReplaceAll(const wxString& value, wxString& out) const {
+    if (find.IsEmpty()) {
+        return false;
+    }
+    
+    if (matchCase) {
+        if (value.find(find) == wxString::npos) {
+            return false;
+        }
+        wxString result = value;
+        result.Replace(find, replacement);
+        out.swap(result);
+        return true;
+    }
+    
+    // Matched in folded text, which keeps every character where it was
+    wxString folded = value.Lower();
+    size_t pos = folded.find(lowerFind);
+    if (pos == wxString::npos) {
+        return false;
+    }
+    wxString result;
+    size_t start = 0;
+    while (pos != wxString::npos) {
+        result.append(value, start, pos - start);
+        result.append(replacement);
+        start = pos + find.length();
+        pos = folded.find(lowerFind, start);
+    }
+    result.append(value, start, wxString::npos);
+    out.swap(result);
+    return true;
+}
+
+bool ColumnTransform::NormalizeNumber(const wxString& value, wxChar group, wxChar decimal,
+                                      wxChar newDecimal, wxString& out) {
+    const wxChar* chars = value.wx_str();
+    size_t length = value.length();
+    wxString result;
+    result.reserve(length);
+    
+    size_t i = 0;
+    if (i < length && (chars[i] == '-' || chars[i] == '+')) {
+        result.append(1, chars[i++]);
+    }
+    
+    // Integer digits. Once a group mark appears the first group has one to
+    // three digits and every later one exactly three, so 1.5 is no grouped
+    // number and stays as it is.
+    size_t digits = 0;
+    size_t run = 0;
+    bool grouped = false;
+    for (; i < length && chars[i] != decimal; ++i) {
+        wxChar ch = chars[i];
+        if (IsDigit(ch)) {
+            result.append(1, ch);
+            ++digits;
+            ++run;
+        } else if (ch == group || ch == ' ' || ch == 0xA0) {
+            if (grouped ? run != 3 : (run == 0 || run > 3)) {
+                return false;
+            }
+            grouped = true;
+            run = 0;
+        } else {
+            return false;
+        }
+    }
+    if (grouped && run != 3) {
+        return false;
+    }
+    
+    bool fraction = i < length;
+    if (fraction) {
+        result.append(1, newDecimal);
+        if (++i == length) {
+            return false;
+        }
+        for (; i < length; ++i) {
+            if (!IsDigit(chars[i])) {
+                return false;
+            }
+            result.append(1, chars[i]);
+            ++digits;
+        }
+    }
+    
+    // Plain integers are already written the same either way
+    if (digits == 0 || (!grouped && !fraction)) {
+        return false;
+    }
+    out.swap(result);
+    return true;
+}
+
+void ColumnTransform::Run(CSVTable& table, int col, CSVTable::RangeList& changed,
+                          std::vector<wxString>& previous) const {
+    PROFILE_SCOPE("transform.run");
+    changed.clear();
+    previous.clear();
+    size_t rows = (size_t)table.GetNumberRows();
+    
+    std::vector<wxString> results;
+    std::vector<wxString> originals;
+    std::vector<unsigned char> flags;
+    std::vector<wxString> values;
+    for (size_t first = 0; first < rows; first += WINDOW_ROWS) {
+        size_t count = wxMin(WINDOW_ROWS, rows - first);
+        table.PrepareRows(first, count);
+        results.resize(count);
+        originals.resize(count);
+        flags.assign(count, 0);
+        
+        size_t chunks = (count + CHUNK_ROWS - 1) / CHUNK_ROWS;
+        WorkerPool::Get().ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+            std::vector<wxString> cells(CHUNK_ROWS);
+            for (size_t chunk = begin; chunk < end; ++chunk) {
+                size_t offset = chunk * CHUNK_ROWS;
+                size_t n = wxMin(CHUNK_ROWS, count - offset);
+                table.ReadColumn(col, first + offset, n, cells);
+                for (size_t i = 0; i < n; ++i) {
+                    if (Apply(cells[i], results[offset + i])) {
+                        flags[offset + i] = 1;
+                        originals[offset + i].swap(cells[i]);
+                    }
+                }
+            }
+        });
+        
+        // Only runs of changed rows are written, other pages stay clean
+        for (size_t i = 0; i < count;) {
+            if (!flags[i]) {
+                ++i;
+                continue;
+            }
+            size_t start = i;
+            values.clear();
+            for (; i < count && flags[i]; ++i) {
+                values.emplace_back();
+                values.back().swap(results[i]);
+                previous.emplace_back();
+                previous.back().swap(originals[i]);
+            }
+            table.WriteColumn(col, first + start, values);
+            if (!changed.empty() && changed.back().first + changed.back().second == first + start) {
+                changed.back().second += i - start;
+            } else {
+                changed.emplace_back(first + start, i - start);
+            }
+        }
+    }
+}
+
+size_t ColumnTransform::CountParts(CSVTable& table, int col) const {
+    PROFILE_SCOPE("transform.count_parts");
+    if (find.IsEmpty()) {
+        return 1;
+    }
+    
+    size_t rows = (size_t)table.GetNumberRows();
+    std::atomic<size_t> most(1);
+    for (size_t first = 0; first < rows && most < MAX_PARTS; first += WINDOW_ROWS) {
+        size_t count = wxMin(WINDOW_ROWS, rows - first);
+        table.PrepareRows(first, count);
+        
+        size_t chunks = (count + CHUNK_ROWS - 1) / CHUNK_ROWS;
+        WorkerPool::Get().ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+            std::vector<wxString> cells(CHUNK_ROWS);
+            size_t local = 1;
+            for (size_t chunk = begin; chunk < end; ++chunk) {
+                size_t offset = chunk * CHUNK_ROWS;
+                size_t n = wxMin(CHUNK_ROWS, count - offset);
+                table.ReadColumn(col, first + offset, n, cells);
+                for (size_t i = 0; i < n; ++i) {
+                    size_t parts = 1;
+                    for (size_t pos = cells[i].find(find); pos != wxString::npos && parts < MAX_PARTS;
+                         pos = cells[i].find(find, pos + find.length())) {
+                        ++parts;
+                    }
+                    local = wxMax(local, parts);
+                }
+            }
+            size_t seen = most.load();
+            while (local > seen && !most.compare_exchange_weak(seen, local)) {
+            }
+        });
+    }
+    return most;
+}
+
+void ColumnTransform::Split(CSVTable& table, int col, size_t parts) const {
+    PROFILE_SCOPE("transform.split");
+    if (parts == 0) {
+        return;
+    }
+    
+    // Each row holds a value per part, so windows shrink as parts grow
+    size_t windowRows = wxMax(CSVTable::PAGE_ROWS, WINDOW_ROWS / parts);
+    size_t rows = (size_t)table.GetNumberRows();
+    std::vector<std::vector<wxString>> results(parts);
+    for (size_t first = 0; first < rows; first += windowRows) {
+        size_t count = wxMin(windowRows, rows - first);
+        table.PrepareRows(first, count);
+        for (auto& values : results) {
+            values.clear();
+            values.resize(count);
+        }
+        
+        size_t chunks = (count + CHUNK_ROWS - 1) / CHUNK_ROWS;
+        WorkerPool::Get().ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+            std::vector<wxString> cells(CHUNK_ROWS);
+            for (size_t chunk = begin; chunk < end; ++chunk) {
+                size_t offset = chunk * CHUNK_ROWS;
+                size_t n = wxMin(CHUNK_ROWS, count - offset);
+                table.ReadColumn(col, first + offset, n, cells);
+                for (size_t i = 0; i < n; ++i) {
+                    const wxString& cell = cells[i];
+                    size_t start = 0;
+                    for (size_t part = 0; part < parts; ++part) {
+                        size_t pos = part + 1 < parts && !find.IsEmpty() ? cell.find(find, start) : wxString::npos;
+                        if (pos == wxString::npos) {
+                            results[part][offset + i].assign(cell, start, wxString::npos);
+                            break;
+                        }
+                        results[part][offset + i].assign(cell, start, pos - start);
+                        start = pos + find.length();
+                    }
+                }
+            }
+        });
+        
+        for (size_t part = 0; part < parts; ++part) {
+            table.WriteColumn(col + 1 + (int)part, first, results[part]);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include "ColumnTransformDialog.h"
+
+wxBEGIN_EVENT_TABLE(ColumnTransformDialog, wxDialog)
+    EVT_CHOICE(ID_OPERATION, ColumnTransformDialog::OnOperationChanged)
+    EVT_BUTTON(wxID_OK, ColumnTransformDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+ColumnTransformDialog::ColumnTransformDialog(wxWindow* parent, Language language,
+                                             const std::vector<wxString>& columnNames, int column)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_transform_title", language), wxDefaultPosition, wxSize(420, 400)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    // Column to transform, the cursor's by default
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("transform_column", language)), 0, wxALL, 5);
+    wxArrayString names;
+    for (const wxString& name : columnNames) {
+        names.Add(name);
+    }
+    columnChoice = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, names);
+    columnChoice->SetSelection(column >= 0 && column < (int)names.GetCount() ? column : 0);
+    mainSizer->Add(columnChoice, 0, wxALL | wxEXPAND, 5);
+    
+    // Operation, in the order of ColumnTransform::Operation
+    wxArrayString operations;
+    operations.Add(Translate("transform_trim", language));
+    operations.Add(Translate("transform_upper", language));
+    operations.Add(Translate("transform_lower", language));
+    operations.Add(Translate("transform_replace", language));
+    operations.Add(Translate("transform_split", language));
+    operations.Add(Translate("transform_decimal_point", language));
+    operations.Add(Translate("transform_decimal_comma", language));
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("transform_operation", language)), 0, wxALL, 5);
+    operationChoice = new wxChoice(this, ID_OPERATION, wxDefaultPosition, wxDefaultSize, operations);
+    operationChoice->SetSelection(0);
+    mainSizer->Add(operationChoice, 0, wxALL | wxEXPAND, 5);
+    
+    // Text to find, or the delimiter of a split
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("transform_find", language)), 0, wxALL, 5);
+    findText = new wxTextCtrl(this, wxID_ANY);
+    mainSizer->Add(findText, 0, wxALL | wxEXPAND, 5);
+    
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("transform_replace_with", language)), 0, wxALL, 5);
+    replaceText = new wxTextCtrl(this, wxID_ANY);
+    mainSizer->Add(replaceText, 0, wxALL | wxEXPAND, 5);
+    
+    matchCaseCheckBox = new wxCheckBox(this, wxID_ANY, Translate("transform_match_case", language));
+    matchCaseCheckBox->SetValue(true);
+    mainSizer->Add(matchCaseCheckBox, 0, wxALL, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+    UpdateControls();
+}
+
+void ColumnTransformDialog::UpdateControls() {
+    ColumnTransform::Operation operation = GetOperation();
+    bool replace = operation == ColumnTransform::Operation::REPLACE;
+    findText->Enable(replace || operation == ColumnTransform::Operation::SPLIT);
+    replaceText->Enable(replace);
+    matchCaseCheckBox->Enable(replace);
+}
+
+void ColumnTransformDialog::OnOperationChanged(wxCommandEvent& event) {
+    UpdateControls();
+}
+
+void ColumnTransformDialog::OnOK(wxCommandEvent& event) {
+    if (findText->IsEnabled() && findText->GetValue().IsEmpty()) {
+        wxMessageBox(Translate("error_transform_find", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+int ColumnTransformDialog::GetColumn() const {
+    return columnChoice->GetSelection();
+}
+
+ColumnTransform::Operation ColumnTransformDialog::GetOperation() const {
+    return (ColumnTransform::Operation)operationChoice->GetSelection();
+}
+
+ColumnTransform ColumnTransformDialog::GetTransform() const {
+    // A tab can not be typed into the field, \t stands for it
+    wxString find = findText->GetValue();
+    find.Replace("\\t", "\t");
+    return ColumnTransform(GetOperation(), find, replaceText->GetValue(), matchCaseCheckBox->GetValue());
+}
@@ -0,0 +1,651 @@
+#include "CommandLine.h"
+#include "CSVDiff.h"
+#include "CSVJoin.h"
+#include "Deduplicator.h"
+#include "CSVSplitter.h"
+#include "CSVValidator.h"
+#include "CSVTable.h"
+#include "ColumnExpression.h"
+#include "TableQuery.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+#ifdef __WXMSW__
+#include <windows.h>
+#endif
+
+bool CommandLine::IsCommand(const wxArrayString& args) {
+    if (args.IsEmpty()) {
+        return false;
+    }
+    wxString command = args[0];
+    return command == "diff" || command == "compute" || command == "query" || command == "merge" || command == "dedup" ||
+           command == "split" || command == "concat" || command == "validate" || command == "help" || command == "--help";
+}
+
+int CommandLine::Run(const wxArrayString& args) {
+    SetUpConsole();
+    
+    wxString command = args[0];
+    wxArrayString rest;
+    for (size_t i = 1; i < args.GetCount(); ++i) {
+        rest.Add(args[i]);
+    }
+    Options options = ParseOptions(rest);
+    
+    if (command == "diff") {
+        return RunDiff(options);
+    }
+    if (command == "compute") {
+        return RunCompute(options);
+    }
+    if (command == "query") {
+        return RunQuery(options);
+    }
+    if (command == "merge") {
+        return RunMerge(options);
+    }
+    if (command == "dedup") {
+        return RunDedup(options);
+    }
+    if (command == "split") {
+        return RunSplit(options);
+    }
+    if (command == "concat") {
+        return RunConcat(options);
+    }
+    if (command == "validate") {
+        return RunValidate(options);
+    }
+    
+    PrintUsage();
+    return 0;
+}
+
+bool CommandLine::Options::Has(const wxString& name) const {
+    for (const auto& option : named) {
+        if (option.first == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+wxString CommandLine::Options::Get(const wxString& name, const wxString& defaultValue) const {
+    for (const auto& option : named) {
+        if (option.first == name) {
+            return option.second;
+        }
+    }
+    return defaultValue;
+}
+
+CommandLine::Options CommandLine::ParseOptions(const wxArrayString& args) {
+    Options options;
+    for (size_t i = 0; i < args.GetCount(); ++i) {
+        wxString arg = args[i];
+        if (arg.StartsWith("--") && arg.length() > 2) {
+            wxString name = arg.Mid(2).BeforeFirst('=');
+            wxString value = arg.Find('=') != wxNOT_FOUND ? arg.AfterFirst('=') : wxString();
+            options.named.push_back(std::make_pair(name, value));
+        } else {
+            options.positional.Add(arg);
+        }
+    }
+    return options;
+}
+
+void CommandLine::SetUpConsole() {
+#ifdef __WXMSW__
+    // The program is built for the GUI subsystem and starts without a console.
+    // Borrow the parent's console unless the output is redirected.
+    HANDLE out = ::GetStdHandle(STD_OUTPUT_HANDLE);
+    HANDLE err = ::GetStdHandle(STD_ERROR_HANDLE);
+    bool outRedirected = out != nullptr && out != INVALID_HANDLE_VALUE;
+    bool errRedirected = err != nullptr && err != INVALID_HANDLE_VALUE;
+    
+    if (::AttachConsole(ATTACH_PARENT_PROCESS)) {
+        if (!outRedirected) {
+            freopen("CONOUT$", "w", stdout);
+        }
+        if (!errRedirected) {
+            freopen("CONOUT$", "w", stderr);
+        }
+        ::SetConsoleOutputCP(CP_UTF8);
+    }
+#endif
+}
+
+void CommandLine::Print(const wxString& text) {
+    fputs(text.utf8_str(), stdout);
+}
+
+void CommandLine::PrintError(const wxString& text) {
+    fputs(("Error: " + text + "\n").utf8_str(), stderr);
+}
+
+void CommandLine::PrintUsage() {
+    Print("Usage: CSVPlusPlus <command> [options] [files]\n"
+          "\n"
+          "Commands:\n"
+          "  diff [--key=COLUMNS] [--header] [--separator=C] [--encoding=E] [--summary] OLD NEW\n"
+          "      Report rows added, removed and modified between two files.\n"
+          "      COLUMNS are header names or 1-based numbers, comma separated.\n"
+          "      Without --key rows are matched by their whole content.\n"
+          "      Exit code is 0 when the files match, 1 when they differ, 2 on error.\n"
+          "  compute --expr=EXPRESSION [--name=NAME] [--at=N] [--header] [--separator=C] [--encoding=E] INPUT OUTPUT\n"
+          "      Write INPUT to OUTPUT with a column computed from an expression,\n"
+          "      e.g. --expr=\"[price] * [qty]\". Columns are referenced by header name,\n"
+          "      letter or 1-based number. The column goes at position N, last by default.\n"
+          "  query --sql=QUERY [--header] [--separator=C] [--encoding=E] INPUT OUTPUT\n"
+          "      Write the result of SELECT items [WHERE ...] [GROUP BY ...]\n"
+          "      [ORDER BY ...] [LIMIT n] over INPUT to OUTPUT, with a header row.\n"
+          "  merge --key=COLUMNS [--right-key=COLUMNS] [--type=T] [--header] [--separator=C] [--encoding=E] LEFT RIGHT OUTPUT\n"
+          "      Write the rows of LEFT joined with the rows of RIGHT whose key columns\n"
+          "      hold the same values, followed by RIGHT's other columns. T is inner,\n"
+          "      left (every LEFT row, the default) or anti (LEFT rows without a match).\n"
+          "      The right key columns default to the left ones.\n"
+          "  dedup [--key=COLUMNS] [--keep=first|last] [--memory=MB] [--header] [--separator=C] [--encoding=E] INPUT OUTPUT\n"
+          "      Write INPUT to OUTPUT without rows repeating an earlier (or with\n"
+          "      --keep=last, a later) row on the key columns, whole rows by default.\n"
+          "      Files larger than MB megabytes of row hashes (256 by default) are\n"
+          "      processed through temporary files.\n"
+          "  split --rows=N | --mb=N [--header] [--encoding=E] INPUT [OUTPUT]\n"
+          "      Write INPUT to parts of at most N rows or N megabytes, named after\n"
+          "      OUTPUT (INPUT by default) as name_001.csv, name_002.csv, ...\n"
+          "      Every part repeats the header row.\n"
+          "  concat [--header] [--separator=C] [--encoding=E] INPUT... OUTPUT\n"
+          "      Append the INPUT files to OUTPUT in order, keeping only the first\n"
+          "      header row. The headers must be the same.\n"
+          "  validate [--schema=FILE] [--report=FILE] [--max-errors=N] [--header] [--separator=C] [--encoding=E] INPUT\n"
+          "      Check INPUT for ragged rows, unterminated quotes and text invalid in\n"
+          "      its encoding, and with a schema for missing columns, empty required\n"
+          "      values, types, ranges and patterns. The first N issues are printed\n"
+          "      (100 by default), every issue goes to the CSV report.\n"
+          "      Exit code is 0 when the file is valid, 1 when it is not, 2 on error.\n"
+          "\n"
+          "Common options:\n"
+          "  --separator=C   Field separator (a character or \"tab\"), detected by default\n"
+          "  --encoding=E    utf8, ansi, utf16 or utf16be, detected by default\n"
+          "  --header        The first row holds the column names\n");
+}
+
+static bool ApplyFormatOptions(const wxString& separator, const wxString& encoding, CSVDiff::Input& input) {
+    if (!separator.IsEmpty()) {
+        input.separator = separator == "tab" || separator == "\\t" ? wxChar('\t') : separator[0];
+    }
+    if (!encoding.IsEmpty()) {
+        wxString name = encoding.Lower();
+        if (name == "utf8" || name == "utf-8") {
+            input.encoding = Encoding::UTF8;
+        } else if (name == "ansi") {
+            input.encoding = Encoding::ANSI;
+        } else if (name == "utf16" || name == "utf-16" || name == "utf16le") {
+            input.encoding = Encoding::UTF16_LE;
+        } else if (name == "utf16be") {
+            input.encoding = Encoding::UTF16_BE;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CommandLine::RunDiff(const Options& options) {
+    if (options.positional.GetCount() != 2) {
+        PrintUsage();
+        return 2;
+    }
+    
+    CSVDiff::Input inputs[2];
+    for (int i = 0; i < 2; ++i) {
+        if (!CSVDiff::DetectInput(options.positional[i], options.Has("header"), inputs[i])) {
+            PrintError(wxString::Format("Cannot open %s", options.positional[i]));
+            return 2;
+        }
+        if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), inputs[i])) {
+            PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+            return 2;
+        }
+    }
+    
+    CSVDiff diff;
+    wxString error;
+    if (!diff.Compare(inputs[0], inputs[1], options.Get("key"), error)) {
+        PrintError(error);
+        return 2;
+    }
+    
+    Print("--- " + inputs[0].filename + "\n");
+    Print("+++ " + inputs[1].filename + "\n");
+    
+    // Line numbers as in the files, counting the header line
+    long long headerLines = options.Has("header") ? 1 : 0;
+    const std::vector<wxString>& header = diff.GetHeader(CSVDiff::RIGHT);
+    
+    if (!options.Has("summary")) {
+        std::vector<wxString> left, right;
+        for (const CSVDiff::Entry& entry : diff.GetEntries()) {
+            switch (entry.change) {
+                case CSVDiff::Change::Removed:
+                    diff.GetRow(CSVDiff::LEFT, entry.leftRow, left);
+                    Print(wxString::Format("- %lld: %s\n", entry.leftRow + 1 + headerLines,
+                                           CSVParser::FormatLine(left, inputs[0].separator)));
+                    break;
+                case CSVDiff::Change::Added:
+                    diff.GetRow(CSVDiff::RIGHT, entry.rightRow, right);
+                    Print(wxString::Format("+ %lld: %s\n", entry.rightRow + 1 + headerLines,
+                                           CSVParser::FormatLine(right, inputs[1].separator)));
+                    break;
+                case CSVDiff::Change::Modified: {
+                    diff.GetRow(CSVDiff::LEFT, entry.leftRow, left);
+                    diff.GetRow(CSVDiff::RIGHT, entry.rightRow, right);
+                    wxString line = wxString::Format("~ %lld -> %lld:", entry.leftRow + 1 + headerLines,
+                                                     entry.rightRow + 1 + headerLines);
+                    for (int col : CSVDiff::GetChangedCells(left, right)) {
+                        wxString name = col < (int)header.size() ? header[col] : wxString::Format("#%d", col + 1);
+                        line += wxString::Format(" %s: \"%s\" -> \"%s\";", name,
+                                                 col < (int)left.size() ? left[col] : wxString(),
+                                                 col < (int)right.size() ? right[col] : wxString());
+                    }
+                    Print(line + "\n");
+                    break;
+                }
+            }
+        }
+    }
+    
+    Print(wxString::Format("Added: %d, Removed: %d, Modified: %d\n",
+                           (int)diff.GetCount(CSVDiff::Change::Added),
+                           (int)diff.GetCount(CSVDiff::Change::Removed),
+                           (int)diff.GetCount(CSVDiff::Change::Modified)));
+    return diff.GetEntries().empty() ? 0 : 1;
+}
+
+// Whole file into a table, the same store the editor works on
+static bool LoadTable(CSVDiff::Input& input, CSVTable& table, wxString& error) {
+    MappedFile file;
+    if (!file.Open(input.filename)) {
+        error = wxString::Format("Cannot open %s", input.filename);
+        return false;
+    }
+    file.AdviseSequential();
+    
+    std::vector<wxString> header;
+    bool headerPending = input.hasHeader;
+    size_t cols = 0;
+    CSVParser parser;
+    bool loaded = parser.ReadFile(file, input.encoding, input.separator,
+                                  [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            cols = wxMax(cols, rows[i].size());
+            if (headerPending) {
+                header = std::move(rows[i]);
+                headerPending = false;
+                continue;
+            }
+            table.AppendLoadedRow(rows[i], offsets[i]);
+        }
+    });
+    if (!loaded) {
+        error = wxString::Format("Cannot read %s", input.filename);
+        return false;
+    }
+    header.resize(cols);
+    table.FinishLoad(header, cols, nullptr);
+    return true;
+}
+
+// Names as the editor shows them, letters for files without a header
+static std::vector<wxString> GetColumnNames(CSVTable& table) {
+    std::vector<wxString> names(table.GetNumberCols());
+    for (size_t col = 0; col < names.size(); ++col) {
+        names[col] = table.GetColLabelValue((int)col);
+    }
+    return names;
+}
+
+// The labels as a header row first when withHeader is set
+static bool WriteTable(const wxString& filename, CSVTable& table, bool withHeader, const CSVDiff::Input& input) {
+    size_t headerRows = withHeader ? 1 : 0;
+    int cols = table.GetNumberCols();
+    return CSVParser::WriteFile(filename, table.GetNumberRows() + headerRows,
+                                [&](size_t row, std::vector<wxString>& fields) {
+        fields.resize(cols);
+        for (int col = 0; col < cols; ++col) {
+            if (row < headerRows) {
+                fields[col] = table.GetColLabelValue(col);
+            } else {
+                table.CopyValue((int)(row - headerRows), col, fields[col]);
+            }
+        }
+    }, input.separator, input.encoding);
+}
+
+int CommandLine::RunCompute(const Options& options) {
+    if (options.positional.GetCount() != 2 || options.Get("expr").IsEmpty()) {
+        PrintUsage();
+        return 2;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(options.positional[0], options.Has("header"), input)) {
+        PrintError(wxString::Format("Cannot open %s", options.positional[0]));
+        return 2;
+    }
+    if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), input)) {
+        PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+        return 2;
+    }
+    CSVTable table;
+    wxString error;
+    if (!LoadTable(input, table, error)) {
+        PrintError(error);
+        return 2;
+    }
+    
+    int cols = table.GetNumberCols();
+    ColumnExpression formula;
+    if (!formula.Compile(options.Get("expr"), GetColumnNames(table), error)) {
+        PrintError(error);
+        return 2;
+    }
+    
+    long at = (long)cols + 1;
+    if (options.Has("at") && (!options.Get("at").ToLong(&at) || at < 1 || at > (long)cols + 1)) {
+        PrintError(wxString::Format("Invalid position: %s", options.Get("at")));
+        return 2;
+    }
+    int target = (int)at - 1;
+    table.InsertCols(target, 1);
+    table.SetColLabelValue(target, options.Get("name"));
+    formula.Fill(table, target);
+    
+    if (!WriteTable(options.positional[1], table, input.hasHeader, input)) {
+        PrintError(wxString::Format("Cannot write %s", options.positional[1]));
+        return 2;
+    }
+    return 0;
+}
+
+int CommandLine::RunQuery(const Options& options) {
+    if (options.positional.GetCount() != 2 || options.Get("sql").IsEmpty()) {
+        PrintUsage();
+        return 2;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(options.positional[0], options.Has("header"), input)) {
+        PrintError(wxString::Format("Cannot open %s", options.positional[0]));
+        return 2;
+    }
+    if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), input)) {
+        PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+        return 2;
+    }
+    CSVTable table;
+    wxString error;
+    if (!LoadTable(input, table, error)) {
+        PrintError(error);
+        return 2;
+    }
+    
+    TableQuery query;
+    if (!query.Parse(options.Get("sql"), GetColumnNames(table), error)) {
+        PrintError(error);
+        return 2;
+    }
+    std::unique_ptr<CSVTable> result = query.Run(table);
+    
+    // Items are named, so the result always has a header row
+    if (!WriteTable(options.positional[1], *result, true, input)) {
+        PrintError(wxString::Format("Cannot write %s", options.positional[1]));
+        return 2;
+    }
+    return 0;
+}
+
+int CommandLine::RunMerge(const Options& options) {
+    if (options.positional.GetCount() != 3 || options.Get("key").IsEmpty()) {
+        PrintUsage();
+        return 2;
+    }
+    
+    wxString typeName = options.Get("type", "left").Lower();
+    CSVJoin::Type type;
+    if (typeName == "inner") {
+        type = CSVJoin::Type::INNER;
+    } else if (typeName == "left") {
+        type = CSVJoin::Type::LEFT;
+    } else if (typeName == "anti") {
+        type = CSVJoin::Type::ANTI;
+    } else {
+        PrintError(wxString::Format("Unknown join type: %s", typeName));
+        return 2;
+    }
+    
+    CSVDiff::Input inputs[2];
+    for (int i = 0; i < 2; ++i) {
+        if (!CSVDiff::DetectInput(options.positional[i], options.Has("header"), inputs[i])) {
+            PrintError(wxString::Format("Cannot open %s", options.positional[i]));
+            return 2;
+        }
+        if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), inputs[i])) {
+            PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+            return 2;
+        }
+    }
+    
+    CSVJoin join;
+    wxString error;
+    if (!join.Run(inputs[0], inputs[1], options.Get("key"), options.Get("right-key"), type,
+                  options.positional[2], error)) {
+        PrintError(error);
+        return 2;
+    }
+    Print(wxString::Format("Rows written: %d\n", (int)join.GetRowCount()));
+    return 0;
+}
+
+int CommandLine::RunDedup(const Options& options) {
+    if (options.positional.GetCount() != 2) {
+        PrintUsage();
+        return 2;
+    }
+    
+    wxString keepName = options.Get("keep", "first").Lower();
+    Deduplicator::Keep keep;
+    if (keepName == "first") {
+        keep = Deduplicator::Keep::FIRST;
+    } else if (keepName == "last") {
+        keep = Deduplicator::Keep::LAST;
+    } else {
+        PrintError(wxString::Format("Unknown keep option: %s", keepName));
+        return 2;
+    }
+    
+    size_t memoryLimit = Deduplicator::DEFAULT_MEMORY_LIMIT;
+    if (options.Has("memory")) {
+        unsigned long megabytes = 0;
+        if (!options.Get("memory").ToULong(&megabytes) || megabytes == 0) {
+            PrintError(wxString::Format("Invalid memory limit: %s", options.Get("memory")));
+            return 2;
+        }
+        memoryLimit = (size_t)megabytes * 1024 * 1024;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(options.positional[0], options.Has("header"), input)) {
+        PrintError(wxString::Format("Cannot open %s", options.positional[0]));
+        return 2;
+    }
+    if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), input)) {
+        PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+        return 2;
+    }
+    
+    Deduplicator deduplicator(keep);
+    wxString error;
+    if (!deduplicator.RemoveDuplicates(input, options.Get("key"), options.positional[1], memoryLimit, error)) {
+        PrintError(error);
+        return 2;
+    }
+    Print(wxString::Format("Rows read: %d, duplicates removed: %d\n",
+                           (int)deduplicator.GetRowCount(), (int)deduplicator.GetDuplicateCount()));
+    return 0;
+}
+
+int CommandLine::RunSplit(const Options& options) {
+    size_t count = options.positional.GetCount();
+    if ((count != 1 && count != 2) || options.Has("rows") == options.Has("mb")) {
+        PrintUsage();
+        return 2;
+    }
+    
+    CSVSplitter::Mode mode = options.Has("rows") ? CSVSplitter::Mode::ROWS : CSVSplitter::Mode::BYTES;
+    wxString sizeText = options.Get(mode == CSVSplitter::Mode::ROWS ? "rows" : "mb");
+    unsigned long size = 0;
+    if (!sizeText.ToULong(&size) || size == 0) {
+        PrintError(wxString::Format("Invalid part size: %s", sizeText));
+        return 2;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(options.positional[0], options.Has("header"), input)) {
+        PrintError(wxString::Format("Cannot open %s", options.positional[0]));
+        return 2;
+    }
+    if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), input)) {
+        PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+        return 2;
+    }
+    
+    CSVSplitter splitter;
+    wxString error;
+    size_t partSize = mode == CSVSplitter::Mode::BYTES ? (size_t)size * 1024 * 1024 : (size_t)size;
+    if (!splitter.Split(input, mode, partSize, options.positional[count - 1], error)) {
+        PrintError(error);
+        return 2;
+    }
+    Print(wxString::Format("Rows: %d, parts written: %d\n",
+                           (int)splitter.GetRowCount(), (int)splitter.GetOutputFiles().size()));
+    return 0;
+}
+
+int CommandLine::RunConcat(const Options& options) {
+    size_t count = options.positional.GetCount();
+    if (count < 3) {
+        PrintUsage();
+        return 2;
+    }
+    
+    std::vector<CSVDiff::Input> inputs(count - 1);
+    for (size_t i = 0; i + 1 < count; ++i) {
+        if (!CSVDiff::DetectInput(options.positional[i], options.Has("header"), inputs[i])) {
+            PrintError(wxString::Format("Cannot open %s", options.positional[i]));
+            return 2;
+        }
+        if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), inputs[i])) {
+            PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+            return 2;
+        }
+    }
+    
+    CSVSplitter splitter;
+    wxString error;
+    if (!splitter.Concat(inputs, options.positional[count - 1], error)) {
+        PrintError(error);
+        return 2;
+    }
+    Print(wxString::Format("Files concatenated: %d\n", (int)inputs.size()));
+    return 0;
+}
+
+int CommandLine::RunValidate(const Options& options) {
+    if (options.positional.GetCount() != 1) {
+        PrintUsage();
+        return 2;
+    }
+    
+    unsigned long maxErrors = 100;
+    if (options.Has("max-errors") && !options.Get("max-errors").ToULong(&maxErrors)) {
+        PrintError(wxString::Format("Invalid error count: %s", options.Get("max-errors")));
+        return 2;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(options.positional[0], options.Has("header"), input)) {
+        PrintError(wxString::Format("Cannot open %s", options.positional[0]));
+        return 2;
+    }
+    if (!ApplyFormatOptions(options.Get("separator"), options.Get("encoding"), input)) {
+        PrintError(wxString::Format("Unknown encoding: %s", options.Get("encoding")));
+        return 2;
+    }
+    
+    CSVValidator validator;
+    wxString error;
+    if (options.Has("schema") && !validator.LoadSchema(options.Get("schema"), error)) {
+        PrintError(error);
+        return 2;
+    }
+    
+    wxString reportFile = options.Get("report");
+    CSVWriter report;
+    if (!reportFile.IsEmpty() && !report.Open(reportFile, Encoding::UTF8)) {
+        PrintError(wxString::Format("Cannot write %s", reportFile));
+        return 2;
+    }
+    bool writeFailed = false;
+    if (!reportFile.IsEmpty()) {
+        wxString line;
+        CSVParser::AppendLine(line, CSVValidator::GetReportHeader(), ',');
+        writeFailed = !report.Write(line + wxT("\r\n"));
+    }
+    
+    // Issues are printed as they are found, compiler style: file:line: ...
+    std::vector<wxString> fields;
+    bool validated = validator.Validate(input, [&](const CSVValidator::Issue& issue) {
+        if (validator.GetIssueCount() <= maxErrors) {
+            wxString where = wxString::Format("%s:%llu: byte %lld", input.filename,
+                                              (unsigned long long)issue.line, issue.offset);
+            if (issue.row >= 0) {
+                where += wxString::Format(", row %lld", issue.row + 1);
+            }
+            if (issue.column >= 0) {
+                where += ", column " + validator.GetColumnName(issue.column);
+            }
+            wxString text = where + ": " + CSVValidator::GetProblemName(issue.problem) + ": " + issue.message;
+            if (!issue.value.IsEmpty()) {
+                text += " \"" + issue.value + "\"";
+            }
+            Print(text + "\n");
+        }
+        if (!reportFile.IsEmpty() && !writeFailed) {
+            validator.FormatIssue(issue, fields);
+            wxString line;
+            CSVParser::AppendLine(line, fields, ',');
+            writeFailed = !report.Write(line + wxT("\r\n"));
+        }
+    }, error);
+    
+    if (!validated) {
+        PrintError(error);
+        return 2;
+    }
+    if (!reportFile.IsEmpty() && (writeFailed || !report.Close())) {
+        PrintError(wxString::Format("Cannot write %s", reportFile));
+        return 2;
+    }
+    
+    wxString summary = wxString::Format("Rows: %d, problems: %d", (int)validator.GetRowCount(),
+                                        (int)validator.GetIssueCount());
+    for (int problem = 0; problem < (int)CSVValidator::Problem::COUNT; ++problem) {
+        size_t count = validator.GetProblemCount((CSVValidator::Problem)problem);
+        if (count > 0) {
+            summary += wxString::Format(", %s: %d", CSVValidator::GetProblemName((CSVValidator::Problem)problem), (int)count);
+        }
+    }
+    Print(summary + "\n");
+    return validator.GetIssueCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include "CompareDialog.h"
+
+wxBEGIN_EVENT_TABLE(CompareDialog, wxDialog)
+    EVT_BUTTON(wxID_OK, CompareDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+CompareDialog::CompareDialog(wxWindow* parent, Language language, const wxString& leftFile)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_compare_title", language), wxDefaultPosition, wxSize(500, 320)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    wxString wildcard = "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*";
+    
+    // Original file, defaults to the active document
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("compare_left", language)), 0, wxALL, 5);
+    leftPicker = new wxFilePickerCtrl(this, wxID_ANY, leftFile, Translate("compare_left", language), wildcard,
+                                      wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(leftPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Changed file
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("compare_right", language)), 0, wxALL, 5);
+    rightPicker = new wxFilePickerCtrl(this, wxID_ANY, "", Translate("compare_right", language), wildcard,
+                                       wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(rightPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Header checkbox
+    headerCheckBox = new wxCheckBox(this, wxID_ANY, Translate("compare_header", language));
+    mainSizer->Add(headerCheckBox, 0, wxALL, 5);
+    
+    // Key columns
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("compare_keys", language)), 0, wxALL, 5);
+    keyText = new wxTextCtrl(this, wxID_ANY);
+    mainSizer->Add(keyText, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void CompareDialog::OnOK(wxCommandEvent& event) {
+    if (!wxFileExists(GetLeftFile()) || !wxFileExists(GetRightFile())) {
+        wxMessageBox(Translate("error_compare_files", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxString CompareDialog::GetLeftFile() const {
+    return leftPicker->GetPath();
+}
+
+wxString CompareDialog::GetRightFile() const {
+    return rightPicker->GetPath();
+}
+
+bool CompareDialog::GetHasHeader() const {
+    return headerCheckBox->GetValue();
+}
+
+wxString CompareDialog::GetKeyColumns() const {
+    return keyText->GetValue();
+}
@@ -0,0 +1,654 @@
+#include "Compression.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/filename.h>
+#include <zlib.h>
+#include <zstd.h>
+#include <lzma.h>
+#include <algorithm>
+#include <cstring>
+
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Decompressed output is made visible to readers in steps of this size
+const size_t PUBLISH_STEP = 4 * 1024 * 1024;
+// Reserved address space is made writable in steps of this size
+const size_t COMMIT_STEP = 64 * 1024 * 1024;
+// Address space reserved for the output, only the part written uses memory
+const size_t RESERVE_SIZE = sizeof(void*) >= 8 ? ((size_t)1 << 40) : ((size_t)1 << 30);
+const size_t MIN_RESERVE_SIZE = (size_t)1 << 28;
+// Blocks decompressed in parallel are handed out in windows of this much output
+const size_t WINDOW_SIZE = 64 * 1024 * 1024;
+
+// Largest BGZF block payload, chosen so a compressed block always fits in 64 KB
+const size_t GZIP_BLOCK_INPUT = 65280;
+// Input of each zstd frame written
+const size_t ZSTD_FRAME_INPUT = 4 * 1024 * 1024;
+const int ZSTD_LEVEL = 3;
+// Blocks per worker gathered before a batch is compressed in parallel, so
+// each batch keeps every worker busy without holding much more input
+const size_t BATCH_BLOCKS_PER_THREAD = 2;
+
+// Empty BGZF block that marks the end of a BGZF file
+const unsigned char BGZF_EOF[28] = {
+    0x1F, 0x8B, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1B, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+unsigned int GetU16(const unsigned char* p) {
+    return p[0] | (p[1] << 8);
+}
+
+unsigned int GetU32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+void PutU16(unsigned char* p, unsigned int value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+void PutU32(unsigned char* p, unsigned int value) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+// Compress one BGZF block: a gzip member whose 'BC' extra field holds its size
+bool CompressGzipBlock(const char* input, size_t length, std::string& out) {
+    const size_t HEADER = 18;
+    const size_t TRAILER = 8;
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(HEADER + deflateBound(&stream, (uLong)length) + TRAILER);
+    stream.next_in = (Bytef*)input;
+    stream.avail_in = (uInt)length;
+    stream.next_out = (Bytef*)&out[HEADER];
+    stream.avail_out = (uInt)(out.size() - HEADER - TRAILER);
+    int result = deflate(&stream, Z_FINISH);
+    size_t compressed = stream.total_out;
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END || HEADER + compressed + TRAILER > 65536) {
+        return false;
+    }
+    
+    unsigned char* p = (unsigned char*)&out[0];
+    const unsigned char header[12] = {0x1F, 0x8B, 0x08, 0x04, 0, 0, 0, 0, 0, 0xFF, 6, 0};
+    memcpy(p, header, sizeof(header));
+    p[12] = 'B';
+    p[13] = 'C';
+    PutU16(p + 14, 2);
+    PutU16(p + 16, (unsigned int)(HEADER + compressed + TRAILER - 1));
+    PutU32(p + HEADER + compressed, (unsigned int)crc32(0, (const Bytef*)input, (uInt)length));
+    PutU32(p + HEADER + compressed + 4, (unsigned int)length);
+    out.resize(HEADER + compressed + TRAILER);
+    return true;
+}
+
+bool CompressZstdFrame(const char* input, size_t length, std::string& out) {
+    out.resize(ZSTD_compressBound(length));
+    size_t compressed = ZSTD_compress(&out[0], out.size(), input, length, ZSTD_LEVEL);
+    if (ZSTD_isError(compressed)) {
+        return false;
+    }
+    out.resize(compressed);
+    return true;
+}
+
+} // namespace
+
+Compression DetectCompression(const char* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    if (size >= 2 && p[0] == 0x1F && p[1] == 0x8B) {
+        return Compression::GZIP;
+    }
+    // A zstd frame or a skippable frame (0x184D2A50 to 0x184D2A5F)
+    if (size >= 4 && ((p[0] == 0x28 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD) ||
+                      ((p[0] & 0xF0) == 0x50 && p[1] == 0x2A && p[2] == 0x4D && p[3] == 0x18))) {
+        return Compression::ZSTD;
+    }
+    if (size >= 6 && p[0] == 0xFD && p[1] == '7' && p[2] == 'z' && p[3] == 'X' && p[4] == 'Z' && p[5] == 0) {
+        return Compression::XZ;
+    }
+    return Compression::NONE;
+}
+
+Compression CompressionFromFilename(const wxString& filename) {
+    wxString extension = wxFileName(filename).GetExt().Lower();
+    if (extension == "gz" || extension == "gzip") {
+        return Compression::GZIP;
+    }
+    if (extension == "zst" || extension == "zstd") {
+        return Compression::ZSTD;
+    }
+    if (extension == "xz") {
+        return Compression::XZ;
+    }
+    return Compression::NONE;
+}
+
+DecompressedBuffer::DecompressedBuffer()
+    : input(nullptr), inputSize(0), format(Compression::NONE),
+      data(nullptr), reserved(0), committed(0),
+      available(0), finished(false), failed(false), stopping(false) {
+}
+
+DecompressedBuffer::~DecompressedBuffer() {
+    stopping = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    Release();
+}
+
+bool DecompressedBuffer::Start(const char* source, size_t sourceSize, Compression compression) {
+    input = source;
+    inputSize = sourceSize;
+    format = compression;
+    if (!Reserve()) {
+        return false;
+    }
+    worker = std::thread(&DecompressedBuffer::Run, this);
+    return true;
+}
+
+size_t DecompressedBuffer::WaitFor(size_t bytes) const {
+    // Readers ask for every record, so the common case takes no lock
+    size_t ready = available.load(std::memory_order_acquire);
+    if (ready >= bytes || finished.load(std::memory_order_acquire)) {
+        return available.load(std::memory_order_acquire);
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [this, bytes] {
+        return available.load(std::memory_order_acquire) >= bytes || finished.load(std::memory_order_acquire);
+    });
+    return available.load(std::memory_order_acquire);
+}
+
+bool DecompressedBuffer::Reserve() {
+    // Address space only, memory is committed as output is written
+    for (size_t size = RESERVE_SIZE; size >= MIN_RESERVE_SIZE; size /= 2) {
+#ifdef __WXMSW__
+        void* region = ::VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+        if (region) {
+#else
+        void* region = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (region != MAP_FAILED) {
+#endif
+            data = (char*)region;
+            reserved = size;
+            return true;
+        }
+    }
+    return false;
+}
+
+void DecompressedBuffer::Release() {
+    if (data) {
+#ifdef __WXMSW__
+        ::VirtualFree(data, 0, MEM_RELEASE);
+#else
+        ::munmap(data, reserved);
+#endif
+    }
+    data = nullptr;
+    reserved = 0;
+    committed = 0;
+}
+
+bool DecompressedBuffer::Commit(size_t end) {
+    if (end <= committed) {
+        return true;
+    }
+    if (end > reserved) {
+        return false;
+    }
+    
+    // Whole steps keep the committed end page aligned
+    size_t target = std::max(end, committed + COMMIT_STEP);
+    target = std::min(reserved, (target + COMMIT_STEP - 1) / COMMIT_STEP * COMMIT_STEP);
+#ifdef __WXMSW__
+    if (!::VirtualAlloc(data + committed, target - committed, MEM_COMMIT, PAGE_READWRITE)) {
+        return false;
+    }
+#else
+    if (::mprotect(data + committed, target - committed, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+#endif
+    committed = target;
+    return true;
+}
+
+void DecompressedBuffer::Publish(size_t end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    available.store(end, std::memory_order_release);
+    progress.notify_all();
+}
+
+void DecompressedBuffer::Run() {
+    PROFILE_SCOPE("compression.decompress");
+    bool ok = false;
+    std::vector<Block> blocks;
+    switch (format) {
+        case Compression::GZIP:
+            ok = FindBgzfBlocks(input, inputSize, blocks) ? DecodeBlocks(blocks) : InflateGzip();
+            break;
+        case Compression::ZSTD:
+            ok = FindZstdFrames(input, inputSize, blocks) ? DecodeBlocks(blocks) : DecompressZstd();
+            break;
+        case Compression::XZ:
+            ok = DecompressXz();
+            break;
+        case Compression::NONE:
+            break;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    failed = !ok || stopping;
+    finished = true;
+    progress.notify_all();
+}
+
+bool DecompressedBuffer::FindBgzfBlocks(const char* source, size_t sourceSize, std::vector<Block>& blocks) {
+    const unsigned char* bytes = (const unsigned char*)source;
+    size_t pos = 0;
+    size_t output = 0;
+    while (pos < sourceSize) {
+        // Fixed header with only the extra field flag set, then the 'BC' subfield
+        const unsigned char* p = bytes + pos;
+        size_t remaining = sourceSize - pos;
+        if (remaining < 26 || p[0] != 0x1F || p[1] != 0x8B || p[2] != 8 || p[3] != 4) {
+            return false;
+        }
+        size_t extraEnd = 12 + GetU16(p + 10);
+        size_t blockSize = 0;
+        for (size_t i = 12; i + 4 <= extraEnd && extraEnd <= remaining; i += 4 + GetU16(p + i + 2)) {
+            if (p[i] == 'B' && p[i + 1] == 'C' && GetU16(p + i + 2) == 2 && i + 6 <= extraEnd) {
+                blockSize = GetU16(p + i + 4) + 1;
+            }
+        }
+        if (blockSize < extraEnd + 8 || blockSize > remaining) {
+            return false;
+        }
+        
+        Block block = { pos + extraEnd, blockSize - extraEnd - 8, output, GetU32(p + blockSize - 4) };
+        blocks.push_back(block);
+        output += block.outputSize;
+        pos += blockSize;
+    }
+    return !blocks.empty();
+}
+
+bool DecompressedBuffer::FindZstdFrames(const char* source, size_t sourceSize, std::vector<Block>& blocks) {
+    size_t pos = 0;
+    size_t output = 0;
+    while (pos < sourceSize) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(source + pos, sourceSize - pos);
+        unsigned long long contentSize = ZSTD_getFrameContentSize(source + pos, sourceSize - pos);
+        // Frames written without their size are decompressed as a stream
+        if (ZSTD_isError(frameSize) || contentSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+            contentSize == ZSTD_CONTENTSIZE_ERROR) {
+            return false;
+        }
+        Block block = { pos, frameSize, output, (size_t)contentSize };
+        blocks.push_back(block);
+        output += block.outputSize;
+        pos += frameSize;
+    }
+    // A single frame gains nothing from the parallel path
+    return blocks.size() > 1;
+}
+
+bool DecompressedBuffer::DecodeBlocks(const std::vector<Block>& blocks) {
+    PROFILE_SCOPE("compression.decode_blocks");
+    size_t first = 0;
+    while (first < blocks.size() && !stopping) {
+        // A window of blocks is decompressed in parallel, then published
+        size_t last = first;
+        size_t windowStart = blocks[first].output;
+        while (last < blocks.size() && (last == first || blocks[last].output - windowStart < WINDOW_SIZE)) {
+            ++last;
+        }
+        size_t windowEnd = blocks[last - 1].output + blocks[last - 1].outputSize;
+        if (!Commit(windowEnd)) {
+            return false;
+        }
+        
+        std::atomic<bool> corrupt(false);
+        WorkerPool::Get().ParallelFor(last - first, 1, [&](size_t begin, size_t end) {
+            for (size_t i = first + begin; i < first + end; ++i) {
+                const Block& block = blocks[i];
+                char* out = data + block.output;
+                if (format == Compression::ZSTD) {
+                    size_t size = ZSTD_decompress(out, block.outputSize, input + block.offset, block.size);
+                    if (ZSTD_isError(size) || size != block.outputSize) {
+                        corrupt = true;
+                    }
+                    continue;
+                }
+                
+                z_stream stream;
+                memset(&stream, 0, sizeof(stream));
+                if (inflateInit2(&stream, -15) != Z_OK) {
+                    corrupt = true;
+                    continue;
+                }
+                stream.next_in = (Bytef*)(input + block.offset);
+                stream.avail_in = (uInt)block.size;
+                stream.next_out = (Bytef*)out;
+                stream.avail_out = (uInt)block.outputSize;
+                int result = inflate(&stream, Z_FINISH);
+                bool complete = result == Z_STREAM_END && stream.total_out == block.outputSize;
+                inflateEnd(&stream);
+                
+                // The trailer's CRC follows the deflate data
+                const unsigned char* trailer = (const unsigned char*)(input + block.offset + block.size);
+                if (!complete || crc32(0, (const Bytef*)out, (uInt)block.outputSize) != GetU32(trailer)) {
+                    corrupt = true;
+                }
+            }
+        });
+        if (corrupt) {
+            return false;
+        }
+        
+        Publish(windowEnd);
+        first = last;
+    }
+    return true;
+}
+
+bool DecompressedBuffer::InflateGzip() {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 16 selects the gzip wrapper
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        return false;
+    }
+    
+    size_t consumed = 0;
+    size_t produced = 0;
+    bool ok = false;
+    while (!stopping) {
+        if (!Commit(produced + PUBLISH_STEP) && !Commit(reserved)) {
+            break;
+        }
+        size_t room = std::min(PUBLISH_STEP, committed - produced);
+        if (room == 0) {
+            break;
+        }
+        // zlib counts in 32 bits, large inputs are fed a piece at a time
+        if (stream.avail_in == 0) {
+            size_t piece = std::min(inputSize - consumed, (size_t)1 << 30);
+            stream.next_in = (Bytef*)(input + consumed);
+            stream.avail_in = (uInt)piece;
+            consumed += piece;
+        }
+        stream.next_out = (Bytef*)(data + produced);
+        stream.avail_out = (uInt)room;
+        
+        int result = inflate(&stream, Z_NO_FLUSH);
+        produced += room - stream.avail_out;
+        Publish(produced);
+        
+        if (result == Z_STREAM_END) {
+            // Concatenated members continue the same content
+            size_t next = consumed - stream.avail_in;
+            const unsigned char* p = (const unsigned char*)input + next;
+            if (next + 2 <= inputSize && p[0] == 0x1F && p[1] == 0x8B) {
+                inflateReset(&stream);
+                continue;
+            }
+            ok = true;
+            break;
+        }
+        // Running out of input before the end of a member means truncation
+        if (result != Z_OK && !(result == Z_BUF_ERROR && stream.avail_in == 0 && consumed < inputSize)) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    return ok;
+}
+
+bool DecompressedBuffer::DecompressZstd() {
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    if (!context) {
+        return false;
+    }
+    
+    ZSTD_inBuffer in = { input, inputSize, 0 };
+    size_t produced = 0;
+    size_t pending = 1;
+    bool ok = false;
+    while (!stopping) {
+        if (!Commit(produced + PUBLISH_STEP) && !Commit(reserved)) {
+            break;
+        }
+        ZSTD_outBuffer out = { data + produced, std::min(PUBLISH_STEP, committed - produced), 0 };
+        if (out.size == 0) {
+            break;
+        }
+        pending = ZSTD_decompressStream(context, &out, &in);
+        if (ZSTD_isError(pending)) {
+            break;
+        }
+        produced += out.pos;
+        Publish(produced);
+        
+        // Everything consumed and flushed, a frame still pending means truncation
+        if (in.pos == in.size && out.pos < out.size) {
+            ok = pending == 0;
+            break;
+        }
+    }
+    ZSTD_freeDCtx(context);
+    return ok;
+}
+
+bool DecompressedBuffer::DecompressXz() {
+    lzma_stream stream = LZMA_STREAM_INIT;
+    lzma_mt options;
+    memset(&options, 0, sizeof(options));
+    options.flags = LZMA_CONCATENATED;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    // Blocks are decoded in parallel when the file records their sizes
+    options.memlimit_threading = std::max((uint64_t)lzma_physmem() / 4, (uint64_t)64 << 20);
+    options.memlimit_stop = UINT64_MAX;
+    if (lzma_stream_decoder_mt(&stream, &options) != LZMA_OK) {
+        return false;
+    }
+    
+    stream.next_in = (const uint8_t*)input;
+    stream.avail_in = inputSize;
+    size_t produced = 0;
+    bool ok = false;
+    while (!stopping) {
+        if (!Commit(produced + PUBLISH_STEP) && !Commit(reserved)) {
+            break;
+        }
+        size_t room = std::min(PUBLISH_STEP, committed - produced);
+        if (room == 0) {
+            break;
+        }
+        stream.next_out = (uint8_t*)(data + produced);
+        stream.avail_out = room;
+        
+        lzma_ret result = lzma_code(&stream, LZMA_FINISH);
+        produced += room - stream.avail_out;
+        Publish(produced);
+        
+        if (result == LZMA_STREAM_END) {
+            ok = true;
+            break;
+        }
+        if (result != LZMA_OK) {
+            break;
+        }
+    }
+    lzma_end(&stream);
+    return ok;
+}
+
+struct CompressedWriter::XzEncoder {
+    lzma_stream stream = LZMA_STREAM_INIT;
+    
+    ~XzEncoder() { lzma_end(&stream); }
+};
+
+CompressedWriter::CompressedWriter()
+    : format(Compression::NONE), ok(false), batchInput(0) {
+}
+
+CompressedWriter::~CompressedWriter() {
+    // Closing was not reached, leave the target untouched
+    if (file.IsOpened()) {
+        file.Discard();
+    }
+}
+
+bool CompressedWriter::Open(const wxString& filename, Compression compression) {
+    format = compression;
+    pending.clear();
+    size_t blockInput = format == Compression::GZIP ? GZIP_BLOCK_INPUT : ZSTD_FRAME_INPUT;
+    batchInput = blockInput * BATCH_BLOCKS_PER_THREAD * WorkerPool::Get().GetThreadCount();
+    if (!file.Open(filename)) {
+        return false;
+    }
+    
+    if (format == Compression::XZ) {
+        xz.reset(new XzEncoder());
+        lzma_mt options;
+        memset(&options, 0, sizeof(options));
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+        options.preset = LZMA_PRESET_DEFAULT;
+        options.check = LZMA_CHECK_CRC64;
+        if (lzma_stream_encoder_mt(&xz->stream, &options) != LZMA_OK) {
+            file.Discard();
+            return false;
+        }
+    }
+    ok = true;
+    return true;
+}
+
+bool CompressedWriter::Write(const char* bytes, size_t length) {
+    switch (format) {
+        case Compression::NONE:
+            WriteOutput(bytes, length);
+            break;
+        case Compression::XZ:
+            WriteXz(bytes, length, false);
+            break;
+        case Compression::GZIP:
+        case Compression::ZSTD:
+            pending.append(bytes, length);
+            if (pending.size() >= batchInput) {
+                CompressPending(false);
+            }
+            break;
+    }
+    return ok;
+}
+
+bool CompressedWriter::Close() {
+    switch (format) {
+        case Compression::NONE:
+            break;
+        case Compression::XZ:
+            WriteXz(nullptr, 0, true);
+            break;
+        case Compression::GZIP:
+            CompressPending(true);
+            WriteOutput(BGZF_EOF, sizeof(BGZF_EOF));
+            break;
+        case Compression::ZSTD:
+            CompressPending(true);
+            break;
+    }
+    xz.reset();
+    
+    if (!ok) {
+        file.Discard();
+        return false;
+    }
+    return file.Commit();
+}
+
+void CompressedWriter::CompressPending(bool final) {
+    PROFILE_SCOPE("compression.compress");
+    // Only whole blocks are compressed until the end of the file
+    size_t blockInput = format == Compression::GZIP ? GZIP_BLOCK_INPUT : ZSTD_FRAME_INPUT;
+    size_t blockCount = final ? (pending.size() + blockInput - 1) / blockInput : pending.size() / blockInput;
+    // An empty zstd file still needs one frame
+    if (final && blockCount == 0 && format == Compression::ZSTD) {
+        blockCount = 1;
+    }
+    
+    std::vector<std::string> outputs(blockCount);
+    std::atomic<bool> failure(false);
+    WorkerPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            size_t start = i * blockInput;
+            size_t length = std::min(blockInput, pending.size() - std::min(start, pending.size()));
+            const char* block = pending.data() + std::min(start, pending.size());
+            bool compressed = format == Compression::GZIP ? CompressGzipBlock(block, length, outputs[i])
+                                                          : CompressZstdFrame(block, length, outputs[i]);
+            if (!compressed) {
+                failure = true;
+            }
+        }
+    });
+    if (failure) {
+        ok = false;
+    }
+    
+    for (const std::string& output : outputs) {
+        WriteOutput(output.data(), output.size());
+    }
+    pending.erase(0, std::min(pending.size(), blockCount * blockInput));
+}
+
+void CompressedWriter::WriteXz(const char* bytes, size_t length, bool final) {
+    lzma_stream& stream = xz->stream;
+    stream.next_in = (const uint8_t*)bytes;
+    stream.avail_in = length;
+    
+    char buffer[64 * 1024];
+    while (ok) {
+        stream.next_out = (uint8_t*)buffer;
+        stream.avail_out = sizeof(buffer);
+        lzma_ret result = lzma_code(&stream, final ? LZMA_FINISH : LZMA_RUN);
+        WriteOutput(buffer, sizeof(buffer) - stream.avail_out);
+        
+        if (result == LZMA_STREAM_END) {
+            return;
+        }
+        if (result != LZMA_OK) {
+            ok = false;
+            return;
+        }
+        // Without finishing, stop once the input is taken and nothing is left to flush
+        if (!final && stream.avail_in == 0 && stream.avail_out != 0) {
+            return;
+        }
+    }
+}
+
+void CompressedWriter::WriteOutput(const void* bytes, size_t length) {
+    if (ok && length > 0 && !file.Write(bytes, length)) {
+        ok = false;
+    }
+}
@@ -0,0 +1,74 @@
+#include "ComputedColumnDialog.h"
+#include "ColumnExpression.h"
+
+wxBEGIN_EVENT_TABLE(ComputedColumnDialog, wxDialog)
+    EVT_LISTBOX_DCLICK(ID_COLUMN_LIST, ComputedColumnDialog::OnColumnChosen)
+    EVT_BUTTON(wxID_OK, ComputedColumnDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+ComputedColumnDialog::ComputedColumnDialog(wxWindow* parent, Language language,
+                                           const std::vector<wxString>& columnNames)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_computed_title", language), wxDefaultPosition, wxSize(520, 480)),
+      columnNames(columnNames),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    // Name of the new column, the default letter label when empty
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("computed_name", language)), 0, wxALL, 5);
+    nameText = new wxTextCtrl(this, wxID_ANY);
+    mainSizer->Add(nameText, 0, wxALL | wxEXPAND, 5);
+    
+    // Expression
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("computed_expression", language)), 0, wxALL, 5);
+    expressionText = new wxTextCtrl(this, wxID_ANY, "", wxDefaultPosition, wxSize(-1, 60), wxTE_MULTILINE);
+    mainSizer->Add(expressionText, 0, wxALL | wxEXPAND, 5);
+    
+    // Columns, double click inserts a reference at the caret
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("computed_columns", language)), 0, wxALL, 5);
+    columnList = new wxListBox(this, ID_COLUMN_LIST);
+    for (const wxString& name : columnNames) {
+        columnList->Append(name);
+    }
+    mainSizer->Add(columnList, 1, wxALL | wxEXPAND, 5);
+    
+    // Syntax summary
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("computed_hint", language)), 0, wxALL, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+    expressionText->SetFocus();
+}
+
+void ComputedColumnDialog::OnColumnChosen(wxCommandEvent& event) {
+    int index = event.GetSelection();
+    if (index < 0 || (size_t)index >= columnNames.size()) {
+        return;
+    }
+    expressionText->WriteText("[" + columnNames[index] + "]");
+    expressionText->SetFocus();
+}
+
+void ComputedColumnDialog::OnOK(wxCommandEvent& event) {
+    // Keep the dialog open until the expression compiles
+    ColumnExpression formula;
+    wxString error;
+    if (!formula.Compile(GetExpression(), columnNames, error)) {
+        wxMessageBox(Translate("error_computed_expression", language) + "\n" + error,
+                     Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxString ComputedColumnDialog::GetColumnName() const {
+    return nameText->GetValue().Strip(wxString::both);
+}
+
+wxString ComputedColumnDialog::GetExpression() const {
+    return expressionText->GetValue();
+}
@@ -0,0 +1,91 @@
+#include "ConcatDialog.h"
+
+wxBEGIN_EVENT_TABLE(ConcatDialog, wxDialog)
+    EVT_BUTTON(ID_ADD_FILES, ConcatDialog::OnAdd)
+    EVT_BUTTON(ID_REMOVE_FILES, ConcatDialog::OnRemove)
+    EVT_BUTTON(wxID_OK, ConcatDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+ConcatDialog::ConcatDialog(wxWindow* parent, Language language)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_concat_title", language), wxDefaultPosition, wxSize(500, 460)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    // Files to append, in order
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("concat_files", language)), 0, wxALL, 5);
+    fileList = new wxListBox(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxArrayString(), wxLB_EXTENDED);
+    mainSizer->Add(fileList, 1, wxALL | wxEXPAND, 5);
+    wxBoxSizer* listButtons = new wxBoxSizer(wxHORIZONTAL);
+    listButtons->Add(new wxButton(this, ID_ADD_FILES, Translate("concat_add", language)), 0, wxRIGHT, 5);
+    listButtons->Add(new wxButton(this, ID_REMOVE_FILES, Translate("concat_remove", language)), 0);
+    mainSizer->Add(listButtons, 0, wxALL, 5);
+    
+    // Header checkbox
+    headerCheckBox = new wxCheckBox(this, wxID_ANY, Translate("compare_header", language));
+    headerCheckBox->SetValue(true);
+    mainSizer->Add(headerCheckBox, 0, wxALL, 5);
+    
+    // Result file
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_output", language)), 0, wxALL, 5);
+    outputPicker = new wxFilePickerCtrl(this, wxID_ANY, "", Translate("merge_output", language),
+                                        "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*",
+                                        wxDefaultPosition, wxDefaultSize, wxFLP_SAVE | wxFLP_OVERWRITE_PROMPT | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(outputPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void ConcatDialog::OnAdd(wxCommandEvent& event) {
+    wxFileDialog dialog(this, Translate("concat_add", language), "", "",
+                        "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*",
+                        wxFD_OPEN | wxFD_FILE_MUST_EXIST | wxFD_MULTIPLE);
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    
+    // Shards are usually named by date or number, so name order is file order
+    wxArrayString paths;
+    dialog.GetPaths(paths);
+    paths.Sort();
+    for (size_t i = 0; i < paths.GetCount(); ++i) {
+        fileList->Append(paths[i]);
+    }
+}
+
+void ConcatDialog::OnRemove(wxCommandEvent& event) {
+    wxArrayInt selections;
+    fileList->GetSelections(selections);
+    for (size_t i = selections.GetCount(); i-- > 0;) {
+        fileList->Delete(selections[i]);
+    }
+}
+
+void ConcatDialog::OnOK(wxCommandEvent& event) {
+    if (fileList->GetCount() < 2 || GetOutputFile().IsEmpty()) {
+        wxMessageBox(Translate("error_concat_input", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxArrayString ConcatDialog::GetInputFiles() const {
+    wxArrayString files;
+    for (unsigned int i = 0; i < fileList->GetCount(); ++i) {
+        files.Add(fileList->GetString(i));
+    }
+    return files;
+}
+
+wxString ConcatDialog::GetOutputFile() const {
+    return outputPicker->GetPath();
+}
+
+bool ConcatDialog::GetHasHeader() const {
+    return headerCheckBox->GetValue();
+}
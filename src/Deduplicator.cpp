@@ -0,0 +1,441 @@
+#include "Deduplicator.h"
+#include "CSVTable.h"
+#include "RowHash.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+
+namespace {
+
+// Field of a short row past its last column
+const wxString EMPTY_FIELD;
+
+// Two hashes of the same fields with different seeds make the 128-bit key
+const uint64_t SEED1 = 0x2545f4914f6cdd1dULL;
+const uint64_t SEED2 = 0x9e3779b97f4a7c15ULL;
+
+// Top six bits, one of the 64 partitions
+inline size_t PartitionOf(uint64_t hash) {
+    return (size_t)(hash >> 58);
+}
+
+// Hash of the selected columns, or of every field when none are selected
+void HashKey(const std::vector<wxString>& fields, const std::vector<int>& columns,
+             uint64_t& hash1, uint64_t& hash2) {
+    hash1 = SEED1;
+    hash2 = SEED2;
+    if (columns.empty()) {
+        for (const wxString& field : fields) {
+            hash1 = HashField(field, hash1);
+            hash2 = HashField(field, hash2);
+        }
+        return;
+    }
+    for (int col : columns) {
+        const wxString& field = col < (int)fields.size() ? fields[col] : EMPTY_FIELD;
+        hash1 = HashField(field, hash1);
+        hash2 = HashField(field, hash2);
+    }
+}
+
+// The same fields quoted as in a CSV line, equal only for equal values
+void AppendKey(wxString& out, const std::vector<wxString>& fields, const std::vector<int>& columns) {
+    if (columns.empty()) {
+        CSVParser::AppendLine(out, fields, ',');
+        return;
+    }
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        int col = columns[i];
+        CSVParser::AppendField(out, col < (int)fields.size() ? fields[col] : EMPTY_FIELD, ',');
+    }
+}
+
+}
+
+Deduplicator::Deduplicator(Keep keep)
+    : keep(keep),
+      duplicateCount(0),
+      rowCount(0) {
+}
+
+std::vector<size_t> Deduplicator::FindDuplicates(CSVTable& table, const std::vector<int>& columns) {
+    PROFILE_SCOPE("dedup.find");
+    std::vector<int> cols = columns;
+    if (cols.empty()) {
+        for (int col = 0; col < table.GetNumberCols(); ++col) {
+            cols.push_back(col);
+        }
+    }
+    size_t pageCount = table.GetPageCount();
+    std::vector<size_t> pageStarts(pageCount + 1, 0);
+    for (size_t page = 0; page < pageCount; ++page) {
+        pageStarts[page + 1] = pageStarts[page] + table.GetPageRows(page);
+    }
+    
+    // Hash page by page, evicted pages are parsed for just the key columns
+    std::vector<RowRecord> records(pageStarts.back());
+    WorkerPool::Get().ParallelFor(pageCount, 1, [&](size_t begin, size_t end) {
+        std::vector<std::vector<wxString>> values;
+        for (size_t page = begin; page < end; ++page) {
+            table.LoadPageColumns(page, cols, values);
+            for (size_t row = 0; row < table.GetPageRows(page); ++row) {
+                RowRecord& record = records[pageStarts[page] + row];
+                record.hash1 = SEED1;
+                record.hash2 = SEED2;
+                for (const std::vector<wxString>& column : values) {
+                    record.hash1 = HashField(column[row], record.hash1);
+                    record.hash2 = HashField(column[row], record.hash2);
+                }
+                record.row = pageStarts[page] + row;
+                record.offset = -1;
+            }
+        }
+    });
+    
+    std::vector<std::vector<RowRecord>> partitions(PARTITIONS);
+    for (const RowRecord& record : records) {
+        partitions[PartitionOf(record.hash1)].push_back(record);
+    }
+    std::vector<RowRecord>().swap(records);
+    
+    std::vector<std::vector<RowRecord>> candidates(PARTITIONS);
+    std::vector<std::vector<size_t>> groupStarts(PARTITIONS);
+    WorkerPool::Get().ParallelFor(PARTITIONS, 1, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            FindCandidates(partitions[p], candidates[p], groupStarts[p]);
+            std::vector<RowRecord>().swap(partitions[p]);
+        }
+    });
+    
+    // Key text of every candidate, read page by page
+    std::vector<uint64_t> candidateRows;
+    for (const std::vector<RowRecord>& partition : candidates) {
+        for (const RowRecord& record : partition) {
+            candidateRows.push_back(record.row);
+        }
+    }
+    std::sort(candidateRows.begin(), candidateRows.end());
+    std::vector<wxString> keys(candidateRows.size());
+    WorkerPool::Get().ParallelFor(pageCount, 1, [&](size_t begin, size_t end) {
+        std::vector<std::vector<wxString>> values;
+        for (size_t page = begin; page < end; ++page) {
+            auto first = std::lower_bound(candidateRows.begin(), candidateRows.end(), (uint64_t)pageStarts[page]);
+            auto last = std::lower_bound(first, candidateRows.end(), (uint64_t)pageStarts[page + 1]);
+            if (first == last) {
+                continue;
+            }
+            table.LoadPageColumns(page, cols, values);
+            for (auto it = first; it != last; ++it) {
+                wxString& key = keys[it - candidateRows.begin()];
+                size_t row = (size_t)(*it - pageStarts[page]);
+                for (size_t i = 0; i < values.size(); ++i) {
+                    if (i > 0) {
+                        key += ',';
+                    }
+                    CSVParser::AppendField(key, values[i][row], ',');
+                }
+            }
+        }
+    });
+    
+    std::vector<std::vector<uint64_t>> found(PARTITIONS);
+    WorkerPool::Get().ParallelFor(PARTITIONS, 1, [&](size_t begin, size_t end) {
+        std::vector<wxString> groupKeys;
+        for (size_t p = begin; p < end; ++p) {
+            for (size_t g = 0; g + 1 < groupStarts[p].size(); ++g) {
+                size_t start = groupStarts[p][g];
+                size_t count = groupStarts[p][g + 1] - start;
+                groupKeys.resize(count);
+                for (size_t i = 0; i < count; ++i) {
+                    size_t index = std::lower_bound(candidateRows.begin(), candidateRows.end(),
+                                                    candidates[p][start + i].row) - candidateRows.begin();
+                    groupKeys[i] = std::move(keys[index]);
+                }
+                ResolveGroup(&candidates[p][start], groupKeys.data(), count, found[p]);
+            }
+        }
+    });
+    
+    std::vector<size_t> duplicates;
+    for (const std::vector<uint64_t>& partition : found) {
+        duplicates.insert(duplicates.end(), partition.begin(), partition.end());
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
+bool Deduplicator::RemoveDuplicates(const CSVDiff::Input& input, const wxString& keyColumns,
+                                    const wxString& output, size_t memoryLimit, wxString& error) {
+    PROFILE_SCOPE("dedup.file");
+    duplicateCount = 0;
+    rowCount = 0;
+    
+    if (wxFileName(output).SameAs(wxFileName(input.filename))) {
+        error = "The output must be a different file than the input";
+        return false;
+    }
+    MappedFile file;
+    if (!file.Open(input.filename)) {
+        error = wxString::Format("Cannot open %s", input.filename);
+        return false;
+    }
+    file.AdviseSequential();
+    
+    // First pass: hash every row, spilling the records to one temporary file
+    // per partition once they outgrow the memory limit
+    std::vector<RowRecord> buffer;
+    size_t bufferLimit = wxMax(memoryLimit / sizeof(RowRecord), (size_t)BLOCK_ROWS);
+    std::vector<wxString> spillPaths;
+    std::vector<std::unique_ptr<wxFile>> spills;
+    bool spillFailed = false;
+    
+    auto spill = [&]() {
+        if (spills.empty()) {
+            for (size_t p = 0; p < PARTITIONS && !spillFailed; ++p) {
+                wxString path = wxFileName::CreateTempFileName("csvdedup");
+                spills.emplace_back(new wxFile());
+                spillPaths.push_back(path);
+                spillFailed = path.IsEmpty() || !spills.back()->Open(path, wxFile::write);
+            }
+        }
+        // Sorting by hash puts each partition's records in one run
+        std::sort(buffer.begin(), buffer.end(), [](const RowRecord& a, const RowRecord& b) {
+            return a.hash1 < b.hash1;
+        });
+        for (size_t i = 0; i < buffer.size() && !spillFailed;) {
+            size_t partition = PartitionOf(buffer[i].hash1);
+            size_t j = i;
+            while (j < buffer.size() && PartitionOf(buffer[j].hash1) == partition) {
+                ++j;
+            }
+            size_t bytes = (j - i) * sizeof(RowRecord);
+            spillFailed = spills[partition]->Write(&buffer[i], bytes) != bytes;
+            i = j;
+        }
+        buffer.clear();
+    };
+    
+    std::vector<int> columns;
+    std::vector<wxString> header;
+    bool headerPending = input.hasHeader;
+    bool keysResolved = false;
+    wxString keyError;
+    CSVParser parser;
+    Encoding encoding = input.encoding;
+    bool parsed = parser.ReadFile(file, encoding, input.separator,
+                                  [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        if (rows.empty() || !keyError.IsEmpty() || spillFailed) {
+            return;
+        }
+        size_t first = 0;
+        if (headerPending) {
+            header = rows[0];
+            headerPending = false;
+            first = 1;
+        }
+        if (!keysResolved) {
+            keysResolved = true;
+            if (!keyColumns.IsEmpty() && !CSVDiff::ResolveKeyColumns(keyColumns, header, columns, keyError)) {
+                return;
+            }
+        }
+        
+        size_t count = rows.size() - first;
+        size_t base = buffer.size();
+        buffer.resize(base + count);
+        WorkerPool::Get().ParallelFor(count, 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                RowRecord& record = buffer[base + i];
+                HashKey(rows[first + i], columns, record.hash1, record.hash2);
+                record.row = rowCount + i;
+                record.offset = offsets[first + i];
+            }
+        });
+        rowCount += count;
+        if (buffer.size() >= bufferLimit) {
+            spill();
+        }
+    });
+    
+    if (!spills.empty() && !buffer.empty()) {
+        spill();
+    }
+    spills.clear();
+    auto removeSpills = [&spillPaths]() {
+        for (const wxString& path : spillPaths) {
+            if (!path.IsEmpty()) {
+                wxRemoveFile(path);
+            }
+        }
+    };
+    if (!parsed) {
+        removeSpills();
+        error = wxString::Format("Failed to read %s", input.filename);
+        return false;
+    }
+    if (!keyError.IsEmpty()) {
+        removeSpills();
+        error = keyError;
+        return false;
+    }
+    if (spillFailed) {
+        removeSpills();
+        error = "Cannot write temporary files";
+        return false;
+    }
+    
+    // Second pass: candidates are verified one partition at a time by
+    // parsing their rows again. One bit per row marks the rows to drop.
+    std::vector<bool> dropped(rowCount, false);
+    size_t dataOffset = CSVParser::GetDataOffset(file, encoding);
+    auto verify = [&](std::vector<RowRecord>& records) {
+        std::vector<RowRecord> candidates;
+        std::vector<size_t> groupStarts;
+        FindCandidates(records, candidates, groupStarts);
+        std::vector<RowRecord>().swap(records);
+        
+        std::vector<wxString> keys(candidates.size());
+        WorkerPool::Get().ParallelFor(candidates.size(), 64, [&](size_t begin, size_t end) {
+            std::vector<std::vector<wxString>> parsedRows;
+            for (size_t i = begin; i < end; ++i) {
+                size_t offset = (size_t)candidates[i].offset;
+                parsedRows.clear();
+                if (CSVParser::ParseRows(file, offset, encoding, input.separator, 1,
+                                         offset == dataOffset, parsedRows) == 1) {
+                    AppendKey(keys[i], parsedRows[0], columns);
+                } else {
+                    // Unreadable now, so never taken for a copy of another row
+                    keys[i] = wxString::Format("\n%llu", (unsigned long long)candidates[i].row);
+                }
+            }
+        });
+        
+        std::vector<uint64_t> found;
+        for (size_t g = 0; g + 1 < groupStarts.size(); ++g) {
+            ResolveGroup(&candidates[groupStarts[g]], &keys[groupStarts[g]],
+                         groupStarts[g + 1] - groupStarts[g], found);
+        }
+        for (uint64_t row : found) {
+            dropped[row] = true;
+        }
+        duplicateCount += found.size();
+    };
+    
+    if (spillPaths.empty()) {
+        verify(buffer);
+    }
+    for (const wxString& path : spillPaths) {
+        wxFile spillFile;
+        std::vector<RowRecord> records;
+        if (spillFile.Open(path, wxFile::read)) {
+            records.resize((size_t)spillFile.Length() / sizeof(RowRecord));
+            size_t bytes = records.size() * sizeof(RowRecord);
+            spillFailed = spillFailed || (size_t)spillFile.Read(records.data(), bytes) != bytes;
+        } else {
+            spillFailed = true;
+        }
+        spillFile.Close();
+        wxRemoveFile(path);
+        if (!spillFailed) {
+            verify(records);
+        }
+    }
+    if (spillFailed) {
+        error = "Cannot read temporary files";
+        return false;
+    }
+    
+    // Third pass: write the header and every row that is kept
+    CSVWriter writer;
+    if (!writer.Open(output, encoding)) {
+        error = wxString::Format("Cannot write %s", output);
+        return false;
+    }
+    headerPending = input.hasHeader;
+    size_t row = 0;
+    bool writeFailed = false;
+    parsed = parser.ReadFile(file, encoding, input.separator,
+                             [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>& offsets) {
+        wxString text;
+        for (const std::vector<wxString>& fields : rows) {
+            if (headerPending) {
+                headerPending = false;
+            } else if (dropped[row++]) {
+                continue;
+            }
+            CSVParser::AppendLine(text, fields, input.separator);
+            text += wxT("\r\n");
+        }
+        writeFailed = writeFailed || !writer.Write(text);
+    });
+    if (!parsed || writeFailed || !writer.Close()) {
+        error = wxString::Format("Cannot write %s", output);
+        return false;
+    }
+    return true;
+}
+
+void Deduplicator::FindCandidates(std::vector<RowRecord>& records, std::vector<RowRecord>& candidates,
+                                  std::vector<size_t>& groupStarts) {
+    std::sort(records.begin(), records.end(), [](const RowRecord& a, const RowRecord& b) {
+        if (a.hash1 != b.hash1) {
+            return a.hash1 < b.hash1;
+        }
+        if (a.hash2 != b.hash2) {
+            return a.hash2 < b.hash2;
+        }
+        return a.row < b.row;
+    });
+    
+    candidates.clear();
+    groupStarts.clear();
+    for (size_t i = 0; i < records.size();) {
+        size_t j = i + 1;
+        while (j < records.size() && records[j].hash1 == records[i].hash1 && records[j].hash2 == records[i].hash2) {
+            ++j;
+        }
+        if (j - i > 1) {
+            groupStarts.push_back(candidates.size());
+            candidates.insert(candidates.end(), records.begin() + i, records.begin() + j);
+        }
+        i = j;
+    }
+    groupStarts.push_back(candidates.size());
+}
+
+void Deduplicator::ResolveGroup(const RowRecord* rows, const wxString* keys, size_t count,
+                                std::vector<uint64_t>& duplicates) const {
+    // Nearly always every key is the same, they differ only on a true collision
+    bool same = std::all_of(keys + 1, keys + count, [keys](const wxString& key) {
+        return key == keys[0];
+    });
+    if (same) {
+        size_t kept = keep == Keep::FIRST ? 0 : count - 1;
+        for (size_t i = 0; i < count; ++i) {
+            if (i != kept) {
+                duplicates.push_back(rows[i].row);
+            }
+        }
+        return;
+    }
+    
+    std::map<wxString, size_t> kept;
+    for (size_t i = 0; i < count; ++i) {
+        auto it = kept.find(keys[i]);
+        if (it == kept.end()) {
+            kept[keys[i]] = i;
+        } else if (keep == Keep::FIRST) {
+            duplicates.push_back(rows[i].row);
+        } else {
+            duplicates.push_back(rows[it->second].row);
+            it->second = i;
+        }
+    }
+}
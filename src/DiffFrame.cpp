@@ -0,0 +1,218 @@
+#include "DiffFrame.h"
+#include <wx/filename.h>
+
+DiffTable::DiffTable(const CSVDiff& diff, CSVDiff::Side side)
+    : diff(diff),
+      side(side) {
+    addedAttr = new wxGridCellAttr();
+    addedAttr->SetBackgroundColour(wxColour(204, 255, 204));
+    removedAttr = new wxGridCellAttr();
+    removedAttr->SetBackgroundColour(wxColour(255, 204, 204));
+    changedAttr = new wxGridCellAttr();
+    changedAttr->SetBackgroundColour(wxColour(255, 240, 160));
+    missingAttr = new wxGridCellAttr();
+    missingAttr->SetBackgroundColour(wxColour(235, 235, 235));
+}
+
+DiffTable::~DiffTable() {
+    addedAttr->DecRef();
+    removedAttr->DecRef();
+    changedAttr->DecRef();
+    missingAttr->DecRef();
+}
+
+int DiffTable::GetNumberRows() {
+    return (int)diff.GetEntries().size();
+}
+
+int DiffTable::GetNumberCols() {
+    return (int)wxMax(diff.GetColumnCount(CSVDiff::LEFT), diff.GetColumnCount(CSVDiff::RIGHT));
+}
+
+wxString DiffTable::GetValue(int row, int col) {
+    long long sourceRow = GetSourceRow(row, side);
+    if (sourceRow < 0) {
+        return wxEmptyString;
+    }
+    const std::vector<wxString>& fields = FetchRow(side, sourceRow);
+    return col >= 0 && col < (int)fields.size() ? fields[col] : wxString();
+}
+
+void DiffTable::SetValue(int row, int col, const wxString& value) {
+    // Read only
+}
+
+bool DiffTable::IsEmptyCell(int row, int col) {
+    return GetValue(row, col).IsEmpty();
+}
+
+wxString DiffTable::GetRowLabelValue(int row) {
+    // Original line numbers, counting the header line
+    long long sourceRow = GetSourceRow(row, side);
+    if (sourceRow < 0) {
+        return wxEmptyString;
+    }
+    int headerLines = diff.GetHeader(side).empty() ? 0 : 1;
+    return wxString::Format("%lld", sourceRow + 1 + headerLines);
+}
+
+wxString DiffTable::GetColLabelValue(int col) {
+    const std::vector<wxString>& header = diff.GetHeader(side);
+    if (col >= 0 && col < (int)header.size() && !header[col].IsEmpty()) {
+        return header[col];
+    }
+    return wxGridTableBase::GetColLabelValue(col);
+}
+
+wxGridCellAttr* DiffTable::GetAttr(int row, int col, wxGridCellAttr::wxAttrKind kind) {
+    if (row < 0 || row >= (int)diff.GetEntries().size()) {
+        return nullptr;
+    }
+    
+    wxGridCellAttr* attr = nullptr;
+    const CSVDiff::Entry& entry = diff.GetEntries()[row];
+    if (GetSourceRow(row, side) < 0) {
+        attr = missingAttr;
+    } else if (entry.change == CSVDiff::Change::Added) {
+        attr = addedAttr;
+    } else if (entry.change == CSVDiff::Change::Removed) {
+        attr = removedAttr;
+    } else {
+        // Modified rows only highlight the cells that differ
+        const std::vector<wxString>& left = FetchRow(CSVDiff::LEFT, entry.leftRow);
+        const std::vector<wxString>& right = FetchRow(CSVDiff::RIGHT, entry.rightRow);
+        const wxString& a = col < (int)left.size() ? left[col] : wxEmptyString;
+        const wxString& b = col < (int)right.size() ? right[col] : wxEmptyString;
+        if (a != b) {
+            attr = changedAttr;
+        }
+    }
+    
+    if (attr) {
+        attr->IncRef();
+    }
+    return attr;
+}
+
+const std::vector<wxString>& DiffTable::FetchRow(CSVDiff::Side fromSide, long long row) {
+    auto& rows = cache[fromSide];
+    auto it = rows.find(row);
+    if (it != rows.end()) {
+        return it->second;
+    }
+    
+    // Keep only the rows around the visible area
+    if (rows.size() >= CACHE_ROWS) {
+        rows.clear();
+    }
+    std::vector<wxString>& fields = rows[row];
+    diff.GetRow(fromSide, row, fields);
+    return fields;
+}
+
+long long DiffTable::GetSourceRow(int row, CSVDiff::Side fromSide) const {
+    const CSVDiff::Entry& entry = diff.GetEntries()[row];
+    return fromSide == CSVDiff::LEFT ? entry.leftRow : entry.rightRow;
+}
+
+wxBEGIN_EVENT_TABLE(DiffFrame, wxFrame)
+    EVT_GRID_SELECT_CELL(DiffFrame::OnSelectCell)
+wxEND_EVENT_TABLE()
+
+DiffFrame::DiffFrame(wxWindow* parent, std::unique_ptr<CSVDiff> diffResult, Language language, int fontSize)
+    : wxFrame(parent, wxID_ANY, Translate("dialog_compare_title", language), wxDefaultPosition, wxSize(1100, 650)),
+      diff(std::move(diffResult)),
+      syncing(false) {
+    
+    wxPanel* panel = new wxPanel(this);
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    wxString summary = wxString::Format(Translate("compare_summary", language),
+                                        (int)diff->GetCount(CSVDiff::Change::Added),
+                                        (int)diff->GetCount(CSVDiff::Change::Removed),
+                                        (int)diff->GetCount(CSVDiff::Change::Modified));
+    if (diff->GetEntries().empty()) {
+        summary = Translate("compare_identical", language);
+    }
+    mainSizer->Add(new wxStaticText(panel, wxID_ANY, summary), 0, wxALL, 8);
+    
+    // Original on the left, changed file on the right
+    wxBoxSizer* gridSizer = new wxBoxSizer(wxHORIZONTAL);
+    for (int side = CSVDiff::LEFT; side <= CSVDiff::RIGHT; ++side) {
+        wxBoxSizer* sideSizer = new wxBoxSizer(wxVERTICAL);
+        wxString name = wxFileName(diff->GetInput((CSVDiff::Side)side).filename).GetFullName();
+        sideSizer->Add(new wxStaticText(panel, wxID_ANY, name), 0, wxBOTTOM, 4);
+        wxGrid* grid = CreateSideGrid(panel, (CSVDiff::Side)side, fontSize);
+        sideSizer->Add(grid, 1, wxEXPAND);
+        gridSizer->Add(sideSizer, 1, wxEXPAND | wxLEFT | wxRIGHT, 4);
+        if (side == CSVDiff::LEFT) {
+            leftGrid = grid;
+        } else {
+            rightGrid = grid;
+        }
+    }
+    mainSizer->Add(gridSizer, 1, wxEXPAND | wxBOTTOM, 4);
+    
+    panel->SetSizer(mainSizer);
+    Centre();
+}
+
+wxGrid* DiffFrame::CreateSideGrid(wxWindow* parent, CSVDiff::Side side, int fontSize) {
+    wxGrid* grid = new wxGrid(parent, wxID_ANY);
+    grid->SetTable(new DiffTable(*diff, side), true);
+    grid->EnableEditing(false);
+    grid->EnableDragRowSize(false);
+    grid->SetDefaultCellOverflow(false);
+    
+    wxFont font = grid->GetDefaultCellFont();
+    font.SetPointSize(fontSize);
+    grid->SetDefaultCellFont(font);
+    wxFont labelFont = grid->GetLabelFont();
+    labelFont.SetPointSize(fontSize);
+    grid->SetLabelFont(labelFont);
+    
+    int rowHeight = fontSize * 2 + 8;
+    grid->SetDefaultRowSize(rowHeight, true);
+    grid->SetColLabelSize(rowHeight);
+    grid->SetDefaultColSize((fontSize * 60) / 8, true);
+    
+    // Scrolling one side scrolls the other
+    const wxEventType scrollEvents[] = {
+        wxEVT_SCROLLWIN_TOP, wxEVT_SCROLLWIN_BOTTOM, wxEVT_SCROLLWIN_LINEUP, wxEVT_SCROLLWIN_LINEDOWN,
+        wxEVT_SCROLLWIN_PAGEUP, wxEVT_SCROLLWIN_PAGEDOWN, wxEVT_SCROLLWIN_THUMBTRACK, wxEVT_SCROLLWIN_THUMBRELEASE
+    };
+    for (wxEventType type : scrollEvents) {
+        grid->Bind(type, &DiffFrame::OnGridScroll, this);
+    }
+    return grid;
+}
+
+void DiffFrame::OnGridScroll(wxScrollWinEvent& event) {
+    event.Skip();
+    // The view start only changes after the grid handled the event
+    wxGrid* source = static_cast<wxGrid*>(event.GetEventObject());
+    CallAfter([this, source]() { SyncScroll(source); });
+}
+
+void DiffFrame::SyncScroll(wxGrid* source) {
+    wxGrid* target = source == leftGrid ? rightGrid : leftGrid;
+    int x, y;
+    source->GetViewStart(&x, &y);
+    target->Scroll(x, y);
+}
+
+void DiffFrame::OnSelectCell(wxGridEvent& event) {
+    event.Skip();
+    if (syncing) {
+        return;
+    }
+    
+    // Keep the cursor on the same diff row on both sides
+    syncing = true;
+    wxGrid* target = event.GetEventObject() == leftGrid ? rightGrid : leftGrid;
+    if (event.GetRow() >= 0 && event.GetCol() >= 0) {
+        target->SetGridCursor(event.GetRow(), event.GetCol());
+        target->MakeCellVisible(event.GetRow(), event.GetCol());
+    }
+    syncing = false;
+}
@@ -0,0 +1,76 @@
+#include "DuplicatesDialog.h"
+
+wxBEGIN_EVENT_TABLE(DuplicatesDialog, wxDialog)
+    EVT_BUTTON(wxID_OK, DuplicatesDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+DuplicatesDialog::DuplicatesDialog(wxWindow* parent, Language language, const std::vector<wxString>& columnNames)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_duplicates_title", language), wxDefaultPosition, wxSize(420, 480)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    // Columns to compare, all of them by default
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("duplicates_columns", language)), 0, wxALL, 5);
+    wxArrayString names;
+    for (const wxString& name : columnNames) {
+        names.Add(name);
+    }
+    columnList = new wxCheckListBox(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, names);
+    for (unsigned int i = 0; i < names.GetCount(); ++i) {
+        columnList->Check(i);
+    }
+    mainSizer->Add(columnList, 1, wxALL | wxEXPAND, 5);
+    
+    // Copy that stays, in the order of Deduplicator::Keep
+    wxArrayString keeps;
+    keeps.Add(Translate("duplicates_keep_first", language));
+    keeps.Add(Translate("duplicates_keep_last", language));
+    keepRadio = new wxRadioBox(this, wxID_ANY, Translate("duplicates_keep", language), wxDefaultPosition, wxDefaultSize,
+                               keeps, 1, wxRA_SPECIFY_COLS);
+    mainSizer->Add(keepRadio, 0, wxALL | wxEXPAND, 5);
+    
+    wxArrayString actions;
+    actions.Add(Translate("duplicates_select", language));
+    actions.Add(Translate("duplicates_remove", language));
+    actionRadio = new wxRadioBox(this, wxID_ANY, Translate("duplicates_action", language), wxDefaultPosition, wxDefaultSize,
+                                 actions, 1, wxRA_SPECIFY_COLS);
+    mainSizer->Add(actionRadio, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void DuplicatesDialog::OnOK(wxCommandEvent& event) {
+    wxArrayInt checked;
+    if (columnList->GetCheckedItems(checked) == 0) {
+        wxMessageBox(Translate("error_duplicates_columns", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+std::vector<int> DuplicatesDialog::GetColumns() const {
+    wxArrayInt checked;
+    columnList->GetCheckedItems(checked);
+    std::vector<int> columns;
+    if (checked.GetCount() == columnList->GetCount()) {
+        return columns;
+    }
+    for (size_t i = 0; i < checked.GetCount(); ++i) {
+        columns.push_back(checked[i]);
+    }
+    return columns;
+}
+
+Deduplicator::Keep DuplicatesDialog::GetKeep() const {
+    return (Deduplicator::Keep)keepRadio->GetSelection();
+}
+
+bool DuplicatesDialog::GetRemove() const {
+    return actionRadio->GetSelection() == 1;
+}
@@ -0,0 +1,470 @@
+#include "EditJournal.h"
+#include <wx/filename.h>
+#include <wx/stdpaths.h>
+#include <wx/dir.h>
+#include <chrono>
+
+#ifdef __WXMSW__
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char JOURNAL_MAGIC[8] = {'C', 'S', 'V', 'P', 'P', 'J', 'N', 'L'};
+// Version 2 added the loaded column selection to the header
+const unsigned int JOURNAL_VERSION = 2;
+
+// FNV-1a, used as a per-record checksum to detect a torn tail after a crash
+unsigned int Checksum(const unsigned char* data, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void PutU32(std::vector<unsigned char>& out, unsigned int value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((unsigned char)(value >> (i * 8)));
+    }
+}
+
+void PutI64(std::vector<unsigned char>& out, wxLongLong_t value) {
+    unsigned long long bits = (unsigned long long)value;
+    for (int i = 0; i < 8; ++i) {
+        out.push_back((unsigned char)(bits >> (i * 8)));
+    }
+}
+
+void PutString(std::vector<unsigned char>& out, const wxString& value) {
+    const wxScopedCharBuffer utf8 = value.utf8_str();
+    PutU32(out, (unsigned int)utf8.length());
+    out.insert(out.end(), utf8.data(), utf8.data() + utf8.length());
+}
+
+// Bounds-checked little-endian reader over a journal file image
+class ByteReader {
+public:
+    ByteReader(const std::vector<unsigned char>& data) : data(data), pos(0) {}
+
+    size_t Position() const { return pos; }
+    bool AtEnd() const { return pos >= data.size(); }
+
+    bool GetU8(unsigned char& value) {
+        if (pos + 1 > data.size()) return false;
+        value = data[pos++];
+        return true;
+    }
+
+    bool GetU32(unsigned int& value) {
+        if (pos + 4 > data.size()) return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= (unsigned int)data[pos++] << (i * 8);
+        }
+        return true;
+    }
+
+    bool GetI64(wxLongLong_t& value) {
+        if (pos + 8 > data.size()) return false;
+        unsigned long long bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= (unsigned long long)data[pos++] << (i * 8);
+        }
+        value = (wxLongLong_t)bits;
+        return true;
+    }
+
+    bool GetString(wxString& value) {
+        unsigned int length;
+        if (!GetU32(length) || pos + length > data.size()) return false;
+        value = wxString::FromUTF8((const char*)data.data() + pos, length);
+        pos += length;
+        return true;
+    }
+
+    unsigned int ChecksumFrom(size_t start) const {
+        return Checksum(data.data() + start, pos - start);
+    }
+
+private:
+    const std::vector<unsigned char>& data;
+    size_t pos;
+};
+
+} // namespace
+
+EditJournal::EditJournal()
+    : active(false), fileCreated(false), appendedBytes(0), writtenBytes(0),
+      flushRequested(false), stopping(false), failed(false), failureReported(false) {
+}
+
+EditJournal::~EditJournal() {
+    Stop(false);
+}
+
+wxString EditJournal::GetJournalDir() {
+    return wxStandardPaths::Get().GetUserLocalDataDir() + wxFileName::GetPathSeparator() + "journal";
+}
+
+wxString EditJournal::MakeJournalPath(const wxString& sourceFile) {
+    // Name is unique per edit session; the source path lives in the header
+    const wxScopedCharBuffer utf8 = sourceFile.Lower().utf8_str();
+    unsigned int hash = Checksum((const unsigned char*)utf8.data(), utf8.length());
+    wxString name = wxString::Format("%013lld-%lu-%08x.journal",
+                                     (long long)wxGetLocalTimeMillis().GetValue(),
+                                     (unsigned long)wxGetProcessId(), hash);
+    return GetJournalDir() + wxFileName::GetPathSeparator() + name;
+}
+
+JournalHeader EditJournal::MakeHeader(const wxString& sourceFile, Encoding encoding,
+                                      wxChar separator, bool hasHeader) {
+    JournalHeader header;
+    header.sourceFile = sourceFile;
+    header.sourceSize = 0;
+    header.sourceModified = 0;
+    header.encoding = encoding;
+    header.separator = separator;
+    header.hasHeader = hasHeader;
+    header.initialRows = 0;
+    header.initialCols = 0;
+
+    if (!sourceFile.IsEmpty() && wxFileExists(sourceFile)) {
+        wxFileName fn(sourceFile);
+        header.sourceSize = (wxLongLong_t)fn.GetSize().GetValue();
+        header.sourceModified = (wxLongLong_t)fn.GetModificationTime().GetTicks();
+    }
+    return header;
+}
+
+void EditJournal::Start(const JournalHeader& newHeader) {
+    Stop(true);
+
+    header = newHeader;
+    path = MakeJournalPath(header.sourceFile);
+    fileCreated = false;
+    active = true;
+    stopping = false;
+    flushRequested = false;
+    failed = false;
+    failureReported = false;
+    appendedBytes = 0;
+    writtenBytes = 0;
+    writer = std::thread(&EditJournal::WriterLoop, this);
+}
+
+bool EditJournal::Resume(const wxString& existingPath, const JournalHeader& existingHeader,
+                         wxFileOffset validLength) {
+    Stop(true);
+
+    // Records appended after a torn one would never be replayed
+    if (!file.Open(existingPath, wxFile::read_write)) {
+        return false;
+    }
+#ifdef __WXMSW__
+    bool truncated = _chsize_s(file.fd(), validLength) == 0;
+#else
+    bool truncated = ftruncate(file.fd(), (off_t)validLength) == 0;
+#endif
+    if (!truncated || file.SeekEnd() == wxInvalidOffset) {
+        file.Close();
+        return false;
+    }
+
+    header = existingHeader;
+    path = existingPath;
+    fileCreated = true;
+    active = true;
+    stopping = false;
+    flushRequested = false;
+    failed = false;
+    failureReported = false;
+    appendedBytes = 0;
+    writtenBytes = 0;
+    writer = std::thread(&EditJournal::WriterLoop, this);
+    return true;
+}
+
+void EditJournal::Stop(bool discard) {
+    if (!active) {
+        return;
+    }
+
+    StopWriter();
+
+    if (file.IsOpened()) {
+        file.Close();
+    }
+    if (discard && fileCreated && wxFileExists(path)) {
+        wxRemoveFile(path);
+    }
+
+    active = false;
+    fileCreated = false;
+    path.Clear();
+}
+
+void EditJournal::StopWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void EditJournal::Flush() {
+    if (!active) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned long long target = appendedBytes;
+    flushRequested = true;
+    wakeup.notify_one();
+    flushed.wait(lock, [this, target] { return writtenBytes >= target || stopping || failed; });
+}
+
+bool EditJournal::TakeFailure() {
+    if (!failed || failureReported) {
+        return false;
+    }
+    failureReported = true;
+    return true;
+}
+
+void EditJournal::Append(JournalOp op, int a, int b, const wxString& value) {
+    if (!active) {
+        return;
+    }
+
+    // Encode outside the lock so the writer thread is never blocked on it
+    std::vector<unsigned char> record;
+    record.reserve(17 + value.length());
+    record.push_back((unsigned char)op);
+    PutU32(record, (unsigned int)a);
+    PutU32(record, (unsigned int)b);
+    PutString(record, value);
+    PutU32(record, Checksum(record.data(), record.size()));
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.insert(pending.end(), record.begin(), record.end());
+        appendedBytes += record.size();
+        wake = pending.size() >= FLUSH_THRESHOLD;
+    }
+    if (wake) {
+        wakeup.notify_one();
+    }
+}
+
+bool EditJournal::CreateFile() {
+    wxString dir = GetJournalDir();
+    if (!wxDirExists(dir) && !wxFileName::Mkdir(dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+        return false;
+    }
+    if (!file.Create(path, true)) {
+        return false;
+    }
+
+    std::vector<unsigned char> data(JOURNAL_MAGIC, JOURNAL_MAGIC + sizeof(JOURNAL_MAGIC));
+    PutU32(data, JOURNAL_VERSION);
+    PutString(data, header.sourceFile);
+    PutI64(data, header.sourceSize);
+    PutI64(data, header.sourceModified);
+    data.push_back((unsigned char)header.encoding);
+    PutU32(data, (unsigned int)header.separator);
+    data.push_back(header.hasHeader ? 1 : 0);
+    PutU32(data, (unsigned int)header.initialRows);
+    PutU32(data, (unsigned int)header.initialCols);
+    PutU32(data, (unsigned int)header.columns.size());
+    for (int col : header.columns) {
+        PutU32(data, (unsigned int)col);
+    }
+    PutU32(data, Checksum(data.data(), data.size()));
+
+    fileCreated = file.Write(data.data(), data.size()) == data.size();
+    return fileCreated;
+}
+
+void EditJournal::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeup.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] {
+            return stopping || flushRequested || pending.size() >= FLUSH_THRESHOLD;
+        });
+        flushRequested = false;
+
+        if (!pending.empty()) {
+            std::vector<unsigned char> batch;
+            batch.swap(pending);
+            unsigned long long target = appendedBytes;
+            lock.unlock();
+
+            // One write and one fsync per batch keeps the cost off the UI thread.
+            // After a failure the rest is dropped, the journal already has a gap.
+            bool written = !failed && (fileCreated || CreateFile()) &&
+                           file.Write(batch.data(), batch.size()) == batch.size() && file.Flush();
+
+            lock.lock();
+            if (written) {
+                writtenBytes = target;
+            } else {
+                failed = true;
+            }
+            flushed.notify_all();
+        }
+
+        if (stopping && pending.empty()) {
+            break;
+        }
+    }
+    flushed.notify_all();
+}
+
+void EditJournal::RecordSetCell(int row, int col, const wxString& value) {
+    Append(JournalOp::SetCell, row, col, value);
+}
+
+void EditJournal::RecordInsertRows(int pos, int count) {
+    Append(JournalOp::InsertRows, pos, count, wxEmptyString);
+}
+
+void EditJournal::RecordDeleteRows(int pos, int count) {
+    Append(JournalOp::DeleteRows, pos, count, wxEmptyString);
+}
+
+void EditJournal::RecordInsertCols(int pos, int count) {
+    Append(JournalOp::InsertCols, pos, count, wxEmptyString);
+}
+
+void EditJournal::RecordDeleteCols(int pos, int count) {
+    Append(JournalOp::DeleteCols, pos, count, wxEmptyString);
+}
+
+void EditJournal::RecordSetHeader(int col, const wxString& value, bool markHeaderRow) {
+    Append(JournalOp::SetHeader, col, markHeaderRow ? 1 : 0, value);
+}
+
+void EditJournal::RecordResize(int rows, int cols) {
+    Append(JournalOp::Resize, rows, cols, wxEmptyString);
+}
+
+void EditJournal::RecordSetFormat(Encoding encoding, wxChar separator) {
+    Append(JournalOp::SetFormat, (int)encoding, (int)separator, wxEmptyString);
+}
+
+void EditJournal::RecordComputeColumn(int col, const wxString& expression) {
+    Append(JournalOp::ComputeColumn, col, 0, expression);
+}
+
+void EditJournal::RecordTransformColumn(int col, int parts, const wxString& transform) {
+    Append(JournalOp::TransformColumn, col, parts, transform);
+}
+
+wxArrayString EditJournal::FindPendingJournals() {
+    wxArrayString files;
+    wxString dir = GetJournalDir();
+    if (wxDirExists(dir)) {
+        wxDir::GetAllFiles(dir, &files, "*.journal", wxDIR_FILES);
+    }
+    // Newest first: names start with the session start time
+    files.Sort(true);
+    return files;
+}
+
+bool EditJournal::ReadJournal(const wxString& journalPath, JournalHeader& header,
+                              std::vector<JournalEntry>& entries, wxFileOffset& validLength) {
+    entries.clear();
+    validLength = 0;
+
+    wxFile in(journalPath);
+    if (!in.IsOpened()) {
+        return false;
+    }
+    wxFileOffset length = in.Length();
+    if (length < (wxFileOffset)sizeof(JOURNAL_MAGIC)) {
+        return false;
+    }
+    std::vector<unsigned char> data((size_t)length);
+    if (in.Read(data.data(), data.size()) != (ssize_t)data.size()) {
+        return false;
+    }
+    if (memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+        return false;
+    }
+
+    ByteReader reader(data);
+    unsigned char byte;
+    for (size_t i = 0; i < sizeof(JOURNAL_MAGIC); ++i) {
+        reader.GetU8(byte);
+    }
+
+    unsigned int version, separator, initialRows, initialCols, checksum;
+    unsigned char encoding, hasHeader;
+    if (!reader.GetU32(version) || version < 1 || version > JOURNAL_VERSION ||
+        !reader.GetString(header.sourceFile) ||
+        !reader.GetI64(header.sourceSize) ||
+        !reader.GetI64(header.sourceModified) ||
+        !reader.GetU8(encoding) ||
+        !reader.GetU32(separator) ||
+        !reader.GetU8(hasHeader) ||
+        !reader.GetU32(initialRows) ||
+        !reader.GetU32(initialCols)) {
+        return false;
+    }
+    header.columns.clear();
+    unsigned int columnCount = 0;
+    if (version >= 2 && !reader.GetU32(columnCount)) {
+        return false;
+    }
+    for (unsigned int i = 0; i < columnCount; ++i) {
+        unsigned int col;
+        if (!reader.GetU32(col)) {
+            return false;
+        }
+        header.columns.push_back((int)col);
+    }
+    unsigned int expected = reader.ChecksumFrom(0);
+    if (!reader.GetU32(checksum) || checksum != expected) {
+        return false;
+    }
+    header.encoding = (Encoding)encoding;
+    header.separator = (wxChar)separator;
+    header.hasHeader = hasHeader != 0;
+    header.initialRows = (int)initialRows;
+    header.initialCols = (int)initialCols;
+    validLength = (wxFileOffset)reader.Position();
+
+    // Replay stops at the first torn or corrupt record
+    while (!reader.AtEnd()) {
+        size_t start = reader.Position();
+        unsigned char op;
+        unsigned int a, b;
+        JournalEntry entry;
+        if (!reader.GetU8(op) || !reader.GetU32(a) || !reader.GetU32(b) ||
+            !reader.GetString(entry.value)) {
+            break;
+        }
+        expected = reader.ChecksumFrom(start);
+        if (!reader.GetU32(checksum) || checksum != expected) {
+            break;
+        }
+        if (op < (unsigned char)JournalOp::SetCell || op > (unsigned char)JournalOp::TransformColumn) {
+            break;
+        }
+        entry.op = (JournalOp)op;
+        entry.a = (int)a;
+        entry.b = (int)b;
+        entries.push_back(entry);
+        validLength = (wxFileOffset)reader.Position();
+    }
+
+    return true;
+}
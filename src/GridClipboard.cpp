@@ -0,0 +1,62 @@
+#include "GridClipboard.h"
+#include "CSVParser.h"
+#include "Profiler.h"
+
+ClipboardCopy::ClipboardCopy(CSVTable* table, int top, int left, int bottom, int right)
+    : table(table),
+      top(top),
+      left(left),
+      bottom(bottom),
+      right(right),
+      rendered(false) {
+}
+
+const wxString& ClipboardCopy::GetText() {
+    if (!rendered) {
+        Render();
+    }
+    return text;
+}
+
+void ClipboardCopy::Detach() {
+    if (!rendered) {
+        Render();
+    }
+    table = nullptr;
+}
+
+void ClipboardCopy::Render() {
+    PROFILE_SCOPE("clipboard.render");
+    rendered = true;
+    text.clear();
+    if (!table) {
+        return;
+    }
+    
+    // Size the buffer once from a sample row so large copies do not reallocate
+    size_t sampleLength = 0;
+    for (int col = left; col <= right; ++col) {
+        sampleLength += table->GetValue(top, col).length() + 1;
+    }
+    text.reserve((sampleLength + 1) * GetRowCount());
+    
+    // Tab separated, quoted like CSV, which spreadsheets paste as cells
+    for (int row = top; row <= bottom; ++row) {
+        for (int col = left; col <= right; ++col) {
+            if (col > left) {
+                text += '\t';
+            }
+            CSVParser::AppendField(text, table->GetValue(row, col), '\t');
+        }
+        text += "\r\n";
+    }
+}
+
+size_t ClipboardTextObject::GetTextLength() const {
+    // Includes the terminating null
+    return copy->GetText().length() + 1;
+}
+
+wxString ClipboardTextObject::GetText() const {
+    return copy->GetText();
+}
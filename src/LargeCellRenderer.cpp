@@ -0,0 +1,56 @@
+#include "LargeCellRenderer.h"
+#include "CSVTable.h"
+
+CSVTable* LargeCellRenderer::GetLargeCellTable(wxGrid& grid, int row, int col) {
+    CSVTable* table = dynamic_cast<CSVTable*>(grid.GetTable());
+    if (!table || table->GetValueLength(row, col) <= CSVTable::LARGE_CELL_CHARS) {
+        return nullptr;
+    }
+    return table;
+}
+
+wxString LargeCellRenderer::GetPreview(CSVTable& table, int row, int col, size_t maxChars) {
+    wxString text;
+    table.CopyPrefix(row, col, maxChars, text);
+    for (wxString::iterator it = text.begin(); it != text.end(); ++it) {
+        if (*it == '\n' || *it == '\r' || *it == '\t') {
+            *it = ' ';
+        }
+    }
+    return text;
+}
+
+void LargeCellRenderer::Draw(wxGrid& grid, wxGridCellAttr& attr, wxDC& dc, const wxRect& rect,
+                             int row, int col, bool isSelected) {
+    CSVTable* table = GetLargeCellTable(grid, row, col);
+    if (!table) {
+        wxGridCellStringRenderer::Draw(grid, attr, dc, rect, row, col, isSelected);
+        return;
+    }
+    
+    // Background as for any cell, then only about as much text as fits. Even
+    // a line of the narrowest characters, a third of the average width, ends
+    // within the prefix, which is cut at the cell's edge with an ellipsis.
+    wxGridCellRenderer::Draw(grid, attr, dc, rect, row, col, isSelected);
+    SetTextColoursAndFont(grid, attr, dc, isSelected);
+    size_t chars = wxMin(DRAW_CHARS, (size_t)(rect.width * 3 / wxMax(dc.GetCharWidth(), 1) + 1));
+    wxString text = wxControl::Ellipsize(GetPreview(*table, row, col, chars), dc, wxELLIPSIZE_END,
+                                         wxMax(rect.width - 4, 0));
+    
+    wxRect textRect = rect;
+    textRect.Inflate(-1);
+    grid.DrawTextRectangle(dc, text, textRect, attr);
+}
+
+wxSize LargeCellRenderer::GetBestSize(wxGrid& grid, wxGridCellAttr& attr, wxDC& dc, int row, int col) {
+    CSVTable* table = GetLargeCellTable(grid, row, col);
+    if (!table) {
+        return wxGridCellStringRenderer::GetBestSize(grid, attr, dc, row, col);
+    }
+    
+    // Sized for a preview, measuring the whole text made autosizing crawl
+    dc.SetFont(attr.GetFont());
+    wxCoord width, height;
+    dc.GetTextExtent(GetPreview(*table, row, col, MEASURE_CHARS), &width, &height);
+    return wxSize(width, height);
+}
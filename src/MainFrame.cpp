@@ -1,5 +1,24 @@
 #include "MainFrame.h"
 #include "CSVOptionsDialog.h"
+#include "MemoryBudget.h"
+#include "CompareDialog.h"
+#include "ComputedColumnDialog.h"
+#include "ColumnTransformDialog.h"
+#include "CellViewerDialog.h"
+#include "DiffFrame.h"
+#include "MergeDialog.h"
+#include "DuplicatesDialog.h"
+#include "SplitDialog.h"
+#include "ConcatDialog.h"
+#include "ValidateDialog.h"
+#include "CSVValidator.h"
+#include "OpenFolderDialog.h"
+#include "ShardSource.h"
+#include "PivotFrame.h"
+#include "Snapshot.h"
+#include "PerformanceFrame.h"
+#include "TableQuery.h"
+#include "Profiler.h"
 #include <wx/filedlg.h>
 #include <wx/msgdlg.h>
 #include <wx/textdlg.h>
@@ -10,11 +29,13 @@
 #include <wx/config.h>
 #include <wx/html/htmlwin.h>
 #include <wx/hyperlink.h>
+#include <wx/progdlg.h>
+#include <wx/clipbrd.h>
 
 // FileDropTarget implementation
 bool FileDropTarget::OnDropFiles(wxCoord x, wxCoord y, const wxArrayString& filenames) {
     if (filenames.GetCount() > 0) {
-        mainFrame->OpenFileFromDrop(filenames[0]);
+        mainFrame->OpenFiles(filenames);
         return true;
     }
     return false;
@@ -24,6 +45,7 @@ bool FileDropTarget::OnDropFiles(wxCoord x, wxCoord y, const wxArrayString& file
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_MENU(ID_NEW, MainFrame::OnNew)
     EVT_MENU(ID_OPEN, MainFrame::OnOpen)
+    EVT_MENU(ID_OPEN_FOLDER, MainFrame::OnOpenFolder)
     EVT_MENU(ID_SAVE, MainFrame::OnSave)
     EVT_MENU(ID_SAVE_AS, MainFrame::OnSaveAs)
     EVT_MENU(ID_CLOSE, MainFrame::OnClose)
@@ -34,8 +56,13 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_MENU(ID_ADD_ROW_ABOVE, MainFrame::OnAddRowAbove)
     EVT_MENU(ID_ADD_COLUMN_LEFT, MainFrame::OnAddColumnLeft)
     EVT_MENU(ID_ADD_COLUMN_RIGHT, MainFrame::OnAddColumnRight)
+    EVT_MENU(ID_ADD_COMPUTED_COLUMN, MainFrame::OnAddComputedColumn)
+    EVT_MENU(ID_TRANSFORM_COLUMN, MainFrame::OnTransformColumn)
     EVT_MENU(ID_DELETE_ROW, MainFrame::OnDeleteRow)
     EVT_MENU(ID_DELETE_COLUMN, MainFrame::OnDeleteColumn)
+    EVT_MENU(ID_COPY, MainFrame::OnCopy)
+    EVT_MENU(ID_PASTE, MainFrame::OnPaste)
+    EVT_MENU(ID_VIEW_CELL, MainFrame::OnViewCell)
     EVT_MENU(ID_ENC_UTF8, MainFrame::OnEncodingChange)
     EVT_MENU(ID_ENC_ANSI, MainFrame::OnEncodingChange)
     EVT_MENU(ID_ENC_UTF16, MainFrame::OnEncodingChange)
@@ -45,9 +72,18 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_MENU(ID_SEP_CUSTOM, MainFrame::OnSeparatorChange)
     EVT_MENU(ID_LANG_ENGLISH, MainFrame::OnLanguageChange)
     EVT_MENU(ID_LANG_SERBIAN, MainFrame::OnLanguageChange)
+    EVT_MENU(ID_COMPARE, MainFrame::OnCompare)
+    EVT_MENU(ID_MERGE, MainFrame::OnMerge)
+    EVT_MENU(ID_SPLIT, MainFrame::OnSplit)
+    EVT_MENU(ID_CONCAT, MainFrame::OnConcat)
+    EVT_MENU(ID_VALIDATE, MainFrame::OnValidate)
+    EVT_MENU(ID_PIVOT, MainFrame::OnPivot)
+    EVT_MENU(ID_DUPLICATES, MainFrame::OnDuplicates)
+    EVT_MENU(ID_PERFORMANCE, MainFrame::OnPerformance)
     EVT_MENU(ID_HELP_INSTRUCTIONS, MainFrame::OnInstructions)
     EVT_MENU(ID_HELP_ABOUT, MainFrame::OnAbout)
     EVT_CHOICE(ID_FONT_SIZE_CHOICE, MainFrame::OnFontSizeChange)
+    EVT_TEXT_ENTER(ID_QUERY, MainFrame::OnQuery)
     EVT_GRID_EDITOR_SHOWN(MainFrame::OnEditorShown)
     EVT_GRID_CELL_CHANGED(MainFrame::OnCellChanged)
     EVT_GRID_LABEL_LEFT_DCLICK(MainFrame::OnLabelDoubleClick)
@@ -55,17 +91,16 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_GRID_LABEL_RIGHT_CLICK(MainFrame::OnGridRightClick)
     EVT_GRID_COL_SIZE(MainFrame::OnColSize)
     EVT_GRID_SELECT_CELL(MainFrame::OnSelectCell)
+    EVT_NOTEBOOK_PAGE_CHANGED(wxID_ANY, MainFrame::OnPageChanged)
 wxEND_EVENT_TABLE()
 
 MainFrame::MainFrame(const wxString& title)
     : wxFrame(nullptr, wxID_ANY, title, wxDefaultPosition, wxSize(1000, 600)),
-      currentEncoding(Encoding::UTF8),
-      currentSeparator(','),
-      isDirty(false),
-      hasHeaderRow(false),
-      currentLanguage(LANGUAGE_ENGLISH),
+      toolBar(nullptr),
+      queryCtrl(nullptr),
       currentFontSize(12),
-      isRestoringState(false) {
+      performanceFrame(nullptr),
+      currentLanguage(LANGUAGE_ENGLISH) {
     
     // Load language setting from registry
     wxConfig config("CSV++");
@@ -82,31 +117,9 @@ MainFrame::MainFrame(const wxString& title)
     
     SetIcon(wxIcon("IDI_APPICON", wxBITMAP_TYPE_ICO_RESOURCE, 32, 32));
     
-    // Create main table grid
-    grid = new wxGrid(this, wxID_ANY);
-    grid->CreateGrid(10, 5);
-    grid->EnableEditing(true);
-    grid->EnableDragGridSize(true);
-    grid->EnableDragColSize(true);
-    grid->EnableDragRowSize(false);
-    grid->SetDefaultCellOverflow(false);
-    
-    // Apply initial font size to grid based on Font setting
-    wxFont font = grid->GetDefaultCellFont();
-    font.SetPointSize(currentFontSize);
-    grid->SetDefaultCellFont(font);
-    
-    wxFont labelFont = grid->GetLabelFont();
-    labelFont.SetPointSize(currentFontSize);
-    grid->SetLabelFont(labelFont);
-    
-    ApplyGridDimensions();
-    
-    // Set default column labels
-    for (int i = 0; i < grid->GetNumberCols(); ++i) {
-        wxChar label = 'A' + i;
-        grid->SetColLabelValue(i, wxString(label));
-    }
+    // Each open document is a tab with its own grid
+    notebook = new wxNotebook(this, wxID_ANY);
+    AddDocument()->NewFile(10, 5);
     
     // Create UI elements
     CreateMenuBar();
@@ -117,9 +130,7 @@ MainFrame::MainFrame(const wxString& title)
     SetDropTarget(new FileDropTarget(this));
     
     // Update UI
-    UpdateStatusBar();
-    UpdateMenuChecks();
-    UpdateUndoRedoButtons();
+    UpdateDocumentUI();
     
     // Check language menu based on loaded setting
     wxMenuBar* menuBar = GetMenuBar();
@@ -129,6 +140,12 @@ MainFrame::MainFrame(const wxString& title)
     }
     
     Centre();
+    
+    // Journals left behind by a previous session are only offered when no
+    // other instance owns them
+    if (instanceChecker.Create("CSV++-" + wxGetUserId()) && !instanceChecker.IsAnotherRunning()) {
+        CallAfter(&MainFrame::RecoverJournals);
+    }
 }
 
 void MainFrame::CreateMenuBar() {
@@ -138,6 +155,7 @@ void MainFrame::CreateMenuBar() {
     wxMenu* fileMenu = new wxMenu();
     fileMenu->Append(ID_NEW, Translate("menu_new", currentLanguage), Translate("menu_new_desc", currentLanguage));
     fileMenu->Append(ID_OPEN, Translate("menu_open", currentLanguage), Translate("menu_open_desc", currentLanguage));
+    fileMenu->Append(ID_OPEN_FOLDER, Translate("menu_open_folder", currentLanguage), Translate("menu_open_folder_desc", currentLanguage));
     fileMenu->Append(ID_SAVE, Translate("menu_save", currentLanguage), Translate("menu_save_desc", currentLanguage));
     fileMenu->Append(ID_SAVE_AS, Translate("menu_save_as", currentLanguage), Translate("menu_save_as_desc", currentLanguage));
     fileMenu->Append(ID_CLOSE, Translate("menu_close", currentLanguage), Translate("menu_close_desc", currentLanguage));
@@ -171,6 +189,21 @@ void MainFrame::CreateMenuBar() {
     
     menuBar->Append(settingsMenu, Translate("menu_settings", currentLanguage));
     
+    // Tools menu
+    wxMenu* toolsMenu = new wxMenu();
+    toolsMenu->Append(ID_COMPARE, Translate("menu_compare", currentLanguage), Translate("menu_compare_desc", currentLanguage));
+    toolsMenu->Append(ID_MERGE, Translate("menu_merge", currentLanguage), Translate("menu_merge_desc", currentLanguage));
+    toolsMenu->Append(ID_SPLIT, Translate("menu_split", currentLanguage), Translate("menu_split_desc", currentLanguage));
+    toolsMenu->Append(ID_CONCAT, Translate("menu_concat", currentLanguage), Translate("menu_concat_desc", currentLanguage));
+    toolsMenu->Append(ID_VALIDATE, Translate("menu_validate", currentLanguage), Translate("menu_validate_desc", currentLanguage));
+    toolsMenu->Append(ID_ADD_COMPUTED_COLUMN, Translate("menu_computed_column", currentLanguage), Translate("menu_computed_column_desc", currentLanguage));
+    toolsMenu->Append(ID_TRANSFORM_COLUMN, Translate("menu_transform_column", currentLanguage), Translate("menu_transform_column_desc", currentLanguage));
+    toolsMenu->Append(ID_PIVOT, Translate("menu_pivot", currentLanguage), Translate("menu_pivot_desc", currentLanguage));
+    toolsMenu->Append(ID_DUPLICATES, Translate("menu_duplicates", currentLanguage), Translate("menu_duplicates_desc", currentLanguage));
+    toolsMenu->AppendSeparator();
+    toolsMenu->Append(ID_PERFORMANCE, Translate("menu_performance", currentLanguage), Translate("menu_performance_desc", currentLanguage));
+    menuBar->Append(toolsMenu, Translate("menu_tools", currentLanguage));
+    
     // Help menu
     wxMenu* helpMenu = new wxMenu();
     helpMenu->Append(ID_HELP_INSTRUCTIONS, Translate("menu_help_instructions", currentLanguage), Translate("menu_help_instructions_desc", currentLanguage));
@@ -232,6 +265,14 @@ void MainFrame::CreateToolBar() {
     }
     toolBar->AddControl(fontSizeChoice);
     
+    // Query bar, Enter runs it over the active tab
+    toolBar->AddSeparator();
+    toolBar->AddControl(new wxStaticText(toolBar, wxID_ANY, Translate("toolbar_query", currentLanguage) + ": "));
+    queryCtrl = new wxTextCtrl(toolBar, ID_QUERY, wxEmptyString, wxDefaultPosition, wxSize(360, -1), wxTE_PROCESS_ENTER);
+    queryCtrl->SetHint(Translate("toolbar_query_hint", currentLanguage));
+    queryCtrl->SetToolTip(Translate("toolbar_query_tooltip", currentLanguage));
+    toolBar->AddControl(queryCtrl);
+    
     toolBar->Realize();
 }
 
@@ -240,484 +281,486 @@ void MainFrame::CreateStatusBar() {
 }
 
 void MainFrame::OnNew(wxCommandEvent& event) {
-    if (!PromptSaveChanges()) {
-        return;
-    }
+    // New files open in their own tab
+    CSVDocument* doc = AddDocument();
+    doc->NewFile(10, 5);
     
-    ClearGrid();
-    currentFile.Clear();
-    hasHeaderRow = false;
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnOpen(wxCommandEvent& event) {
+    wxFileDialog openFileDialog(this, "Open CSV file", "", "",
+                               "CSV files (*.csv)|*.csv|Compressed CSV files (*.csv.gz;*.csv.zst;*.csv.xz)|*.csv.gz;*.csv.zst;*.csv.xz|CSV++ snapshots (*.csvpp)|*.csvpp|Text files (*.txt)|*.txt|All files (*.*)|*.*",
+                               wxFD_OPEN | wxFD_FILE_MUST_EXIST | wxFD_MULTIPLE);
     
-    // Create empty grid
-    if (grid->GetNumberRows() > 0) {
-        grid->DeleteRows(0, grid->GetNumberRows());
-    }
-    if (grid->GetNumberCols() > 0) {
-        grid->DeleteCols(0, grid->GetNumberCols());
+    if (openFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
     }
     
-    grid->AppendRows(10);
-    grid->AppendCols(5);
-    
-    // Apply grid dimensions based on current font size
-    ApplyGridDimensions();
+    wxArrayString filenames;
+    openFileDialog.GetPaths(filenames);
+    OpenFiles(filenames);
+}
+
+void MainFrame::OnOpenFolder(wxCommandEvent& event) {
+    OpenFolderDialog dialog(this, currentLanguage);
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
     
-    // Set default column labels
-    for (int i = 0; i < grid->GetNumberCols(); ++i) {
-        wxChar label = 'A' + i;
-        grid->SetColLabelValue(i, wxString(label));
+    wxArrayString files;
+    ShardSource::FindFiles(dialog.GetPattern(), files);
+    OpenShards(files, dialog.GetPattern());
+}
+
+void MainFrame::OpenFiles(const wxArrayString& filenames) {
+    // A folder is one table of the files in it, snapshots always get a tab
+    wxArrayString files;
+    for (size_t i = 0; i < filenames.GetCount(); ++i) {
+        if (Snapshot::IsSnapshotFile(filenames[i])) {
+            OpenFileFromDrop(filenames[i]);
+            continue;
+        }
+        if (!wxDirExists(filenames[i])) {
+            files.Add(filenames[i]);
+            continue;
+        }
+        wxArrayString shards;
+        if (ShardSource::FindFiles(filenames[i], shards)) {
+            OpenShards(shards, filenames[i]);
+        } else {
+            wxMessageBox(Translate("error_open_folder", currentLanguage),
+                         Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        }
     }
     
-    SetDirty(false);
-    undoStack.clear();
-    redoStack.clear();
-    UpdateStatusBar();
-    UpdateMenuChecks();
-    UpdateUndoRedoButtons();
+    // Several files are shards of one table, or else every file gets a tab
+    if (files.GetCount() > 1 &&
+        wxMessageBox(wxString::Format(Translate("prompt_open_as_one", currentLanguage), (int)files.GetCount()),
+                     Translate("prompt_open_as_one_title", currentLanguage), wxYES_NO | wxICON_QUESTION) == wxYES) {
+        OpenShards(files, wxFileName(files[0]).GetPath());
+        return;
+    }
+    for (size_t i = 0; i < files.GetCount(); ++i) {
+        OpenFileFromDrop(files[i]);
+    }
 }
 
-void MainFrame::OnOpen(wxCommandEvent& event) {
-    if (!PromptSaveChanges()) {
+void MainFrame::OpenShards(const wxArrayString& files, const wxString& name) {
+    // The first file decides the format of all of them
+    MappedFile file;
+    if (files.IsEmpty() || !file.Open(files[0])) {
+        wxMessageBox("Failed to read file!", "Error", wxOK | wxICON_ERROR);
         return;
     }
+    Encoding detectedEnc = Encoding::UTF8;
+    wxChar detectedSep = ',';
+    CSVParser::DetectFormat(file, detectedEnc, detectedSep);
+    file.Close();
     
-    wxFileDialog openFileDialog(this, "Open CSV file", "", "",
-                               "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*",
-                               wxFD_OPEN | wxFD_FILE_MUST_EXIST);
-    
-    if (openFileDialog.ShowModal() == wxID_CANCEL) {
+    CSVOptionsDialog dialog(this, detectedEnc, detectedSep, true, files[0]);
+    if (dialog.ShowModal() != wxID_OK) {
         return;
     }
     
-    wxString filename = openFileDialog.GetPath();
-    OpenFileFromDrop(filename);
+    // Reuse an untouched empty tab, otherwise open a new one
+    CSVDocument* doc = GetActiveDocument();
+    bool reuse = doc && doc->IsUntouched();
+    if (!reuse) {
+        doc = AddDocument();
+    }
+    
+    wxString error;
+    bool loaded;
+    {
+        wxProgressDialog progress(Translate("dialog_open_folder_title", currentLanguage),
+                                  wxString::Format(Translate("open_folder_progress", currentLanguage), (int)files.GetCount()),
+                                  100, this, wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+        loaded = doc->LoadShards(files, name, dialog.GetSelectedEncoding(), dialog.GetSelectedSeparator(),
+                                 dialog.GetHasHeader(), dialog.GetSelectedColumns(), error,
+                                 [&progress](int percent) { progress.Update(percent); });
+    }
+    
+    if (!loaded) {
+        if (!reuse) {
+            CloseDocument(doc);
+        }
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    UpdateDocumentUI();
 }
 
 void MainFrame::OpenFileFromDrop(const wxString& filename) {
-    // Auto-detect encoding and separator
-    Encoding detectedEnc = CSVParser::DetectEncoding(filename);
+    // Switch to the tab if the file is already open
+    for (size_t i = 0; i < notebook->GetPageCount(); ++i) {
+        CSVDocument* doc = GetDocument(i);
+        if (!doc->GetFile().IsEmpty() && wxFileName(doc->GetFile()).SameAs(wxFileName(filename))) {
+            notebook->SetSelection(i);
+            return;
+        }
+    }
     
-    std::vector<std::vector<wxString>> tempData;
-    wxChar detectedSep = ',';
-    bool tempHeader = false;
+    // Snapshots store their encoding, separator and header setting
+    if (Snapshot::IsSnapshotFile(filename)) {
+        LoadCSVFile(filename, Encoding::UTF8, ',', false);
+        return;
+    }
     
-    CSVParser parser;
-    if (!parser.ReadFile(filename, tempData, detectedSep, detectedEnc, tempHeader)) {
+    // Auto-detect encoding and separator from the start of the file
+    MappedFile file;
+    if (!file.Open(filename)) {
         wxMessageBox("Failed to read file!", "Error", wxOK | wxICON_ERROR);
         return;
     }
+    Encoding detectedEnc = Encoding::UTF8;
+    wxChar detectedSep = ',';
+    CSVParser::DetectFormat(file, detectedEnc, detectedSep);
+    file.Close();
     
     // Show options dialog
-    CSVOptionsDialog dialog(this, detectedEnc, detectedSep, true);
+    CSVOptionsDialog dialog(this, detectedEnc, detectedSep, true, filename);
     if (dialog.ShowModal() == wxID_OK) {
         Encoding selectedEnc = dialog.GetSelectedEncoding();
         wxChar selectedSep = dialog.GetSelectedSeparator();
         bool hasHeader = dialog.GetHasHeader();
         
-        LoadCSVFile(filename, selectedEnc, selectedSep, hasHeader);
+        LoadCSVFile(filename, selectedEnc, selectedSep, hasHeader, dialog.GetSelectedColumns());
     }
 }
 
 void MainFrame::LoadCSVFile(const wxString& filename, Encoding encoding,
-                           wxChar separator, bool hasHeader) {
-    std::vector<std::vector<wxString>> data;
-    CSVParser parser;
-    
-    if (!parser.ReadFile(filename, data, separator, encoding, hasHeader)) {
-        wxMessageBox("Failed to load CSV file!", "Error", wxOK | wxICON_ERROR);
-        return;
+                           wxChar separator, bool hasHeader, const std::vector<int>& columns) {
+    // Reuse an untouched empty tab, otherwise open a new one
+    CSVDocument* doc = GetActiveDocument();
+    bool reuse = doc && doc->IsUntouched();
+    if (!reuse) {
+        doc = AddDocument();
     }
     
-    if (data.empty()) {
-        wxMessageBox("CSV file is empty!", "Warning", wxOK | wxICON_WARNING);
-        return;
-    }
-    ClearGrid();
-    
-    // Determine grid size
-    int rows = data.size();
-    int cols = 0;
-    for (const auto& row : data) {
-        cols = wxMax(cols, (int)row.size());
-    }
-    
-    if (hasHeader && rows > 0) {
-        rows--;
-    }
-    
-    // Create grid
-    if (rows > 0 && cols > 0) {
-        grid->AppendRows(rows);
-        grid->AppendCols(cols);
-        
-        // Apply grid dimensions based on current font size
-        ApplyGridDimensions();
-        
-        // Set headers if present
-        int startRow = 0;
-        if (hasHeader && !data.empty()) {
-            for (int col = 0; col < cols && col < (int)data[0].size(); ++col) {
-                grid->SetColLabelValue(col, data[0][col]);
-            }
-            startRow = 1;
-        } else {
-            // Default column labels
-            for (int col = 0; col < cols; ++col) {
-                wxChar label = 'A' + col;
-                grid->SetColLabelValue(col, wxString(label));
-            }
-        }
-        
-        // Fill data
-        for (int row = startRow; row < (int)data.size(); ++row) {
-            for (int col = 0; col < (int)data[row].size() && col < cols; ++col) {
-                grid->SetCellValue(row - startRow, col, data[row][col]);
-            }
-        }
-        
-        // Auto-size columns to fit content
-        grid->AutoSizeColumns(false);
-        for (int col = 0; col < cols; ++col) {
-            int width = grid->GetColSize(col);
-            grid->SetColSize(col, width + width / 5);
+    if (!doc->LoadFile(filename, encoding, separator, hasHeader, columns)) {
+        if (!reuse) {
+            CloseDocument(doc);
         }
+        return;
     }
     
-    currentFile = filename;
-    currentEncoding = encoding;
-    currentSeparator = separator;
-    hasHeaderRow = hasHeader;
-    SetDirty(false);
-    
-    undoStack.clear();
-    redoStack.clear();
-    
-    UpdateStatusBar();
-    UpdateMenuChecks();
-    UpdateUndoRedoButtons();
-    
-    SetTitle("CSV++ - " + wxFileName(filename).GetFullName());
+    UpdateDocumentUI();
 }
 
 void MainFrame::OnSave(wxCommandEvent& event) {
-    if (currentFile.IsEmpty()) {
+    SaveDocument(GetActiveDocument());
+}
+
+bool MainFrame::SaveDocument(CSVDocument* doc) {
+    wxString filename = doc->GetFile();
+    if (filename.IsEmpty()) {
         wxFileDialog saveFileDialog(this, "Save CSV file", "", "",
-                                   "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt",
+                                   "CSV files (*.csv)|*.csv|gzip compressed CSV (*.csv.gz)|*.csv.gz|zstd compressed CSV (*.csv.zst)|*.csv.zst|xz compressed CSV (*.csv.xz)|*.csv.xz|CSV++ snapshots (*.csvpp)|*.csvpp|Text files (*.txt)|*.txt",
                                    wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
         
         if (saveFileDialog.ShowModal() == wxID_CANCEL) {
-            return;
+            return false;
         }
         
-        currentFile = saveFileDialog.GetPath();
+        filename = saveFileDialog.GetPath();
     }
     
-    SaveCSVFile(currentFile);
+    return SaveCSVFile(doc, filename);
 }
 
 void MainFrame::OnSaveAs(wxCommandEvent& event) {
     wxFileDialog saveFileDialog(this, "Save CSV file as", "", "",
-                               "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt",
+                               "CSV files (*.csv)|*.csv|gzip compressed CSV (*.csv.gz)|*.csv.gz|zstd compressed CSV (*.csv.zst)|*.csv.zst|xz compressed CSV (*.csv.xz)|*.csv.xz|CSV++ snapshots (*.csvpp)|*.csvpp|Text files (*.txt)|*.txt",
                                wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
     
     if (saveFileDialog.ShowModal() == wxID_CANCEL) {
         return;
     }
     
-    SaveCSVFile(saveFileDialog.GetPath());
+    SaveCSVFile(GetActiveDocument(), saveFileDialog.GetPath());
 }
 
-void MainFrame::SaveCSVFile(const wxString& filename) {
-    std::vector<std::vector<wxString>> data;
-    
-    // Add headers if present
-    if (hasHeaderRow) {
-        std::vector<wxString> headers;
-        for (int col = 0; col < grid->GetNumberCols(); ++col) {
-            headers.push_back(grid->GetColLabelValue(col));
-        }
-        data.push_back(headers);
-    }
-    
-    // Add data rows
-    for (int row = 0; row < grid->GetNumberRows(); ++row) {
-        std::vector<wxString> rowData;
-        for (int col = 0; col < grid->GetNumberCols(); ++col) {
-            rowData.push_back(grid->GetCellValue(row, col));
+bool MainFrame::SaveCSVFile(CSVDocument* doc, const wxString& filename) {
+    // Only some columns were loaded, saving over the source drops the rest
+    if (!doc->GetLoadedColumns().empty() && wxFileName(filename).SameAs(wxFileName(doc->GetFile()))) {
+        if (wxMessageBox(Translate("prompt_projection_overwrite", currentLanguage),
+                         Translate("prompt_projection_overwrite_title", currentLanguage),
+                         wxYES_NO | wxICON_WARNING) != wxYES) {
+            return false;
         }
-        data.push_back(rowData);
     }
     
-    CSVParser parser;
-    if (parser.WriteFile(filename, data, currentSeparator, currentEncoding)) {
-        SetDirty(false);
-        currentFile = filename;
-        SetTitle("CSV++ - " + wxFileName(filename).GetFullName());
+    if (doc->SaveFile(filename)) {
+        UpdateDocumentUI();
         wxMessageBox(Translate("msg_save_success", currentLanguage), Translate("msg_success_title", currentLanguage), wxOK | wxICON_INFORMATION);
-    } else {
-        wxMessageBox(Translate("msg_save_error", currentLanguage), Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return true;
     }
+    wxMessageBox(Translate("msg_save_error", currentLanguage), Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+    return false;
 }
 
 void MainFrame::OnClose(wxCommandEvent& event) {
-    if (PromptSaveChanges()) {
-        ClearGrid();
-        currentFile.Clear();
-        SetTitle("CSV++");
-        SetDirty(false);
+    CSVDocument* doc = GetActiveDocument();
+    if (PromptSaveChanges(doc)) {
+        CloseDocument(doc);
     }
 }
 
 void MainFrame::OnQuit(wxCommandEvent& event) {
-    if (PromptSaveChanges()) {
-        Close(true);
+    for (size_t i = 0; i < notebook->GetPageCount(); ++i) {
+        if (!PromptSaveChanges(GetDocument(i))) {
+            return;
+        }
+    }
+    
+    // Changes were saved or explicitly discarded, nothing left to recover
+    for (size_t i = 0; i < notebook->GetPageCount(); ++i) {
+        GetDocument(i)->StopJournal(true);
     }
+    
+    // Render a pending copy while its table is still alive so it outlives the app
+    if (wxTheClipboard->Open()) {
+        wxTheClipboard->Flush();
+        wxTheClipboard->Close();
+    }
+    Close(true);
 }
 
 void MainFrame::OnUndo(wxCommandEvent& event) {
-    if (undoStack.empty()) {
+    GetActiveDocument()->Undo();
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnRedo(wxCommandEvent& event) {
+    GetActiveDocument()->Redo();
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnAddRowBelow(wxCommandEvent& event) {
+    GetActiveDocument()->AddRowBelow();
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnAddRowAbove(wxCommandEvent& event) {
+    GetActiveDocument()->AddRowAbove();
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnAddColumnRight(wxCommandEvent& event) {
+    GetActiveDocument()->AddColumnRight();
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnAddComputedColumn(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    ComputedColumnDialog dialog(this, currentLanguage, doc->GetColumnNames());
+    if (dialog.ShowModal() != wxID_OK) {
         return;
     }
     
-    // Save current state to redo stack
-    redoStack.push_back(GetCurrentState());
-    if (redoStack.size() > MAX_UNDO_LEVELS) {
-        redoStack.pop_front();
+    wxString error;
+    bool inserted;
+    {
+        wxBusyCursor busy;
+        inserted = doc->InsertComputedColumn(dialog.GetColumnName(), dialog.GetExpression(), error);
     }
-    
-    // Restore from undo stack
-    GridState state = undoStack.back();
-    undoStack.pop_back();
-    RestoreState(state);
-    
-    UpdateUndoRedoButtons();
-    SetDirty(true);
+    if (!inserted) {
+        wxMessageBox(Translate("error_computed_expression", currentLanguage) + "\n" + error,
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    UpdateDocumentUI();
 }
 
-void MainFrame::OnRedo(wxCommandEvent& event) {
-    if (redoStack.empty()) {
+void MainFrame::OnTransformColumn(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    ColumnTransformDialog dialog(this, currentLanguage, doc->GetColumnNames(), doc->GetGrid()->GetGridCursorCol());
+    if (dialog.ShowModal() != wxID_OK) {
         return;
     }
     
-    // Save current state to undo stack
-    undoStack.push_back(GetCurrentState());
-    if (undoStack.size() > MAX_UNDO_LEVELS) {
-        undoStack.pop_front();
+    bool changed;
+    {
+        wxBusyCursor busy;
+        changed = doc->TransformColumn(dialog.GetColumn(), dialog.GetTransform());
     }
-    
-    // Restore from redo stack
-    GridState state = redoStack.back();
-    redoStack.pop_back();
-    RestoreState(state);
-    
-    UpdateUndoRedoButtons();
-    SetDirty(true);
+    if (!changed) {
+        wxMessageBox(Translate("msg_transform_none", currentLanguage),
+                     Translate("dialog_transform_title", currentLanguage), wxOK | wxICON_INFORMATION);
+        return;
+    }
+    UpdateDocumentUI();
 }
 
-void MainFrame::OnAddRowBelow(wxCommandEvent& event) {
-    SaveState();
-    
-    int currentRow = grid->GetGridCursorRow();
-    if (currentRow < 0) {
-        currentRow = grid->GetNumberRows() - 1;
-    }
-    
-    grid->InsertRows(currentRow + 1, 1);
-    
-    // Set row height based on current font size
-    int rowHeight = currentFontSize * 2 + 8;
-    grid->SetRowSize(currentRow + 1, rowHeight);
-    
-    UpdateStatusBar();
-    SetDirty(true);
+void MainFrame::OnAddColumnLeft(wxCommandEvent& event) {
+    GetActiveDocument()->AddColumnLeft();
+    UpdateDocumentUI();
 }
 
-void MainFrame::OnAddRowAbove(wxCommandEvent& event) {
-    SaveState();
-    
-    int currentRow = grid->GetGridCursorRow();
-    if (currentRow < 0) {
-        currentRow = 0;
-    }
-    
-    grid->InsertRows(currentRow, 1);
-    
-    // Set row height based on current font size
-    int rowHeight = currentFontSize * 2 + 8;
-    grid->SetRowSize(currentRow, rowHeight);
-    
-    UpdateStatusBar();
-    SetDirty(true);
+void MainFrame::OnDeleteRow(wxCommandEvent& event) {
+    GetActiveDocument()->DeleteSelectedRows();
+    UpdateDocumentUI();
 }
 
-void MainFrame::OnAddColumnRight(wxCommandEvent& event) {
-    SaveState();
-    
-    int currentCol = grid->GetGridCursorCol();
-    if (currentCol < 0) {
-        currentCol = grid->GetNumberCols() - 1;
+void MainFrame::OnDeleteColumn(wxCommandEvent& event) {
+    GetActiveDocument()->DeleteSelectedColumns();
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnCopy(wxCommandEvent& event) {
+    std::shared_ptr<ClipboardCopy> copy = GetActiveDocument()->Copy();
+    if (!copy) {
+        return;
     }
     
-    grid->InsertCols(currentCol + 1, 1);
-    
-    // Set default label
-    int newCol = currentCol + 1;
-    wxChar label = 'A' + newCol;
-    if (newCol < 26) {
-        grid->SetColLabelValue(newCol, wxString(label));
-    } else {
-        grid->SetColLabelValue(newCol, wxString::Format("Col%d", newCol + 1));
+    // The text is rendered only when another program pastes it
+    if (wxTheClipboard->Open()) {
+        wxTheClipboard->SetData(new ClipboardTextObject(copy));
+        wxTheClipboard->Close();
     }
-    
-    // Set column width for new column only
-    grid->SetColSize(newCol, GetDefaultColumnWidth());
-    
-    UpdateStatusBar();
-    SetDirty(true);
 }
 
-void MainFrame::OnAddColumnLeft(wxCommandEvent& event) {
-    SaveState();
-    
-    int currentCol = grid->GetGridCursorCol();
-    if (currentCol < 0) {
-        currentCol = 0;
+void MainFrame::OnPaste(wxCommandEvent& event) {
+    wxTextDataObject data;
+    if (!wxTheClipboard->Open()) {
+        return;
     }
+    bool hasText = wxTheClipboard->IsSupported(wxDF_UNICODETEXT) && wxTheClipboard->GetData(data);
+    wxTheClipboard->Close();
     
-    grid->InsertCols(currentCol, 1);
-    
-    // Set default labels
-    wxChar label = 'A' + currentCol;
-    if (currentCol < 26) {
-        grid->SetColLabelValue(currentCol, wxString(label));
-    } else {
-        grid->SetColLabelValue(currentCol, wxString::Format("Col%d", currentCol + 1));
+    if (hasText) {
+        wxBusyCursor busy;
+        GetActiveDocument()->Paste(data.GetText());
+        UpdateDocumentUI();
     }
-    
-    // Set column width for new column only
-    grid->SetColSize(currentCol, GetDefaultColumnWidth());
-    
-    UpdateStatusBar();
-    SetDirty(true);
 }
 
-void MainFrame::OnDeleteRow(wxCommandEvent& event) {
-    wxArrayInt selectedRows = grid->GetSelectedRows();
-    
-    if (selectedRows.GetCount() == 0) {
-        int currentRow = grid->GetGridCursorRow();
-        if (currentRow >= 0) {
-            SaveState();
-            grid->DeleteRows(currentRow, 1);
-            UpdateStatusBar();
-            SetDirty(true);
-        }
-    } else {
-        SaveState();
-        // Delete in reverse order to maintain indices
-        for (int i = selectedRows.GetCount() - 1; i >= 0; --i) {
-            grid->DeleteRows(selectedRows[i], 1);
-        }
-        UpdateStatusBar();
-        SetDirty(true);
-    }
+void MainFrame::OnViewCell(wxCommandEvent& event) {
+    wxGrid* grid = GetActiveDocument()->GetGrid();
+    ShowCellViewer(grid->GetGridCursorRow(), grid->GetGridCursorCol());
 }
 
-void MainFrame::OnDeleteColumn(wxCommandEvent& event) {
-    wxArrayInt selectedCols = grid->GetSelectedCols();
-    
-    if (selectedCols.GetCount() == 0) {
-        int currentCol = grid->GetGridCursorCol();
-        if (currentCol >= 0) {
-            SaveState();
-            grid->DeleteCols(currentCol, 1);
-            UpdateStatusBar();
-            SetDirty(true);
-        }
-    } else {
-        SaveState();
-        // Delete in reverse order to maintain indices
-        for (int i = selectedCols.GetCount() - 1; i >= 0; --i) {
-            grid->DeleteCols(selectedCols[i], 1);
-        }
-        UpdateStatusBar();
-        SetDirty(true);
+void MainFrame::ShowCellViewer(int row, int col) {
+    CSVDocument* doc = GetActiveDocument();
+    wxGrid* grid = doc->GetGrid();
+    if (row < 0 || col < 0 || row >= grid->GetNumberRows() || col >= grid->GetNumberCols()) {
+        return;
+    }
+    
+    wxString value;
+    doc->GetTable()->CopyValue(row, col, value);
+    CellViewerDialog dialog(this, currentLanguage, grid->GetColLabelValue(col), row, value);
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    wxString edited = dialog.GetValue();
+    if (edited != value) {
+        doc->SetCell(row, col, edited);
+        UpdateDocumentUI();
     }
 }
 
 void MainFrame::OnEncodingChange(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    Encoding encoding = doc->GetEncoding();
     switch (event.GetId()) {
         case ID_ENC_UTF8:
-            currentEncoding = Encoding::UTF8;
+            encoding = Encoding::UTF8;
             break;
         case ID_ENC_ANSI:
-            currentEncoding = Encoding::ANSI;
+            encoding = Encoding::ANSI;
             break;
         case ID_ENC_UTF16:
-            currentEncoding = Encoding::UTF16_LE;
+            encoding = Encoding::UTF16_LE;
             break;
     }
+    doc->SetFormat(encoding, doc->GetSeparator());
     
-    UpdateMenuChecks();
-    UpdateStatusBar();
-    SetDirty(true);
+    UpdateDocumentUI();
 }
 
 void MainFrame::OnSeparatorChange(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    wxChar separator = doc->GetSeparator();
     switch (event.GetId()) {
         case ID_SEP_COMMA:
-            currentSeparator = ',';
+            separator = ',';
             break;
         case ID_SEP_SEMICOLON:
-            currentSeparator = ';';
+            separator = ';';
             break;
         case ID_SEP_TAB:
-            currentSeparator = '\t';
+            separator = '\t';
             break;
         case ID_SEP_CUSTOM:
             {
                 wxTextEntryDialog dialog(this, Translate("dialog_custom_sep_message", currentLanguage),
-                                        Translate("dialog_custom_sep_title", currentLanguage), wxString(currentSeparator));
+                                        Translate("dialog_custom_sep_title", currentLanguage), wxString(separator));
                 if (dialog.ShowModal() == wxID_OK) {
                     wxString value = dialog.GetValue();
                     if (!value.IsEmpty()) {
-                        currentSeparator = value[0];
+                        separator = value[0];
                     }
                 }
             }
             break;
     }
+    doc->SetFormat(doc->GetEncoding(), separator);
     
-    UpdateMenuChecks();
-    UpdateStatusBar();
-    SetDirty(true);
+    UpdateDocumentUI();
 }
 
 void MainFrame::OnEditorShown(wxGridEvent& event) {
-    if (!isRestoringState) {
-        SaveState();
+    CSVDocument* doc = GetActiveDocument();
+    // The in-place editor would lay out all of a large cell, the viewer loads it in slices
+    if (doc->IsLargeCell(event.GetRow(), event.GetCol())) {
+        event.Veto();
+        int row = event.GetRow();
+        int col = event.GetCol();
+        CallAfter([this, row, col]() { ShowCellViewer(row, col); });
+        return;
     }
+    doc->PrepareCellEdit();
     event.Skip();
 }
 
 void MainFrame::OnCellChanged(wxGridEvent& event) {
-    SetDirty(true);
+    // The event carries the value the cell had before the edit
+    GetActiveDocument()->CellChanged(event.GetRow(), event.GetCol(), event.GetString());
+    UpdateTitle();
+    UpdateUndoRedoButtons();
+    WarnJournalFailure();
     event.Skip();
 }
 
 void MainFrame::OnLabelDoubleClick(wxGridEvent& event) {
     if (event.GetCol() >= 0) {
         // Edit column header
-        wxString currentLabel = grid->GetColLabelValue(event.GetCol());
+        CSVDocument* doc = GetActiveDocument();
+        wxString currentLabel = doc->GetGrid()->GetColLabelValue(event.GetCol());
         wxTextEntryDialog dialog(this, Translate("dialog_col_header_message", currentLanguage),
                                 Translate("dialog_col_header_title", currentLanguage), currentLabel);
         
         if (dialog.ShowModal() == wxID_OK) {
-            SaveState();
-            wxString newLabel = dialog.GetValue();
-            grid->SetColLabelValue(event.GetCol(), newLabel);
-            hasHeaderRow = true;
-            SetDirty(true);
+            doc->RenameColumn(event.GetCol(), dialog.GetValue());
+            UpdateDocumentUI();
+        }
+    }
+    event.Skip();
+}
+
+void MainFrame::OnGridKeyDown(wxKeyEvent& event) {
+    // Only reaches the grid itself, an open cell editor keeps its own shortcuts
+    if (event.ControlDown() && !event.AltDown()) {
+        wxCommandEvent command;
+        if (event.GetKeyCode() == 'C') {
+            OnCopy(command);
+            return;
+        }
+        if (event.GetKeyCode() == 'V') {
+            OnPaste(command);
+            return;
         }
     }
     event.Skip();
@@ -744,6 +787,11 @@ void MainFrame::OnRightClick(wxGridEvent& event) {
         return wxBitmap(16, 16);
     };
     
+    menu.Append(ID_COPY, Translate("menu_copy", currentLanguage));
+    menu.Append(ID_PASTE, Translate("menu_paste", currentLanguage));
+    menu.Append(ID_VIEW_CELL, Translate("menu_view_cell", currentLanguage));
+    menu.AppendSeparator();
+    
     wxMenuItem* addRowBelowItem = new wxMenuItem(&menu, ID_ADD_ROW_BELOW, Translate("toolbar_add_row_below", currentLanguage));
     addRowBelowItem->SetBitmap(loadIcon("row-insert-bottom"));
     menu.Append(addRowBelowItem);
@@ -766,6 +814,9 @@ void MainFrame::OnRightClick(wxGridEvent& event) {
     addColRightItem->SetBitmap(loadIcon("column-insert-right"));
     menu.Append(addColRightItem);
     
+    menu.Append(ID_ADD_COMPUTED_COLUMN, Translate("menu_computed_column", currentLanguage));
+    menu.Append(ID_TRANSFORM_COLUMN, Translate("menu_transform_column", currentLanguage));
+    
     wxMenuItem* deleteColItem = new wxMenuItem(&menu, ID_DELETE_COLUMN, Translate("toolbar_del_col", currentLanguage));
     deleteColItem->SetBitmap(loadIcon("column-remove"));
     menu.Append(deleteColItem);
@@ -779,8 +830,11 @@ void MainFrame::OnGridRightClick(wxGridEvent& event) {
 }
 
 void MainFrame::UpdateStatusBar() {
+    CSVDocument* doc = GetActiveDocument();
+    wxGrid* grid = doc->GetGrid();
+    
     wxString encStr;
-    switch (currentEncoding) {
+    switch (doc->GetEncoding()) {
         case Encoding::UTF8:
         case Encoding::UTF8_BOM:
             encStr = "UTF-8";
@@ -794,11 +848,12 @@ void MainFrame::UpdateStatusBar() {
             break;
     }
     
+    wxChar separator = doc->GetSeparator();
     wxString sepStr;
-    if (currentSeparator == ',') sepStr = ",";
-    else if (currentSeparator == ';') sepStr = ";";
-    else if (currentSeparator == '\t') sepStr = "Tab";
-    else sepStr = wxString(currentSeparator);
+    if (separator == ',') sepStr = ",";
+    else if (separator == ';') sepStr = ";";
+    else if (separator == '\t') sepStr = "Tab";
+    else sepStr = wxString(separator);
     
     // Get cell coordinates
     wxString coords = "";
@@ -818,133 +873,70 @@ void MainFrame::UpdateStatusBar() {
                                       Translate("status_separator", currentLanguage),
                                       sepStr,
                                       coords);
+    
+    // Duration of the last operation while the performance monitor runs
+    wxString operation;
+    double ms;
+    if (Profiler::IsEnabled() && Profiler::Get().GetLastOperation(operation, ms)) {
+        status += wxString::Format(" | %s: %.1f ms", operation, ms);
+    }
     statusBar->SetStatusText(status);
 }
 
 void MainFrame::UpdateMenuChecks() {
     wxMenuBar* menuBar = GetMenuBar();
+    CSVDocument* doc = GetActiveDocument();
+    Encoding encoding = doc->GetEncoding();
+    wxChar separator = doc->GetSeparator();
     
     // Update encoding checks
-    menuBar->Check(ID_ENC_UTF8, currentEncoding == Encoding::UTF8 || currentEncoding == Encoding::UTF8_BOM);
-    menuBar->Check(ID_ENC_ANSI, currentEncoding == Encoding::ANSI);
-    menuBar->Check(ID_ENC_UTF16, currentEncoding == Encoding::UTF16_LE || currentEncoding == Encoding::UTF16_BE);
+    menuBar->Check(ID_ENC_UTF8, encoding == Encoding::UTF8 || encoding == Encoding::UTF8_BOM);
+    menuBar->Check(ID_ENC_ANSI, encoding == Encoding::ANSI);
+    menuBar->Check(ID_ENC_UTF16, encoding == Encoding::UTF16_LE || encoding == Encoding::UTF16_BE);
     
     // Update separator checks
-    menuBar->Check(ID_SEP_COMMA, currentSeparator == ',');
-    menuBar->Check(ID_SEP_SEMICOLON, currentSeparator == ';');
-    menuBar->Check(ID_SEP_TAB, currentSeparator == '\t');
-    menuBar->Check(ID_SEP_CUSTOM, currentSeparator != ',' && currentSeparator != ';' && currentSeparator != '\t');
+    menuBar->Check(ID_SEP_COMMA, separator == ',');
+    menuBar->Check(ID_SEP_SEMICOLON, separator == ';');
+    menuBar->Check(ID_SEP_TAB, separator == '\t');
+    menuBar->Check(ID_SEP_CUSTOM, separator != ',' && separator != ';' && separator != '\t');
 }
 
-void MainFrame::SaveState() {
-    undoStack.push_back(GetCurrentState());
-    if (undoStack.size() > MAX_UNDO_LEVELS) {
-        undoStack.pop_front();
+void MainFrame::UpdateTitle() {
+    CSVDocument* doc = GetActiveDocument();
+    wxString title = "CSV++";
+    if (!doc->GetFile().IsEmpty()) {
+        title += " - " + wxFileName(doc->GetFile()).GetFullName();
     }
-    redoStack.clear();
-    UpdateUndoRedoButtons();
-}
-
-void MainFrame::RestoreState(const GridState& state) {
-    isRestoringState = true;
-    
-    // Save current column widths before clearing
-    std::vector<int> savedColWidths;
-    for (int col = 0; col < grid->GetNumberCols(); ++col) {
-        savedColWidths.push_back(grid->GetColSize(col));
+    if (doc->IsDirty()) {
+        title += " *";
     }
+    SetTitle(title);
     
-    ClearGrid();
-    
-    if (state.rows > 0 && state.cols > 0) {
-        grid->AppendRows(state.rows);
-        grid->AppendCols(state.cols);
-        
-        // Restore headers
-        for (int col = 0; col < state.cols && col < (int)state.headers.size(); ++col) {
-            grid->SetColLabelValue(col, state.headers[col]);
+    // Tab labels carry the same unsaved marker
+    for (size_t i = 0; i < notebook->GetPageCount(); ++i) {
+        CSVDocument* page = GetDocument(i);
+        wxString label = page->GetDisplayName();
+        if (page->IsDirty()) {
+            label += " *";
         }
-        
-        // Restore previously saved column widths (preserve user adjustments)
-        for (int col = 0; col < state.cols && col < (int)savedColWidths.size(); ++col) {
-            grid->SetColSize(col, savedColWidths[col]);
-        }
-        // For any new columns beyond saved widths, use default
-        for (int col = savedColWidths.size(); col < state.cols; ++col) {
-            grid->SetColSize(col, GetDefaultColumnWidth());
-        }
-        
-        // Apply row heights based on current font size
-        int rowHeight = currentFontSize * 2 + 8;
-        for (int i = 0; i < grid->GetNumberRows(); ++i) {
-            grid->SetRowSize(i, rowHeight);
-        }
-        grid->SetColLabelSize(rowHeight);
-        
-        // Restore data
-        for (int row = 0; row < state.rows && row < (int)state.data.size(); ++row) {
-            for (int col = 0; col < state.cols && col < (int)state.data[row].size(); ++col) {
-                grid->SetCellValue(row, col, state.data[row][col]);
-            }
+        if (notebook->GetPageText(i) != label) {
+            notebook->SetPageText(i, label);
         }
     }
-    
-    isRestoringState = false;
-    
-    UpdateStatusBar();
 }
 
-GridState MainFrame::GetCurrentState() {
-    GridState state;
-    state.rows = grid->GetNumberRows();
-    state.cols = grid->GetNumberCols();
-    
-    // Save headers
-    for (int col = 0; col < state.cols; ++col) {
-        state.headers.push_back(grid->GetColLabelValue(col));
-    }
-    
-    // Save data
-    for (int row = 0; row < state.rows; ++row) {
-        std::vector<wxString> rowData;
-        for (int col = 0; col < state.cols; ++col) {
-            rowData.push_back(grid->GetCellValue(row, col));
+bool MainFrame::PromptSaveChanges(CSVDocument* doc) {
+    if (doc->IsDirty()) {
+        // Show the document being asked about
+        int index = notebook->FindPage(doc);
+        if (index != wxNOT_FOUND && index != notebook->GetSelection()) {
+            notebook->SetSelection(index);
         }
-        state.data.push_back(rowData);
-    }
-    
-    return state;
-}
-
-void MainFrame::ClearGrid() {
-    if (grid->GetNumberRows() > 0) {
-        grid->DeleteRows(0, grid->GetNumberRows());
-    }
-    if (grid->GetNumberCols() > 0) {
-        grid->DeleteCols(0, grid->GetNumberCols());
-    }
-}
-
-void MainFrame::SetDirty(bool dirty) {
-    isDirty = dirty;
-    wxString title = "CSV++";
-    if (!currentFile.IsEmpty()) {
-        title += " - " + wxFileName(currentFile).GetFullName();
-    }
-    if (isDirty) {
-        title += " *";
-    }
-    SetTitle(title);
-}
-
-bool MainFrame::PromptSaveChanges() {
-    if (isDirty) {
+        
         int result = wxMessageBox(Translate("prompt_save_message", currentLanguage), Translate("prompt_save_title", currentLanguage),
                                  wxYES_NO | wxCANCEL | wxICON_QUESTION);
         if (result == wxYES) {
-            wxCommandEvent dummy;
-            OnSave(dummy);
-            return !isDirty; // Return false if save was cancelled
+            return SaveDocument(doc) && !doc->IsDirty(); // Return false if save was cancelled
         } else if (result == wxCANCEL) {
             return false;
         }
@@ -953,8 +945,17 @@ bool MainFrame::PromptSaveChanges() {
 }
 
 void MainFrame::UpdateUndoRedoButtons() {
-    toolBar->EnableTool(ID_UNDO, !undoStack.empty());
-    toolBar->EnableTool(ID_REDO, !redoStack.empty());
+    CSVDocument* doc = GetActiveDocument();
+    toolBar->EnableTool(ID_UNDO, doc->CanUndo());
+    toolBar->EnableTool(ID_REDO, doc->CanRedo());
+}
+
+void MainFrame::WarnJournalFailure() {
+    // The journal is written in the background, a failure shows on a later edit
+    if (GetActiveDocument()->TakeJournalFailure()) {
+        wxMessageBox(Translate("error_journal_write", currentLanguage),
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_WARNING);
+    }
 }
 
 void MainFrame::OnColSize(wxGridSizeEvent& event) {
@@ -964,7 +965,9 @@ void MainFrame::OnColSize(wxGridSizeEvent& event) {
 
 void MainFrame::OnSelectCell(wxGridEvent& event) {
     event.Skip();
-    if (grid && statusBar) {
+    CSVDocument* doc = GetActiveDocument();
+    if (doc && statusBar) {
+        wxGrid* grid = doc->GetGrid();
         // Get coordinates directly from the event
         int row = event.GetRow();
         int col = event.GetCol();
@@ -972,7 +975,7 @@ void MainFrame::OnSelectCell(wxGridEvent& event) {
             wxString coords = wxString::Format("[%d,%d]", col, row);
             // Update just the coordinates part of status bar
             wxString encStr;
-            switch (currentEncoding) {
+            switch (doc->GetEncoding()) {
                 case Encoding::UTF8:
                 case Encoding::UTF8_BOM:
                     encStr = "UTF-8";
@@ -986,11 +989,12 @@ void MainFrame::OnSelectCell(wxGridEvent& event) {
                     break;
             }
             
+            wxChar separator = doc->GetSeparator();
             wxString sepStr;
-            if (currentSeparator == ',') sepStr = ",";
-            else if (currentSeparator == ';') sepStr = ";";
-            else if (currentSeparator == '\t') sepStr = "Tab";
-            else sepStr = wxString(currentSeparator);
+            if (separator == ',') sepStr = ",";
+            else if (separator == ';') sepStr = ";";
+            else if (separator == '\t') sepStr = "Tab";
+            else sepStr = wxString(separator);
             
             wxString status = wxString::Format("%s: %d | %s: %d | %s: %s | %s: %s %s",
                                               Translate("status_rows", currentLanguage),
@@ -1033,82 +1037,456 @@ void MainFrame::OnFontSizeChange(wxCommandEvent& event) {
         config.Write("FontSize", (long)currentFontSize);
         config.Flush();
         
-        // Apply font size to all cells
-        wxFont font = grid->GetDefaultCellFont();
-        font.SetPointSize(currentFontSize);
-        grid->SetDefaultCellFont(font);
-        
-        // Apply to label cells as well
-        wxFont labelFont = grid->GetLabelFont();
-        labelFont.SetPointSize(currentFontSize);
-        grid->SetLabelFont(labelFont);
-        
-        // Apply row heights and column label height
-        int rowHeight = currentFontSize * 2 + 8;
-        for (int i = 0; i < grid->GetNumberRows(); ++i) {
-            grid->SetRowSize(i, rowHeight);
+        // Font size is shared by all open documents
+        for (size_t i = 0; i < notebook->GetPageCount(); ++i) {
+            GetDocument(i)->SetFontSize(currentFontSize);
         }
-        grid->SetColLabelSize(rowHeight);
-        
-        // Auto-size columns to fit content with 20% extra space
-        grid->AutoSizeColumns(false);
-        for (int col = 0; col < grid->GetNumberCols(); ++col) {
-            int width = grid->GetColSize(col);
-            grid->SetColSize(col, width + width / 5);
-        }
-        
-        // Refresh grid
-        grid->ForceRefresh();
     }
 }
 
-int MainFrame::GetDefaultColumnWidth() const {
-    // Base width for font size 8 is 60 pixels
-    return (currentFontSize * 60) / 8;
+void MainFrame::OnPageChanged(wxBookCtrlEvent& event) {
+    event.Skip();
+    // Pages are added while the frame is still being built
+    if (toolBar) {
+        UpdateDocumentUI();
+    }
+}
+
+CSVDocument* MainFrame::GetActiveDocument() const {
+    int selection = notebook->GetSelection();
+    if (selection == wxNOT_FOUND) {
+        return nullptr;
+    }
+    return GetDocument(selection);
+}
+
+CSVDocument* MainFrame::GetDocument(size_t index) const {
+    return static_cast<CSVDocument*>(notebook->GetPage(index));
 }
 
-void MainFrame::ApplyGridDimensions() {
-    // Calculate row height based on font size
-    // Formula: fontSize * 2 + 8 pixels
-    int rowHeight = currentFontSize * 2 + 8;
+CSVDocument* MainFrame::AddDocument() {
+    CSVDocument* doc = new CSVDocument(notebook, currentFontSize, currentLanguage);
+    doc->GetGrid()->Bind(wxEVT_KEY_DOWN, &MainFrame::OnGridKeyDown, this);
+    notebook->AddPage(doc, doc->GetDisplayName(), true);
+    return doc;
+}
+
+void MainFrame::CloseDocument(CSVDocument* doc) {
+    doc->StopJournal(true);
     
-    // Set row heights for all rows
-    for (int i = 0; i < grid->GetNumberRows(); ++i) {
-        grid->SetRowSize(i, rowHeight);
+    // The last tab is kept and emptied instead
+    if (notebook->GetPageCount() > 1) {
+        notebook->DeletePage(notebook->FindPage(doc));
+    } else {
+        doc->CloseFile();
     }
     
-    // Set column label height
-    grid->SetColLabelSize(rowHeight);
+    UpdateDocumentUI();
+}
+
+void MainFrame::UpdateDocumentUI() {
+    UpdateTitle();
+    UpdateStatusBar();
+    UpdateMenuChecks();
+    UpdateUndoRedoButtons();
+    WarnJournalFailure();
     
-    // Set column widths for all columns
-    int colWidth = GetDefaultColumnWidth();
-    for (int i = 0; i < grid->GetNumberCols(); ++i) {
-        grid->SetColSize(i, colWidth);
+    // Inactive documents give back their cold pages first
+    MemoryBudget::Get().SetActive(GetActiveDocument()->GetTable());
+    MemoryBudget::Get().Enforce();
+}
+
+void MainFrame::RecoverJournals() {
+    wxArrayString journals = EditJournal::FindPendingJournals();
+    for (size_t i = 0; i < journals.GetCount(); ++i) {
+        // Skip the journals of documents open in this session
+        bool owned = false;
+        for (size_t page = 0; page < notebook->GetPageCount(); ++page) {
+            if (journals[i] == GetDocument(page)->GetJournalPath()) {
+                owned = true;
+                break;
+            }
+        }
+        if (!owned) {
+            RecoverJournal(journals[i]);
+        }
     }
 }
 
+bool MainFrame::RecoverJournal(const wxString& path) {
+    JournalHeader header;
+    std::vector<JournalEntry> entries;
+    wxFileOffset validLength;
+    if (!EditJournal::ReadJournal(path, header, entries, validLength) || entries.empty()) {
+        wxRemoveFile(path);
+        return false;
+    }
+    
+    wxString name = header.sourceFile.IsEmpty() ? Translate("recover_untitled", currentLanguage) : header.sourceFile;
+    wxString message = wxString::Format(Translate("prompt_recover_message", currentLanguage), name, (int)entries.size());
+    
+    if (!header.sourceFile.IsEmpty()) {
+        if (!wxFileExists(header.sourceFile)) {
+            wxMessageBox(wxString::Format(Translate("error_recover_missing", currentLanguage), header.sourceFile),
+                        Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+            wxRemoveFile(path);
+            return false;
+        }
+        
+        JournalHeader current = EditJournal::MakeHeader(header.sourceFile, header.encoding, header.separator, header.hasHeader);
+        if (current.sourceSize != header.sourceSize || current.sourceModified != header.sourceModified) {
+            message += "\n\n" + Translate("prompt_recover_changed", currentLanguage);
+        }
+    }
+    
+    if (wxMessageBox(message, Translate("prompt_recover_title", currentLanguage), wxYES_NO | wxICON_QUESTION) != wxYES) {
+        wxRemoveFile(path);
+        return false;
+    }
+    
+    // Each recovered journal gets its own tab
+    CSVDocument* doc = GetActiveDocument();
+    bool reuse = doc && doc->IsUntouched();
+    if (!reuse) {
+        doc = AddDocument();
+    }
+    
+    if (!doc->Recover(path, header, entries, validLength)) {
+        if (!reuse) {
+            CloseDocument(doc);
+        }
+        return false;
+    }
+    
+    UpdateDocumentUI();
+    return true;
+}
+
 void MainFrame::UpdateUILanguage() {
     // Recreate menu bar with new language
     SetMenuBar(nullptr);
     CreateMenuBar();
     
-    // Update toolbar
+    // Update toolbar, keeping the query being written
+    wxString query = queryCtrl->GetValue();
     toolBar->Destroy();
     CreateToolBar();
+    queryCtrl->ChangeValue(query);
     
-    // Update menu checks
-    UpdateMenuChecks();
+    // Untitled tabs are named in the current language
+    for (size_t i = 0; i < notebook->GetPageCount(); ++i) {
+        GetDocument(i)->SetLanguage(currentLanguage);
+    }
     
     // Check language menu
     wxMenuBar* menuBar = GetMenuBar();
     menuBar->Check(ID_LANG_ENGLISH, currentLanguage == LANGUAGE_ENGLISH);
     menuBar->Check(ID_LANG_SERBIAN, currentLanguage == LANGUAGE_SERBIAN);
     
-    // Update status bar
-    UpdateStatusBar();
+    // Update title, status bar, menu checks and undo/redo buttons
+    UpdateDocumentUI();
+}
+
+void MainFrame::OnCompare(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    CompareDialog dialog(this, currentLanguage, doc->GetFile());
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
     
-    // Update undo/redo buttons
-    UpdateUndoRedoButtons();
+    CSVDiff::Input inputs[2];
+    wxString files[2] = { dialog.GetLeftFile(), dialog.GetRightFile() };
+    for (int i = 0; i < 2; ++i) {
+        if (!CSVDiff::DetectInput(files[i], dialog.GetHasHeader(), inputs[i])) {
+            wxMessageBox(Translate("error_compare_files", currentLanguage),
+                        Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+            return;
+        }
+        // The open document knows its format better than detection
+        if (!doc->GetFile().IsEmpty() && wxFileName(files[i]).SameAs(wxFileName(doc->GetFile()))) {
+            inputs[i].encoding = doc->GetEncoding();
+            inputs[i].separator = doc->GetSeparator();
+        }
+    }
+    
+    std::unique_ptr<CSVDiff> diff(new CSVDiff());
+    wxString error;
+    bool compared;
+    {
+        wxProgressDialog progress(Translate("dialog_compare_title", currentLanguage),
+                                  Translate("compare_progress", currentLanguage), 100, this,
+                                  wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+        compared = diff->Compare(inputs[0], inputs[1], dialog.GetKeyColumns(), error,
+                                 [&progress](int percent) { progress.Update(percent); });
+    }
+    
+    if (!compared) {
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    (new DiffFrame(this, std::move(diff), currentLanguage, currentFontSize))->Show();
+}
+
+void MainFrame::OnMerge(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    MergeDialog dialog(this, currentLanguage, doc->GetFile());
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    
+    CSVDiff::Input inputs[2];
+    wxString files[2] = { dialog.GetLeftFile(), dialog.GetRightFile() };
+    for (int i = 0; i < 2; ++i) {
+        if (!CSVDiff::DetectInput(files[i], dialog.GetHasHeader(), inputs[i])) {
+            wxMessageBox(Translate("error_merge_input", currentLanguage),
+                         Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+            return;
+        }
+        // The open document knows its format better than detection
+        if (!doc->GetFile().IsEmpty() && wxFileName(files[i]).SameAs(wxFileName(doc->GetFile()))) {
+            inputs[i].encoding = doc->GetEncoding();
+            inputs[i].separator = doc->GetSeparator();
+        }
+    }
+    
+    CSVJoin join;
+    wxString error;
+    bool merged;
+    {
+        wxProgressDialog progress(Translate("dialog_merge_title", currentLanguage),
+                                  Translate("merge_progress", currentLanguage), 100, this,
+                                  wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+        merged = join.Run(inputs[0], inputs[1], dialog.GetLeftKeys(), dialog.GetRightKeys(), dialog.GetType(),
+                          dialog.GetOutputFile(), error, [&progress](int percent) { progress.Update(percent); });
+    }
+    
+    if (!merged) {
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    // The result is in the left file's format
+    LoadCSVFile(dialog.GetOutputFile(), inputs[0].encoding, inputs[0].separator, inputs[0].hasHeader);
+}
+
+void MainFrame::OnSplit(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    SplitDialog dialog(this, currentLanguage, doc->GetFile());
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(dialog.GetInputFile(), dialog.GetHasHeader(), input)) {
+        wxMessageBox(Translate("error_split_input", currentLanguage),
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    // The open document knows its format better than detection
+    if (!doc->GetFile().IsEmpty() && wxFileName(input.filename).SameAs(wxFileName(doc->GetFile()))) {
+        input.encoding = doc->GetEncoding();
+    }
+    
+    CSVSplitter splitter;
+    wxString error;
+    bool split;
+    {
+        wxProgressDialog progress(Translate("dialog_split_title", currentLanguage),
+                                  Translate("split_progress", currentLanguage), 100, this,
+                                  wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+        split = splitter.Split(input, dialog.GetMode(), dialog.GetPartSize(), dialog.GetOutputFile(), error,
+                               [&progress](int percent) { progress.Update(percent); });
+    }
+    
+    if (!split) {
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    wxMessageBox(wxString::Format(Translate("msg_split_done", currentLanguage),
+                                  (int)splitter.GetOutputFiles().size(), (int)splitter.GetRowCount()),
+                 Translate("dialog_split_title", currentLanguage), wxOK | wxICON_INFORMATION);
+}
+
+void MainFrame::OnConcat(wxCommandEvent& event) {
+    ConcatDialog dialog(this, currentLanguage);
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    
+    wxArrayString files = dialog.GetInputFiles();
+    std::vector<CSVDiff::Input> inputs(files.GetCount());
+    for (size_t i = 0; i < files.GetCount(); ++i) {
+        if (!CSVDiff::DetectInput(files[i], dialog.GetHasHeader(), inputs[i])) {
+            wxMessageBox(Translate("error_concat_input", currentLanguage),
+                         Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+            return;
+        }
+    }
+    
+    CSVSplitter splitter;
+    wxString error;
+    bool concatenated;
+    {
+        wxProgressDialog progress(Translate("dialog_concat_title", currentLanguage),
+                                  Translate("concat_progress", currentLanguage), 100, this,
+                                  wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+        concatenated = splitter.Concat(inputs, dialog.GetOutputFile(), error,
+                                       [&progress](int percent) { progress.Update(percent); });
+    }
+    
+    if (!concatenated) {
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    LoadCSVFile(dialog.GetOutputFile(), inputs[0].encoding, inputs[0].separator, inputs[0].hasHeader);
+}
+
+void MainFrame::OnValidate(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    ValidateDialog dialog(this, currentLanguage, doc->GetFile());
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    
+    CSVDiff::Input input;
+    if (!CSVDiff::DetectInput(dialog.GetInputFile(), dialog.GetHasHeader(), input)) {
+        wxMessageBox(Translate("error_validate_input", currentLanguage),
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    // The open document knows its format better than detection
+    if (!doc->GetFile().IsEmpty() && wxFileName(input.filename).SameAs(wxFileName(doc->GetFile()))) {
+        input.encoding = doc->GetEncoding();
+        input.separator = doc->GetSeparator();
+    }
+    
+    CSVValidator validator;
+    wxString error;
+    if (!dialog.GetSchemaFile().IsEmpty() && !validator.LoadSchema(dialog.GetSchemaFile(), error)) {
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    
+    // Every issue goes to the report, the first ones are also listed in a tab
+    const size_t MAX_LISTED_ISSUES = 100000;
+    CSVWriter report;
+    bool writeReport = !dialog.GetReportFile().IsEmpty();
+    if (writeReport && !report.Open(dialog.GetReportFile(), Encoding::UTF8)) {
+        wxMessageBox(wxString::Format(Translate("error_validate_report", currentLanguage), dialog.GetReportFile()),
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    std::vector<wxString> header = CSVValidator::GetReportHeader();
+    std::unique_ptr<CSVTable> listed(new CSVTable());
+    bool writeFailed = false;
+    if (writeReport) {
+        wxString line;
+        CSVParser::AppendLine(line, header, ',');
+        writeFailed = !report.Write(line + wxT("\r\n"));
+    }
+    
+    bool validated;
+    {
+        wxProgressDialog progress(Translate("dialog_validate_title", currentLanguage),
+                                  Translate("validate_progress", currentLanguage), 100, this,
+                                  wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+        std::vector<wxString> fields;
+        validated = validator.Validate(input, [&](const CSVValidator::Issue& issue) {
+            validator.FormatIssue(issue, fields);
+            if (writeReport && !writeFailed) {
+                wxString line;
+                CSVParser::AppendLine(line, fields, ',');
+                writeFailed = !report.Write(line + wxT("\r\n"));
+            }
+            if (validator.GetIssueCount() <= MAX_LISTED_ISSUES) {
+                listed->AppendLoadedRow(fields, -1);
+            }
+        }, error, [&progress](int percent) { progress.Update(percent); });
+    }
+    
+    if (!validated) {
+        wxMessageBox(error, Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    if (writeReport && (writeFailed || !report.Close())) {
+        wxMessageBox(wxString::Format(Translate("error_validate_report", currentLanguage), dialog.GetReportFile()),
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    if (validator.GetIssueCount() == 0) {
+        wxMessageBox(wxString::Format(Translate("msg_validate_clean", currentLanguage), (int)validator.GetRowCount()),
+                     Translate("dialog_validate_title", currentLanguage), wxOK | wxICON_INFORMATION);
+        return;
+    }
+    
+    // The issues get a tab of their own, sorted and filtered like any table
+    listed->FinishLoad(header, header.size(), nullptr);
+    CSVDocument* issuesDoc = AddDocument();
+    issuesDoc->ShowQueryResult(listed.release(), Encoding::UTF8, ',');
+    UpdateDocumentUI();
+    wxMessageBox(wxString::Format(Translate("msg_validate_issues", currentLanguage),
+                                  (int)validator.GetIssueCount(), (int)validator.GetRowCount()),
+                 Translate("dialog_validate_title", currentLanguage), wxOK | wxICON_WARNING);
+}
+
+void MainFrame::OnPivot(wxCommandEvent& event) {
+    (new PivotFrame(this, GetActiveDocument(), currentLanguage, currentFontSize))->Show();
+}
+
+void MainFrame::OnDuplicates(wxCommandEvent& event) {
+    CSVDocument* doc = GetActiveDocument();
+    DuplicatesDialog dialog(this, currentLanguage, doc->GetColumnNames());
+    if (dialog.ShowModal() != wxID_OK) {
+        return;
+    }
+    
+    size_t count;
+    {
+        wxBusyCursor busy;
+        if (dialog.GetRemove()) {
+            count = doc->RemoveDuplicates(dialog.GetColumns(), dialog.GetKeep());
+        } else {
+            count = doc->SelectDuplicates(dialog.GetColumns(), dialog.GetKeep());
+        }
+    }
+    UpdateDocumentUI();
+    
+    wxString key = count == 0 ? "msg_no_duplicates" : (dialog.GetRemove() ? "msg_duplicates_removed" : "msg_duplicates_selected");
+    wxMessageBox(wxString::Format(Translate(key, currentLanguage), (int)count),
+                 Translate("dialog_duplicates_title", currentLanguage), wxOK | wxICON_INFORMATION);
+}
+
+void MainFrame::OnPerformance(wxCommandEvent& event) {
+    if (!performanceFrame) {
+        performanceFrame = new PerformanceFrame(this, currentLanguage);
+    }
+    performanceFrame->Start();
+}
+
+void MainFrame::OnQuery(wxCommandEvent& event) {
+    wxString sql = queryCtrl->GetValue();
+    if (sql.Strip(wxString::both).IsEmpty()) {
+        return;
+    }
+    
+    CSVDocument* doc = GetActiveDocument();
+    TableQuery query;
+    wxString error;
+    if (!query.Parse(sql, doc->GetColumnNames(), error)) {
+        wxMessageBox(Translate("error_query", currentLanguage) + "\n" + error,
+                     Translate("msg_error_title", currentLanguage), wxOK | wxICON_ERROR);
+        return;
+    }
+    
+    std::unique_ptr<CSVTable> result;
+    {
+        wxBusyCursor busy;
+        result = query.Run(*doc->GetTable());
+    }
+    
+    // The result gets a tab of its own, Save As exports it
+    CSVDocument* resultDoc = AddDocument();
+    resultDoc->ShowQueryResult(result.release(), doc->GetEncoding(), doc->GetSeparator());
+    UpdateDocumentUI();
 }
 
 void MainFrame::OnInstructions(wxCommandEvent& event) {
@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    :
+#ifdef __WXMSW__
+      fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr),
+#else
+      fd(-1),
+#endif
+      data(nullptr), size(0), opened(false), compression(Compression::NONE) {
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const wxString& name) {
+    Close();
+
+#ifdef __WXMSW__
+    // Share everything so other programs can still read the file while it is open
+    HANDLE file = ::CreateFileW(name.wc_str(), GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(file, &fileSize)) {
+        ::CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    size = (size_t)fileSize.QuadPart;
+    
+    // Zero length files cannot be mapped
+    if (size > 0) {
+        mappingHandle = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mappingHandle) {
+            Close();
+            return false;
+        }
+        data = (const char*)::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            Close();
+            return false;
+        }
+    }
+#else
+    fd = ::open(name.utf8_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        Close();
+        return false;
+    }
+    size = (size_t)info.st_size;
+    
+    if (size > 0) {
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            Close();
+            return false;
+        }
+        data = (const char*)mapped;
+    }
+#endif
+    
+    // The mapping stays as the input of the decompressor
+    compression = DetectCompression(data, size);
+    if (compression != Compression::NONE) {
+        decompressed.reset(new DecompressedBuffer());
+        if (!decompressed->Start(data, size, compression)) {
+            Close();
+            return false;
+        }
+    }
+    
+    filename = name;
+    opened = true;
+    return true;
+}
+
+void MappedFile::Close() {
+    // Stop the decompressor before its input is unmapped
+    decompressed.reset();
+    compression = Compression::NONE;
+
+#ifdef __WXMSW__
+    if (data) {
+        ::UnmapViewOfFile(data);
+    }
+    if (mappingHandle) {
+        ::CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data) {
+        ::munmap((void*)data, size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    opened = false;
+    filename.Clear();
+}
+
+void MappedFile::AdviseSequential() {
+#ifndef __WXMSW__
+    // On Windows the FILE_FLAG_SEQUENTIAL_SCAN hint is given at open time
+    if (data) {
+        ::madvise((void*)data, size, MADV_SEQUENTIAL);
+    }
+#endif
+}
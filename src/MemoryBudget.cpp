@@ -0,0 +1,92 @@
+#include "MemoryBudget.h"
+#include "CSVTable.h"
+#include "Profiler.h"
+#include <wx/config.h>
+#include <algorithm>
+
+MemoryBudget& MemoryBudget::Get() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget() : active(nullptr) {
+    // Budget in megabytes, configurable in the registry (default 2 GB)
+    wxConfig config("CSV++");
+    long budgetMB = 2048;
+    config.Read("MemoryBudgetMB", &budgetMB);
+    limit = (size_t)wxMax(budgetMB, 64L) * 1024 * 1024;
+}
+
+void MemoryBudget::Register(CSVTable* table) {
+    tables.push_back(table);
+}
+
+void MemoryBudget::Unregister(CSVTable* table) {
+    tables.erase(std::remove(tables.begin(), tables.end(), table), tables.end());
+    if (active == table) {
+        active = nullptr;
+    }
+}
+
+void MemoryBudget::SetActive(CSVTable* table) {
+    active = table;
+}
+
+void MemoryBudget::SetLimit(size_t bytes) {
+    limit = bytes;
+}
+
+size_t MemoryBudget::GetUsage() const {
+    size_t usage = 0;
+    for (CSVTable* table : tables) {
+        usage += table->GetMemoryUsage();
+    }
+    return usage;
+}
+
+size_t MemoryBudget::Enforce() {
+    PROFILE_SCOPE("budget.enforce");
+    size_t usage = GetUsage();
+    size_t target = limit;
+    
+    // When the system is short on memory, give back what it is missing
+    wxLongLong freeMemory = wxGetFreeMemory();
+    if (freeMemory.GetValue() >= 0 && (size_t)freeMemory.GetValue() < LOW_MEMORY_BYTES) {
+        size_t missing = LOW_MEMORY_BYTES - (size_t)freeMemory.GetValue();
+        target = wxMin(target, usage > missing ? usage - missing : 0);
+    }
+    if (usage <= target) {
+        return 0;
+    }
+    
+    struct Candidate {
+        CSVTable* table;
+        size_t page;
+        unsigned long long lastAccess;
+    };
+    std::vector<Candidate> candidates;
+    for (CSVTable* table : tables) {
+        if (table == active) {
+            continue;
+        }
+        for (size_t page = 0; page < table->GetPageCount(); ++page) {
+            if (table->CanEvictPage(page)) {
+                candidates.push_back({table, page, table->GetPageLastAccess(page)});
+            }
+        }
+    }
+    
+    // Coldest pages first
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.lastAccess < b.lastAccess;
+    });
+    
+    size_t freed = 0;
+    for (const Candidate& candidate : candidates) {
+        if (usage - freed <= target) {
+            break;
+        }
+        freed += candidate.table->EvictPage(candidate.page);
+    }
+    return freed;
+}
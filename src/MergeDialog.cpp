@@ -0,0 +1,98 @@
+#include "MergeDialog.h"
+
+wxBEGIN_EVENT_TABLE(MergeDialog, wxDialog)
+    EVT_BUTTON(wxID_OK, MergeDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+MergeDialog::MergeDialog(wxWindow* parent, Language language, const wxString& leftFile)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_merge_title", language), wxDefaultPosition, wxSize(500, 520)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    wxString wildcard = "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*";
+    
+    // File whose rows are kept, defaults to the active document
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_left", language)), 0, wxALL, 5);
+    leftPicker = new wxFilePickerCtrl(this, wxID_ANY, leftFile, Translate("merge_left", language), wildcard,
+                                      wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(leftPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // File the columns are looked up in
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_right", language)), 0, wxALL, 5);
+    rightPicker = new wxFilePickerCtrl(this, wxID_ANY, "", Translate("merge_right", language), wildcard,
+                                       wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(rightPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Header checkbox
+    headerCheckBox = new wxCheckBox(this, wxID_ANY, Translate("compare_header", language));
+    headerCheckBox->SetValue(true);
+    mainSizer->Add(headerCheckBox, 0, wxALL, 5);
+    
+    // Key columns, the right ones default to the left ones
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_left_keys", language)), 0, wxALL, 5);
+    leftKeyText = new wxTextCtrl(this, wxID_ANY);
+    mainSizer->Add(leftKeyText, 0, wxALL | wxEXPAND, 5);
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_right_keys", language)), 0, wxALL, 5);
+    rightKeyText = new wxTextCtrl(this, wxID_ANY);
+    mainSizer->Add(rightKeyText, 0, wxALL | wxEXPAND, 5);
+    
+    // Join type, in the order of CSVJoin::Type
+    wxArrayString types;
+    types.Add(Translate("merge_inner", language));
+    types.Add(Translate("merge_left_join", language));
+    types.Add(Translate("merge_anti", language));
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_type", language)), 0, wxALL, 5);
+    typeChoice = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, types);
+    typeChoice->SetSelection(1);
+    mainSizer->Add(typeChoice, 0, wxALL | wxEXPAND, 5);
+    
+    // Result file
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("merge_output", language)), 0, wxALL, 5);
+    outputPicker = new wxFilePickerCtrl(this, wxID_ANY, "", Translate("merge_output", language), wildcard,
+                                        wxDefaultPosition, wxDefaultSize, wxFLP_SAVE | wxFLP_OVERWRITE_PROMPT | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(outputPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void MergeDialog::OnOK(wxCommandEvent& event) {
+    if (!wxFileExists(GetLeftFile()) || !wxFileExists(GetRightFile()) || GetOutputFile().IsEmpty() ||
+        GetLeftKeys().Strip(wxString::both).IsEmpty()) {
+        wxMessageBox(Translate("error_merge_input", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxString MergeDialog::GetLeftFile() const {
+    return leftPicker->GetPath();
+}
+
+wxString MergeDialog::GetRightFile() const {
+    return rightPicker->GetPath();
+}
+
+wxString MergeDialog::GetOutputFile() const {
+    return outputPicker->GetPath();
+}
+
+bool MergeDialog::GetHasHeader() const {
+    return headerCheckBox->GetValue();
+}
+
+wxString MergeDialog::GetLeftKeys() const {
+    return leftKeyText->GetValue();
+}
+
+wxString MergeDialog::GetRightKeys() const {
+    return rightKeyText->GetValue();
+}
+
+CSVJoin::Type MergeDialog::GetType() const {
+    return (CSVJoin::Type)typeChoice->GetSelection();
+}
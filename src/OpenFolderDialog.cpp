@@ -0,0 +1,50 @@
+#include "OpenFolderDialog.h"
+#include "ShardSource.h"
+#include <wx/filename.h>
+
+wxBEGIN_EVENT_TABLE(OpenFolderDialog, wxDialog)
+    EVT_BUTTON(wxID_OK, OpenFolderDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+OpenFolderDialog::OpenFolderDialog(wxWindow* parent, Language language)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_open_folder_title", language), wxDefaultPosition, wxSize(500, 250)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    // Folder holding the files
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("open_folder_folder", language)), 0, wxALL, 5);
+    folderPicker = new wxDirPickerCtrl(this, wxID_ANY, wxGetCwd(), Translate("open_folder_folder", language),
+                                       wxDefaultPosition, wxDefaultSize, wxDIRP_DIR_MUST_EXIST | wxDIRP_USE_TEXTCTRL);
+    mainSizer->Add(folderPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Wildcards in the file name, empty for every CSV and text file
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("open_folder_pattern", language)), 0, wxALL, 5);
+    patternText = new wxTextCtrl(this, wxID_ANY, "*.csv");
+    mainSizer->Add(patternText, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void OpenFolderDialog::OnOK(wxCommandEvent& event) {
+    wxArrayString files;
+    if (!ShardSource::FindFiles(GetPattern(), files)) {
+        wxMessageBox(Translate("error_open_folder", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxString OpenFolderDialog::GetPattern() const {
+    wxString folder = folderPicker->GetPath();
+    wxString pattern = patternText->GetValue().Strip(wxString::both);
+    if (pattern.IsEmpty()) {
+        return folder;
+    }
+    return wxFileName(folder, pattern).GetFullPath();
+}
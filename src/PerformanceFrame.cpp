@@ -0,0 +1,97 @@
+#include "PerformanceFrame.h"
+#include "Profiler.h"
+#include <wx/filedlg.h>
+#include <wx/msgdlg.h>
+
+wxBEGIN_EVENT_TABLE(PerformanceFrame, wxFrame)
+    EVT_TIMER(wxID_ANY, PerformanceFrame::OnTimer)
+    EVT_BUTTON(ID_RESET, PerformanceFrame::OnReset)
+    EVT_BUTTON(ID_SAVE_TRACE, PerformanceFrame::OnSaveTrace)
+    EVT_CLOSE(PerformanceFrame::OnCloseWindow)
+wxEND_EVENT_TABLE()
+
+PerformanceFrame::PerformanceFrame(wxWindow* parent, Language language)
+    : wxFrame(parent, wxID_ANY, Translate("perf_title", language), wxDefaultPosition, wxSize(760, 420)),
+      language(language),
+      timer(this) {
+    
+    wxPanel* panel = new wxPanel(this);
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    
+    list = new wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxLC_SINGLE_SEL);
+    list->InsertColumn(0, Translate("perf_scope", language), wxLIST_FORMAT_LEFT, 200);
+    list->InsertColumn(1, Translate("perf_calls", language), wxLIST_FORMAT_RIGHT, 70);
+    list->InsertColumn(2, Translate("perf_total", language), wxLIST_FORMAT_RIGHT, 90);
+    list->InsertColumn(3, Translate("perf_average", language), wxLIST_FORMAT_RIGHT, 90);
+    list->InsertColumn(4, Translate("perf_max", language), wxLIST_FORMAT_RIGHT, 90);
+    list->InsertColumn(5, Translate("perf_allocations", language), wxLIST_FORMAT_RIGHT, 90);
+    list->InsertColumn(6, Translate("perf_bytes", language), wxLIST_FORMAT_RIGHT, 90);
+    mainSizer->Add(list, 1, wxEXPAND | wxALL, 8);
+    
+    wxBoxSizer* buttonSizer = new wxBoxSizer(wxHORIZONTAL);
+    buttonSizer->Add(new wxButton(panel, ID_RESET, Translate("perf_reset", language)), 0, wxRIGHT, 8);
+    buttonSizer->Add(new wxButton(panel, ID_SAVE_TRACE, Translate("perf_save_trace", language)));
+    mainSizer->Add(buttonSizer, 0, wxLEFT | wxRIGHT | wxBOTTOM, 8);
+    
+    panel->SetSizer(mainSizer);
+}
+
+void PerformanceFrame::Start() {
+    Profiler::Get().SetEnabled(true);
+    UpdateStats();
+    timer.Start(REFRESH_MS);
+    Show();
+    Raise();
+}
+
+void PerformanceFrame::UpdateStats() {
+    std::vector<ProfileStat> stats = Profiler::Get().GetStats();
+    
+    list->Freeze();
+    list->DeleteAllItems();
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const ProfileStat& stat = stats[i];
+        long item = list->InsertItem((long)i, wxString::FromUTF8(stat.name));
+        list->SetItem(item, 1, wxString::Format("%llu", (unsigned long long)stat.calls));
+        list->SetItem(item, 2, wxString::Format("%.1f", stat.totalMs));
+        list->SetItem(item, 3, wxString::Format("%.2f", stat.calls ? stat.totalMs / stat.calls : 0.0));
+        list->SetItem(item, 4, wxString::Format("%.1f", stat.maxMs));
+        list->SetItem(item, 5, wxString::Format("%llu", (unsigned long long)stat.allocations));
+        list->SetItem(item, 6, wxString::Format("%llu", (unsigned long long)(stat.allocatedBytes / 1024)));
+    }
+    list->Thaw();
+}
+
+void PerformanceFrame::OnTimer(wxTimerEvent& event) {
+    UpdateStats();
+}
+
+void PerformanceFrame::OnReset(wxCommandEvent& event) {
+    Profiler::Get().Reset();
+    UpdateStats();
+}
+
+void PerformanceFrame::OnSaveTrace(wxCommandEvent& event) {
+    wxFileDialog saveDialog(this, Translate("perf_save_trace", language), "", "trace.json",
+                            Translate("perf_trace_files", language),
+                            wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    
+    if (!Profiler::Get().WriteTrace(saveDialog.GetPath())) {
+        wxMessageBox(Translate("error_perf_trace", language), "Error", wxOK | wxICON_ERROR);
+    }
+}
+
+void PerformanceFrame::OnCloseWindow(wxCloseEvent& event) {
+    // Kept around so the next Start shows the totals collected so far
+    Profiler::Get().SetEnabled(false);
+    timer.Stop();
+    if (event.CanVeto()) {
+        event.Veto();
+        Hide();
+    } else {
+        Destroy();
+    }
+}
@@ -0,0 +1,204 @@
+#include "PivotFrame.h"
+#include "CSVTable.h"
+#include <wx/filedlg.h>
+#include <wx/msgdlg.h>
+
+wxBEGIN_EVENT_TABLE(PivotFrame, wxFrame)
+    EVT_CHECKLISTBOX(ID_ROW_KEYS, PivotFrame::OnKeysChanged)
+    EVT_CHECKLISTBOX(ID_COLUMN_KEYS, PivotFrame::OnKeysChanged)
+    EVT_BUTTON(ID_ADD_VALUE, PivotFrame::OnAddValue)
+    EVT_BUTTON(ID_REMOVE_VALUE, PivotFrame::OnRemoveValue)
+    EVT_BUTTON(ID_REFRESH, PivotFrame::OnRefresh)
+    EVT_BUTTON(ID_EXPORT, PivotFrame::OnExport)
+wxEND_EVENT_TABLE()
+
+PivotFrame::PivotFrame(wxWindow* parent, CSVDocument* source, Language language, int fontSize)
+    : wxFrame(parent, wxID_ANY, Translate("pivot_title", language) + " - " + source->GetDisplayName(),
+              wxDefaultPosition, wxSize(1000, 600)),
+      document(source),
+      table(source->GetTable()),
+      language(language),
+      encoding(source->GetEncoding()),
+      separator(source->GetSeparator()),
+      result(nullptr) {
+    
+    wxPanel* panel = new wxPanel(this);
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxHORIZONTAL);
+    
+    wxArrayString names;
+    for (const wxString& name : source->GetColumnNames()) {
+        names.Add(name);
+    }
+    wxArrayString functions;
+    const PivotTable::Function allFunctions[] = {
+        PivotTable::Function::COUNT, PivotTable::Function::SUM, PivotTable::Function::AVG,
+        PivotTable::Function::MIN, PivotTable::Function::MAX, PivotTable::Function::DISTINCT
+    };
+    for (PivotTable::Function function : allFunctions) {
+        functions.Add(PivotTable::GetFunctionName(function));
+    }
+    
+    // Layout on the left, result on the right
+    wxBoxSizer* layoutSizer = new wxBoxSizer(wxVERTICAL);
+    layoutSizer->Add(new wxStaticText(panel, wxID_ANY, Translate("pivot_rows", language)), 0, wxBOTTOM, 4);
+    rowKeyList = new wxCheckListBox(panel, ID_ROW_KEYS, wxDefaultPosition, wxSize(220, -1), names);
+    layoutSizer->Add(rowKeyList, 1, wxEXPAND | wxBOTTOM, 8);
+    layoutSizer->Add(new wxStaticText(panel, wxID_ANY, Translate("pivot_columns", language)), 0, wxBOTTOM, 4);
+    columnKeyList = new wxCheckListBox(panel, ID_COLUMN_KEYS, wxDefaultPosition, wxSize(220, -1), names);
+    layoutSizer->Add(columnKeyList, 1, wxEXPAND | wxBOTTOM, 8);
+    
+    layoutSizer->Add(new wxStaticText(panel, wxID_ANY, Translate("pivot_values", language)), 0, wxBOTTOM, 4);
+    wxBoxSizer* valueSizer = new wxBoxSizer(wxHORIZONTAL);
+    functionChoice = new wxChoice(panel, wxID_ANY, wxDefaultPosition, wxSize(90, -1), functions);
+    functionChoice->SetSelection(0);
+    valueSizer->Add(functionChoice, 0, wxRIGHT, 4);
+    valueColumnChoice = new wxChoice(panel, wxID_ANY, wxDefaultPosition, wxSize(126, -1), names);
+    valueColumnChoice->SetSelection(names.IsEmpty() ? wxNOT_FOUND : 0);
+    valueSizer->Add(valueColumnChoice, 1);
+    layoutSizer->Add(valueSizer, 0, wxEXPAND | wxBOTTOM, 4);
+    valueList = new wxListBox(panel, wxID_ANY, wxDefaultPosition, wxSize(220, 80));
+    layoutSizer->Add(valueList, 1, wxEXPAND | wxBOTTOM, 4);
+    wxBoxSizer* valueButtonSizer = new wxBoxSizer(wxHORIZONTAL);
+    valueButtonSizer->Add(new wxButton(panel, ID_ADD_VALUE, Translate("pivot_add_value", language)), 1, wxRIGHT, 4);
+    valueButtonSizer->Add(new wxButton(panel, ID_REMOVE_VALUE, Translate("pivot_remove_value", language)), 1);
+    layoutSizer->Add(valueButtonSizer, 0, wxEXPAND | wxBOTTOM, 8);
+    
+    wxBoxSizer* buttonSizer = new wxBoxSizer(wxHORIZONTAL);
+    buttonSizer->Add(new wxButton(panel, ID_REFRESH, Translate("pivot_refresh", language)), 1, wxRIGHT, 4);
+    buttonSizer->Add(new wxButton(panel, ID_EXPORT, Translate("pivot_export", language)), 1);
+    layoutSizer->Add(buttonSizer, 0, wxEXPAND);
+    mainSizer->Add(layoutSizer, 0, wxEXPAND | wxALL, 8);
+    
+    wxBoxSizer* resultSizer = new wxBoxSizer(wxVERTICAL);
+    status = new wxStaticText(panel, wxID_ANY, Translate("pivot_pick", language));
+    resultSizer->Add(status, 0, wxBOTTOM, 4);
+    grid = new wxGrid(panel, wxID_ANY);
+    grid->EnableEditing(false);
+    grid->EnableDragRowSize(false);
+    grid->SetDefaultCellOverflow(false);
+    wxFont font = grid->GetDefaultCellFont();
+    font.SetPointSize(fontSize);
+    grid->SetDefaultCellFont(font);
+    wxFont labelFont = grid->GetLabelFont();
+    labelFont.SetPointSize(fontSize);
+    grid->SetLabelFont(labelFont);
+    int rowHeight = fontSize * 2 + 8;
+    grid->SetDefaultRowSize(rowHeight, true);
+    grid->SetColLabelSize(rowHeight);
+    grid->SetDefaultColSize((fontSize * 60) / 8, true);
+    resultSizer->Add(grid, 1, wxEXPAND);
+    mainSizer->Add(resultSizer, 1, wxEXPAND | wxTOP | wxRIGHT | wxBOTTOM, 8);
+    
+    panel->SetSizer(mainSizer);
+    Centre();
+}
+
+bool PivotFrame::IsSourceOpen() const {
+    // The pivot reads the table it was opened on, not a file opened in its place
+    CSVDocument* source = document;
+    return source && source->GetTable() == table;
+}
+
+void PivotFrame::UpdatePivot() {
+    if (!IsSourceOpen()) {
+        pivot.reset();
+        status->SetLabel(Translate("pivot_source_closed", language));
+        return;
+    }
+    
+    PivotTable::Layout layout;
+    wxArrayInt checked;
+    rowKeyList->GetCheckedItems(checked);
+    layout.rowKeys.assign(checked.begin(), checked.end());
+    columnKeyList->GetCheckedItems(checked);
+    layout.columnKeys.assign(checked.begin(), checked.end());
+    layout.values = values;
+    if (layout.rowKeys.empty() && layout.columnKeys.empty() && layout.values.empty()) {
+        status->SetLabel(Translate("pivot_pick", language));
+        return;
+    }
+    
+    if (!pivot) {
+        pivot.reset(new PivotTable(*table));
+    }
+    std::unique_ptr<CSVTable> output;
+    wxString error;
+    bool computed;
+    {
+        wxBusyCursor busy;
+        computed = pivot->Compute(layout, output, error);
+    }
+    if (!computed) {
+        status->SetLabel(Translate("pivot_error", language) + " " + error);
+        return;
+    }
+    
+    result = output.release();
+    grid->SetTable(result, true);
+    status->SetLabel(wxString::Format(Translate("pivot_summary", language), result->GetNumberRows()));
+    // Measuring every row of a long result would take longer than computing it
+    if (result->GetNumberRows() <= AUTOSIZE_ROWS) {
+        grid->AutoSizeColumns(false);
+    }
+    grid->ForceRefresh();
+}
+
+void PivotFrame::OnKeysChanged(wxCommandEvent& event) {
+    UpdatePivot();
+}
+
+void PivotFrame::OnAddValue(wxCommandEvent& event) {
+    int column = valueColumnChoice->GetSelection();
+    int function = functionChoice->GetSelection();
+    if (column == wxNOT_FOUND || function == wxNOT_FOUND) {
+        return;
+    }
+    PivotTable::Value value = { column, (PivotTable::Function)function };
+    values.push_back(value);
+    valueList->Append(functionChoice->GetString(function) + "(" + valueColumnChoice->GetString(column) + ")");
+    UpdatePivot();
+}
+
+void PivotFrame::OnRemoveValue(wxCommandEvent& event) {
+    int index = valueList->GetSelection();
+    if (index == wxNOT_FOUND) {
+        return;
+    }
+    values.erase(values.begin() + index);
+    valueList->Delete(index);
+    UpdatePivot();
+}
+
+void PivotFrame::OnRefresh(wxCommandEvent& event) {
+    // Read the table again, it may have been edited since
+    pivot.reset();
+    UpdatePivot();
+}
+
+void PivotFrame::OnExport(wxCommandEvent& event) {
+    if (!result) {
+        return;
+    }
+    wxFileDialog saveDialog(this, Translate("pivot_export", language), "", "pivot.csv",
+                            "CSV files (*.csv)|*.csv|All files (*.*)|*.*",
+                            wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    
+    // In the source file's dialect, the labels as the header row
+    int cols = result->GetNumberCols();
+    RowSource rows = [this, cols](size_t row, std::vector<wxString>& fields) {
+        fields.resize(cols);
+        for (int col = 0; col < cols; ++col) {
+            if (row == 0) {
+                fields[col] = result->GetColLabelValue(col);
+            } else {
+                result->CopyValue((int)row - 1, col, fields[col]);
+            }
+        }
+    };
+    if (!CSVParser::WriteFile(saveDialog.GetPath(), result->GetNumberRows() + 1, rows, separator, encoding)) {
+        wxMessageBox(Translate("msg_save_error", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+    }
+}
@@ -0,0 +1,533 @@
+#include "PivotTable.h"
+#include "CSVTable.h"
+#include "ColumnExpression.h"
+#include "TableQuery.h"
+#include "RowHash.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Set of indices into a vector of values, hashed and compared by value, so
+// a value is looked up by appending it and stored only once
+struct ValueHash {
+    const std::vector<wxString>* values;
+    size_t operator()(uint32_t index) const { return (size_t)HashField((*values)[index], 0); }
+};
+
+struct ValueEqual {
+    const std::vector<wxString>* values;
+    bool operator()(uint32_t a, uint32_t b) const { return (*values)[a] == (*values)[b]; }
+};
+
+typedef std::unordered_set<uint32_t, ValueHash, ValueEqual> ValueSet;
+
+// Code of the value just appended to values, dropping it again when it was already there
+uint32_t InternLast(ValueSet& set, std::vector<wxString>& values) {
+    auto inserted = set.insert((uint32_t)(values.size() - 1));
+    if (!inserted.second) {
+        values.pop_back();
+    }
+    return *inserted.first;
+}
+
+// Top bits of a multiplicative hash, so neighbouring keys spread out
+size_t PartitionOf(uint64_t key) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 58);
+}
+
+// Consecutive ranges of [0, count) for tasks that must know their index
+size_t BlockCount(size_t count, size_t minimum) {
+    size_t blocks = wxMin(count / minimum + 1, WorkerPool::Get().GetThreadCount() * 4);
+    return wxMax(blocks, (size_t)1);
+}
+
+size_t BlockStart(size_t count, size_t blocks, size_t block) {
+    return count * block / blocks;
+}
+
+}
+
+PivotTable::PivotTable(CSVTable& table)
+    : table(table),
+      cachedRows(0),
+      cachedCols(0) {
+}
+
+PivotTable::~PivotTable() {
+}
+
+void PivotTable::Clear() {
+    columns.clear();
+    grouping.reset();
+}
+
+wxString PivotTable::GetFunctionName(Function function) {
+    switch (function) {
+        case Function::COUNT: return "COUNT";
+        case Function::SUM: return "SUM";
+        case Function::AVG: return "AVG";
+        case Function::MIN: return "MIN";
+        case Function::MAX: return "MAX";
+        case Function::DISTINCT: return "DISTINCT";
+    }
+    return wxString();
+}
+
+bool PivotTable::Compute(const Layout& layout, std::unique_ptr<CSVTable>& result, wxString& error) {
+    PROFILE_SCOPE("pivot.compute");
+    // Cached codes cover the rows the table had when they were read
+    size_t tableRows = (size_t)table.GetNumberRows();
+    size_t tableCols = (size_t)table.GetNumberCols();
+    if (tableRows != cachedRows || tableCols != cachedCols) {
+        Clear();
+        cachedRows = tableRows;
+        cachedCols = tableCols;
+    }
+    auto outside = [tableCols](int col) { return col < 0 || (size_t)col >= tableCols; };
+    if (std::any_of(layout.rowKeys.begin(), layout.rowKeys.end(), outside) ||
+        std::any_of(layout.columnKeys.begin(), layout.columnKeys.end(), outside) ||
+        std::any_of(layout.values.begin(), layout.values.end(), [&outside](const Value& value) {
+            return outside(value.column);
+        })) {
+        error = "A chosen column no longer exists";
+        return false;
+    }
+    
+    std::vector<int> keys = layout.rowKeys;
+    keys.insert(keys.end(), layout.columnKeys.begin(), layout.columnKeys.end());
+    if (!GroupRows(keys, error)) {
+        return false;
+    }
+    std::vector<std::vector<wxString>> cells;
+    Aggregate(layout.values, cells);
+    
+    // A packed key is its row part times the column key combinations plus its column part
+    size_t rowKeyCount = layout.rowKeys.size();
+    uint64_t columnSpace = 1;
+    for (size_t i = rowKeyCount; i < keys.size(); ++i) {
+        columnSpace *= grouping->sizes[i];
+    }
+    auto codeOf = [this](uint64_t packed, size_t key) {
+        return (uint32_t)((packed / grouping->radix[key]) % grouping->sizes[key]);
+    };
+    
+    std::vector<uint64_t> rowParts;
+    std::vector<uint64_t> columnParts;
+    std::unordered_map<uint64_t, size_t> rowIndex;
+    std::unordered_map<uint64_t, size_t> columnIndex;
+    for (const Partition& partition : grouping->partitions) {
+        for (uint64_t packed : partition.groupKeys) {
+            if (rowIndex.emplace(packed / columnSpace, 0).second) {
+                rowParts.push_back(packed / columnSpace);
+            }
+            if (columnIndex.emplace(packed % columnSpace, 0).second) {
+                columnParts.push_back(packed % columnSpace);
+            }
+        }
+    }
+    size_t valueCount = layout.values.size();
+    if (rowKeyCount + columnParts.size() * wxMax(valueCount, (size_t)1) > MAX_RESULT_COLUMNS) {
+        error = wxString::Format("The column keys give more than %d columns", (int)MAX_RESULT_COLUMNS);
+        return false;
+    }
+    
+    // Rows and columns in the order of their key values
+    auto sortParts = [&](std::vector<uint64_t>& parts, uint64_t scale, size_t firstKey, size_t endKey) {
+        std::sort(parts.begin(), parts.end(), [&](uint64_t a, uint64_t b) {
+            for (size_t key = firstKey; key < endKey; ++key) {
+                const std::vector<uint32_t>& ranks = columns[keys[key]]->ranks;
+                uint32_t aRank = ranks[codeOf(a * scale, key)];
+                uint32_t bRank = ranks[codeOf(b * scale, key)];
+                if (aRank != bRank) {
+                    return aRank < bRank;
+                }
+            }
+            return false;
+        });
+    };
+    sortParts(rowParts, columnSpace, 0, rowKeyCount);
+    sortParts(columnParts, 1, rowKeyCount, keys.size());
+    for (size_t i = 0; i < rowParts.size(); ++i) {
+        rowIndex[rowParts[i]] = i;
+    }
+    for (size_t i = 0; i < columnParts.size(); ++i) {
+        columnIndex[columnParts[i]] = i;
+    }
+    
+    std::vector<wxString> labels;
+    for (int col : layout.rowKeys) {
+        labels.push_back(table.GetColLabelValue(col));
+    }
+    for (uint64_t part : columnParts) {
+        wxString prefix;
+        for (size_t key = rowKeyCount; key < keys.size(); ++key) {
+            prefix += (key > rowKeyCount ? " / " : "") + columns[keys[key]]->values[codeOf(part, key)];
+        }
+        for (const Value& value : layout.values) {
+            wxString label = GetFunctionName(value.function) + "(" + table.GetColLabelValue(value.column) + ")";
+            labels.push_back(rowKeyCount == keys.size() ? label : prefix + ": " + label);
+        }
+    }
+    
+    std::vector<std::vector<wxString>> rows(rowParts.size(), std::vector<wxString>(labels.size()));
+    for (size_t row = 0; row < rowParts.size(); ++row) {
+        for (size_t key = 0; key < rowKeyCount; ++key) {
+            rows[row][key] = columns[keys[key]]->values[codeOf(rowParts[row] * columnSpace, key)];
+        }
+    }
+    for (size_t p = 0; p < grouping->partitions.size(); ++p) {
+        const Partition& partition = grouping->partitions[p];
+        for (size_t group = 0; group < partition.groupKeys.size(); ++group) {
+            uint64_t packed = partition.groupKeys[group];
+            std::vector<wxString>& row = rows[rowIndex[packed / columnSpace]];
+            size_t first = rowKeyCount + columnIndex[packed % columnSpace] * valueCount;
+            for (size_t v = 0; v < valueCount; ++v) {
+                row[first + v] = std::move(cells[p][group * valueCount + v]);
+            }
+        }
+    }
+    
+    result.reset(new CSVTable());
+    for (auto& row : rows) {
+        result->AppendLoadedRow(row, -1);
+    }
+    result->FinishLoad(labels, labels.size(), nullptr);
+    return true;
+}
+
+void PivotTable::EncodeColumns(const std::vector<int>& cols) {
+    std::vector<int> missing;
+    for (int col : cols) {
+        if (!columns.count(col)) {
+            missing.push_back(col);
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    if (missing.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("pivot.encode");
+    
+    size_t pageCount = table.GetPageCount();
+    std::vector<size_t> pageStarts(pageCount + 1, 0);
+    for (size_t page = 0; page < pageCount; ++page) {
+        pageStarts[page + 1] = pageStarts[page] + table.GetPageRows(page);
+    }
+    std::vector<std::unique_ptr<EncodedColumn>> encoded(missing.size());
+    for (auto& column : encoded) {
+        column.reset(new EncodedColumn());
+        column->codes.resize(pageStarts[pageCount]);
+    }
+    
+    // Each block of pages numbers its values itself, evicted pages parse
+    // only these columns. The values of the blocks are then split into
+    // shards by hash, and every shard is merged into the column's values
+    // by one task, so columns with many distinct values merge in parallel.
+    struct Block {
+        std::vector<std::vector<wxString>> values;                 // per column
+        std::vector<std::vector<std::vector<uint32_t>>> shards;    // per column and shard, indices into values
+        std::vector<std::vector<uint32_t>> remap;                  // per column, block code to column code
+    };
+    size_t blockCount = BlockCount(pageCount, 1);
+    std::vector<Block> blocks(blockCount);
+    WorkerPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        std::vector<std::vector<wxString>> loaded;
+        for (size_t b = begin; b < end; ++b) {
+            Block& block = blocks[b];
+            block.values.resize(missing.size());
+            std::vector<ValueSet> ids;
+            for (auto& values : block.values) {
+                ids.emplace_back(0, ValueHash{&values}, ValueEqual{&values});
+            }
+            size_t lastPage = BlockStart(pageCount, blockCount, b + 1);
+            for (size_t page = BlockStart(pageCount, blockCount, b); page < lastPage; ++page) {
+                table.LoadPageColumns(page, missing, loaded);
+                for (size_t k = 0; k < missing.size(); ++k) {
+                    uint32_t* codes = encoded[k]->codes.data() + pageStarts[page];
+                    for (size_t row = 0; row < loaded[k].size(); ++row) {
+                        block.values[k].push_back(std::move(loaded[k][row]));
+                        codes[row] = InternLast(ids[k], block.values[k]);
+                    }
+                }
+            }
+            
+            block.shards.assign(missing.size(), std::vector<std::vector<uint32_t>>(PARTITIONS));
+            block.remap.resize(missing.size());
+            for (size_t k = 0; k < missing.size(); ++k) {
+                for (size_t i = 0; i < block.values[k].size(); ++i) {
+                    block.shards[k][PartitionOf(HashField(block.values[k][i], 0))].push_back((uint32_t)i);
+                }
+                block.remap[k].resize(block.values[k].size());
+            }
+        }
+    });
+    
+    // Column code = first code of the shard + position within the shard
+    std::vector<std::vector<uint32_t>> shardStarts(missing.size(), std::vector<uint32_t>(PARTITIONS));
+    for (size_t k = 0; k < missing.size(); ++k) {
+        std::vector<std::vector<wxString>> shardValues(PARTITIONS);
+        WorkerPool::Get().ParallelFor(PARTITIONS, 1, [&](size_t begin, size_t end) {
+            for (size_t shard = begin; shard < end; ++shard) {
+                std::vector<wxString>& values = shardValues[shard];
+                ValueSet ids(0, ValueHash{&values}, ValueEqual{&values});
+                for (Block& block : blocks) {
+                    for (uint32_t i : block.shards[k][shard]) {
+                        values.push_back(std::move(block.values[k][i]));
+                        block.remap[k][i] = InternLast(ids, values);
+                    }
+                }
+            }
+        });
+        
+        EncodedColumn& column = *encoded[k];
+        for (size_t shard = 0; shard < PARTITIONS; ++shard) {
+            shardStarts[k][shard] = (uint32_t)column.values.size();
+            std::move(shardValues[shard].begin(), shardValues[shard].end(), std::back_inserter(column.values));
+        }
+    }
+    WorkerPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            Block& block = blocks[b];
+            size_t first = pageStarts[BlockStart(pageCount, blockCount, b)];
+            size_t last = pageStarts[BlockStart(pageCount, blockCount, b + 1)];
+            for (size_t k = 0; k < missing.size(); ++k) {
+                std::vector<uint32_t>& map = block.remap[k];
+                for (size_t shard = 0; shard < PARTITIONS; ++shard) {
+                    for (uint32_t i : block.shards[k][shard]) {
+                        map[i] += shardStarts[k][shard];
+                    }
+                }
+                std::vector<uint32_t>& codes = encoded[k]->codes;
+                for (size_t row = first; row < last; ++row) {
+                    codes[row] = map[codes[row]];
+                }
+            }
+        }
+    });
+    blocks.clear();
+    
+    // Values are compared by rank, in the order ORDER BY uses
+    for (size_t k = 0; k < missing.size(); ++k) {
+        EncodedColumn& column = *encoded[k];
+        size_t count = column.values.size();
+        column.numbers.resize(count);
+        column.emptyCode = (uint32_t)count;
+        for (size_t code = 0; code < count; ++code) {
+            column.numbers[code] = ColumnExpression::ParseNumber(column.values[code]);
+            if (column.values[code].IsEmpty()) {
+                column.emptyCode = (uint32_t)code;
+            }
+        }
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&column](uint32_t a, uint32_t b) {
+            return TableQuery::CompareValues(column.values[a], column.numbers[a],
+                                             column.values[b], column.numbers[b]) < 0;
+        });
+        column.ranks.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            column.ranks[order[i]] = (uint32_t)i;
+        }
+        columns[missing[k]] = std::move(encoded[k]);
+    }
+}
+
+bool PivotTable::GroupRows(const std::vector<int>& keys, wxString& error) {
+    if (grouping && grouping->keys == keys) {
+        return true;
+    }
+    grouping.reset();
+    EncodeColumns(keys);
+    PROFILE_SCOPE("pivot.group");
+    
+    std::unique_ptr<Grouping> next(new Grouping());
+    next->keys = keys;
+    next->sizes.resize(keys.size());
+    next->radix.resize(keys.size());
+    uint64_t space = 1;
+    for (size_t i = keys.size(); i-- > 0;) {
+        next->sizes[i] = wxMax(columns[keys[i]]->values.size(), (size_t)1);
+        next->radix[i] = space;
+        if (space > std::numeric_limits<uint64_t>::max() / next->sizes[i]) {
+            error = "The keys have too many combinations";
+            return false;
+        }
+        space *= next->sizes[i];
+    }
+    
+    std::vector<const uint32_t*> codes;
+    for (int key : keys) {
+        codes.push_back(columns[key]->codes.data());
+    }
+    size_t rowCount = table.GetNumberRows();
+    
+    // Radix partitioning: count rows per partition in each block, then
+    // scatter them so every partition lists its rows in table order
+    size_t blockCount = BlockCount(rowCount, 65536);
+    std::vector<uint64_t> packed(rowCount);
+    std::vector<std::vector<size_t>> counts(blockCount, std::vector<size_t>(PARTITIONS, 0));
+    WorkerPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            size_t last = BlockStart(rowCount, blockCount, block + 1);
+            for (size_t row = BlockStart(rowCount, blockCount, block); row < last; ++row) {
+                uint64_t key = 0;
+                for (size_t i = 0; i < codes.size(); ++i) {
+                    key += codes[i][row] * next->radix[i];
+                }
+                packed[row] = key;
+                ++counts[block][PartitionOf(key)];
+            }
+        }
+    });
+    
+    next->partitions.resize(PARTITIONS);
+    for (size_t p = 0; p < PARTITIONS; ++p) {
+        size_t size = 0;
+        for (size_t block = 0; block < blockCount; ++block) {
+            size_t count = counts[block][p];
+            counts[block][p] = size;
+            size += count;
+        }
+        next->partitions[p].rows.resize(size);
+    }
+    WorkerPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            std::vector<size_t>& cursor = counts[block];
+            size_t last = BlockStart(rowCount, blockCount, block + 1);
+            for (size_t row = BlockStart(rowCount, blockCount, block); row < last; ++row) {
+                size_t p = PartitionOf(packed[row]);
+                next->partitions[p].rows[cursor[p]++] = (uint32_t)row;
+            }
+        }
+    });
+    
+    // Partitions share no keys, so each is grouped without locking
+    WorkerPool::Get().ParallelFor(PARTITIONS, 1, [&](size_t begin, size_t end) {
+        std::unordered_map<uint64_t, uint32_t> ids;
+        for (size_t p = begin; p < end; ++p) {
+            Partition& partition = next->partitions[p];
+            ids.clear();
+            partition.groupOfRow.resize(partition.rows.size());
+            for (size_t i = 0; i < partition.rows.size(); ++i) {
+                uint64_t key = packed[partition.rows[i]];
+                auto found = ids.find(key);
+                if (found == ids.end()) {
+                    found = ids.emplace(key, (uint32_t)partition.groupKeys.size()).first;
+                    partition.groupKeys.push_back(key);
+                }
+                partition.groupOfRow[i] = found->second;
+            }
+        }
+    });
+    
+    grouping = std::move(next);
+    return true;
+}
+
+void PivotTable::Aggregate(const std::vector<Value>& values, std::vector<std::vector<wxString>>& cells) {
+    std::vector<int> cols;
+    for (const Value& value : values) {
+        cols.push_back(value.column);
+    }
+    EncodeColumns(cols);
+    PROFILE_SCOPE("pivot.aggregate");
+    std::vector<const EncodedColumn*> sources;
+    for (int col : cols) {
+        sources.push_back(columns[col].get());
+    }
+    
+    struct Accumulator {
+        double sum;
+        long long count;
+        uint32_t best;
+    };
+    
+    cells.assign(PARTITIONS, std::vector<wxString>());
+    WorkerPool::Get().ParallelFor(PARTITIONS, 1, [&](size_t begin, size_t end) {
+        std::vector<Accumulator> accumulators;
+        std::unordered_set<uint64_t> distinct;
+        for (size_t p = begin; p < end; ++p) {
+            const Partition& partition = grouping->partitions[p];
+            size_t groups = partition.groupKeys.size();
+            cells[p].resize(groups * values.size());
+            
+            for (size_t v = 0; v < values.size(); ++v) {
+                const EncodedColumn& column = *sources[v];
+                Function function = values[v].function;
+                accumulators.assign(groups, Accumulator{0, 0, 0});
+                distinct.clear();
+                
+                // Empty cells are skipped by every aggregate
+                for (size_t i = 0; i < partition.rows.size(); ++i) {
+                    uint32_t code = column.codes[partition.rows[i]];
+                    if (code == column.emptyCode) {
+                        continue;
+                    }
+                    uint32_t group = partition.groupOfRow[i];
+                    Accumulator& accumulator = accumulators[group];
+                    switch (function) {
+                        case Function::COUNT:
+                            ++accumulator.count;
+                            break;
+                        case Function::SUM:
+                        case Function::AVG:
+                            if (!std::isnan(column.numbers[code])) {
+                                accumulator.sum += column.numbers[code];
+                                ++accumulator.count;
+                            }
+                            break;
+                        case Function::MIN:
+                        case Function::MAX:
+                            if (accumulator.count == 0 ||
+                                (function == Function::MIN ? column.ranks[code] < column.ranks[accumulator.best]
+                                                           : column.ranks[code] > column.ranks[accumulator.best])) {
+                                accumulator.best = code;
+                            }
+                            ++accumulator.count;
+                            break;
+                        case Function::DISTINCT:
+                            if (distinct.insert(((uint64_t)group << 32) | code).second) {
+                                ++accumulator.count;
+                            }
+                            break;
+                    }
+                }
+                
+                for (size_t group = 0; group < groups; ++group) {
+                    const Accumulator& accumulator = accumulators[group];
+                    wxString& cell = cells[p][group * values.size() + v];
+                    switch (function) {
+                        case Function::COUNT:
+                        case Function::DISTINCT:
+                            cell = wxString::Format("%lld", accumulator.count);
+                            break;
+                        case Function::SUM:
+                            if (accumulator.count > 0) {
+                                ColumnExpression::FormatNumber(accumulator.sum, cell);
+                            }
+                            break;
+                        case Function::AVG:
+                            if (accumulator.count > 0) {
+                                ColumnExpression::FormatNumber(accumulator.sum / accumulator.count, cell);
+                            }
+                            break;
+                        case Function::MIN:
+                        case Function::MAX:
+                            if (accumulator.count > 0) {
+                                cell = column.values[accumulator.best];
+                            }
+                            break;
+                    }
+                }
+            }
+        }
+    });
+}
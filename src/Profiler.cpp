@@ -0,0 +1,260 @@
+#include "Profiler.h"
+#include <wx/ffile.h>
+#include <wx/thread.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+std::atomic<bool> Profiler::enabled(false);
+
+namespace {
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+thread_local uint64_t threadAllocations = 0;
+thread_local uint64_t threadAllocatedBytes = 0;
+thread_local int threadDepth = 0;
+thread_local uint32_t threadIndex = 0;
+std::atomic<uint32_t> nextThreadIndex(1);
+
+// Small stable thread numbers for the trace, the main thread is usually 1
+uint32_t GetThreadIndex() {
+    if (threadIndex == 0) {
+        threadIndex = nextThreadIndex++;
+    }
+    return threadIndex;
+}
+
+void AppendEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        out += *c;
+    }
+}
+
+} // namespace
+
+#ifndef CSVPP_NO_PROFILER
+// Allocation counters need the global operators. While profiling is
+// disabled they add one branch to each allocation.
+void* operator new(size_t size) {
+    if (Profiler::IsEnabled()) {
+        Profiler::CountAllocation(size);
+    }
+    void* block = std::malloc(size ? size : 1);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+    std::free(block);
+}
+#endif
+
+Profiler& Profiler::Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : lastName(nullptr),
+      lastDuration(0) {
+}
+
+void Profiler::SetEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+int64_t Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+uint64_t Profiler::GetThreadAllocations() {
+    return threadAllocations;
+}
+
+uint64_t Profiler::GetThreadAllocatedBytes() {
+    return threadAllocatedBytes;
+}
+
+void Profiler::CountAllocation(size_t bytes) {
+    ++threadAllocations;
+    threadAllocatedBytes += bytes;
+}
+
+void Profiler::Record(const char* name, int depth, int64_t start, int64_t duration,
+                      uint64_t allocations, uint64_t bytes) {
+    uint32_t thread = GetThreadIndex();
+    bool mainThread = wxIsMainThread();
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = stats.find(name);
+    if (found == stats.end()) {
+        ProfileStat stat = { name, 0, 0.0, 0.0, 0, 0 };
+        found = stats.insert(std::make_pair(name, stat)).first;
+    }
+    ProfileStat& stat = found->second;
+    double ms = duration / 1000.0;
+    stat.calls++;
+    stat.totalMs += ms;
+    stat.maxMs = std::max(stat.maxMs, ms);
+    stat.allocations += allocations;
+    stat.allocatedBytes += bytes;
+    
+    if (events.size() < MAX_EVENTS) {
+        Event event = { name, thread, start, duration, allocations, bytes };
+        events.push_back(event);
+    }
+    
+    // What the user just did, shown in the status bar
+    if (depth == 0 && mainThread) {
+        lastName = name;
+        lastDuration = duration;
+    }
+}
+
+std::vector<ProfileStat> Profiler::GetStats() const {
+    std::vector<ProfileStat> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : stats) {
+            result.push_back(entry.second);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const ProfileStat& a, const ProfileStat& b) {
+        return a.totalMs > b.totalMs;
+    });
+    return result;
+}
+
+bool Profiler::GetLastOperation(wxString& name, double& ms) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!lastName) {
+        return false;
+    }
+    name = wxString::FromUTF8(lastName);
+    ms = lastDuration / 1000.0;
+    return true;
+}
+
+void Profiler::RecordCounter(const char* name, int64_t value) {
+    int64_t now = Now();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (counters.size() < MAX_EVENTS) {
+        CounterSample sample = { name, now, value };
+        counters.push_back(sample);
+    }
+}
+
+void Profiler::Reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    counters.clear();
+    stats.clear();
+    lastName = nullptr;
+    lastDuration = 0;
+}
+
+bool Profiler::WriteTrace(const wxString& filename) const {
+    std::vector<Event> snapshot;
+    std::vector<CounterSample> samples;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot = events;
+        samples = counters;
+    }
+    
+    // Complete ("X") events, timestamps and durations in microseconds
+    std::string json = "{\"traceEvents\":[\n";
+    char buffer[160];
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const Event& event = snapshot[i];
+        json += "{\"name\":\"";
+        AppendEscaped(json, event.name);
+        snprintf(buffer, sizeof(buffer),
+                 "\",\"cat\":\"csvpp\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u,"
+                 "\"args\":{\"allocations\":%llu,\"bytes\":%llu}}",
+                 (long long)event.start, (long long)event.duration, (unsigned)event.thread,
+                 (unsigned long long)event.allocations, (unsigned long long)event.bytes);
+        json += buffer;
+        json += i + 1 < snapshot.size() || !samples.empty() ? ",\n" : "\n";
+    }
+    
+    // Counter ("C") events are drawn as a graph per name
+    for (size_t i = 0; i < samples.size(); ++i) {
+        json += "{\"name\":\"";
+        AppendEscaped(json, samples[i].name);
+        snprintf(buffer, sizeof(buffer),
+                 "\",\"cat\":\"csvpp\",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,\"args\":{\"value\":%lld}}",
+                 (long long)samples[i].time, (long long)samples[i].value);
+        json += buffer;
+        json += i + 1 < samples.size() ? ",\n" : "\n";
+    }
+    json += "],\"displayTimeUnit\":\"ms\"}\n";
+    
+    wxFFile file(filename, "wb");
+    if (!file.IsOpened()) {
+        return false;
+    }
+    bool written = file.Write(json.data(), json.size()) == json.size();
+    return file.Close() && written;
+}
+
+void ProfileScope::Begin() {
+    depth = threadDepth++;
+    allocations = Profiler::GetThreadAllocations();
+    bytes = Profiler::GetThreadAllocatedBytes();
+    start = Profiler::Now();
+}
+
+void ProfileScope::End() {
+    int64_t duration = Profiler::Now() - start;
+    --threadDepth;
+    Profiler::Get().Record(name, depth, start, duration,
+                           Profiler::GetThreadAllocations() - allocations,
+                           Profiler::GetThreadAllocatedBytes() - bytes);
+}
@@ -0,0 +1,218 @@
+#include "ShardSource.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/dir.h>
+#include <wx/filename.h>
+
+namespace {
+
+// Rows of one file, parsed on its own task
+struct ShardRows {
+    std::vector<std::vector<wxString>> rows;
+    std::vector<long long> offsets;
+    std::vector<wxString> header;
+    Encoding encoding;
+    bool ok;
+};
+
+// Read a file front to back on the calling thread, keeping the same rows as
+// CSVParser::ReadFile: empty lines are skipped after the first
+void ParseShard(const MappedFile& file, Encoding encoding, wxChar separator, bool hasHeader,
+                const std::vector<int>& columns, size_t blockRecords, ShardRows& parsed) {
+    PROFILE_SCOPE("shards.parse_file");
+    parsed.rows.clear();
+    parsed.offsets.clear();
+    parsed.header.clear();
+    parsed.encoding = CSVParser::ResolveEncoding(file, encoding);
+    parsed.ok = true;
+    
+    size_t pos = CSVParser::GetDataOffset(file, parsed.encoding);
+    std::vector<std::pair<size_t, size_t>> records;
+    bool firstLine = true;
+    bool headerPending = hasHeader;
+    while (parsed.ok && CSVParser::FindRecords(file, pos, parsed.encoding, blockRecords, records) > 0) {
+        for (const auto& record : records) {
+            if (record.second == record.first && !firstLine) {
+                continue;
+            }
+            firstLine = false;
+            
+            std::vector<wxString> fields;
+            if (!CSVParser::ParseRecordAt(file, record.first, record.second, parsed.encoding, separator,
+                                          fields, columns)) {
+                parsed.ok = false;
+                break;
+            }
+            if (headerPending) {
+                parsed.header = std::move(fields);
+                headerPending = false;
+                continue;
+            }
+            parsed.rows.push_back(std::move(fields));
+            parsed.offsets.push_back((long long)record.first);
+        }
+    }
+    parsed.ok = parsed.ok && file.IsValid();
+}
+
+}
+
+bool ShardSource::FindFiles(const wxString& pattern, wxArrayString& files) {
+    files.Clear();
+    wxArrayString specs;
+    wxString folder;
+    if (wxDirExists(pattern)) {
+        folder = pattern;
+        for (const char* spec : {"*.csv", "*.txt", "*.csv.gz", "*.csv.zst", "*.csv.xz"}) {
+            specs.Add(spec);
+        }
+    } else {
+        wxFileName name(pattern);
+        folder = name.GetPath();
+        specs.Add(name.GetFullName());
+        if (folder.IsEmpty()) {
+            folder = wxGetCwd();
+        }
+    }
+    if (!wxDirExists(folder)) {
+        return false;
+    }
+    
+    for (const wxString& spec : specs) {
+        wxDir::GetAllFiles(folder, &files, spec, wxDIR_FILES);
+    }
+    files.Sort();
+    return !files.IsEmpty();
+}
+
+bool ShardSource::Load(const wxArrayString& files, const wxString& tableName, Encoding encoding, wxChar separator,
+                       bool hasHeader, const std::vector<int>& columns, CSVTable& table,
+                       std::vector<wxString>& header, size_t& cols, wxString& error,
+                       const std::function<void(int)>& progress) {
+    PROFILE_SCOPE("shards.load");
+    name = tableName;
+    shards.clear();
+    shardNames.clear();
+    header.clear();
+    cols = 0;
+    
+    for (size_t i = 0; i < files.GetCount(); ++i) {
+        std::unique_ptr<CSVFileSource> shard(new CSVFileSource());
+        if (!shard->Open(files[i])) {
+            error = wxString::Format("Cannot open %s", files[i]);
+            return false;
+        }
+        shard->GetFile().AdviseSequential();
+        shards.push_back(std::move(shard));
+        shardNames.push_back(wxFileName(files[i]).GetFullName());
+    }
+    
+    // Rows of a round are appended in file order before the next round is read
+    size_t roundFiles = WorkerPool::Get().GetThreadCount();
+    std::vector<ShardRows> round(roundFiles);
+    for (size_t first = 0; first < shards.size(); first += roundFiles) {
+        size_t count = wxMin(roundFiles, shards.size() - first);
+        WorkerPool::Get().ParallelFor(count, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                ParseShard(shards[first + i]->GetFile(), encoding, separator, hasHeader, columns,
+                           BLOCK_RECORDS, round[i]);
+            }
+        });
+        
+        for (size_t i = 0; i < count; ++i) {
+            size_t index = first + i;
+            ShardRows& parsed = round[i];
+            if (!parsed.ok) {
+                error = wxString::Format("Failed to read %s", files[index]);
+                return false;
+            }
+            if (hasHeader && index == 0) {
+                header = parsed.header;
+                cols = header.size() + 1;
+            } else if (hasHeader && parsed.header != header) {
+                error = wxString::Format("The header of %s differs from the header of %s", files[index], files[0]);
+                return false;
+            }
+            
+            // Pages reload from each file in the encoding it was actually read with
+            shards[index]->SetFormat(parsed.encoding, separator);
+            shards[index]->SetColumns(columns);
+            table.EndLoadedPage();
+            for (size_t row = 0; row < parsed.rows.size(); ++row) {
+                std::vector<wxString>& fields = parsed.rows[row];
+                fields.insert(fields.begin(), shardNames[index]);
+                cols = wxMax(cols, fields.size());
+                table.AppendLoadedRow(fields, ((long long)index << OFFSET_BITS) | parsed.offsets[row]);
+            }
+            std::vector<std::vector<wxString>>().swap(parsed.rows);
+        }
+        
+        if (progress) {
+            progress((int)((first + count) * 100 / shards.size()));
+        }
+    }
+    return true;
+}
+
+bool ShardSource::ReadsFrom(const wxString& filename) const {
+    wxFileName target(filename);
+    for (const auto& shard : shards) {
+        if (wxFileName(shard->GetFilename()).SameAs(target)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShardSource::Locate(long long position, size_t& shard, size_t& offset) const {
+    if (position < 0) {
+        return false;
+    }
+    shard = (size_t)(position >> OFFSET_BITS);
+    offset = (size_t)(position & ((1LL << OFFSET_BITS) - 1));
+    return shard < shards.size();
+}
+
+bool ShardSource::LoadRows(long long position, size_t rowCount,
+                           std::vector<std::vector<wxString>>& rows) {
+    size_t shard, offset;
+    if (!Locate(position, shard, offset) || !shards[shard]->LoadRows((long long)offset, rowCount, rows)) {
+        return false;
+    }
+    for (std::vector<wxString>& fields : rows) {
+        fields.insert(fields.begin(), shardNames[shard]);
+    }
+    return true;
+}
+
+bool ShardSource::LoadSelectedColumns(long long position, size_t rowCount, const std::vector<int>& selected,
+                                      std::vector<std::vector<wxString>>& loaded) {
+    size_t shard, offset;
+    if (!Locate(position, shard, offset)) {
+        return false;
+    }
+    
+    // Column 0 is the file name, the others come from the file one to the left
+    std::vector<int> fileSelected;
+    for (int col : selected) {
+        if (col > 0) {
+            fileSelected.push_back(col - 1);
+        }
+    }
+    std::vector<std::vector<wxString>> fileColumns;
+    if (!fileSelected.empty() &&
+        !shards[shard]->LoadSelectedColumns((long long)offset, rowCount, fileSelected, fileColumns)) {
+        return false;
+    }
+    
+    loaded.assign(selected.size(), std::vector<wxString>());
+    size_t next = 0;
+    for (size_t i = 0; i < selected.size(); ++i) {
+        if (selected[i] > 0) {
+            loaded[i] = std::move(fileColumns[next++]);
+        } else {
+            loaded[i].assign(rowCount, shardNames[shard]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,389 @@
+#include "Snapshot.h"
+#include "RowHash.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <unordered_map>
+#include <cstring>
+#include <zstd.h>
+
+const char* const Snapshot::EXTENSION = "csvpp";
+const char Snapshot::MAGIC[8] = {'C', 'S', 'V', 'P', 'P', 'S', 'N', 'P'};
+
+namespace {
+
+// Fast enough that saving is bound by gathering the values, not compression
+const int COMPRESSION_LEVEL = 3;
+
+// Bounds checked reading from the mapped file or a decompressed block
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t size) : data(data), size(size), pos(0) {}
+    
+    const char* Take(size_t length) {
+        if (length > size - pos) {
+            return nullptr;
+        }
+        const char* p = data + pos;
+        pos += length;
+        return p;
+    }
+    
+    bool Read(void* out, size_t length) {
+        const char* p = Take(length);
+        if (!p) {
+            return false;
+        }
+        memcpy(out, p, length);
+        return true;
+    }
+    
+    bool ReadString(wxString& value) {
+        uint32_t length;
+        if (!Read(&length, sizeof(length))) {
+            return false;
+        }
+        const char* text = Take(length);
+        if (!text) {
+            return false;
+        }
+        value = wxString::FromUTF8(text, length);
+        return true;
+    }
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+};
+
+struct FieldHash {
+    size_t operator()(const wxString& value) const { return (size_t)HashField(value, 0); }
+};
+
+void PutU32(std::string& out, uint32_t value) {
+    out.append((const char*)&value, sizeof(value));
+}
+
+void PutString(std::string& out, const wxString& value) {
+    wxScopedCharBuffer utf8 = value.utf8_str();
+    PutU32(out, (uint32_t)utf8.length());
+    out.append(utf8.data(), utf8.length());
+}
+
+// An array of strings as all lengths followed by all bytes
+void PutStrings(std::string& out, const std::vector<const wxString*>& values) {
+    std::string bytes;
+    for (const wxString* value : values) {
+        wxScopedCharBuffer utf8 = value->utf8_str();
+        PutU32(out, (uint32_t)utf8.length());
+        bytes.append(utf8.data(), utf8.length());
+    }
+    out += bytes;
+}
+
+bool ReadStrings(ByteReader& reader, size_t count, std::vector<wxString>& values) {
+    const char* lengths = reader.Take(count * sizeof(uint32_t));
+    if (!lengths) {
+        return false;
+    }
+    values.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t length;
+        memcpy(&length, lengths + i * sizeof(uint32_t), sizeof(length));
+        const char* text = reader.Take(length);
+        if (!text) {
+            return false;
+        }
+        values[i] = wxString::FromUTF8(text, length);
+    }
+    return true;
+}
+
+} // namespace
+
+bool Snapshot::IsSnapshotFile(const wxString& filename) {
+    return wxFileName(filename).GetExt().CmpNoCase(EXTENSION) == 0;
+}
+
+bool Snapshot::Write(const wxString& filename, CSVTable& table, const SnapshotInfo& info,
+                     const std::vector<int>& columnWidths) {
+    PROFILE_SCOPE("snapshot.write");
+    // Structures are written as they are in memory, little endian
+    static_assert(sizeof(Header) == 48 && sizeof(BlockEntry) == 24, "Snapshot structures must not be padded");
+    
+    size_t rowCount = table.GetNumberRows();
+    size_t columnCount = table.GetNumberCols();
+    size_t blockCount = (rowCount + CSVTable::PAGE_ROWS - 1) / CSVTable::PAGE_ROWS;
+    
+    // Written next to the target and renamed over it once complete, a
+    // failed or interrupted save leaves the previous snapshot in place
+    wxTempFile out;
+    if (!out.Open(filename)) {
+        return false;
+    }
+    
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.encoding = (uint32_t)info.encoding;
+    header.separator = (uint32_t)info.separator;
+    header.hasHeader = info.hasHeader ? 1 : 0;
+    header.rowCount = rowCount;
+    header.columnCount = (uint32_t)columnCount;
+    header.blockCount = (uint32_t)blockCount;
+    header.indexOffset = 0;
+    
+    std::string prefix((const char*)&header, sizeof(header));
+    for (size_t col = 0; col < columnCount; ++col) {
+        PutU32(prefix, col < columnWidths.size() ? (uint32_t)columnWidths[col] : 0);
+        PutString(prefix, table.GetColLabelValue((int)col));
+    }
+    if (!out.Write(prefix.data(), prefix.size())) {
+        return false;
+    }
+    
+    std::vector<BlockEntry> index(blockCount);
+    uint64_t offset = prefix.size();
+    
+    // Values are gathered on this thread since the table is not thread safe,
+    // then a group of blocks is encoded and compressed in parallel
+    size_t groupSize = WorkerPool::Get().GetThreadCount() * 2;
+    for (size_t first = 0; first < blockCount; first += groupSize) {
+        size_t count = wxMin(groupSize, blockCount - first);
+        std::vector<std::vector<std::vector<wxString>>> values(count);
+        for (size_t i = 0; i < count; ++i) {
+            size_t startRow = (first + i) * CSVTable::PAGE_ROWS;
+            size_t rows = wxMin(CSVTable::PAGE_ROWS, rowCount - startRow);
+            values[i].assign(columnCount, std::vector<wxString>(rows));
+            for (size_t col = 0; col < columnCount; ++col) {
+                for (size_t row = 0; row < rows; ++row) {
+                    values[i][col][row] = table.GetValue((int)(startRow + row), (int)col);
+                }
+            }
+            index[first + i].rowCount = (uint32_t)rows;
+            index[first + i].reserved = 0;
+        }
+        
+        std::vector<std::string> compressed(count);
+        WorkerPool::Get().ParallelFor(count, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                std::string raw = EncodeBlock(values[i], index[first + i].rowCount);
+                std::vector<std::vector<wxString>>().swap(values[i]);
+                if (raw.size() > UINT32_MAX) {
+                    continue;
+                }
+                
+                // An empty result marks a failed block, a zstd frame is never empty
+                std::string& packed = compressed[i];
+                packed.resize(ZSTD_compressBound(raw.size()));
+                size_t size = ZSTD_compress(&packed[0], packed.size(), raw.data(), raw.size(), COMPRESSION_LEVEL);
+                packed.resize(ZSTD_isError(size) ? 0 : size);
+                index[first + i].rawSize = (uint32_t)raw.size();
+            }
+        });
+        
+        for (size_t i = 0; i < count; ++i) {
+            const std::string& packed = compressed[i];
+            if (packed.empty() || packed.size() > UINT32_MAX ||
+                !out.Write(packed.data(), packed.size())) {
+                return false;
+            }
+            index[first + i].offset = offset;
+            index[first + i].compressedSize = (uint32_t)packed.size();
+            offset += packed.size();
+        }
+    }
+    
+    size_t indexSize = index.size() * sizeof(BlockEntry);
+    if (indexSize > 0 && !out.Write(index.data(), indexSize)) {
+        return false;
+    }
+    
+    // Point the header at the index now that its offset is known
+    header.indexOffset = offset;
+    if (out.Seek(0) != 0 || !out.Write(&header, sizeof(header))) {
+        return false;
+    }
+    return out.Commit();
+}
+
+std::string Snapshot::EncodeBlock(const std::vector<std::vector<wxString>>& columns, size_t rowCount) {
+    std::string out;
+    for (const auto& column : columns) {
+        // Dictionary encode columns where values repeat at least twice on average
+        std::unordered_map<wxString, uint16_t, FieldHash> ids;
+        std::vector<const wxString*> distinct;
+        std::vector<uint16_t> codes(rowCount);
+        bool dictionary = rowCount >= 8;
+        for (size_t row = 0; row < rowCount && dictionary; ++row) {
+            auto it = ids.find(column[row]);
+            if (it == ids.end()) {
+                if (distinct.size() * 2 >= rowCount || distinct.size() >= 65536) {
+                    dictionary = false;
+                    break;
+                }
+                it = ids.emplace(column[row], (uint16_t)distinct.size()).first;
+                distinct.push_back(&column[row]);
+            }
+            codes[row] = it->second;
+        }
+        
+        if (!dictionary) {
+            out.push_back((char)PLAIN);
+            std::vector<const wxString*> values(rowCount);
+            for (size_t row = 0; row < rowCount; ++row) {
+                values[row] = &column[row];
+            }
+            PutStrings(out, values);
+            continue;
+        }
+        
+        bool narrow = distinct.size() <= 256;
+        out.push_back((char)(narrow ? DICTIONARY8 : DICTIONARY16));
+        PutU32(out, (uint32_t)distinct.size());
+        PutStrings(out, distinct);
+        for (uint16_t code : codes) {
+            if (narrow) {
+                out.push_back((char)code);
+            } else {
+                out.append((const char*)&code, sizeof(code));
+            }
+        }
+    }
+    return out;
+}
+
+bool Snapshot::DecodeBlock(const char* data, size_t size, size_t rowCount, size_t columnCount,
+                           std::vector<std::vector<wxString>>& columns) {
+    ByteReader reader(data, size);
+    columns.assign(columnCount, std::vector<wxString>());
+    for (size_t col = 0; col < columnCount; ++col) {
+        uint8_t kind;
+        if (!reader.Read(&kind, sizeof(kind))) {
+            return false;
+        }
+        
+        std::vector<wxString>& column = columns[col];
+        if (kind == PLAIN) {
+            if (!ReadStrings(reader, rowCount, column)) {
+                return false;
+            }
+            continue;
+        }
+        if (kind != DICTIONARY8 && kind != DICTIONARY16) {
+            return false;
+        }
+        
+        // Each distinct value is decoded once and copied into the rows
+        uint32_t dictionarySize;
+        std::vector<wxString> dictionary;
+        if (!reader.Read(&dictionarySize, sizeof(dictionarySize)) ||
+            !ReadStrings(reader, dictionarySize, dictionary)) {
+            return false;
+        }
+        size_t width = kind == DICTIONARY8 ? 1 : 2;
+        const char* codes = reader.Take(rowCount * width);
+        if (!codes) {
+            return false;
+        }
+        column.resize(rowCount);
+        for (size_t row = 0; row < rowCount; ++row) {
+            uint16_t code = 0;
+            memcpy(&code, codes + row * width, width);
+            if (code >= dictionarySize) {
+                return false;
+            }
+            column[row] = dictionary[code];
+        }
+    }
+    return true;
+}
+
+bool SnapshotSource::Open(const wxString& filename) {
+    PROFILE_SCOPE("snapshot.open");
+    if (!file.Open(filename)) {
+        return false;
+    }
+    
+    ByteReader reader(file.GetData(), file.GetSize());
+    Snapshot::Header header;
+    bool valid = reader.Read(&header, sizeof(header)) &&
+                 memcmp(header.magic, Snapshot::MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == Snapshot::VERSION &&
+                 header.encoding <= (uint32_t)Encoding::UTF16_BE;
+    
+    labels.resize(valid ? header.columnCount : 0);
+    columnWidths.resize(labels.size());
+    for (size_t col = 0; col < labels.size() && valid; ++col) {
+        uint32_t width;
+        valid = reader.Read(&width, sizeof(width)) && reader.ReadString(labels[col]);
+        columnWidths[col] = (int)width;
+    }
+    
+    // The index must fit in the file and every block must lie before it
+    size_t size = file.GetSize();
+    valid = valid && header.indexOffset <= size &&
+            (uint64_t)header.blockCount * sizeof(Snapshot::BlockEntry) <= size - header.indexOffset;
+    if (valid) {
+        blocks.resize(header.blockCount);
+        if (!blocks.empty()) {
+            memcpy(blocks.data(), file.GetData() + header.indexOffset, blocks.size() * sizeof(Snapshot::BlockEntry));
+        }
+        uint64_t rows = 0;
+        for (const Snapshot::BlockEntry& block : blocks) {
+            valid = valid && block.offset + block.compressedSize <= header.indexOffset;
+            rows += block.rowCount;
+        }
+        valid = valid && rows == header.rowCount;
+    }
+    
+    if (!valid) {
+        labels.clear();
+        columnWidths.clear();
+        blocks.clear();
+        file.Close();
+        return false;
+    }
+    
+    info.encoding = (Encoding)header.encoding;
+    info.separator = (wxChar)header.separator;
+    info.hasHeader = header.hasHeader != 0;
+    return true;
+}
+
+bool SnapshotSource::LoadColumns(long long position, size_t rowCount,
+                                 std::vector<std::vector<wxString>>& columns) {
+    PROFILE_SCOPE("snapshot.load_block");
+    if (!file.IsOpened() || position < 0 || position >= (long long)blocks.size()) {
+        return false;
+    }
+    const Snapshot::BlockEntry& block = blocks[position];
+    if (block.rowCount != rowCount) {
+        return false;
+    }
+    
+    // Decompress straight from the mapping
+    std::string raw(block.rawSize, '\0');
+    size_t size = ZSTD_decompress(&raw[0], raw.size(), file.GetData() + block.offset, block.compressedSize);
+    if (ZSTD_isError(size) || size != raw.size()) {
+        return false;
+    }
+    return Snapshot::DecodeBlock(raw.data(), raw.size(), rowCount, labels.size(), columns);
+}
+
+bool SnapshotSource::LoadRows(long long position, size_t rowCount,
+                              std::vector<std::vector<wxString>>& rows) {
+    std::vector<std::vector<wxString>> columns;
+    if (!LoadColumns(position, rowCount, columns)) {
+        return false;
+    }
+    rows.assign(rowCount, std::vector<wxString>(columns.size()));
+    for (size_t col = 0; col < columns.size(); ++col) {
+        for (size_t row = 0; row < rowCount; ++row) {
+            rows[row][col] = std::move(columns[col][row]);
+        }
+    }
+    return true;
+}
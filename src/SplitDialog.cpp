@@ -0,0 +1,82 @@
+#include "SplitDialog.h"
+
+wxBEGIN_EVENT_TABLE(SplitDialog, wxDialog)
+    EVT_BUTTON(wxID_OK, SplitDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+SplitDialog::SplitDialog(wxWindow* parent, Language language, const wxString& inputFile)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_split_title", language), wxDefaultPosition, wxSize(500, 400)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    wxString wildcard = "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*";
+    
+    // File to split, defaults to the active document
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("split_input", language)), 0, wxALL, 5);
+    inputPicker = new wxFilePickerCtrl(this, wxID_ANY, inputFile, Translate("split_input", language), wildcard,
+                                       wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(inputPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Header checkbox
+    headerCheckBox = new wxCheckBox(this, wxID_ANY, Translate("compare_header", language));
+    headerCheckBox->SetValue(true);
+    mainSizer->Add(headerCheckBox, 0, wxALL, 5);
+    
+    // Part size, in the order of CSVSplitter::Mode
+    wxArrayString modes;
+    modes.Add(Translate("split_rows", language));
+    modes.Add(Translate("split_megabytes", language));
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("split_size", language)), 0, wxALL, 5);
+    wxBoxSizer* sizeSizer = new wxBoxSizer(wxHORIZONTAL);
+    sizeText = new wxTextCtrl(this, wxID_ANY, "1000000");
+    sizeSizer->Add(sizeText, 1, wxRIGHT, 5);
+    modeChoice = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, modes);
+    modeChoice->SetSelection(0);
+    sizeSizer->Add(modeChoice, 0);
+    mainSizer->Add(sizeSizer, 0, wxALL | wxEXPAND, 5);
+    
+    // Parts are numbered after this name
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("split_output", language)), 0, wxALL, 5);
+    outputPicker = new wxFilePickerCtrl(this, wxID_ANY, inputFile, Translate("split_output", language), wildcard,
+                                        wxDefaultPosition, wxDefaultSize, wxFLP_SAVE | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(outputPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void SplitDialog::OnOK(wxCommandEvent& event) {
+    if (!wxFileExists(GetInputFile()) || GetOutputFile().IsEmpty() || GetPartSize() == 0) {
+        wxMessageBox(Translate("error_split_input", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxString SplitDialog::GetInputFile() const {
+    return inputPicker->GetPath();
+}
+
+wxString SplitDialog::GetOutputFile() const {
+    return outputPicker->GetPath();
+}
+
+bool SplitDialog::GetHasHeader() const {
+    return headerCheckBox->GetValue();
+}
+
+CSVSplitter::Mode SplitDialog::GetMode() const {
+    return (CSVSplitter::Mode)modeChoice->GetSelection();
+}
+
+size_t SplitDialog::GetPartSize() const {
+    unsigned long size = 0;
+    if (!sizeText->GetValue().Strip(wxString::both).ToULong(&size)) {
+        return 0;
+    }
+    return GetMode() == CSVSplitter::Mode::BYTES ? (size_t)size * 1024 * 1024 : (size_t)size;
+}
@@ -0,0 +1,81 @@
+#include "StringDictionary.h"
+#include "RowHash.h"
+
+StringDictionary::StringDictionary()
+    : slots(64) {
+    Code code;
+    Intern(wxString(), code);
+}
+
+bool StringDictionary::Intern(const wxString& value, Code& code) {
+    uint32_t hash = Hash(value);
+    size_t slot = Probe(value, hash);
+    if (slots[slot].entry != 0) {
+        code = (Code)(slots[slot].entry - 1);
+        return true;
+    }
+    if (IsFull()) {
+        return false;
+    }
+    
+    code = (Code)values.size();
+    values.push_back(value);
+    slots[slot].hash = hash;
+    slots[slot].entry = (uint32_t)values.size();
+    
+    // Keep the table at most half full so probe chains stay short
+    if (values.size() * 2 > slots.size()) {
+        Grow();
+    }
+    return true;
+}
+
+bool StringDictionary::Find(const wxString& value, Code& code) const {
+    size_t slot = Probe(value, Hash(value));
+    if (slots[slot].entry == 0) {
+        return false;
+    }
+    code = (Code)(slots[slot].entry - 1);
+    return true;
+}
+
+size_t StringDictionary::GetMemoryUsage() const {
+    size_t usage = slots.size() * sizeof(Slot);
+    for (const wxString& value : values) {
+        usage += sizeof(wxString) + value.length() * sizeof(wxChar);
+    }
+    return usage;
+}
+
+size_t StringDictionary::Probe(const wxString& value, uint32_t hash) const {
+    size_t mask = slots.size() - 1;
+    size_t slot = hash & mask;
+    while (slots[slot].entry != 0) {
+        const Slot& current = slots[slot];
+        if (current.hash == hash && values[current.entry - 1] == value) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void StringDictionary::Grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const Slot& entry : old) {
+        if (entry.entry == 0) {
+            continue;
+        }
+        size_t slot = entry.hash & mask;
+        while (slots[slot].entry != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = entry;
+    }
+}
+
+uint32_t StringDictionary::Hash(const wxString& value) {
+    return (uint32_t)HashField(value, 0);
+}
@@ -0,0 +1,827 @@
+#include "TableQuery.h"
+#include "CSVTable.h"
+#include "RowHash.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+struct KeyHash {
+    size_t operator()(const wxString& value) const { return (size_t)HashField(value, 0); }
+};
+
+bool IsWordChar(wxChar c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c > 127;
+}
+
+bool IsBlank(wxChar c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+wxString Trimmed(const wxString& text) {
+    size_t begin = 0;
+    size_t end = text.length();
+    while (begin < end && IsBlank(text[begin])) {
+        ++begin;
+    }
+    while (end > begin && IsBlank(text[end - 1])) {
+        --end;
+    }
+    return text.Mid(begin, end - begin);
+}
+
+// Length of a keyword at pos, 0 when it is not there. A space in the keyword
+// matches any run of blanks, so "GROUP BY" also matches "group\n  by".
+size_t MatchKeyword(const wxString& text, size_t pos, const char* keyword) {
+    if (pos > 0 && IsWordChar(text[pos - 1])) {
+        return 0;
+    }
+    size_t i = pos;
+    for (const char* k = keyword; *k; ++k) {
+        if (*k == ' ') {
+            if (i >= text.length() || !IsBlank(text[i])) {
+                return 0;
+            }
+            while (i < text.length() && IsBlank(text[i])) {
+                ++i;
+            }
+        } else {
+            if (i >= text.length() || wxTolower(text[i]) != wxTolower((wxChar)*k)) {
+                return 0;
+            }
+            ++i;
+        }
+    }
+    if (i < text.length() && IsWordChar(text[i])) {
+        return 0;
+    }
+    return i - pos;
+}
+
+// Calls visit(pos) for every position outside quotes, brackets and
+// parentheses until it returns true, returns that position or npos
+template <typename Visit>
+size_t ScanTopLevel(const wxString& text, size_t from, Visit visit) {
+    int depth = 0;
+    wxChar quote = 0;
+    for (size_t i = from; i < text.length(); ++i) {
+        wxChar c = text[i];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;   // a doubled quote closes and reopens
+            }
+            continue;
+        }
+        if (c == '\'' || c == '"' || c == '[') {
+            quote = c == '[' ? wxChar(']') : c;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (depth == 0 && visit(i)) {
+            return i;
+        }
+    }
+    return wxString::npos;
+}
+
+size_t FindKeyword(const wxString& text, const char* keyword, size_t from = 0) {
+    return ScanTopLevel(text, from, [&](size_t i) { return MatchKeyword(text, i, keyword) > 0; });
+}
+
+std::vector<wxString> SplitList(const wxString& text) {
+    std::vector<wxString> parts;
+    size_t start = 0;
+    ScanTopLevel(text, 0, [&](size_t i) {
+        if (text[i] == ',') {
+            parts.push_back(Trimmed(text.Mid(start, i - start)));
+            start = i + 1;
+        }
+        return false;
+    });
+    parts.push_back(Trimmed(text.Mid(start)));
+    return parts;
+}
+
+// A name written as [name], "name" or 'name' loses its quotes
+wxString Unquote(const wxString& name) {
+    if (name.length() >= 2 && ((name[0] == '[' && name.Last() == ']') ||
+                               (name[0] == '"' && name.Last() == '"') ||
+                               (name[0] == '\'' && name.Last() == '\''))) {
+        return name.Mid(1, name.length() - 2);
+    }
+    return name;
+}
+
+}
+
+struct TableQuery::Accumulator {
+    long long count;
+    double sum;
+    wxString best;
+    double bestNumber;
+    bool hasBest;
+    
+    Accumulator() : count(0), sum(0), bestNumber(0), hasBest(false) {}
+};
+
+struct TableQuery::Group {
+    std::vector<wxString> values;              // items without an aggregate, from the first row
+    std::vector<Accumulator> accumulators;     // per item
+};
+
+// Everything one worker produced from a run of consecutive morsels
+struct TableQuery::Partial {
+    size_t firstMorsel;
+    
+    // Registers of each expression, reused from batch to batch
+    ColumnExpression::Workspace whereSpace;
+    std::vector<ColumnExpression::Workspace> itemSpaces;
+    std::vector<ColumnExpression::Workspace> groupSpaces;
+    std::vector<ColumnExpression::Workspace> keySpaces;
+    
+    // Projected rows in table order
+    std::vector<std::vector<wxString>> rows;
+    
+    // Groups in order of first appearance
+    std::unordered_map<wxString, size_t, KeyHash> index;
+    std::vector<wxString> keys;
+    std::vector<Group> groups;
+    wxString key;
+    wxString part;
+};
+
+// One page of the table
+struct TableQuery::Morsel {
+    size_t page;
+    size_t rows;
+    const std::vector<int>* slots;              // slot in data of each table column
+    std::vector<std::vector<wxString>> data;    // columns parsed from the source
+    ColumnExpression::ColumnReader reader;
+};
+
+TableQuery::TableQuery()
+    : hasWhere(false),
+      limit(-1),
+      grouped(false) {
+}
+
+bool TableQuery::Parse(const wxString& sql, const std::vector<wxString>& columnNames, wxString& error) {
+    items.clear();
+    groupBy.clear();
+    orderBy.clear();
+    hasWhere = false;
+    limit = -1;
+    
+    wxString text = Trimmed(sql);
+    if (text.EndsWith(";")) {
+        text = Trimmed(text.Left(text.length() - 1));
+    }
+    size_t selectLength = MatchKeyword(text, 0, "SELECT");
+    if (selectLength == 0) {
+        error = "The query must start with SELECT";
+        return false;
+    }
+    
+    // Clauses in the order SQL requires them, any of them may be left out
+    static const char* const CLAUSES[] = {"SELECT", "FROM", "WHERE", "GROUP BY", "ORDER BY", "LIMIT"};
+    const size_t CLAUSE_COUNT = sizeof(CLAUSES) / sizeof(CLAUSES[0]);
+    size_t starts[CLAUSE_COUNT];
+    size_t bodies[CLAUSE_COUNT];
+    starts[0] = 0;
+    bodies[0] = selectLength;
+    size_t last = 0;
+    for (size_t i = 1; i < CLAUSE_COUNT; ++i) {
+        starts[i] = FindKeyword(text, CLAUSES[i], selectLength);
+        if (starts[i] == wxString::npos) {
+            continue;
+        }
+        if (starts[i] < starts[last]) {
+            error = "Clauses must be in the order SELECT, FROM, WHERE, GROUP BY, ORDER BY, LIMIT";
+            return false;
+        }
+        bodies[i] = starts[i] + MatchKeyword(text, starts[i], CLAUSES[i]);
+        last = i;
+    }
+    wxString clauses[CLAUSE_COUNT];
+    for (size_t i = 0; i < CLAUSE_COUNT; ++i) {
+        if (i > 0 && starts[i] == wxString::npos) {
+            continue;
+        }
+        size_t end = text.length();
+        for (size_t next = i + 1; next < CLAUSE_COUNT; ++next) {
+            if (starts[next] != wxString::npos) {
+                end = starts[next];
+                break;
+            }
+        }
+        clauses[i] = Trimmed(text.Mid(bodies[i], end - bodies[i]));
+        if (clauses[i].IsEmpty()) {
+            error = wxString::Format("%s is missing its argument", CLAUSES[i]);
+            return false;
+        }
+    }
+    
+    // FROM names the table for readability, the query always runs on the open one
+    if (starts[2] != wxString::npos) {
+        if (!where.Compile(clauses[2], columnNames, ColumnExpression::Type::BOOL, error)) {
+            error = "WHERE: " + error;
+            return false;
+        }
+        hasWhere = true;
+    }
+    if (starts[3] != wxString::npos) {
+        for (const wxString& part : SplitList(clauses[3])) {
+            groupBy.emplace_back();
+            if (!groupBy.back().Compile(part, columnNames, error)) {
+                error = "GROUP BY: " + error;
+                return false;
+            }
+        }
+    }
+    if (!ParseItems(clauses[0], columnNames, error)) {
+        return false;
+    }
+    grouped = !groupBy.empty();
+    for (const Item& item : items) {
+        grouped = grouped || item.aggregate != Aggregate::NONE;
+    }
+    if (starts[4] != wxString::npos && !ParseOrderBy(clauses[4], columnNames, error)) {
+        return false;
+    }
+    if (starts[5] != wxString::npos && (!clauses[5].ToLongLong(&limit) || limit < 0)) {
+        error = wxString::Format("Invalid LIMIT %s", clauses[5]);
+        return false;
+    }
+    
+    CollectColumns();
+    return true;
+}
+
+bool TableQuery::ParseItems(const wxString& text, const std::vector<wxString>& columnNames, wxString& error) {
+    static const struct {
+        const char* name;
+        Aggregate aggregate;
+    } AGGREGATES[] = {
+        {"COUNT", Aggregate::COUNT}, {"SUM", Aggregate::SUM}, {"AVG", Aggregate::AVG},
+        {"MIN", Aggregate::MIN}, {"MAX", Aggregate::MAX}
+    };
+    
+    for (const wxString& part : SplitList(text)) {
+        if (part == "*") {
+            for (size_t col = 0; col < columnNames.size(); ++col) {
+                items.emplace_back();
+                Item& item = items.back();
+                item.label = columnNames[col];
+                item.text = wxString::Format("[%d]", (int)col + 1);
+                item.aggregate = Aggregate::NONE;
+                // By index, a column named "2" must not stand in for the second
+                item.expression.CompileColumn((int)col);
+            }
+            continue;
+        }
+        
+        items.emplace_back();
+        Item& item = items.back();
+        item.text = part;
+        item.aggregate = Aggregate::NONE;
+        
+        // A trailing AS names the item
+        size_t as = wxString::npos;
+        for (size_t found = FindKeyword(part, "AS"); found != wxString::npos; found = FindKeyword(part, "AS", found + 2)) {
+            as = found;
+        }
+        if (as != wxString::npos) {
+            item.label = Unquote(Trimmed(part.Mid(as + 2)));
+            item.text = Trimmed(part.Left(as));
+        }
+        if (item.text.IsEmpty()) {
+            error = "Empty item in SELECT";
+            return false;
+        }
+        
+        // An aggregate spans the whole item: its call's parentheses close at the end
+        wxString argument = item.text;
+        for (const auto& aggregate : AGGREGATES) {
+            size_t length = MatchKeyword(item.text, 0, aggregate.name);
+            if (length == 0) {
+                continue;
+            }
+            size_t open = length;
+            while (open < item.text.length() && IsBlank(item.text[open])) {
+                ++open;
+            }
+            if (open >= item.text.length() || item.text[open] != '(' || item.text.Last() != ')' ||
+                ScanTopLevel(item.text, open, [](size_t) { return true; }) != wxString::npos) {
+                continue;
+            }
+            argument = Trimmed(item.text.Mid(open + 1, item.text.length() - open - 2));
+            item.aggregate = aggregate.aggregate;
+            if (item.aggregate == Aggregate::COUNT && argument == "*") {
+                item.aggregate = Aggregate::COUNT_ALL;
+            }
+            break;
+        }
+        if (item.label.IsEmpty()) {
+            item.label = item.aggregate == Aggregate::NONE ? Unquote(item.text) : item.text;
+        }
+        
+        bool compiled = true;
+        switch (item.aggregate) {
+            case Aggregate::NONE:
+                compiled = item.expression.Compile(argument, columnNames, error);
+                break;
+            case Aggregate::COUNT_ALL:
+                break;
+            case Aggregate::COUNT:
+            case Aggregate::MIN:
+            case Aggregate::MAX:
+                compiled = item.expression.Compile(argument, columnNames, ColumnExpression::Type::TEXT, error);
+                break;
+            case Aggregate::SUM:
+            case Aggregate::AVG:
+                compiled = item.expression.Compile(argument, columnNames, ColumnExpression::Type::NUMBER, error);
+                break;
+        }
+        if (!compiled) {
+            error = item.text + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TableQuery::ParseOrderBy(const wxString& text, const std::vector<wxString>& columnNames, wxString& error) {
+    for (wxString term : SplitList(text)) {
+        orderBy.emplace_back();
+        SortKey& key = orderBy.back();
+        key.descending = false;
+        key.column = -1;
+        
+        size_t space = term.find_last_of(wxT(" \t\r\n"));
+        wxString direction = space == wxString::npos ? wxString() : term.Mid(space + 1);
+        if (direction.IsSameAs("DESC", false) || direction.IsSameAs("ASC", false)) {
+            key.descending = direction.IsSameAs("DESC", false);
+            term = Trimmed(term.Left(space));
+        }
+        
+        // A position, a label or the text of an item sorts on that item
+        long position;
+        if (term.ToLong(&position)) {
+            if (position < 1 || position > (long)items.size()) {
+                error = wxString::Format("ORDER BY %s is not a selected column", term);
+                return false;
+            }
+            key.column = (int)position - 1;
+            continue;
+        }
+        for (size_t i = 0; i < items.size() && key.column < 0; ++i) {
+            if (items[i].label.IsSameAs(Unquote(term), false) || items[i].text.IsSameAs(term, false)) {
+                key.column = (int)i;
+            }
+        }
+        if (key.column >= 0) {
+            continue;
+        }
+        
+        // Anything else is computed per row, which a grouped result no longer has
+        if (grouped) {
+            error = wxString::Format("ORDER BY %s must name a selected column when grouping", term);
+            return false;
+        }
+        if (!key.expression.Compile(term, columnNames, error)) {
+            error = "ORDER BY: " + error;
+            return false;
+        }
+        key.column = (int)items.size() + (int)orderBy.size() - 1;
+    }
+    return true;
+}
+
+void TableQuery::CollectColumns() {
+    whereColumns = hasWhere ? where.GetColumns() : std::vector<int>();
+    
+    std::vector<int> used;
+    auto add = [&used](const ColumnExpression& expression) {
+        std::vector<int> columns = expression.GetColumns();
+        used.insert(used.end(), columns.begin(), columns.end());
+    };
+    for (const Item& item : items) {
+        if (item.aggregate != Aggregate::COUNT_ALL) {
+            add(item.expression);
+        }
+    }
+    for (const ColumnExpression& expression : groupBy) {
+        add(expression);
+    }
+    for (const SortKey& key : orderBy) {
+        if (key.column >= (int)items.size()) {
+            add(key.expression);
+        }
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    
+    otherColumns.clear();
+    std::set_difference(used.begin(), used.end(), whereColumns.begin(), whereColumns.end(),
+                        std::back_inserter(otherColumns));
+}
+
+std::unique_ptr<CSVTable> TableQuery::Run(CSVTable& table) const {
+    PROFILE_SCOPE("query.run");
+    
+    // Columns parsed from evicted pages go to slots, condition columns first
+    std::vector<int> slots(table.GetNumberCols(), -1);
+    for (size_t i = 0; i < whereColumns.size(); ++i) {
+        slots[whereColumns[i]] = (int)i;
+    }
+    for (size_t i = 0; i < otherColumns.size(); ++i) {
+        slots[otherColumns[i]] = (int)(whereColumns.size() + i);
+    }
+    
+    std::vector<Partial> partials;
+    std::mutex mutex;
+    WorkerPool::Get().ParallelFor(table.GetPageCount(), 1, [&](size_t begin, size_t end) {
+        Partial partial;
+        partial.firstMorsel = begin;
+        if (hasWhere) {
+            where.InitWorkspace(partial.whereSpace);
+        }
+        partial.itemSpaces.resize(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (items[i].aggregate != Aggregate::COUNT_ALL) {
+                items[i].expression.InitWorkspace(partial.itemSpaces[i]);
+            }
+        }
+        partial.groupSpaces.resize(groupBy.size());
+        for (size_t i = 0; i < groupBy.size(); ++i) {
+            groupBy[i].InitWorkspace(partial.groupSpaces[i]);
+        }
+        partial.keySpaces.resize(orderBy.size());
+        for (size_t i = 0; i < orderBy.size(); ++i) {
+            if (orderBy[i].column >= (int)items.size()) {
+                orderBy[i].expression.InitWorkspace(partial.keySpaces[i]);
+            }
+        }
+        
+        // Without sorting or grouping a LIMIT is met by the first rows of each run
+        bool enough = false;
+        for (size_t page = begin; page < end && !enough; ++page) {
+            Morsel morsel;
+            morsel.page = page;
+            morsel.rows = table.GetPageRows(page);
+            morsel.slots = &slots;
+            RunMorsel(table, morsel, partial);
+            enough = !grouped && orderBy.empty() && limit >= 0 && partial.rows.size() >= (size_t)limit;
+        }
+        
+        // The registers are scratch, only the results are kept
+        partial.whereSpace.clear();
+        partial.itemSpaces.clear();
+        partial.groupSpaces.clear();
+        partial.keySpaces.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        partials.push_back(std::move(partial));
+    });
+    std::sort(partials.begin(), partials.end(), [](const Partial& a, const Partial& b) {
+        return a.firstMorsel < b.firstMorsel;
+    });
+    
+    std::vector<std::vector<wxString>> rows;
+    if (grouped) {
+        FinishGroups(partials, rows);
+    } else {
+        for (Partial& partial : partials) {
+            std::move(partial.rows.begin(), partial.rows.end(), std::back_inserter(rows));
+        }
+    }
+    partials.clear();
+    SortRows(rows);
+    
+    std::unique_ptr<CSVTable> result(new CSVTable());
+    std::vector<wxString> labels;
+    for (const Item& item : items) {
+        labels.push_back(item.label);
+    }
+    for (auto& row : rows) {
+        row.resize(items.size());   // drops the sort keys that were not selected
+        result->AppendLoadedRow(row, -1);
+    }
+    result->FinishLoad(labels, items.size(), nullptr);
+    return result;
+}
+
+void TableQuery::RunMorsel(const CSVTable& table, Morsel& morsel, Partial& partial) const {
+    // Loaded pages are read in place, evicted ones from the columns parsed for them
+    size_t page = morsel.page;
+    if (table.IsPageResident(page)) {
+        morsel.reader = [&table, page](int column, size_t first, size_t count, std::vector<wxString>& values) {
+            table.ReadPageColumn(page, column, first, count, values.data());
+        };
+    } else {
+        morsel.data.resize(whereColumns.size() + otherColumns.size());
+        morsel.reader = [&morsel](int column, size_t first, size_t count, std::vector<wxString>& values) {
+            const std::vector<wxString>& source = morsel.data[(*morsel.slots)[column]];
+            std::copy(source.begin() + first, source.begin() + first + count, values.begin());
+        };
+    }
+    
+    // The condition runs first, on an evicted page after parsing only its
+    // columns, so the rest is never decoded for pages where nothing matches
+    std::vector<unsigned char> pass(morsel.rows, 1);
+    if (hasWhere) {
+        if (!table.IsPageResident(page)) {
+            std::vector<std::vector<wxString>> loaded;
+            table.LoadPageColumns(page, whereColumns, loaded);
+            for (size_t i = 0; i < loaded.size(); ++i) {
+                morsel.data[i] = std::move(loaded[i]);
+            }
+        }
+        for (size_t offset = 0; offset < morsel.rows; offset += ColumnExpression::BATCH_ROWS) {
+            size_t count = wxMin(ColumnExpression::BATCH_ROWS, morsel.rows - offset);
+            where.RunBatch(partial.whereSpace, offset, count, morsel.reader);
+            const std::vector<unsigned char>& flags = where.GetResult(partial.whereSpace).flags;
+            std::copy(flags.begin(), flags.begin() + count, pass.begin() + offset);
+        }
+        if (std::find(pass.begin(), pass.end(), 1) == pass.end()) {
+            return;
+        }
+    }
+    if (!table.IsPageResident(page) && !otherColumns.empty()) {
+        std::vector<std::vector<wxString>> loaded;
+        table.LoadPageColumns(page, otherColumns, loaded);
+        for (size_t i = 0; i < loaded.size(); ++i) {
+            morsel.data[whereColumns.size() + i] = std::move(loaded[i]);
+        }
+    }
+    
+    std::vector<size_t> selection;
+    for (size_t offset = 0; offset < morsel.rows; offset += ColumnExpression::BATCH_ROWS) {
+        size_t count = wxMin(ColumnExpression::BATCH_ROWS, morsel.rows - offset);
+        selection.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (pass[offset + i]) {
+                selection.push_back(i);
+            }
+        }
+        if (selection.empty()) {
+            continue;
+        }
+        if (grouped) {
+            Accumulate(morsel, offset, selection, partial);
+        } else {
+            Project(morsel, offset, selection, partial);
+        }
+    }
+}
+
+void TableQuery::Project(Morsel& morsel, size_t offset, const std::vector<size_t>& selection,
+                         Partial& partial) const {
+    size_t count = wxMin(ColumnExpression::BATCH_ROWS, morsel.rows - offset);
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].expression.RunBatch(partial.itemSpaces[i], offset, count, morsel.reader);
+    }
+    for (size_t i = 0; i < orderBy.size(); ++i) {
+        if (orderBy[i].column >= (int)items.size()) {
+            orderBy[i].expression.RunBatch(partial.keySpaces[i], offset, count, morsel.reader);
+        }
+    }
+    
+    // Rows are items followed by the sort keys that are not items
+    size_t width = items.size();
+    for (const SortKey& key : orderBy) {
+        width = wxMax(width, (size_t)key.column + 1);
+    }
+    for (size_t row : selection) {
+        partial.rows.emplace_back(width);
+        std::vector<wxString>& out = partial.rows.back();
+        for (size_t i = 0; i < items.size(); ++i) {
+            items[i].expression.FormatResult(partial.itemSpaces[i], row, out[i]);
+        }
+        for (size_t i = 0; i < orderBy.size(); ++i) {
+            if (orderBy[i].column >= (int)items.size()) {
+                orderBy[i].expression.FormatResult(partial.keySpaces[i], row, out[orderBy[i].column]);
+            }
+        }
+    }
+}
+
+void TableQuery::Accumulate(Morsel& morsel, size_t offset, const std::vector<size_t>& selection,
+                            Partial& partial) const {
+    size_t count = wxMin(ColumnExpression::BATCH_ROWS, morsel.rows - offset);
+    for (size_t i = 0; i < groupBy.size(); ++i) {
+        groupBy[i].RunBatch(partial.groupSpaces[i], offset, count, morsel.reader);
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].aggregate != Aggregate::COUNT_ALL) {
+            items[i].expression.RunBatch(partial.itemSpaces[i], offset, count, morsel.reader);
+        }
+    }
+    
+    for (size_t row : selection) {
+        // Group values joined by a character cells do not contain
+        partial.key.clear();
+        for (size_t i = 0; i < groupBy.size(); ++i) {
+            groupBy[i].FormatResult(partial.groupSpaces[i], row, partial.part);
+            partial.key += partial.part;
+            partial.key += wxChar(0);
+        }
+        
+        auto found = partial.index.find(partial.key);
+        size_t index;
+        if (found != partial.index.end()) {
+            index = found->second;
+        } else {
+            index = partial.groups.size();
+            partial.index.emplace(partial.key, index);
+            partial.keys.push_back(partial.key);
+            partial.groups.emplace_back();
+            Group& group = partial.groups.back();
+            group.values.resize(items.size());
+            group.accumulators.resize(items.size());
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (items[i].aggregate == Aggregate::NONE) {
+                    items[i].expression.FormatResult(partial.itemSpaces[i], row, group.values[i]);
+                }
+            }
+        }
+        
+        Group& group = partial.groups[index];
+        for (size_t i = 0; i < items.size(); ++i) {
+            Accumulator& accumulator = group.accumulators[i];
+            switch (items[i].aggregate) {
+                case Aggregate::NONE:
+                    break;
+                case Aggregate::COUNT_ALL:
+                    ++accumulator.count;
+                    break;
+                case Aggregate::COUNT:
+                    if (!items[i].expression.GetResult(partial.itemSpaces[i]).texts[row].IsEmpty()) {
+                        ++accumulator.count;
+                    }
+                    break;
+                case Aggregate::SUM:
+                case Aggregate::AVG: {
+                    double value = items[i].expression.GetResult(partial.itemSpaces[i]).numbers[row];
+                    if (!std::isnan(value)) {
+                        accumulator.sum += value;
+                        ++accumulator.count;
+                    }
+                    break;
+                }
+                case Aggregate::MIN:
+                case Aggregate::MAX: {
+                    // Empty cells are ignored, as SQL ignores NULL
+                    const wxString& value = items[i].expression.GetResult(partial.itemSpaces[i]).texts[row];
+                    if (value.IsEmpty()) {
+                        break;
+                    }
+                    double number = ColumnExpression::ParseNumber(value);
+                    int order = accumulator.hasBest ? CompareValues(value, number, accumulator.best, accumulator.bestNumber) : 0;
+                    if (!accumulator.hasBest || (items[i].aggregate == Aggregate::MIN ? order < 0 : order > 0)) {
+                        accumulator.best = value;
+                        accumulator.bestNumber = number;
+                        accumulator.hasBest = true;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void TableQuery::FinishGroups(std::vector<Partial>& partials, std::vector<std::vector<wxString>>& rows) const {
+    PROFILE_SCOPE("query.merge_groups");
+    // Partials are in table order, so groups keep the order they first appear in
+    std::unordered_map<wxString, size_t, KeyHash> index;
+    std::vector<Group> groups;
+    for (Partial& partial : partials) {
+        for (size_t g = 0; g < partial.groups.size(); ++g) {
+            auto found = index.find(partial.keys[g]);
+            if (found == index.end()) {
+                index.emplace(partial.keys[g], groups.size());
+                groups.push_back(std::move(partial.groups[g]));
+                continue;
+            }
+            Group& group = groups[found->second];
+            for (size_t i = 0; i < items.size(); ++i) {
+                Accumulator& total = group.accumulators[i];
+                const Accumulator& part = partial.groups[g].accumulators[i];
+                total.count += part.count;
+                total.sum += part.sum;
+                if (part.hasBest) {
+                    int order = total.hasBest ? CompareValues(part.best, part.bestNumber, total.best, total.bestNumber) : 0;
+                    if (!total.hasBest || (items[i].aggregate == Aggregate::MIN ? order < 0 : order > 0)) {
+                        total.best = part.best;
+                        total.bestNumber = part.bestNumber;
+                        total.hasBest = true;
+                    }
+                }
+            }
+        }
+        partial.groups.clear();
+        partial.index.clear();
+    }
+    
+    // Aggregates over no rows at all still give one row, COUNT(*) = 0
+    if (groups.empty() && groupBy.empty()) {
+        groups.emplace_back();
+        groups.back().values.resize(items.size());
+        groups.back().accumulators.resize(items.size());
+    }
+    
+    rows.resize(groups.size());
+    for (size_t g = 0; g < groups.size(); ++g) {
+        Group& group = groups[g];
+        std::vector<wxString>& row = rows[g];
+        row.resize(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            const Accumulator& accumulator = group.accumulators[i];
+            switch (items[i].aggregate) {
+                case Aggregate::NONE:
+                    row[i] = std::move(group.values[i]);
+                    break;
+                case Aggregate::COUNT_ALL:
+                case Aggregate::COUNT:
+                    row[i] = wxString::Format("%lld", accumulator.count);
+                    break;
+                case Aggregate::SUM:
+                    if (accumulator.count > 0) {
+                        ColumnExpression::FormatNumber(accumulator.sum, row[i]);
+                    }
+                    break;
+                case Aggregate::AVG:
+                    if (accumulator.count > 0) {
+                        ColumnExpression::FormatNumber(accumulator.sum / accumulator.count, row[i]);
+                    }
+                    break;
+                case Aggregate::MIN:
+                case Aggregate::MAX:
+                    row[i] = accumulator.best;
+                    break;
+            }
+        }
+    }
+}
+
+void TableQuery::SortRows(std::vector<std::vector<wxString>>& rows) const {
+    size_t kept = limit >= 0 ? wxMin((size_t)limit, rows.size()) : rows.size();
+    if (orderBy.empty()) {
+        rows.resize(kept);
+        return;
+    }
+    PROFILE_SCOPE("query.sort");
+    
+    // Numbers are parsed once per key instead of on every comparison
+    std::vector<std::vector<double>> numbers(orderBy.size(), std::vector<double>(rows.size()));
+    WorkerPool::Get().ParallelFor(rows.size(), 4096, [&](size_t begin, size_t end) {
+        for (size_t k = 0; k < orderBy.size(); ++k) {
+            for (size_t row = begin; row < end; ++row) {
+                numbers[k][row] = ColumnExpression::ParseNumber(rows[row][orderBy[k].column]);
+            }
+        }
+    });
+    
+    // Ties keep table order; with a LIMIT only the first rows are fully sorted
+    std::vector<size_t> order(rows.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&](size_t a, size_t b) {
+        for (size_t k = 0; k < orderBy.size(); ++k) {
+            int column = orderBy[k].column;
+            int result = CompareValues(rows[a][column], numbers[k][a], rows[b][column], numbers[k][b]);
+            if (result != 0) {
+                return orderBy[k].descending ? result > 0 : result < 0;
+            }
+        }
+        return a < b;
+    };
+    if (kept < rows.size()) {
+        std::partial_sort(order.begin(), order.begin() + kept, order.end(), less);
+    } else {
+        std::sort(order.begin(), order.end(), less);
+    }
+    
+    std::vector<std::vector<wxString>> sorted(kept);
+    for (size_t i = 0; i < kept; ++i) {
+        sorted[i] = std::move(rows[order[i]]);
+    }
+    rows.swap(sorted);
+}
+
+int TableQuery::CompareValues(const wxString& a, double aNumber, const wxString& b, double bNumber) {
+    int aRank = a.IsEmpty() ? 0 : (std::isnan(aNumber) ? 2 : 1);
+    int bRank = b.IsEmpty() ? 0 : (std::isnan(bNumber) ? 2 : 1);
+    if (aRank != bRank) {
+        return aRank < bRank ? -1 : 1;
+    }
+    if (aRank == 1) {
+        return aNumber < bNumber ? -1 : (aNumber > bNumber ? 1 : 0);
+    }
+    int order = a.compare(b);
+    return order < 0 ? -1 : (order > 0 ? 1 : 0);
+}
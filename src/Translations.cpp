@@ -81,7 +81,165 @@ wxString Translate(const wxString& key, Language language) {
         if (key == "msg_save_success") return wxString::FromUTF8("Datoteka je uspešno sačuvana!");
         if (key == "msg_save_error") return wxString::FromUTF8("Greška pri čuvanju datoteke!");
         if (key == "msg_success_title") return wxString::FromUTF8("Uspeh");
-        if (key == "msg_error_title") return wxString::FromUTF8("Greška");    }
+        if (key == "msg_error_title") return wxString::FromUTF8("Greška");
+        
+        if (key == "prompt_recover_title") return wxString::FromUTF8("Vraćanje izmena");
+        if (key == "prompt_recover_message") return wxString::FromUTF8("Pronađene su nesačuvane izmene iz prethodne sesije za: %s (%d izmena).\nDa li želite da ih vratite?");
+        if (key == "prompt_recover_changed") return wxString::FromUTF8("Upozorenje: datoteka je izmenjena nakon što su ove izmene napravljene.");
+        if (key == "recover_untitled") return wxString::FromUTF8("nova datoteka");
+        if (key == "error_recover_missing") return wxString::FromUTF8("Pronađene su nesačuvane izmene za %s, ali datoteka više ne postoji.");
+        if (key == "tab_untitled") return wxString::FromUTF8("Bez naslova");
+        
+        if (key == "menu_tools") return wxString::FromUTF8("&Alati");
+        if (key == "menu_compare") return wxString::FromUTF8("&Uporedi datoteke...");
+        if (key == "menu_compare_desc") return wxString::FromUTF8("Uporedi dve CSV datoteke red po red");
+        if (key == "dialog_compare_title") return wxString::FromUTF8("Poređenje datoteka");
+        if (key == "compare_left") return wxString::FromUTF8("Originalna datoteka:");
+        if (key == "compare_right") return wxString::FromUTF8("Izmenjena datoteka:");
+        if (key == "compare_header") return wxString::FromUTF8("Prvi red je zaglavlje");
+        if (key == "compare_keys") return wxString::FromUTF8("Ključne kolone (nazivi ili brojevi, odvojeni zapetom; prazno = ceo red):");
+        if (key == "compare_progress") return wxString::FromUTF8("Poređenje datoteka...");
+        if (key == "compare_summary") return wxString::FromUTF8("Dodato: %d, uklonjeno: %d, izmenjeno: %d");
+        if (key == "compare_identical") return wxString::FromUTF8("Datoteke su identične.");
+        if (key == "error_compare_files") return wxString::FromUTF8("Izaberite dve postojeće datoteke za poređenje.");
+        
+        if (key == "menu_copy") return wxString::FromUTF8("Kopiraj\tCtrl+C");
+        if (key == "menu_paste") return wxString::FromUTF8("Nalepi\tCtrl+V");
+        
+        if (key == "menu_performance") return wxString::FromUTF8("&Merenje performansi");
+        if (key == "menu_performance_desc") return wxString::FromUTF8("Prikaži vreme i alokacije po fazama učitavanja, čuvanja i izmena");
+        if (key == "perf_title") return wxString::FromUTF8("Merenje performansi");
+        if (key == "perf_scope") return wxString::FromUTF8("Faza");
+        if (key == "perf_calls") return wxString::FromUTF8("Poziva");
+        if (key == "perf_total") return wxString::FromUTF8("Ukupno (ms)");
+        if (key == "perf_average") return wxString::FromUTF8("Prosek (ms)");
+        if (key == "perf_max") return wxString::FromUTF8("Najduže (ms)");
+        if (key == "perf_allocations") return wxString::FromUTF8("Alokacija");
+        if (key == "perf_bytes") return wxString::FromUTF8("Alocirano (KB)");
+        if (key == "perf_reset") return wxString::FromUTF8("Poništi");
+        if (key == "perf_save_trace") return wxString::FromUTF8("Sačuvaj trag...");
+        if (key == "perf_trace_files") return wxString::FromUTF8("Chrome trag (*.json)|*.json");
+        if (key == "error_perf_trace") return wxString::FromUTF8("Čuvanje datoteke traga nije uspelo.");
+        if (key == "prompt_projection_overwrite_title") return wxString::FromUTF8("Učitane su samo neke kolone");
+        if (key == "prompt_projection_overwrite") return wxString::FromUTF8("Iz ove datoteke su učitane samo izabrane kolone. Čuvanjem preko nje ostale kolone će biti uklonjene.\nDa li želite da nastavite?");
+        if (key == "menu_computed_column") return wxString::FromUTF8("Izračunata kolona...");
+        if (key == "menu_computed_column_desc") return wxString::FromUTF8("Umetni kolonu izračunatu iz izraza nad drugim kolonama");
+        if (key == "dialog_computed_title") return wxString::FromUTF8("Izračunata kolona");
+        if (key == "computed_name") return wxString::FromUTF8("Naziv kolone (opciono):");
+        if (key == "computed_expression") return wxString::FromUTF8("Izraz:");
+        if (key == "computed_columns") return wxString::FromUTF8("Kolone (dvoklik za umetanje):");
+        if (key == "computed_hint") return wxString::FromUTF8("Primeri: [cena] * [kolicina], LEFT(naziv, 3) & \"-\" & YEAR(datum), IF([iznos] > 100, \"veliki\", \"mali\")\nOperatori: + - * / % & = <> < <= > >= AND OR NOT\nFunkcije: IF LEN LEFT RIGHT MID UPPER LOWER TRIM CONTAINS ISEMPTY YEAR MONTH DAY ROUND ABS");
+        if (key == "error_computed_expression") return wxString::FromUTF8("Izraz nije ispravan.");
+        if (key == "toolbar_query") return wxString::FromUTF8("Upit");
+        if (key == "toolbar_query_hint") return wxString::FromUTF8("SELECT ... WHERE ... GROUP BY ... ORDER BY ... LIMIT ...");
+        if (key == "toolbar_query_tooltip") return wxString::FromUTF8("Upit nad aktivnom karticom, npr. SELECT status, COUNT(*) WHERE amount > 100 GROUP BY status. Enter otvara rezultat u novoj kartici.");
+        if (key == "error_query") return wxString::FromUTF8("Upit nije ispravan.");
+        if (key == "menu_pivot") return wxString::FromUTF8("Pivot tabela...");
+        if (key == "menu_pivot_desc") return wxString::FromUTF8("Grupiši redove aktivne kartice po ključnim kolonama i sumiraj ih");
+        if (key == "pivot_title") return wxString::FromUTF8("Pivot tabela");
+        if (key == "pivot_rows") return wxString::FromUTF8("Redovi:");
+        if (key == "pivot_columns") return wxString::FromUTF8("Kolone:");
+        if (key == "pivot_values") return wxString::FromUTF8("Vrednosti:");
+        if (key == "pivot_add_value") return wxString::FromUTF8("Dodaj");
+        if (key == "pivot_remove_value") return wxString::FromUTF8("Ukloni");
+        if (key == "pivot_refresh") return wxString::FromUTF8("Osveži");
+        if (key == "pivot_export") return wxString::FromUTF8("Izvezi...");
+        if (key == "pivot_pick") return wxString::FromUTF8("Izaberite ključne kolone ili dodajte vrednost.");
+        if (key == "pivot_source_closed") return wxString::FromUTF8("Izvorna kartica je zatvorena.");
+        if (key == "pivot_error") return wxString::FromUTF8("Pivot tabela nije izračunata:");
+        if (key == "pivot_summary") return wxString::FromUTF8("%d redova");
+        if (key == "menu_merge") return wxString::FromUTF8("&Spoji sa datotekom...");
+        if (key == "menu_merge_desc") return wxString::FromUTF8("Dopuni redove jedne CSV datoteke kolonama druge po ključnim kolonama");
+        if (key == "dialog_merge_title") return wxString::FromUTF8("Spajanje datoteka");
+        if (key == "merge_left") return wxString::FromUTF8("Datoteka čiji se redovi zadržavaju:");
+        if (key == "merge_right") return wxString::FromUTF8("Datoteka u kojoj se traže kolone:");
+        if (key == "merge_left_keys") return wxString::FromUTF8("Ključne kolone prve datoteke (nazivi ili brojevi, odvojeni zapetom):");
+        if (key == "merge_right_keys") return wxString::FromUTF8("Ključne kolone druge datoteke (prazno = iste kao u prvoj):");
+        if (key == "merge_type") return wxString::FromUTF8("Vrsta spajanja:");
+        if (key == "merge_inner") return wxString::FromUTF8("Samo redovi sa parom (inner)");
+        if (key == "merge_left_join") return wxString::FromUTF8("Svi redovi prve datoteke (left)");
+        if (key == "merge_anti") return wxString::FromUTF8("Redovi prve datoteke bez para (anti)");
+        if (key == "merge_output") return wxString::FromUTF8("Datoteka rezultata:");
+        if (key == "merge_progress") return wxString::FromUTF8("Spajanje datoteka...");
+        if (key == "error_merge_input") return wxString::FromUTF8("Izaberite dve postojeće datoteke, ključne kolone i datoteku rezultata.");
+        if (key == "menu_duplicates") return wxString::FromUTF8("Pronađi &duplikate...");
+        if (key == "menu_duplicates_desc") return wxString::FromUTF8("Označi ili ukloni redove koji ponavljaju neki drugi red");
+        if (key == "dialog_duplicates_title") return wxString::FromUTF8("Duplikati");
+        if (key == "duplicates_columns") return wxString::FromUTF8("Kolone koje se porede:");
+        if (key == "duplicates_keep") return wxString::FromUTF8("Zadrži");
+        if (key == "duplicates_keep_first") return wxString::FromUTF8("Prvi primerak");
+        if (key == "duplicates_keep_last") return wxString::FromUTF8("Poslednji primerak");
+        if (key == "duplicates_action") return wxString::FromUTF8("Akcija");
+        if (key == "duplicates_select") return wxString::FromUTF8("Označi duplikate");
+        if (key == "duplicates_remove") return wxString::FromUTF8("Ukloni duplikate");
+        if (key == "msg_no_duplicates") return wxString::FromUTF8("Nema duplikata.");
+        if (key == "msg_duplicates_selected") return wxString::FromUTF8("Označeno duplikata: %d");
+        if (key == "msg_duplicates_removed") return wxString::FromUTF8("Uklonjeno duplikata: %d");
+        if (key == "error_duplicates_columns") return wxString::FromUTF8("Izaberite bar jednu kolonu.");
+        if (key == "menu_split") return wxString::FromUTF8("&Podeli datoteku...");
+        if (key == "menu_split_desc") return wxString::FromUTF8("Podeli veliku CSV datoteku na delove od zadatog broja redova ili megabajta");
+        if (key == "dialog_split_title") return wxString::FromUTF8("Podela datoteke");
+        if (key == "split_input") return wxString::FromUTF8("Datoteka koja se deli:");
+        if (key == "split_size") return wxString::FromUTF8("Najviše po delu:");
+        if (key == "split_rows") return wxString::FromUTF8("redova");
+        if (key == "split_megabytes") return wxString::FromUTF8("MB");
+        if (key == "split_output") return wxString::FromUTF8("Naziv delova (dodaje se _001, _002, ...):");
+        if (key == "split_progress") return wxString::FromUTF8("Podela datoteke...");
+        if (key == "msg_split_done") return wxString::FromUTF8("Zapisano delova: %d (redova: %d).");
+        if (key == "error_split_input") return wxString::FromUTF8("Izaberite postojeću datoteku, veličinu dela veću od nule i naziv delova.");
+        if (key == "menu_concat") return wxString::FromUTF8("Na&dovezi datoteke...");
+        if (key == "menu_concat_desc") return wxString::FromUTF8("Spoji više CSV datoteka istih kolona u jednu");
+        if (key == "dialog_concat_title") return wxString::FromUTF8("Nadovezivanje datoteka");
+        if (key == "concat_files") return wxString::FromUTF8("Datoteke, redom kojim se nadovezuju:");
+        if (key == "concat_add") return wxString::FromUTF8("Dodaj...");
+        if (key == "concat_remove") return wxString::FromUTF8("Ukloni");
+        if (key == "concat_progress") return wxString::FromUTF8("Nadovezivanje datoteka...");
+        if (key == "error_concat_input") return wxString::FromUTF8("Dodajte bar dve postojeće datoteke i izaberite datoteku rezultata.");
+        if (key == "menu_validate") return wxString::FromUTF8("Pro&veri datoteku...");
+        if (key == "menu_validate_desc") return wxString::FromUTF8("Proveri strukturu CSV datoteke i vrednosti kolona prema šemi");
+        if (key == "dialog_validate_title") return wxString::FromUTF8("Provera datoteke");
+        if (key == "validate_input") return wxString::FromUTF8("Datoteka koja se proverava:");
+        if (key == "validate_schema") return wxString::FromUTF8("Šema (neobavezno):");
+        if (key == "validate_report") return wxString::FromUTF8("Izveštaj o svim problemima (neobavezno):");
+        if (key == "validate_progress") return wxString::FromUTF8("Provera datoteke...");
+        if (key == "msg_validate_clean") return wxString::FromUTF8("Nema problema u %d redova.");
+        if (key == "msg_validate_issues") return wxString::FromUTF8("Pronađeno problema: %d u %d redova.");
+        if (key == "error_validate_input") return wxString::FromUTF8("Izaberite postojeću datoteku i, po želji, postojeću šemu.");
+        if (key == "error_validate_report") return wxString::FromUTF8("Nije moguće zapisati izveštaj %s.");
+        if (key == "menu_open_folder") return wxString::FromUTF8("Otvori &fasciklu...");
+        if (key == "menu_open_folder_desc") return wxString::FromUTF8("Otvori sve CSV datoteke iz fascikle ili po šablonu kao jednu tabelu");
+        if (key == "dialog_open_folder_title") return wxString::FromUTF8("Otvaranje više datoteka");
+        if (key == "open_folder_folder") return wxString::FromUTF8("Fascikla:");
+        if (key == "open_folder_pattern") return wxString::FromUTF8("Šablon naziva datoteka (prazno za sve CSV i tekstualne datoteke):");
+        if (key == "open_folder_progress") return wxString::FromUTF8("Učitavanje datoteka: %d...");
+        if (key == "error_open_folder") return wxString::FromUTF8("Nijedna datoteka ne odgovara fascikli i šablonu.");
+        if (key == "prompt_open_as_one") return wxString::FromUTF8("Otvoriti %d datoteka kao jednu tabelu?\n\nIzaberite Ne da se svaka otvori u svojoj kartici.");
+        if (key == "prompt_open_as_one_title") return wxString::FromUTF8("Više datoteka");
+        if (key == "shards_file_column") return wxString::FromUTF8("Datoteka");
+        if (key == "menu_transform_column") return wxString::FromUTF8("Transformacija kolone...");
+        if (key == "menu_transform_column_desc") return wxString::FromUTF8("Očisti kolonu: skrati razmake, promeni velika i mala slova, zameni tekst, podeli kolonu ili ujednači decimalni znak");
+        if (key == "dialog_transform_title") return wxString::FromUTF8("Transformacija kolone");
+        if (key == "transform_column") return wxString::FromUTF8("Kolona:");
+        if (key == "transform_operation") return wxString::FromUTF8("Operacija:");
+        if (key == "transform_trim") return wxString::FromUTF8("Ukloni razmake na početku i kraju");
+        if (key == "transform_upper") return wxString::FromUTF8("Velika slova");
+        if (key == "transform_lower") return wxString::FromUTF8("Mala slova");
+        if (key == "transform_replace") return wxString::FromUTF8("Pronađi i zameni");
+        if (key == "transform_split") return wxString::FromUTF8("Podeli po graničniku u nove kolone");
+        if (key == "transform_decimal_point") return wxString::FromUTF8("Decimalni zarez u decimalnu tačku (1.234,5 -> 1234.5)");
+        if (key == "transform_decimal_comma") return wxString::FromUTF8("Decimalna tačka u decimalni zarez (1,234.5 -> 1234,5)");
+        if (key == "transform_find") return wxString::FromUTF8("Pronađi / graničnik (\\t za tab):");
+        if (key == "transform_replace_with") return wxString::FromUTF8("Zameni sa:");
+        if (key == "transform_match_case") return wxString::FromUTF8("Razlikuj velika i mala slova");
+        if (key == "error_transform_find") return wxString::FromUTF8("Unesite tekst koji se traži ili graničnik.");
+        if (key == "msg_transform_none") return wxString::FromUTF8("Nijedna ćelija nije promenjena.");
+        if (key == "menu_view_cell") return wxString::FromUTF8("Prikaži ćeliju...");
+        if (key == "dialog_cell_viewer_title") return wxString::FromUTF8("Sadržaj ćelije");
+        if (key == "cell_viewer_info") return wxString::FromUTF8("Kolona %s, red %d, %d znakova");
+        if (key == "cell_viewer_format_json") return wxString::FromUTF8("Formatiraj JSON");
+        if (key == "error_cell_viewer_json") return wxString::FromUTF8("Tekst nije ispravan JSON objekat ili niz.");
+        if (key == "error_journal_write") return wxString::FromUTF8("Izmene se više ne beleže za vraćanje posle pada programa (disk je pun ili nedostupan). Sačuvajte datoteku da ih ne biste izgubili.");
+    }
     
     // Default English
     if (key == "menu_file") return "&File";
@@ -162,5 +320,162 @@ wxString Translate(const wxString& key, Language language) {
     if (key == "msg_success_title") return "Success";
     if (key == "msg_error_title") return "Error";
     
+    if (key == "prompt_recover_title") return "Recover Changes";
+    if (key == "prompt_recover_message") return "Unsaved changes from a previous session were found for: %s (%d edits).\nDo you want to recover them?";
+    if (key == "prompt_recover_changed") return "Warning: the file has been modified since these changes were made.";
+    if (key == "recover_untitled") return "a new file";
+    if (key == "error_recover_missing") return "Unsaved changes were found for %s, but the file no longer exists.";
+    if (key == "tab_untitled") return "Untitled";
+    
+    if (key == "menu_tools") return "&Tools";
+    if (key == "menu_compare") return "&Compare Files...";
+    if (key == "menu_compare_desc") return "Compare two CSV files row by row";
+    if (key == "dialog_compare_title") return "Compare Files";
+    if (key == "compare_left") return "Original file:";
+    if (key == "compare_right") return "Changed file:";
+    if (key == "compare_header") return "First row is header";
+    if (key == "compare_keys") return "Key columns (names or numbers, comma separated; empty = whole row):";
+    if (key == "compare_progress") return "Comparing files...";
+    if (key == "compare_summary") return "Added: %d, removed: %d, modified: %d";
+    if (key == "compare_identical") return "The files are identical.";
+    if (key == "error_compare_files") return "Select two existing files to compare.";
+    
+    if (key == "menu_copy") return "Copy\tCtrl+C";
+    if (key == "menu_paste") return "Paste\tCtrl+V";
+    
+    if (key == "menu_performance") return "&Performance Monitor";
+    if (key == "menu_performance_desc") return "Show time and allocations per phase of loading, saving and editing";
+    if (key == "perf_title") return "Performance Monitor";
+    if (key == "perf_scope") return "Phase";
+    if (key == "perf_calls") return "Calls";
+    if (key == "perf_total") return "Total (ms)";
+    if (key == "perf_average") return "Average (ms)";
+    if (key == "perf_max") return "Max (ms)";
+    if (key == "perf_allocations") return "Allocations";
+    if (key == "perf_bytes") return "Allocated (KB)";
+    if (key == "perf_reset") return "Reset";
+    if (key == "perf_save_trace") return "Save Trace...";
+    if (key == "perf_trace_files") return "Chrome trace (*.json)|*.json";
+    if (key == "error_perf_trace") return "Failed to write the trace file.";
+    if (key == "prompt_projection_overwrite_title") return "Only Some Columns Loaded";
+    if (key == "prompt_projection_overwrite") return "Only the selected columns of this file were loaded. Saving over it will remove the other columns.\nDo you want to continue?";
+    if (key == "menu_computed_column") return "Computed Column...";
+    if (key == "menu_computed_column_desc") return "Insert a column computed from an expression over other columns";
+    if (key == "dialog_computed_title") return "Computed Column";
+    if (key == "computed_name") return "Column name (optional):";
+    if (key == "computed_expression") return "Expression:";
+    if (key == "computed_columns") return "Columns (double click to insert):";
+    if (key == "computed_hint") return "Examples: [price] * [qty], LEFT(name, 3) & \"-\" & YEAR(date), IF([amount] > 100, \"large\", \"small\")\nOperators: + - * / % & = <> < <= > >= AND OR NOT\nFunctions: IF LEN LEFT RIGHT MID UPPER LOWER TRIM CONTAINS ISEMPTY YEAR MONTH DAY ROUND ABS";
+    if (key == "error_computed_expression") return "The expression is not valid.";
+    if (key == "toolbar_query") return "Query";
+    if (key == "toolbar_query_hint") return "SELECT ... WHERE ... GROUP BY ... ORDER BY ... LIMIT ...";
+    if (key == "toolbar_query_tooltip") return "Query the active tab, e.g. SELECT status, COUNT(*) WHERE amount > 100 GROUP BY status. Press Enter to open the result in a new tab.";
+    if (key == "error_query") return "The query is not valid.";
+    if (key == "menu_pivot") return "Pivot Table...";
+    if (key == "menu_pivot_desc") return "Group the active tab's rows by key columns and summarize them";
+    if (key == "pivot_title") return "Pivot Table";
+    if (key == "pivot_rows") return "Rows:";
+    if (key == "pivot_columns") return "Columns:";
+    if (key == "pivot_values") return "Values:";
+    if (key == "pivot_add_value") return "Add";
+    if (key == "pivot_remove_value") return "Remove";
+    if (key == "pivot_refresh") return "Refresh";
+    if (key == "pivot_export") return "Export...";
+    if (key == "pivot_pick") return "Tick key columns or add a value.";
+    if (key == "pivot_source_closed") return "The source tab was closed.";
+    if (key == "pivot_error") return "The pivot could not be computed:";
+    if (key == "pivot_summary") return "%d rows";
+    if (key == "menu_merge") return "&Merge with File...";
+    if (key == "menu_merge_desc") return "Add columns from another CSV file to the rows of one, matched by key columns";
+    if (key == "dialog_merge_title") return "Merge Files";
+    if (key == "merge_left") return "File whose rows are kept:";
+    if (key == "merge_right") return "File to look columns up in:";
+    if (key == "merge_left_keys") return "Key columns of the first file (names or numbers, comma separated):";
+    if (key == "merge_right_keys") return "Key columns of the second file (empty = same as the first):";
+    if (key == "merge_type") return "Join:";
+    if (key == "merge_inner") return "Only rows with a match (inner)";
+    if (key == "merge_left_join") return "All rows of the first file (left)";
+    if (key == "merge_anti") return "Rows of the first file without a match (anti)";
+    if (key == "merge_output") return "Result file:";
+    if (key == "merge_progress") return "Merging files...";
+    if (key == "error_merge_input") return "Select two existing files, the key columns and a result file.";
+    if (key == "menu_duplicates") return "Find &Duplicates...";
+    if (key == "menu_duplicates_desc") return "Select or remove rows that repeat another row";
+    if (key == "dialog_duplicates_title") return "Duplicates";
+    if (key == "duplicates_columns") return "Columns to compare:";
+    if (key == "duplicates_keep") return "Keep";
+    if (key == "duplicates_keep_first") return "First copy";
+    if (key == "duplicates_keep_last") return "Last copy";
+    if (key == "duplicates_action") return "Action";
+    if (key == "duplicates_select") return "Select duplicates";
+    if (key == "duplicates_remove") return "Remove duplicates";
+    if (key == "msg_no_duplicates") return "No duplicates found.";
+    if (key == "msg_duplicates_selected") return "Duplicates selected: %d";
+    if (key == "msg_duplicates_removed") return "Duplicates removed: %d";
+    if (key == "error_duplicates_columns") return "Select at least one column.";
+    if (key == "menu_split") return "S&plit File...";
+    if (key == "menu_split_desc") return "Split a large CSV file into parts of a number of rows or megabytes";
+    if (key == "dialog_split_title") return "Split File";
+    if (key == "split_input") return "File to split:";
+    if (key == "split_size") return "At most per part:";
+    if (key == "split_rows") return "rows";
+    if (key == "split_megabytes") return "MB";
+    if (key == "split_output") return "Part name (_001, _002, ... is added):";
+    if (key == "split_progress") return "Splitting file...";
+    if (key == "msg_split_done") return "Parts written: %d (%d rows).";
+    if (key == "error_split_input") return "Select an existing file, a part size above zero and a part name.";
+    if (key == "menu_concat") return "Co&ncatenate Files...";
+    if (key == "menu_concat_desc") return "Append CSV files with the same columns into one";
+    if (key == "dialog_concat_title") return "Concatenate Files";
+    if (key == "concat_files") return "Files, in the order they are appended:";
+    if (key == "concat_add") return "Add...";
+    if (key == "concat_remove") return "Remove";
+    if (key == "concat_progress") return "Concatenating files...";
+    if (key == "error_concat_input") return "Add at least two existing files and select a result file.";
+    if (key == "menu_validate") return "&Validate File...";
+    if (key == "menu_validate_desc") return "Check a CSV file's structure and column values against a schema";
+    if (key == "dialog_validate_title") return "Validate File";
+    if (key == "validate_input") return "File to validate:";
+    if (key == "validate_schema") return "Schema (optional):";
+    if (key == "validate_report") return "Report of every issue (optional):";
+    if (key == "validate_progress") return "Validating file...";
+    if (key == "msg_validate_clean") return "No problems in %d rows.";
+    if (key == "msg_validate_issues") return "%d problems found in %d rows.";
+    if (key == "error_validate_input") return "Select an existing file and, optionally, an existing schema.";
+    if (key == "error_validate_report") return "Cannot write the report %s.";
+    if (key == "menu_open_folder") return "Open &Folder...";
+    if (key == "menu_open_folder_desc") return "Open every CSV file of a folder or pattern as one table";
+    if (key == "dialog_open_folder_title") return "Open Several Files";
+    if (key == "open_folder_folder") return "Folder:";
+    if (key == "open_folder_pattern") return "File name pattern (empty for every CSV and text file):";
+    if (key == "open_folder_progress") return "Loading %d files...";
+    if (key == "error_open_folder") return "No files match the folder and pattern.";
+    if (key == "prompt_open_as_one") return "Open the %d files as one table?\n\nChoose No to open each in its own tab.";
+    if (key == "prompt_open_as_one_title") return "Several Files";
+    if (key == "shards_file_column") return "File";
+    if (key == "menu_transform_column") return "Transform Column...";
+    if (key == "menu_transform_column_desc") return "Clean up a column: trim, change case, replace text, split it or convert the decimal mark";
+    if (key == "dialog_transform_title") return "Transform Column";
+    if (key == "transform_column") return "Column:";
+    if (key == "transform_operation") return "Operation:";
+    if (key == "transform_trim") return "Trim leading and trailing white space";
+    if (key == "transform_upper") return "Uppercase";
+    if (key == "transform_lower") return "Lowercase";
+    if (key == "transform_replace") return "Find and replace";
+    if (key == "transform_split") return "Split on a delimiter into new columns";
+    if (key == "transform_decimal_point") return "Decimal comma to decimal point (1.234,5 -> 1234.5)";
+    if (key == "transform_decimal_comma") return "Decimal point to decimal comma (1,234.5 -> 1234,5)";
+    if (key == "transform_find") return "Find / delimiter (\\t for tab):";
+    if (key == "transform_replace_with") return "Replace with:";
+    if (key == "transform_match_case") return "Match case";
+    if (key == "error_transform_find") return "Enter the text to find or the delimiter.";
+    if (key == "msg_transform_none") return "No cells were changed.";
+    if (key == "menu_view_cell") return "View Cell...";
+    if (key == "dialog_cell_viewer_title") return "Cell Contents";
+    if (key == "cell_viewer_info") return "Column %s, row %d, %d characters";
+    if (key == "cell_viewer_format_json") return "Format JSON";
+    if (key == "error_cell_viewer_json") return "The text is not a valid JSON object or array.";
+    if (key == "error_journal_write") return "Edits are no longer recorded for crash recovery (the disk is full or unavailable). Save the file to keep them.";
+    
     return key; // Return key if not found
 }
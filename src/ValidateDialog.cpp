@@ -0,0 +1,67 @@
+#include "ValidateDialog.h"
+
+wxBEGIN_EVENT_TABLE(ValidateDialog, wxDialog)
+    EVT_BUTTON(wxID_OK, ValidateDialog::OnOK)
+wxEND_EVENT_TABLE()
+
+ValidateDialog::ValidateDialog(wxWindow* parent, Language language, const wxString& inputFile)
+    : wxDialog(parent, wxID_ANY, Translate("dialog_validate_title", language), wxDefaultPosition, wxSize(500, 400)),
+      language(language) {
+    
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
+    wxString wildcard = "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*";
+    
+    // File to check, defaults to the active document
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("validate_input", language)), 0, wxALL, 5);
+    inputPicker = new wxFilePickerCtrl(this, wxID_ANY, inputFile, Translate("validate_input", language), wildcard,
+                                       wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(inputPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Header checkbox
+    headerCheckBox = new wxCheckBox(this, wxID_ANY, Translate("compare_header", language));
+    headerCheckBox->SetValue(true);
+    mainSizer->Add(headerCheckBox, 0, wxALL, 5);
+    
+    // Optional schema with the rules of each column
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("validate_schema", language)), 0, wxALL, 5);
+    schemaPicker = new wxFilePickerCtrl(this, wxID_ANY, wxEmptyString, Translate("validate_schema", language), wildcard,
+                                        wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(schemaPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Optional report with every issue, not only those listed
+    mainSizer->Add(new wxStaticText(this, wxID_ANY, Translate("validate_report", language)), 0, wxALL, 5);
+    reportPicker = new wxFilePickerCtrl(this, wxID_ANY, wxEmptyString, Translate("validate_report", language), wildcard,
+                                        wxDefaultPosition, wxDefaultSize, wxFLP_SAVE | wxFLP_OVERWRITE_PROMPT | wxFLP_USE_TEXTCTRL);
+    mainSizer->Add(reportPicker, 0, wxALL | wxEXPAND, 5);
+    
+    // Buttons
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALL | wxEXPAND, 10);
+    
+    SetSizer(mainSizer);
+    Centre();
+}
+
+void ValidateDialog::OnOK(wxCommandEvent& event) {
+    if (!wxFileExists(GetInputFile()) || (!GetSchemaFile().IsEmpty() && !wxFileExists(GetSchemaFile()))) {
+        wxMessageBox(Translate("error_validate_input", language), Translate("msg_error_title", language), wxOK | wxICON_ERROR);
+        return;
+    }
+    event.Skip();
+}
+
+wxString ValidateDialog::GetInputFile() const {
+    return inputPicker->GetPath();
+}
+
+bool ValidateDialog::GetHasHeader() const {
+    return headerCheckBox->GetValue();
+}
+
+wxString ValidateDialog::GetSchemaFile() const {
+    return schemaPicker->GetPath().Strip(wxString::both);
+}
+
+wxString ValidateDialog::GetReportFile() const {
+    return reportPicker->GetPath().Strip(wxString::both);
+}
@@ -0,0 +1,126 @@
+#include "WorkerPool.h"
+#include <atomic>
+#include <memory>
+
+namespace {
+
+// Shared between the caller and helper tasks of one ParallelFor. Helpers
+// may start after the caller has returned, so it is reference counted.
+struct ParallelJob {
+    std::function<void(size_t, size_t)> fn;
+    size_t count;
+    size_t chunkSize;
+    size_t chunkCount;
+    std::atomic<size_t> nextChunk;
+    std::atomic<size_t> doneChunks;
+    std::mutex mutex;
+    std::condition_variable finished;
+    
+    // Claim and run chunks until none are left
+    void Run() {
+        while (true) {
+            size_t chunk = nextChunk.fetch_add(1);
+            if (chunk >= chunkCount) {
+                return;
+            }
+            size_t begin = chunk * chunkSize;
+            size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+            fn(begin, end);
+            if (doneChunks.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace
+
+WorkerPool& WorkerPool::Get() {
+    static WorkerPool pool;
+    return pool;
+}
+
+WorkerPool::WorkerPool() : stopping(false) {
+    unsigned int count = std::thread::hardware_concurrency();
+    if (count < 2) {
+        count = 2;
+    }
+    // The calling thread always takes part, so start one worker less
+    for (unsigned int i = 0; i + 1 < count; ++i) {
+        threads.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    
+    // Aim for a few chunks per thread so uneven chunks balance out
+    size_t chunkSize = count / (GetThreadCount() * 4);
+    if (chunkSize < grain) {
+        chunkSize = grain;
+    }
+    size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1) {
+        fn(0, count);
+        return;
+    }
+    
+    auto job = std::make_shared<ParallelJob>();
+    job->fn = fn;
+    job->count = count;
+    job->chunkSize = chunkSize;
+    job->chunkCount = chunkCount;
+    job->nextChunk = 0;
+    job->doneChunks = 0;
+    
+    size_t helpers = chunkCount - 1 < threads.size() ? chunkCount - 1 : threads.size();
+    for (size_t i = 0; i < helpers; ++i) {
+        Submit([job] { job->Run(); });
+    }
+    
+    job->Run();
+    
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job] { return job->doneChunks.load() == job->chunkCount; });
+}
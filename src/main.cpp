@@ -1,15 +1,41 @@
 #include <wx/wx.h>
 #include "MainFrame.h"
+#include "CommandLine.h"
 
 class CSVApp : public wxApp {
 public:
+    CSVApp() : commandLineMode(false), exitCode(0) {}
+    
     virtual bool OnInit();
+    virtual int OnRun();
+    
+private:
+    bool commandLineMode;
+    int exitCode;
 };
 
 wxIMPLEMENT_APP(CSVApp);
 
 bool CSVApp::OnInit() {
+    // Subcommands run without opening a window
+    wxArrayString args;
+    for (int i = 1; i < argc; ++i) {
+        args.Add(argv[i]);
+    }
+    if (CommandLine::IsCommand(args)) {
+        commandLineMode = true;
+        exitCode = CommandLine::Run(args);
+        return true;
+    }
+    
     MainFrame* frame = new MainFrame("CSV++");
     frame->Show(true);
     return true;
 }
+
+int CSVApp::OnRun() {
+    if (commandLineMode) {
+        return exitCode;
+    }
+    return wxApp::OnRun();
+}
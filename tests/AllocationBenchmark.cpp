@@ -0,0 +1,88 @@
+#include "CSVParser.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "TestSupport.h"
+#include <wx/filename.h>
+#include <random>
+#include <vector>
+
+// Counts the heap allocations of saving and loading with the profiler's
+// allocation counter. The file repeats a generated corpus many times, so
+// the buffers the writer and the load pipeline reuse have long grown and
+// what is left per row is the steady state: mostly field strings that
+// outgrow the capacity they kept from an earlier row. Every scope is
+// listed with its allocations per row and per cell; a scope includes the
+// scopes nested in it on the same thread. Optional arguments: the seed and
+// the number of rows written.
+
+namespace {
+
+void Report(const char* phase, size_t rowCount, size_t colCount) {
+    printf("%s, %d rows\n", phase, (int)rowCount);
+    for (const ProfileStat& stat : Profiler::Get().GetStats()) {
+        printf("  %-24s %6d calls %10llu allocations %9.4f per row %9.5f per cell %9.1f bytes per row\n",
+               stat.name, (int)stat.calls, (unsigned long long)stat.allocations,
+               (double)stat.allocations / rowCount, (double)stat.allocations / (rowCount * colCount),
+               (double)stat.allocatedBytes / rowCount);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer;
+    if (!TestInitialized(initializer)) {
+        return 1;
+    }
+    std::mt19937 random(TestSeed(argc, argv, 41u));
+    size_t rowCount = argc > 2 ? (size_t)atol(argv[2]) : 2000000;
+    const size_t colCount = 8;
+    const wxChar separator = ',';
+    
+    // The written rows cycle through the corpus
+    std::vector<std::vector<wxString>> corpus = MakeCorpus(random, 100000, colCount);
+    wxString path = wxFileName::CreateTempFileName("csvpp");
+    
+    Profiler::Get().Reset();
+    Profiler::Get().SetEnabled(true);
+    bool written = CSVParser::WriteFile(path, rowCount,
+        [&corpus](size_t row, std::vector<wxString>& fields) {
+            fields = corpus[row % corpus.size()];
+        }, separator, Encoding::UTF8);
+    Profiler::Get().SetEnabled(false);
+    if (!written) {
+        printf("The corpus could not be written\n");
+        wxRemoveFile(path);
+        return 1;
+    }
+    Report("Save", rowCount, colCount);
+    
+    size_t loaded = 0;
+    {
+        MappedFile file;
+        if (!file.Open(path)) {
+            printf("The corpus could not be opened\n");
+            wxRemoveFile(path);
+            return 1;
+        }
+        
+        // The handler only counts, so the rows are what the pipeline allocated
+        CSVParser parser;
+        Encoding encoding = Encoding::UTF8;
+        Profiler::Get().Reset();
+        Profiler::Get().SetEnabled(true);
+        bool read = parser.ReadFile(file, encoding, separator,
+            [&loaded](std::vector<std::vector<wxString>>& rows, const std::vector<long long>&) {
+                loaded += rows.size();
+            });
+        Profiler::Get().SetEnabled(false);
+        if (!read || loaded != rowCount) {
+            ++failures;
+            printf("FAIL %d of %d rows loaded\n", (int)loaded, (int)rowCount);
+        }
+    }
+    Report("Load", rowCount, colCount);
+    
+    wxRemoveFile(path);
+    return FinishTest("allocation");
+}
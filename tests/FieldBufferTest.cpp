@@ -0,0 +1,85 @@
+#include "CSVParser.h"
+#include "TestSupport.h"
+#include <random>
+#include <vector>
+
+// Parses lines into one field buffer kept across lines and formats rows
+// into one output string kept across rows, the way the loader and the
+// writer reuse them. Each result is compared with a fresh reference, so
+// strings left over from a longer earlier line or row show up as a
+// difference.
+
+namespace {
+
+// Selected columns of the reference, missing ones empty
+std::vector<wxString> SelectReference(const std::vector<wxString>& fields, const std::vector<int>& columns) {
+    std::vector<wxString> selected;
+    for (int col : columns) {
+        selected.push_back((size_t)col < fields.size() ? fields[col] : wxString());
+    }
+    return selected;
+}
+
+void Compare(const char* what, int round, const wxString& input,
+             const std::vector<wxString>& expected, const std::vector<wxString>& actual) {
+    if (actual != expected) {
+        ++failures;
+        printf("FAIL %s, round %d, on \"%s\"\n  expected %s\n  got      %s\n", what, round,
+               (const char*)Printable(input).ToUTF8(), (const char*)Printable(expected).ToUTF8(),
+               (const char*)Printable(actual).ToUTF8());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer;
+    if (!TestInitialized(initializer)) {
+        return 1;
+    }
+    std::mt19937 random(TestSeed(argc, argv, 39u));
+    const wxChar separator = ',';
+    
+    // Lines of varying width parsed into the same buffer, all columns and
+    // a selection of them
+    std::vector<wxString> fields;
+    std::vector<wxString> selected;
+    for (int round = 0; round < 5000 && failures < 10; ++round) {
+        wxString line = RandomText(random, "ab,,\"\"\r\n", round % 3 == 0 ? 80 : 12);
+        std::vector<wxString> expected = SplitFieldsReference(line, separator);
+        CSVParser::ParseLine(line, separator, fields);
+        Compare("ParseLine", round, line, expected, fields);
+        
+        std::vector<int> columns;
+        for (int col = 0; col < 8; ++col) {
+            if (random() % 2) {
+                columns.push_back(col);
+            }
+        }
+        if (!columns.empty()) {
+            CSVParser::ParseLine(line, separator, selected, columns);
+            Compare("ParseLine with columns", round, line, SelectReference(expected, columns), selected);
+        }
+    }
+    
+    // Rows of varying width formatted into the same string and parsed back.
+    // Long fields cross the blocks FindSpecial scans at once.
+    wxString out;
+    std::vector<wxString> parsed;
+    for (int round = 0; round < 5000 && failures < 10; ++round) {
+        std::vector<wxString> row(1 + random() % 6);
+        for (wxString& field : row) {
+            field = RandomText(random, "abcdefgh ,\"\r\n;", random() % 4 == 0 ? 70 : 10);
+        }
+        out.clear();
+        CSVParser::AppendLine(out, row, separator);
+        if (out != CSVParser::FormatLine(row, separator)) {
+            ++failures;
+            printf("FAIL AppendLine differs from FormatLine, round %d\n", round);
+        }
+        CSVParser::ParseLine(out, separator, parsed);
+        Compare("AppendLine then ParseLine", round, out, row, parsed);
+    }
+    
+    return FinishTest("field buffer");
+}
@@ -0,0 +1,91 @@
+#include "CSVParser.h"
+#include "MappedFile.h"
+#include "TestSupport.h"
+#include <wx/filename.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Writes a generated corpus with the streaming writer, loads it back
+// through the parallel load pipeline and reports both rates. The corpus
+// mixes plain fields with the quotes, separators and line breaks of the
+// random test cases, so quoted records are timed too. Every loaded row is
+// compared with the written one. Optional arguments: the seed and the
+// number of rows.
+
+namespace {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Run(const wxString& path, const std::vector<std::vector<wxString>>& corpus, Encoding encoding,
+         const char* name) {
+    const wxChar separator = ',';
+    auto start = std::chrono::steady_clock::now();
+    bool written = CSVParser::WriteFile(path, corpus.size(),
+        [&corpus](size_t row, std::vector<wxString>& fields) {
+            fields = corpus[row];
+        }, separator, encoding);
+    double writeSeconds = SecondsSince(start);
+    if (!written) {
+        ++failures;
+        printf("FAIL %s: the corpus could not be written\n", name);
+        return;
+    }
+    
+    MappedFile file;
+    if (!file.Open(path)) {
+        ++failures;
+        printf("FAIL %s: the corpus could not be opened\n", name);
+        return;
+    }
+    double megabytes = file.GetSize() / (1024.0 * 1024.0);
+    
+    CSVParser parser;
+    size_t loaded = 0;
+    size_t differing = 0;
+    start = std::chrono::steady_clock::now();
+    bool read = parser.ReadFile(file, encoding, separator,
+        [&](std::vector<std::vector<wxString>>& rows, const std::vector<long long>&) {
+            for (const std::vector<wxString>& row : rows) {
+                if (loaded >= corpus.size() || row != corpus[loaded]) {
+                    if (differing++ == 0) {
+                        printf("FAIL %s: row %d loads as %s\n", name, (int)loaded,
+                               (const char*)Printable(row).ToUTF8());
+                    }
+                }
+                ++loaded;
+            }
+        });
+    double readSeconds = SecondsSince(start);
+    if (!read || loaded != corpus.size() || differing > 0) {
+        ++failures;
+        printf("FAIL %s: %d of %d rows loaded, %d differ\n", name, (int)loaded,
+               (int)corpus.size(), (int)differing);
+        return;
+    }
+    
+    printf("%-9s %8.1f MB  save %7.3f s %8.1f MB/s  load %7.3f s %8.1f MB/s\n", name, megabytes,
+           writeSeconds, megabytes / writeSeconds, readSeconds, megabytes / readSeconds);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer;
+    if (!TestInitialized(initializer)) {
+        return 1;
+    }
+    std::mt19937 random(TestSeed(argc, argv, 37u));
+    size_t rowCount = argc > 2 ? (size_t)atol(argv[2]) : 500000;
+    
+    std::vector<std::vector<wxString>> corpus = MakeCorpus(random, rowCount, 8);
+    printf("%d rows of %d columns\n", (int)rowCount, 8);
+    
+    wxString path = wxFileName::CreateTempFileName("csvpp");
+    Run(path, corpus, Encoding::UTF8, "UTF-8");
+    Run(path, corpus, Encoding::UTF16_LE, "UTF-16LE");
+    wxRemoveFile(path);
+    return FinishTest("load and save");
+}
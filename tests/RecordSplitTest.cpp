@@ -0,0 +1,136 @@
+#include "CSVParser.h"
+#include "MappedFile.h"
+#include "TestSupport.h"
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// Splits records with CSVParser and compares them against a plain state
+// machine written from the rules: a CR, LF or CRLF ends a record only
+// outside quotes, a doubled quote inside quotes is one quote, and an
+// unterminated quote runs to the end of the file. Fixed cases cover the
+// edge cases by name, random inputs built from the characters that matter
+// cover the rest.
+
+namespace {
+
+typedef std::vector<wxString> Record;
+
+// Each byte widened to one UTF-16 code unit, the inputs are ASCII
+std::string ToUtf16(const std::string& data, Encoding encoding) {
+    std::string out;
+    for (char c : data) {
+        if (encoding == Encoding::UTF16_LE) {
+            out += c;
+            out += '\0';
+        } else {
+            out += '\0';
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool SplitWithParser(const wxString& path, const std::string& bytes, Encoding encoding,
+                     char separator, std::vector<Record>& records) {
+    records.clear();
+    {
+        wxFile out;
+        if (!out.Create(path, true) || (!bytes.empty() && out.Write(bytes.data(), bytes.size()) != bytes.size())) {
+            return false;
+        }
+    }
+    
+    MappedFile file;
+    if (!bytes.empty() && !file.Open(path)) {
+        return false;
+    }
+    size_t pos = 0;
+    std::vector<std::pair<size_t, size_t>> spans;
+    if (!bytes.empty()) {
+        CSVParser::FindRecords(file, pos, encoding, (size_t)-1, spans);
+    }
+    
+    Record fields;
+    for (const auto& span : spans) {
+        if (!CSVParser::ParseRecordAt(file, span.first, span.second, encoding, separator, fields)) {
+            return false;
+        }
+        records.push_back(fields);
+    }
+    return true;
+}
+
+wxString Describe(const std::vector<Record>& records) {
+    wxString out;
+    for (const Record& record : records) {
+        out += Printable(record);
+    }
+    return out;
+}
+
+void Check(const wxString& path, const std::string& name, const std::string& data) {
+    const Encoding encodings[] = {Encoding::UTF8, Encoding::UTF16_LE, Encoding::UTF16_BE};
+    std::vector<Record> expected = SplitRecordsReference(wxString::FromUTF8(data.data(), data.size()), ',');
+    for (Encoding encoding : encodings) {
+        std::string bytes = encoding == Encoding::UTF8 ? data : ToUtf16(data, encoding);
+        std::vector<Record> actual;
+        bool ok = SplitWithParser(path, bytes, encoding, ',', actual);
+        if (!ok || Describe(actual) != Describe(expected)) {
+            ++failures;
+            printf("FAIL %s (encoding %d) on \"%s\"\n  expected %s\n  got      %s\n", name.c_str(),
+                   (int)encoding, (const char*)Printable(wxString::FromUTF8(data.data(), data.size())).ToUTF8(),
+                   (const char*)Describe(expected).ToUTF8(),
+                   ok ? (const char*)Describe(actual).ToUTF8() : "(read failed)");
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer;
+    if (!TestInitialized(initializer)) {
+        return 1;
+    }
+    wxString path = wxFileName::CreateTempFileName("csvpp");
+    
+    Check(path, "plain LF", "a,b\nc,d\n");
+    Check(path, "plain CRLF", "a,b\r\nc,d\r\n");
+    Check(path, "plain CR", "a,b\rc,d\r");
+    Check(path, "no final break", "a,b\nc,d");
+    Check(path, "empty lines", "a\n\n\nb");
+    Check(path, "LF in quotes", "1,\"x\ny\",2\n3,4\n");
+    Check(path, "CRLF in quotes", "1,\"x\r\ny\",2\r\n3,4\r\n");
+    Check(path, "CR in quotes", "1,\"x\ry\",2\r3,4\r");
+    Check(path, "several breaks in quotes", "\"a\n\n\r\nb\"\nc");
+    Check(path, "doubled quotes", "\"say \"\"hi\"\"\",2\n");
+    Check(path, "doubled quotes around break", "\"\"\"\n\"\"\",x\ny");
+    Check(path, "empty quoted field", "\"\",\"\"\n\"\"\n");
+    Check(path, "quote inside unquoted field", "ab\"c\nd\"e\nf");
+    Check(path, "unterminated quote", "a,\"b\nc,d\ne");
+    Check(path, "unterminated quote ending in LF", "a,\"b\nc\n");
+    Check(path, "unterminated quote ending in CRLF", "a,\"b\r\nc\r\n");
+    Check(path, "unterminated quote ending in CR", "a,\"b\rc\r");
+    Check(path, "only a quote", "\"");
+    Check(path, "only a break", "\n");
+    Check(path, "empty file", "");
+    
+    // Random inputs from the characters record splitting looks at
+    const char alphabet[] = {'a', 'b', ',', '"', '"', '\r', '\n'};
+    std::mt19937 random(TestSeed(argc, argv, 31u));
+    std::uniform_int_distribution<size_t> length(0, 24);
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+    for (int round = 0; round < 2000 && failures < 10; ++round) {
+        std::string data(length(random), ' ');
+        for (char& c : data) {
+            c = alphabet[pick(random)];
+        }
+        Check(path, "random " + std::to_string(round), data);
+    }
+    
+    wxRemoveFile(path);
+    return FinishTest("record splitting");
+}
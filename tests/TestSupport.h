@@ -0,0 +1,143 @@
+#ifndef TESTSUPPORT_H
+#define TESTSUPPORT_H
+
+#include <wx/wx.h>
+#include <wx/init.h>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Shared by the console programs in tests\. Each compares CSVParser with a
+// reference written from the rules, counts the cases that differ and exits
+// with 1 when any did. An optional first argument seeds the random cases.
+
+// Cases that differed so far
+inline int failures = 0;
+
+// False, after saying so, when wxWidgets could not be set up
+inline bool TestInitialized(const wxInitializer& initializer) {
+    if (!initializer.IsOk()) {
+        printf("wxWidgets could not be initialised\n");
+        return false;
+    }
+    return true;
+}
+
+// Report the failures and return the exit code
+inline int FinishTest(const char* what) {
+    if (failures > 0) {
+        printf("%d case(s) failed\n", failures);
+        return 1;
+    }
+    printf("All %s cases passed\n", what);
+    return 0;
+}
+
+inline unsigned int TestSeed(int argc, char** argv, unsigned int seed) {
+    return argc > 1 ? (unsigned int)atoi(argv[1]) : seed;
+}
+
+// Line breaks shown escaped
+inline wxString Printable(const wxString& text) {
+    wxString out = text;
+    out.Replace("\r", "\\r");
+    out.Replace("\n", "\\n");
+    return out;
+}
+
+inline wxString Printable(const std::vector<wxString>& fields) {
+    wxString out;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        out += (i > 0 ? "|" : "") + Printable(fields[i]);
+    }
+    return "[" + out + "]";
+}
+
+// The reference splitter, one character at a time from pos. A doubled quote
+// inside quotes is one quote. With breaksEnd a CR, LF or CRLF outside quotes
+// ends the record and pos moves past it, and an unterminated quote keeps its
+// line breaks except the one ending the text. Without, line breaks are
+// field content.
+inline std::vector<wxString> SplitReference(const wxString& text, size_t& pos, wxChar separator,
+                                            bool breaksEnd) {
+    std::vector<wxString> fields(1);
+    bool inQuotes = false;
+    bool ended = false;
+    size_t breakStart = wxString::npos;   // in the last field, of a quoted line break ending the text
+    size_t size = text.length();
+    for (; pos < size; ++pos) {
+        wxChar c = text[pos];
+        if (c == '"') {
+            if (inQuotes && pos + 1 < size && text[pos + 1] == '"') {
+                fields.back() += '"';
+                ++pos;
+            } else {
+                inQuotes = !inQuotes;
+            }
+        } else if (c == separator && !inQuotes) {
+            fields.emplace_back();
+        } else if (breaksEnd && (c == '\r' || c == '\n')) {
+            size_t length = (c == '\r' && pos + 1 < size && text[pos + 1] == '\n') ? 2 : 1;
+            if (!inQuotes) {
+                pos += length;
+                ended = true;
+                break;
+            }
+            breakStart = pos + length == size ? fields.back().length() : wxString::npos;
+            fields.back() += text.Mid(pos, length);
+            pos += length - 1;
+        } else {
+            fields.back() += c;
+        }
+    }
+    
+    if (!ended && inQuotes && breakStart != wxString::npos) {
+        fields.back().resize(breakStart);
+    }
+    return fields;
+}
+
+// The fields of one line, as ParseLine splits it
+inline std::vector<wxString> SplitFieldsReference(const wxString& line, wxChar separator) {
+    size_t pos = 0;
+    return SplitReference(line, pos, separator, false);
+}
+
+// The records of a whole file, as the loader splits it
+inline std::vector<std::vector<wxString>> SplitRecordsReference(const wxString& data, wxChar separator) {
+    std::vector<std::vector<wxString>> records;
+    size_t pos = 0;
+    while (pos < data.length()) {
+        records.push_back(SplitReference(data, pos, separator, true));
+    }
+    return records;
+}
+
+inline wxString RandomText(std::mt19937& random, const wxString& alphabet, size_t maxLength) {
+    size_t length = random() % (maxLength + 1);
+    wxString text;
+    for (size_t i = 0; i < length; ++i) {
+        text += alphabet[random() % alphabet.length()];
+    }
+    return text;
+}
+
+// Rows for the benchmarks: mostly plain text and numbers, with quotes,
+// separators and line breaks in some fields as in the random test cases
+inline std::vector<std::vector<wxString>> MakeCorpus(std::mt19937& random, size_t rowCount, size_t colCount) {
+    std::vector<std::vector<wxString>> rows(rowCount, std::vector<wxString>(colCount));
+    for (std::vector<wxString>& row : rows) {
+        for (size_t col = 0; col < colCount; ++col) {
+            if (col == 0) {
+                row[col] = wxString::Format("%u", (unsigned int)random());
+            } else if (random() % 8 == 0) {
+                row[col] = RandomText(random, "ab ,\"\r\n", 24);
+            } else {
+                row[col] = RandomText(random, "abcdefghijklmnopqrstuvwxyz ", 16);
+            }
+        }
+    }
+    return rows;
+}
+
+#endif // TESTSUPPORT_H